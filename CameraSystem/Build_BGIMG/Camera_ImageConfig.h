@@ -7,16 +7,18 @@
 #ifndef _IMAGE_CONFIG_H_
 #define _IMAGE_CONFIG_H_
 
-// Menu_MM图像配置 (Menu_MM.png)
-#define MENU_MM_IMAGE_DATA MENU_MM_PIC
-#define MENU_MM_IMAGE_SIZE sizeof(MENU_MM_PIC)
-#define MENU_MM_IMAGE_WIDTH MENU_MM_WIDTH
-#define MENU_MM_IMAGE_HEIGHT MENU_MM_HEIGHT
+// MM图像配置 (MM.png)
+#define MM_IMAGE_DATA MM_RLE
+#define MM_IMAGE_SIZE sizeof(MM_RLE)
+#define MM_IMAGE_WIDTH MM_WIDTH
+#define MM_IMAGE_HEIGHT MM_HEIGHT
+#define MM_IMAGE_RLE 1
 
-// Menu_SM图像配置 (Menu_SM.png)
-#define MENU_SM_IMAGE_DATA MENU_SM_PIC
-#define MENU_SM_IMAGE_SIZE sizeof(MENU_SM_PIC)
-#define MENU_SM_IMAGE_WIDTH MENU_SM_WIDTH
-#define MENU_SM_IMAGE_HEIGHT MENU_SM_HEIGHT
+// SM图像配置 (SM.png)
+#define SM_IMAGE_DATA SM_RLE
+#define SM_IMAGE_SIZE sizeof(SM_RLE)
+#define SM_IMAGE_WIDTH SM_WIDTH
+#define SM_IMAGE_HEIGHT SM_HEIGHT
+#define SM_IMAGE_RLE 1
 
 #endif // _IMAGE_CONFIG_H_
\ No newline at end of file
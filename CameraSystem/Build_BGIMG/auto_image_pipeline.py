@@ -3,6 +3,7 @@
 """
 图片处理全自动流水线
 自动搜索.png图片 → 自动转换格式 → 自动生成配置文件
+默认生成RLE压缩的大端数据（*_RLE），运行时加--raw生成未压缩数据（*_PIC）
 """
 
 import os
@@ -39,6 +40,9 @@ def scan_png_files():
     return png_files
 
 
+RAW_MODE = "--raw" in sys.argv
+
+
 def convert_images(png_files):
     """使用convert_image.py转换图片为.h文件"""
     print("\n" + "=" * 50)
@@ -57,7 +61,8 @@ def convert_images(png_files):
         try:
             # 使用shell=True和正确的编码处理
             result = subprocess.run(
-                f'python convert_image.py "{png_file}" "{h_file}"',
+                f'python convert_image.py "{png_file}" "{h_file}"'
+                + (" --raw" if RAW_MODE else ""),
                 shell=True,
                 capture_output=True,
                 text=True,
@@ -77,6 +82,7 @@ def convert_images(png_files):
                         if (
                             "Image size:" in line
                             or "Generated variable names:" in line
+                            or "RLE:" in line
                             or "Successfully converted" in line
                         ):
                             print(f"   {line}")
@@ -96,8 +102,14 @@ def generate_config(h_files):
     print("\n" + "=" * 50)
     print("开始生成配置文件...")
 
-    # 提取图片名称（不含扩展名）
-    image_names = [os.path.splitext(file)[0] for file in h_files]
+    # 提取图片名称（不含扩展名和Menu_前缀，与convert_image.py生成的变量名一致）
+    image_names = []
+    for file in h_files:
+        name = os.path.splitext(file)[0]
+        if name.startswith("Menu_"):
+            name = name[5:]
+        image_names.append(name)
+    data_suffix = "PIC" if RAW_MODE else "RLE"
 
     config_content = """/*
  * Camera_ImageConfig.h - 图像配置头文件
@@ -114,10 +126,11 @@ def generate_config(h_files):
     for name in image_names:
         prefix = name.upper()
         config_content += f"""// {name}图像配置 ({name}.png)
-#define {prefix}_IMAGE_DATA {prefix}_PIC
-#define {prefix}_IMAGE_SIZE sizeof({prefix}_PIC)
+#define {prefix}_IMAGE_DATA {prefix}_{data_suffix}
+#define {prefix}_IMAGE_SIZE sizeof({prefix}_{data_suffix})
 #define {prefix}_IMAGE_WIDTH {prefix}_WIDTH
 #define {prefix}_IMAGE_HEIGHT {prefix}_HEIGHT
+#define {prefix}_IMAGE_RLE {0 if RAW_MODE else 1}
 
 """
 
@@ -131,8 +144,8 @@ def generate_config(h_files):
     print("\n生成的宏定义:")
     for name in image_names:
         prefix = name.upper()
-        print(f"  • {prefix}_IMAGE_DATA -> {prefix}_PIC")
-        print(f"  • {prefix}_IMAGE_SIZE -> sizeof({prefix}_PIC)")
+        print(f"  • {prefix}_IMAGE_DATA -> {prefix}_{data_suffix}")
+        print(f"  • {prefix}_IMAGE_SIZE -> sizeof({prefix}_{data_suffix})")
         print(f"  • {prefix}_IMAGE_WIDTH -> {prefix}_WIDTH")
         print(f"  • {prefix}_IMAGE_HEIGHT -> {prefix}_HEIGHT")
 
@@ -8,6 +8,76 @@ def rgb_to_rgb565(r, g, b):
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
 
 
+# RLE控制字：最高位为1表示重复段（下一个字重复count次），为0表示字面段（后面count个字原样输出），
+# 低15位为count-1，格式与examples/Camera/Display_RleDecoder.h一致
+RLE_RUN_FLAG = 0x8000
+RLE_MAX_COUNT = 0x8000
+RLE_MIN_RUN = 3  # 少于3个相同像素按字面段保存更短
+
+
+def swap_bytes(value):
+    """RGB565交换为大端（ST7789发送顺序），显示时不再逐像素交换"""
+    return ((value & 0xFF) << 8) | (value >> 8)
+
+
+def rle_encode(pixels):
+    """RLE压缩像素序列，返回16位字列表"""
+    words = []
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:RLE_MAX_COUNT]
+            del literal[:RLE_MAX_COUNT]
+            words.append(len(chunk) - 1)
+            words.extend(chunk)
+
+    i = 0
+    count = len(pixels)
+    while i < count:
+        j = i + 1
+        while j < count and pixels[j] == pixels[i] and j - i < RLE_MAX_COUNT:
+            j += 1
+        if j - i >= RLE_MIN_RUN:
+            flush_literal()
+            words.append(RLE_RUN_FLAG | (j - i - 1))
+            words.append(pixels[i])
+            i = j
+        else:
+            literal.append(pixels[i])
+            i += 1
+    flush_literal()
+    return words
+
+
+def rle_decode(words):
+    """解压验证用"""
+    pixels = []
+    pos = 0
+    while pos < len(words):
+        ctrl = words[pos]
+        count = (ctrl & 0x7FFF) + 1
+        if ctrl & RLE_RUN_FLAG:
+            pixels.extend([words[pos + 1]] * count)
+            pos += 2
+        else:
+            pixels.extend(words[pos + 1 : pos + 1 + count])
+            pos += 1 + count
+    return pixels
+
+
+def write_words(f, words):
+    """每行写入16个16位值"""
+    for i, value in enumerate(words):
+        if i % 16 == 0:
+            f.write("    ")
+        f.write(f"0x{value:04X}")
+        if i < len(words) - 1:
+            f.write(", ")
+        if i % 16 == 15 or i == len(words) - 1:
+            f.write("\n")
+
+
 def validate_color_conversion():
     """颜色转换验证逻辑"""
     test_colors = [
@@ -24,7 +94,7 @@ def validate_color_conversion():
         print(f"RGB({r:3d},{g:3d},{b:3d}) -> 0x{rgb565:04X}")
 
 
-def convert_image_to_header(input_path, output_path):
+def convert_image_to_header(input_path, output_path, compress=True):
     try:
         # 打开图片文件
         img = Image.open(input_path)
@@ -48,7 +118,7 @@ def convert_image_to_header(input_path, output_path):
         var_prefix = filename_without_ext.upper()
         width_var = f"{var_prefix}_WIDTH"
         height_var = f"{var_prefix}_HEIGHT"
-        pic_var = f"{var_prefix}_PIC"
+        pic_var = f"{var_prefix}_RLE" if compress else f"{var_prefix}_PIC"
         header_guard = f"_{var_prefix}_H_"
 
         print(f"Generated variable names:")
@@ -85,30 +155,34 @@ def convert_image_to_header(input_path, output_path):
             # 添加图片尺寸定义
             f.write(f"const uint16_t {width_var} = {width};\n")
             f.write(f"const uint16_t {height_var} = {height};\n\n")
-            f.write(f"const uint16_t {pic_var}[{width * height}] PROGMEM = {{\n")
 
             # 处理每个像素 - 修复颜色转换公式
-            pixels = list(img.getdata())
-            for i, (r, g, b) in enumerate(pixels):
+            pixels = []
+            for i, (r, g, b) in enumerate(img.getdata()):
                 # 修正RGB565转换公式 (使用标准位移操作)
                 rgb565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
 
                 # 调试输出前10个像素值
                 if i < 10:
                     print(f"Pixel {i}: RGB({r},{g},{b}) -> RGB565 0x{rgb565:04X}")
-
-                # 每行写入16个像素值
-                if i % 16 == 0:
-                    f.write("    ")
-
-                # 写入像素值
-                f.write(f"0x{rgb565:04X}")
-                if i < len(pixels) - 1:
-                    f.write(", ")
-
-                # 换行
-                if i % 16 == 15 or i == len(pixels) - 1:
-                    f.write("\n")
+                pixels.append(rgb565)
+
+            if compress:
+                # 大端RGB565后RLE压缩，由Display_RleDecoder分段解压直接送显
+                big_endian = [swap_bytes(p) for p in pixels]
+                words = rle_encode(big_endian)
+                if rle_decode(words) != big_endian:
+                    raise ValueError("RLE压缩校验失败")
+                raw_size = len(pixels) * 2
+                rle_size = len(words) * 2
+                print(f"RLE: {raw_size} -> {rle_size} bytes ({rle_size * 100.0 / raw_size:.1f}%)")
+
+                f.write(f"// RLE压缩的大端RGB565（ST7789发送顺序），原始{raw_size}字节，压缩后{rle_size}字节\n")
+                f.write(f"const uint16_t {pic_var}[{len(words)}] PROGMEM = {{\n")
+                write_words(f, words)
+            else:
+                f.write(f"const uint16_t {pic_var}[{width * height}] PROGMEM = {{\n")
+                write_words(f, pixels)
 
             # 写入文件尾
             f.write("};\n\n")
@@ -125,11 +199,13 @@ if __name__ == "__main__":
     # 在脚本启动时自动运行颜色校验
     validate_color_conversion()
 
-    if len(sys.argv) != 3:
-        print("Usage: python convert_image.py input.png output.h")
+    args = [arg for arg in sys.argv[1:] if arg != "--raw"]
+    if len(args) != 2:
+        print("Usage: python convert_image.py input.png output.h [--raw]")
+        print("  默认输出RLE压缩的大端数据，--raw输出未压缩的小端数据")
         sys.exit(1)
 
-    input_file = sys.argv[1]
-    output_file = sys.argv[2]
+    input_file = args[0]
+    output_file = args[1]
 
-    convert_image_to_header(input_file, output_file)
+    convert_image_to_header(input_file, output_file, "--raw" not in sys.argv)
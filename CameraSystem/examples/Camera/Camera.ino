@@ -86,6 +86,9 @@
  * | TASK_TIME_SYNC    | 后台校时          | 1      | 2048    |
  * | TASK_AUDIO_PROCESSING | 音频处理       | 4      | 2048    |
  * | TASK_VIDEO_FRAME_CAPTURE | 视频帧获取 | 5      | 2048    |
+ * | TASK_AVI_WRITER   | AVI写入           | 3      | 4096    |
+ * | TASK_LOOP_FINALIZER | 循环录制分段收尾 | 2      | 4096    |
+ * | TASK_PLAYBACK_READER | 回放预取        | 3      | 4096    |
  *
  * =============================================================================
  * 模块化架构
@@ -172,6 +175,7 @@
 #include "Utils_Logger.h"
 #include "Utils_Timer.h"
 #include "Utils_BufferManager.h"
+#include "Utils_JpegDecoderPool.h"
 
 // 模块化移植：阶段三 - 显示模块头文件
 #include "Display_TFTManager.h"
@@ -274,7 +278,6 @@ DS3231_Time currentTime;
 // 任务函数现在在RTOS_TaskFactory.cpp中实现
 
 MenuManager menuManager(tftManager);
-JPEGDEC jpeg;
 
 // 初始化SD卡管理器实例
 SDCardManager sdCardManager;
@@ -309,6 +312,34 @@ int JPEGDraw(JPEGDRAW *pDraw) {
     return 1;
 }
 
+#if JPEG_DSP_SELFTEST_ENABLED
+// DWT周期计数器（Cortex-M33），供JPEG DSP内核自检测量耗时
+static uint32_t readCycleCounter() {
+    return *(volatile uint32_t*)0xE0001004;  // DWT_CYCCNT
+}
+
+/**
+ * JPEG DSP内核自检：逐位比较DSP内核与C查表实现的输出，并记录两者的周期数
+ */
+static void runJpegDspSelfTest() {
+    *(volatile uint32_t*)0xE000EDFC |= (1UL << 24);  // DEMCR.TRCENA
+    *(volatile uint32_t*)0xE0001000 |= 1UL;          // DWT_CTRL.CYCCNTENA
+
+    JPEGDSPSTATS stats;
+    int result = JPEGDEC::dspSelfTest(&stats, readCycleCounter);
+    if (result < 0) {
+        Utils_Logger::info("JPEG DSP内核未启用（未定义__ARM_FEATURE_DSP），使用C查表实现");
+    } else if (result == 0) {
+        Utils_Logger::info("JPEG DSP内核自检通过: %d个输出与C实现一致", stats.iPixelsChecked);
+        Utils_Logger::info("JPEG DSP内核耗时(C/DSP周期): 像素转换 %u/%u, IDCT输出 %u/%u",
+                          stats.u32PixelRefCycles, stats.u32PixelDspCycles,
+                          stats.u32IDCTRefCycles, stats.u32IDCTDspCycles);
+    } else {
+        Utils_Logger::error("JPEG DSP内核自检失败: %d/%d个输出与C实现不一致", stats.iMismatches, stats.iPixelsChecked);
+    }
+}
+#endif
+
 void setup() {
     // 初始化串口
     Serial.begin(115200);
@@ -344,6 +375,7 @@ void setup() {
     // 初始化工具模块
     Utils_Logger::init(Utils_Logger::LEVEL_INFO);
     Utils_BufferManager::init();
+    Utils_JpegDecoderPool::init();
     
 
     
@@ -364,6 +396,10 @@ void setup() {
     Utils_Logger::info("\n=== AMB82-MINI相机控制系统启动 ===");
     Utils_Logger::info("当前版本: %s", SYSTEM_VERSION_STRING);
     Utils_Logger::info("使用16x16点阵字库显示提示文字");
+
+#if JPEG_DSP_SELFTEST_ENABLED
+    runJpegDspSelfTest();
+#endif
     
     // 初始化TFT屏幕（使用TFT管理器）
     tftManager.setBacklight(true);
@@ -417,7 +453,7 @@ void setup() {
     
     // 模块化移植：阶段五 - 初始化相机管理器
     Utils_Logger::info("初始化相机管理器...");
-    if (!cameraManager.init(tftManager, fontRenderer, jpeg)) {
+    if (!cameraManager.init(tftManager, fontRenderer)) {
         Utils_Logger::error("相机管理器初始化失败!");
         while(1);
     }
@@ -472,6 +508,9 @@ void setup() {
     TaskFactory::registerTask(TaskManager::TASK_TIME_SYNC, "TimeSync", taskTimeSync, 2048, 1); // 注册后台校时任务
     TaskFactory::registerTask(TaskManager::TASK_AUDIO_PROCESSING, "AudioProcessing", taskAudioProcessing, 2048, 4); // 注册音频处理任务（优先级4）
     TaskFactory::registerTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE, "VideoFrameCapture", taskVideoFrameCapture, 2048, 5); // 注册视频帧获取任务（优先级5）
+    TaskFactory::registerTask(TaskManager::TASK_AVI_WRITER, "AVIWriter", taskAviWriter, 4096, 3); // 注册AVI写入任务（优先级3）
+    TaskFactory::registerTask(TaskManager::TASK_LOOP_FINALIZER, "LoopFinalizer", taskLoopFinalizer, 4096, 2); // 注册循环录制分段收尾任务（优先级2）
+    TaskFactory::registerTask(TaskManager::TASK_PLAYBACK_READER, "PlaybackReader", taskPlaybackReader, 4096, 3); // 注册回放预取任务（优先级3）
     /*
     // 创建后台校时任务
     Utils_Logger::info("创建后台校时任务...");
@@ -646,7 +685,11 @@ void loop() {
     if (StateManager::getInstance().getCurrentState() == STATE_MAIN_MENU || 
         StateManager::getInstance().getCurrentState() == STATE_SUB_MENU) {
         encoder.checkButton();
+        // 旋转导航的菜单重绘先写入影子帧缓冲区，处理完后只发送变化的区域
+        // （按钮操作可能启动任务或阻塞等待，仍直接送显）
+        tftManager.beginFrame();
         encoder.checkRotation();
+        tftManager.flush();
     }
     
     // DS3231时间读取与计数功能控制开关
@@ -662,7 +705,9 @@ void loop() {
 
                 // 如果时间同步窗口正在显示，更新窗口内容
                 if (menuContext.isInTimeSyncWindow()) {
+                    tftManager.beginFrame();
                     menuContext.updateTimeSyncWindow();
+                    tftManager.flush();
                 }
             } else {
                 timeCounter++;
@@ -13,9 +13,6 @@
 extern VideoSetting configPreview;
 extern VideoSetting configStill;
 
-// 静态指针，用于JPEGDraw回调访问TFTManager
-static Display_TFTManager* s_tftManagerForJPEG = nullptr;
-
 // 预览画面显示区域配置（默认值，可通过setPreviewDisplayMode动态修改）
 static int s_previewDisplayWidth = 320;     // 屏幕上的显示宽度（默认全屏，旋转后屏幕宽320）
 static const int PREVIEW_DISPLAY_HEIGHT = 240;   // 屏幕上的显示高度
@@ -23,63 +20,8 @@ static const int FULL_SCREEN_WIDTH = 320;        // 全屏模式宽度（旋转
 static const int PANEL_MODE_WIDTH = 195;         // 参数设置面板模式宽度（与PANEL_X对齐，右侧留空间给面板）
 static const int MCU_BLOCK_SIZE = 16;             // MCU块大小
 
-// 帧缓冲区 - 使用最大尺寸（全屏）分配
+// 帧缓冲区 - 使用最大尺寸（全屏）分配，解码时通过m_previewTarget写入
 static uint16_t s_frameBuffer[FULL_SCREEN_WIDTH * PREVIEW_DISPLAY_HEIGHT];
-static bool s_frameBufferReady = false;
-
-// JPEGDraw回调函数 - 将MCU块写入帧缓冲区（使用动态宽度）
-static int CameraManager_JPEGDraw(JPEGDRAW *pDraw) {
-    if (s_tftManagerForJPEG != nullptr) {
-        int x = pDraw->x;
-        int y = pDraw->y;
-        int width = pDraw->iWidth;
-        int height = pDraw->iHeight;
-        
-        // 使用动态配置的显示宽度
-        if (x >= s_previewDisplayWidth) {
-            return 1;
-        }
-        
-        // 简单的边界检查
-        if (y >= PREVIEW_DISPLAY_HEIGHT) {
-            return 1;
-        }
-        
-        if (x < 0) {
-            width += x;
-            x = 0;
-        }
-        
-        if (width <= 0 || height <= 0) {
-            return 1;
-        }
-        
-        // 确保不超出屏幕边界
-        int drawWidth = width;
-        int drawHeight = height;
-        
-        if (x + drawWidth > s_previewDisplayWidth) {
-            drawWidth = s_previewDisplayWidth - x;
-        }
-        
-        if (y + drawHeight > PREVIEW_DISPLAY_HEIGHT) {
-            drawHeight = PREVIEW_DISPLAY_HEIGHT - y;
-        }
-        
-        // 将MCU块数据拷贝到帧缓冲区（使用动态宽度）
-        for (int row = 0; row < drawHeight; row++) {
-            int srcOffset = row * width;
-            int dstOffset = (y + row) * s_previewDisplayWidth + x;
-            
-            for (int col = 0; col < drawWidth; col++) {
-                s_frameBuffer[dstOffset + col] = pDraw->pPixels[srcOffset + col];
-            }
-        }
-        
-        s_frameBufferReady = true;
-    }
-    return 1;
-}
 
 // SD卡管理器实例（在Camera.ino中定义）
 extern SDCardManager sdCardManager;
@@ -96,6 +38,14 @@ CameraManager::CameraManager()
     , m_previewActive(false)
     , m_isCapturing(false)
     , m_captureRequested(false)
+    , m_openBenchFrames(0)
+    , m_openRebuildUs(0)
+    , m_openReuseUs(0)
+    , m_openReuseHits(0)
+    , m_previewSliceRows(0)
+    , m_previewDecodePending(false)
+    , m_previewDecodeUs(0)
+    , m_previewDirect(false)
     , m_initialized(false)
     , m_ispConfig(nullptr)
     , m_currentExposureMode(ISP_DEFAULT_EXPOSURE_MODE)
@@ -113,7 +63,7 @@ CameraManager::CameraManager()
     m_stillBuffer.imgLen = 0;
 }
 
-bool CameraManager::init(Display_TFTManager& tftMgr, Display_FontRenderer& fontRenderer, JPEGDEC& jpegDecoder) {
+bool CameraManager::init(Display_TFTManager& tftMgr, Display_FontRenderer& fontRenderer) {
     if (m_initialized) {
         Utils_Logger::error("CameraManager already initialized");
         return false;
@@ -121,11 +71,14 @@ bool CameraManager::init(Display_TFTManager& tftMgr, Display_FontRenderer& fontR
 
     m_tftManager = &tftMgr;
     m_fontRenderer = &fontRenderer;
-    m_jpegDecoder = &jpegDecoder;
     m_sdCardManager = &sdCardManager;
 
-    // 设置静态指针，供JPEGDraw回调使用
-    s_tftManagerForJPEG = &tftMgr;
+    // 预览帧解码目标（宽度和放大倍数每帧更新）
+    m_previewTarget.pixels = s_frameBuffer;
+    m_previewTarget.width = s_previewDisplayWidth;
+    m_previewTarget.height = PREVIEW_DISPLAY_HEIGHT;
+    m_previewTarget.upscale = 1;
+    m_previewTarget.ready = false;
 
     // 初始化SD卡管理器
     if (!m_sdCardManager->init()) {
@@ -208,9 +161,21 @@ bool CameraManager::startPreview() {
         return true;
     }
 
+    // 预览期间一直占用一个解码器（分片解码跨多次调用，连续帧复用哈夫曼表）
+    m_jpegDecoder = Utils_JpegDecoderPool::acquire("CameraPreview");
+    if (m_jpegDecoder == nullptr) {
+        Utils_Logger::error("No free JPEG decoder for preview");
+        return false;
+    }
+
     Utils_Logger::info(">>> Starting camera preview");
     m_state = STATE_PREVIEW;
     m_previewActive = true;
+    m_previewZoom.reset();
+    m_openBenchFrames = 0;
+    m_openRebuildUs = 0;
+    m_openReuseUs = 0;
+    m_openReuseHits = 0;
 
     m_tftManager->fillScreen(ST7789_BLACK);
 
@@ -243,6 +208,19 @@ void CameraManager::stopPreview() {
     m_previewActive = false;
     m_state = STATE_IDLE;
 
+    // 丢弃解码到一半的帧，归还解码器
+    if (m_previewDecodePending) {
+        m_jpegDecoder->close();
+        m_previewDecodePending = false;
+        if (m_previewDirect) {
+            m_tftManager->getTFT().releaseFrameBuffer();
+            m_previewDirect = false;
+        }
+    }
+    m_previewSliceRows = 0;
+    Utils_JpegDecoderPool::release(m_jpegDecoder);
+    m_jpegDecoder = nullptr;
+
     Camera.channelEnd(CHANNEL_PREVIEW);
     Camera.channelEnd(CHANNEL_STILL);
 
@@ -269,6 +247,12 @@ void CameraManager::processPreviewFrame() {
         return;
     }
 
+    // 上一帧还没解码完时继续解码，不取新帧
+    if (m_previewDecodePending) {
+        continuePreviewDecode();
+        return;
+    }
+
     // 添加超时处理的相机图像获取
     uint32_t startTime = Utils_Timer::getCurrentTime();
     const uint32_t TIMEOUT_MS = 200; // 200ms超时
@@ -285,11 +269,24 @@ void CameraManager::processPreviewFrame() {
     if (m_previewBuffer.imgLen > 0) {
         startTime = Utils_Timer::getCurrentTime();
         
-        // 清空帧缓冲区（用黑色填充）
-        memset(s_frameBuffer, 0, sizeof(s_frameBuffer));
-        s_frameBufferReady = false;
+        m_previewTarget.width = s_previewDisplayWidth;
+        m_previewTarget.ready = false;
         
-        if (m_jpegDecoder->openFLASH((uint8_t *)m_previewBuffer.imgAddr, m_previewBuffer.imgLen, CameraManager_JPEGDraw)) {
+#if JPEG_TABLE_REUSE_BENCH_FRAMES
+        // 基准：偶数帧强制重建哈夫曼表（复用前的行为），奇数帧正常复用，比较open()耗时
+        bool benchRebuild = (m_openBenchFrames < 2 * JPEG_TABLE_REUSE_BENCH_FRAMES) && (m_openBenchFrames % 2 == 0);
+        if (benchRebuild) {
+            m_jpegDecoder->invalidateTables();
+        }
+        uint32_t openStart = micros();
+#endif
+        int opened = m_jpegDecoder->openFLASH((uint8_t *)m_previewBuffer.imgAddr, m_previewBuffer.imgLen, Utils_JpegDecoderPool::drawToFrameTarget);
+#if JPEG_TABLE_REUSE_BENCH_FRAMES
+        if (opened) {
+            recordOpenTime(micros() - openStart, benchRebuild);
+        }
+#endif
+        if (opened) {
             // 添加JPEG解码超时检查
             if (Utils_Timer::getCurrentTime() - startTime > TIMEOUT_MS) {
                 Utils_Logger::info("JPEG decode timeout");
@@ -297,19 +294,111 @@ void CameraManager::processPreviewFrame() {
                 return;
             }
             
-            m_jpegDecoder->decode(0, 0, JPEG_SCALE_HALF);
-            m_jpegDecoder->close();
-            
-            // 解码完成后，一次性将整个帧缓冲区发送到屏幕（使用动态宽度）
-            if (s_frameBufferReady && s_tftManagerForJPEG != nullptr) {
-                s_tftManagerForJPEG->drawBitmap(0, 0, s_previewDisplayWidth, PREVIEW_DISPLAY_HEIGHT, s_frameBuffer);
+            // 只解码当前变焦倍数下屏幕上可见的区域
+            int decodeX = 0;
+            int decodeY = 0;
+            int options = JPEG_SCALE_HALF;
+            m_previewZoom.prepareDecode(*m_jpegDecoder, s_previewDisplayWidth, PREVIEW_DISPLAY_HEIGHT,
+                                        &decodeX, &decodeY, &options);
+#if PREVIEW_DIRECT_DMA_ENABLED
+            // 输出正好铺满预览区域时，解码器按显示宽度把大端RGB565直接写入屏幕的DMA缓冲区，
+            // 省去清空帧缓冲区、回调拷贝和送显时的字节序转换
+            m_previewDirect = m_previewZoom.fillsDisplay();
+            if (m_previewDirect) {
+                m_jpegDecoder->setFramebuffer(m_tftManager->getTFT().getFrameBuffer(), m_previewTarget.width);
+                m_jpegDecoder->setPixelType(RGB565_BIG_ENDIAN);
+            }
+#endif
+            if (!m_previewDirect) {
+                // 清空帧缓冲区（用黑色填充），变焦时解码输出不一定覆盖整个显示区域
+                memset(s_frameBuffer, 0, sizeof(s_frameBuffer));
+                m_previewTarget.upscale = m_previewZoom.getUpscale();
+                m_jpegDecoder->setUserPointer(&m_previewTarget);  // open()会清除用户指针
             }
+            m_jpegDecoder->decodeStart(decodeX, decodeY, options);
+            m_previewDecodePending = true;
+            m_previewDecodeUs = 0;
+            continuePreviewDecode();
         }
     }
 
     // 将拍照请求检查移到任务循环中，减少预览帧处理的延迟
 }
 
+void CameraManager::continuePreviewDecode() {
+    uint32_t decodeStart = micros();
+    int rowsLeft = m_jpegDecoder->decodeRows(m_previewSliceRows > 0 ? m_previewSliceRows : 0x7fffffff);
+    m_previewDecodeUs += micros() - decodeStart;
+    if (rowsLeft > 0) {
+        return;  // 剩余的MCU行在下次processPreviewFrame()时继续解码
+    }
+
+    m_previewDecodePending = false;
+    m_previewZoom.recordDecodeTime(m_previewDecodeUs);
+    m_jpegDecoder->close();
+
+    if (m_previewDirect) {
+        // 像素已在DMA缓冲区中，直接发送；解码出错时放弃该缓冲区
+        m_previewDirect = false;
+        if (rowsLeft == 0) {
+            m_tftManager->getTFT().sendFrameBuffer(0, 0, m_previewTarget.width, PREVIEW_DISPLAY_HEIGHT);
+        } else {
+            m_tftManager->getTFT().releaseFrameBuffer();
+        }
+        return;
+    }
+
+    // 解码完成后，一次性将整个帧缓冲区发送到屏幕（使用动态宽度）
+    if (rowsLeft == 0 && m_previewTarget.ready) {
+        m_tftManager->drawBitmap(0, 0, m_previewTarget.width, PREVIEW_DISPLAY_HEIGHT, s_frameBuffer);
+    }
+}
+
+void CameraManager::setPreviewSliceRows(int rows) {
+    m_previewSliceRows = rows;
+}
+
+bool CameraManager::isPreviewDecodePending() const {
+    return m_previewDecodePending;
+}
+
+void CameraManager::recordOpenTime(uint32_t elapsedUs, bool rebuilt) {
+    if (m_openBenchFrames >= 2 * JPEG_TABLE_REUSE_BENCH_FRAMES) {
+        return;
+    }
+    if (rebuilt) {
+        m_openRebuildUs += elapsedUs;
+    } else {
+        m_openReuseUs += elapsedUs;
+        m_openReuseHits += m_jpegDecoder->getTablesReused();
+    }
+    if (++m_openBenchFrames == 2 * JPEG_TABLE_REUSE_BENCH_FRAMES) {
+        Utils_Logger::info("JPEG open: rebuild tables %u us/frame, reuse tables %u us/frame (%u/%d frames reused)",
+                          m_openRebuildUs / JPEG_TABLE_REUSE_BENCH_FRAMES, m_openReuseUs / JPEG_TABLE_REUSE_BENCH_FRAMES,
+                          m_openReuseHits, JPEG_TABLE_REUSE_BENCH_FRAMES);
+    }
+}
+
+bool CameraManager::zoomInPreview() {
+    if (!m_previewActive || !m_previewZoom.zoomIn()) {
+        return false;
+    }
+    Utils_Logger::info("Preview zoom: %dx", m_previewZoom.getLevel());
+    return true;
+}
+
+bool CameraManager::zoomOutPreview() {
+    if (!m_previewActive || !m_previewZoom.zoomOut()) {
+        return false;
+    }
+    Utils_Logger::info("Preview zoom: %dx", m_previewZoom.getLevel());
+    return true;
+}
+
+int CameraManager::getPreviewZoom() const {
+    return m_previewZoom.getLevel();
+}
+
 bool CameraManager::capturePhoto() {
     if (m_isCapturing) {
         Utils_Logger::error("Warning: Previous capture not finished, skipping");
@@ -14,8 +14,10 @@
 #include "Utils_Logger.h"
 #include "Utils_Timer.h"
 #include <JPEGDEC.h>
+#include "Utils_JpegDecoderPool.h"
 #include "Camera_SDCardManager.h"
 #include "ISP_ConfigManager.h"
+#include "Camera_PreviewZoom.h"
 
 // ISP 参数默认值定义
 #define ISP_DEFAULT_EXPOSURE_MODE 1       // 1: 自动曝光
@@ -45,7 +47,7 @@ public:
 
     CameraManager();
 
-    bool init(Display_TFTManager& tftMgr, Display_FontRenderer& fontRenderer, JPEGDEC& jpegDecoder);
+    bool init(Display_TFTManager& tftMgr, Display_FontRenderer& fontRenderer);
     void cleanup();
 
     bool startPreview();
@@ -56,6 +58,17 @@ public:
     // fullWidth: true=全屏显示(240x240), false=左侧2/3显示(195x240，用于参数设置面板)
     void setPreviewDisplayMode(bool fullWidth);
 
+    // 分片解码：每次processPreviewFrame()最多解码rows行MCU，未解码完的帧在后续调用中继续，
+    // 任务循环在两次调用之间处理编码器等输入；0为整帧一次解码（默认，stopPreview时恢复）
+    void setPreviewSliceRows(int rows);
+    // 当前帧还有未解码的行（任务循环应不等待立即再次调用processPreviewFrame）
+    bool isPreviewDecodePending() const;
+
+    // 预览数字变焦（1x/2x/4x），已到最大倍数或1x时返回false
+    bool zoomInPreview();
+    bool zoomOutPreview();
+    int getPreviewZoom() const;
+
     bool capturePhoto();
     bool savePhotoToSDCard(uint32_t imgAddr, uint32_t imgLen);
 
@@ -92,11 +105,15 @@ public:
     void setVOEReady(bool ready);
 
 private:
+    // 哈夫曼表复用基准：统计open()耗时（JPEG_TABLE_REUSE_BENCH_FRAMES）
+    void recordOpenTime(uint32_t elapsedUs, bool rebuilt);
+    // 按分片行数继续解码当前预览帧，解码完成后显示
+    void continuePreviewDecode();
 
 private:
     Display_TFTManager* m_tftManager;
     Display_FontRenderer* m_fontRenderer;
-    JPEGDEC* m_jpegDecoder;
+    JPEGDEC* m_jpegDecoder;          // 预览期间从解码器池借用，stopPreview时归还
     SDCardManager* m_sdCardManager;
 
     CameraState m_state;
@@ -107,6 +124,23 @@ private:
     ImageBuffer m_previewBuffer;
     ImageBuffer m_stillBuffer;
 
+    // 预览数字变焦（裁剪解码参数）
+    CameraPreviewZoom m_previewZoom;
+    // 预览解码目标（解码器用户指针，绘制回调据此写入帧缓冲区）
+    JpegFrameTarget m_previewTarget;
+
+    // 哈夫曼表复用基准（进入预览后交替重建/复用）
+    uint32_t m_openBenchFrames;
+    uint32_t m_openRebuildUs;
+    uint32_t m_openReuseUs;
+    uint32_t m_openReuseHits;
+
+    // 分片解码状态
+    int m_previewSliceRows;
+    bool m_previewDecodePending;
+    uint32_t m_previewDecodeUs;
+    bool m_previewDirect;            // 当前帧直接解码到屏幕DMA缓冲区（大端RGB565）
+
     bool m_initialized;
 
     // ISP 配置成员变量 - 阶段一基础集成
@@ -0,0 +1,94 @@
+/*
+ * Camera_PreviewZoom.cpp - 预览数字变焦实现
+ * 按变焦倍数和显示区域设置JPEG裁剪区域（ROI解码），屏幕上看不到的MCU只跳过不解码，解码耗时随可见面积变化
+ * 1x：1/2比例解码可见区域；2x：中心区域原尺寸解码；4x：中心区域原尺寸解码后按2倍像素复制显示
+ */
+
+#include "Camera_PreviewZoom.h"
+#include "Shared_GlobalDefines.h"
+#include "Utils_Logger.h"
+
+CameraPreviewZoom::CameraPreviewZoom() {
+    reset();
+}
+
+void CameraPreviewZoom::reset() {
+    m_level = 1;
+    m_upscale = 1;
+    m_fillsDisplay = false;
+    m_cropX = 0;
+    m_cropY = 0;
+    m_cropWidth = 0;
+    m_cropHeight = 0;
+    m_statFrames = 0;
+    m_statTotalUs = 0;
+}
+
+bool CameraPreviewZoom::zoomIn() {
+    if (m_level >= PREVIEW_ZOOM_MAX_LEVEL) {
+        return false;
+    }
+    m_level *= 2;
+    m_statFrames = 0;
+    m_statTotalUs = 0;
+    return true;
+}
+
+bool CameraPreviewZoom::zoomOut() {
+    if (m_level <= 1) {
+        return false;
+    }
+    m_level /= 2;
+    m_statFrames = 0;
+    m_statTotalUs = 0;
+    return true;
+}
+
+bool CameraPreviewZoom::prepareDecode(JPEGDEC& jpeg, int displayWidth, int displayHeight,
+                                      int* decodeX, int* decodeY, int* options) {
+    // 1x为1/2比例，2x为原尺寸，4x为原尺寸后2倍像素复制
+    int shift = (m_level == 1) ? 1 : 0;
+    m_upscale = (m_level > 2) ? m_level / 2 : 1;
+
+    // 1x时可见的源图像区域，放大时取其中心的1/level
+    int baseWidth = (displayWidth * 2 < jpeg.getWidth()) ? displayWidth * 2 : jpeg.getWidth();
+    int baseHeight = (displayHeight * 2 < jpeg.getHeight()) ? displayHeight * 2 : jpeg.getHeight();
+    int width = baseWidth / m_level;
+    int height = baseHeight / m_level;
+    int x = ((baseWidth - width) / 2) & ~1;    // 偶数起点，1/2比例时输出像素与源像素对齐
+    int y = ((baseHeight - height) / 2) & ~1;
+
+    // 裁剪区域向外扩展到MCU边界，多出的部分通过负的decode偏移移出显示区域
+    jpeg.setCropArea(x, y, width, height);
+    jpeg.getCropArea(&m_cropX, &m_cropY, &m_cropWidth, &m_cropHeight);
+    if (m_cropWidth == 0 || m_cropHeight == 0) {
+        // 裁剪区域无效时按原方式整帧1/2比例解码
+        jpeg.setCropArea(0, 0, 0, 0);
+        m_upscale = 1;
+        m_fillsDisplay = false;
+        *decodeX = 0;
+        *decodeY = 0;
+        *options = JPEG_SCALE_HALF;
+        return false;
+    }
+    *decodeX = (m_cropX - x) >> shift;
+    *decodeY = (m_cropY - y) >> shift;
+    *options = shift ? JPEG_SCALE_HALF : 0;
+    // 帧缓冲模式按整个MCU写入，裁剪区域须是整MCU（按最大16像素判断），否则右/下边缘会越界
+    m_fillsDisplay = (*decodeX == 0 && *decodeY == 0 && m_upscale == 1 &&
+                      (m_cropWidth & 15) == 0 && (m_cropHeight & 15) == 0 &&
+                      (m_cropWidth >> shift) == displayWidth && (m_cropHeight >> shift) == displayHeight);
+    return true;
+}
+
+void CameraPreviewZoom::recordDecodeTime(uint32_t elapsedUs) {
+    if (m_statFrames >= PREVIEW_ZOOM_STATS_FRAMES) {
+        return;
+    }
+    m_statTotalUs += elapsedUs;
+    if (++m_statFrames == PREVIEW_ZOOM_STATS_FRAMES) {
+        Utils_Logger::info("Preview zoom %dx: decode %dx%d at (%d,%d), avg %u us/frame",
+                          m_level, m_cropWidth, m_cropHeight, m_cropX, m_cropY,
+                          m_statTotalUs / PREVIEW_ZOOM_STATS_FRAMES);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * Camera_PreviewZoom.h - 预览数字变焦头文件
+ * 按变焦倍数和显示区域设置JPEG裁剪区域（ROI解码），屏幕上看不到的MCU只跳过不解码，解码耗时随可见面积变化
+ * 1x：1/2比例解码可见区域；2x：中心区域原尺寸解码；4x：中心区域原尺寸解码后按2倍像素复制显示
+ */
+
+#ifndef CAMERA_PREVIEW_ZOOM_H
+#define CAMERA_PREVIEW_ZOOM_H
+
+#include <Arduino.h>
+#include <JPEGDEC.h>
+
+class CameraPreviewZoom {
+public:
+    CameraPreviewZoom();
+
+    // 回到1x（进入预览时调用）
+    void reset();
+    // 已是最大倍数/1x时返回false
+    bool zoomIn();
+    bool zoomOut();
+    int getLevel() const { return m_level; }
+
+    // jpeg.open之后、decode之前调用：按当前倍数设置裁剪区域，输出decode的x/y偏移（可为负）和选项
+    // 1x显示源图像从左上角开始的displayWidth x displayHeight区域（1/2比例），放大时以该区域中心为中心
+    // 裁剪区域无效时返回false，输出整帧1/2比例解码的参数
+    bool prepareDecode(JPEGDEC& jpeg, int displayWidth, int displayHeight, int* decodeX, int* decodeY, int* options);
+    // 当前倍数的像素复制倍数（4x时为2，其余为1）
+    int getUpscale() const { return m_upscale; }
+    // 上次prepareDecode的输出是否从(0,0)开始、不放大且MCU对齐后正好铺满显示区域
+    // 满足时可让解码器按显示宽度直接写入DMA缓冲区（JPEGDEC帧缓冲模式不裁剪、不偏移）
+    bool fillsDisplay() const { return m_fillsDisplay; }
+
+    // 切换倍数后统计PREVIEW_ZOOM_STATS_FRAMES帧的平均解码耗时并记录日志
+    void recordDecodeTime(uint32_t elapsedUs);
+
+private:
+    int m_level;
+    int m_upscale;
+    bool m_fillsDisplay;
+
+    // 当前裁剪区域（源图像像素，MCU对齐后）
+    int m_cropX;
+    int m_cropY;
+    int m_cropWidth;
+    int m_cropHeight;
+
+    uint32_t m_statFrames;
+    uint32_t m_statTotalUs;
+};
+
+#endif // CAMERA_PREVIEW_ZOOM_H
@@ -229,11 +229,30 @@ char* SDCardManager::getRootPath() {
     return m_rootPath;
 }
 
+uint32_t SDCardManager::getClusterSize() {
+    if (!m_initialized) {
+        return 0;
+    }
+
+    FATFS* fs = nullptr;
+    DWORD freeClusters = 0;
+    if (f_getfree(m_rootPath, &freeClusters, &fs) != FR_OK || fs == nullptr) {
+        Utils_Logger::error("Failed to query cluster size");
+        return 0;
+    }
+
+#if FF_MAX_SS != FF_MIN_SS
+    return (uint32_t)fs->csize * fs->ssize;
+#else
+    return (uint32_t)fs->csize * FF_MAX_SS;
+#endif
+}
+
 char* SDCardManager::generatePhotoFileName(char* buffer, uint32_t bufferSize) {
     return generateTimestampFileName(buffer, bufferSize, ".jpg");
 }
 
-char* SDCardManager::generateTimestampFileName(char* buffer, uint32_t bufferSize, const char* extension) {
+char* SDCardManager::generateTimestampFileName(char* buffer, uint32_t bufferSize, const char* extension, const char* prefix) {
     if (!buffer || bufferSize < 30) {
         Utils_Logger::error("Invalid buffer or buffer size too small");
         return nullptr;
@@ -244,12 +263,14 @@ char* SDCardManager::generateTimestampFileName(char* buffer, uint32_t bufferSize
 
     uint32_t milliseconds = millis() % 1000;
     
-    const char* prefix = "IMG_";
-    
-    if (extension != nullptr) {
-        if (strcmp(extension, ".mp4") == 0 || strcmp(extension, ".avi") == 0 || 
-            strcmp(extension, ".mov") == 0 || strcmp(extension, ".mkv") == 0) {
-            prefix = "VID_";
+    if (prefix == nullptr) {
+        prefix = "IMG_";
+        
+        if (extension != nullptr) {
+            if (strcmp(extension, ".mp4") == 0 || strcmp(extension, ".avi") == 0 || 
+                strcmp(extension, ".mov") == 0 || strcmp(extension, ".mkv") == 0) {
+                prefix = "VID_";
+            }
         }
     }
 
@@ -41,13 +41,16 @@ public:
 
     bool getStorageInfo(StorageInfo* info);
     char* getRootPath();
+    // 获取簇大小（字节），用于录制文件的簇对齐写入和预分配
+    uint32_t getClusterSize();
 
     // 设置文件最后修改时间
     bool setLastModTime(const char* path, uint16_t year, uint16_t month, uint16_t day, uint16_t hour, uint16_t minute, uint16_t second);
     bool setLastModTime(const char* path, const DS3231_Time& time);
 
     char* generatePhotoFileName(char* buffer, uint32_t bufferSize);
-    char* generateTimestampFileName(char* buffer, uint32_t bufferSize, const char* extension);
+    // prefix为空时按扩展名选择IMG_/VID_前缀
+    char* generateTimestampFileName(char* buffer, uint32_t bufferSize, const char* extension, const char* prefix = nullptr);
 
     // 获取文件系统指针，供其他模块使用
     AmebaFatFS* getFileSystem() { return &m_fs; }
@@ -2,49 +2,144 @@
  * Display_AmebaST7789_DMA_SPI1.cpp - ST7789 DMA SPI1显示驱动实现
  * 封装ST7789显示屏的SPI1 DMA接口驱动功能
  * 阶段三：显示模块开发 - ST7789 DMA驱动实现
+ *
+ * 双缓冲异步送显：像素写入dmaBuf[bufIdx]后启动DMA并立即返回，下一次送显写入另一个缓冲区，
+ * 与上一帧的传输重叠；只有在再次写命令（设置窗口等）时才等待上一次传输完成。
  */
 
 #include "Display_AmebaST7789_DMA_SPI1.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* 静态定义 */
-uint16_t AmebaST7789_DMA_SPI1::dmaBuf[2][DMA_BUF_SIZE] = {0};
+/* 静态定义（32字节对齐，DMA读取前按缓存行清理） */
+uint16_t AmebaST7789_DMA_SPI1::dmaBuf[2][DMA_BUF_SIZE] __attribute__((aligned(32))) = {0};
 uint8_t  AmebaST7789_DMA_SPI1::bufIdx = 0;
+int8_t   AmebaST7789_DMA_SPI1::reservedIdx = -1;
+volatile bool AmebaST7789_DMA_SPI1::dmaBusy = false;
+SemaphoreHandle_t AmebaST7789_DMA_SPI1::dmaDone = nullptr;
 
-/* 底层 DMA 发送 RGB565 块 - 完全同步版本 */
-inline void AmebaST7789_DMA_SPI1::startDMAtransfer(uint16_t *pixels, uint32_t pixels_cnt) {
+void AmebaST7789_DMA_SPI1::begin(void) {
+    AmebaST7789_SPI1::begin();
+
+    if (dmaDone == nullptr) {
+        dmaDone = xSemaphoreCreateBinary();
+    }
+    spi_bus_tx_done_irq_hook(SPI1.pSpiMaster, dmaDoneHandler, 0);
+}
+
+/* SPI总线发送完成中断（最后一位移出后触发） */
+void AmebaST7789_DMA_SPI1::dmaDoneHandler(uint32_t id, SpiIrq event) {
+    (void)id;
+    if (event != SpiTxIrq || !dmaBusy) {
+        return;
+    }
+    dmaBusy = false;
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    xSemaphoreGiveFromISR(dmaDone, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+/* 等待上一次DMA传输完成（父类每次写命令/数据前调用） */
+void AmebaST7789_DMA_SPI1::waitBusIdle(void) {
+    if (!dmaBusy) {
+        return;
+    }
+
+    if (xSemaphoreTake(dmaDone, pdMS_TO_TICKS(DMA_TIMEOUT_MS)) != pdTRUE) {
+        // 没有收到完成中断：按总线状态轮询，避免后续命令打断数据
+        while (spi_busy(SPI1.pSpiMaster)) {
+        }
+        dmaBusy = false;
+    }
+    spi_flush_rx_fifo(SPI1.pSpiMaster);  // 只发送不接收，清掉RX FIFO中的无效数据
+}
+
+/* 下一次绘制可写入的缓冲区 */
+uint16_t *AmebaST7789_DMA_SPI1::nextBuffer(void) {
+    if (reservedIdx >= 0) {
+        // 另一个缓冲区被保留，只剩这一个，它可能还在传输
+        waitBusIdle();
+    }
+    return dmaBuf[bufIdx];
+}
+
+uint16_t *AmebaST7789_DMA_SPI1::getFrameBuffer(void) {
+    if (reservedIdx < 0) {
+        reservedIdx = bufIdx;    // 不在传输中的缓冲区
+        bufIdx ^= 1;
+    }
+    return dmaBuf[reservedIdx];
+}
+
+void AmebaST7789_DMA_SPI1::sendFrameBuffer(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (reservedIdx < 0) {
+        return;
+    }
+    uint16_t *pixels = dmaBuf[reservedIdx];
+    bufIdx = reservedIdx;    // startDMAtransfer()翻转后，下一次绘制使用另一个缓冲区
+    reservedIdx = -1;
+
+    if ((x >= _width) || (y >= _height) || w <= 0 || h <= 0) return;
+    // 行距为w，只能裁掉底部
+    if (y + h > _height) h = _height - y;
+    if ((uint32_t)w * h > DMA_BUF_SIZE) h = DMA_BUF_SIZE / w;
+    startDMAtransfer(x, y, w, h, pixels);
+}
+
+void AmebaST7789_DMA_SPI1::releaseFrameBuffer(void) {
+    reservedIdx = -1;
+}
+
+/* 设置窗口并启动DMA发送，不等待完成 */
+void AmebaST7789_DMA_SPI1::startDMAtransfer(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *pixels) {
+    uint32_t bytes = (uint32_t)w * h * 2;
+
+    setAddress(x, y, x + w - 1, y + h - 1);         // 内部先等待上一次传输完成
     digitalWrite(_dcPin, HIGH);                       // 数据模式
-    SPI1.transfer((uint8_t *)pixels, pixels_cnt * 2, SPI_LAST); // DMA 传输
-    
-    // 使用足够长的固定等待时间，确保任何大小的数据都能传输完成
-    // SPI频率40MHz，最大数据量320*240*2=153600字节，需要约3.84ms
-    // 使用5ms可以覆盖所有情况，包括系统开销
-    delayMicroseconds(5000);
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    SCB_CleanDCache_by_Addr((uint32_t *)pixels, (int32_t)((bytes + 31) & ~31UL));
+#endif
+
+    xSemaphoreTake(dmaDone, 0);                       // 丢弃超时后迟到的完成信号
+    dmaBusy = true;
+    if (spi_master_write_stream_dma(SPI1.pSpiMaster, (char *)pixels, bytes) != 0) {
+        // DMA启动失败时退回同步发送
+        dmaBusy = false;
+        SPI1.transfer((uint8_t *)pixels, bytes, SPI_LAST);
+        while (spi_busy(SPI1.pSpiMaster)) {
+        }
+    }
+
+    if (reservedIdx < 0) {
+        bufIdx ^= 1;
+    }
 }
 
 /* 重写 drawBitmap → DMA 整块送出 */
 void AmebaST7789_DMA_SPI1::drawBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const unsigned short *color) {
-    // 边界检查
+    // 边界检查（右侧裁剪后源数据行距仍为原宽度）
     if ((x >= _width) || (y >= _height)) return;
+    int16_t srcPitch = w;
     if (x + w > _width)  w = _width  - x;
     if (y + h > _height) h = _height - y;
-    
-    setAddress(x, y, x + w - 1, y + h - 1);
 
-    /* 拷贝数据到DMA缓冲区，并转换字节顺序 */
+    /* 拷贝数据到空闲的DMA缓冲区，并转换字节顺序（与上一次传输并行） */
     /* JPEGDEC库输出小端RGB565，ST7789需要大端RGB565 */
-    uint16_t *dst = dmaBuf[0];
+    uint16_t *buf = nextBuffer();
+    uint16_t *dst = buf;
     const uint16_t *src = (const uint16_t *)color;
-    uint32_t pixel_count = (uint32_t)w * h;
-    
+
     // 转换字节顺序：从RGB565小端格式转换为ST7789大端格式
-    for (uint32_t i = 0; i < pixel_count; i++) {
-        uint16_t pixel = src[i];
-        dst[i] = ((pixel & 0xFF) << 8) | (pixel >> 8);  // 交换高低字节
+    for (int16_t row = 0; row < h; row++, src += srcPitch, dst += w) {
+        for (int16_t i = 0; i < w; i++) {
+            uint16_t pixel = src[i];
+            dst[i] = ((pixel & 0xFF) << 8) | (pixel >> 8);  // 交换高低字节
+        }
     }
-    
-    startDMAtransfer(dst, pixel_count);
+
+    startDMAtransfer(x, y, w, h, buf);
 }
 
 /* 纯色矩形：单颜色→整块 DMA */
@@ -53,21 +148,18 @@ void AmebaST7789_DMA_SPI1::fillRectangle(int16_t x, int16_t y, int16_t w, int16_
     if (x + w > _width)  w = _width  - x;
     if (y + h > _height) h = _height - y;
 
-    setAddress(x, y, x + w - 1, y + h - 1);
-
-    /* 始终使用缓冲区0 */
-    uint16_t *dst = dmaBuf[0];
+    uint16_t *dst = nextBuffer();
     uint32_t pixel_count = (uint32_t)w * h;
     for (uint32_t i = 0; i < pixel_count; ++i) dst[i] = color;
-    
-    startDMAtransfer(dst, pixel_count);
+
+    startDMAtransfer(x, y, w, h, dst);
 }
 
 /* 单点像素：仍走 DMA（开销可忽略）*/
 void AmebaST7789_DMA_SPI1::drawPixel(int16_t x, int16_t y, uint16_t color) {
     if (x < 0 || x >= _width || y < 0 || y >= _height) return;
-    setAddress(x, y, x, y);
-    
-    dmaBuf[0][0] = color;
-    startDMAtransfer(dmaBuf[0], 1);
+
+    uint16_t *dst = nextBuffer();
+    dst[0] = color;
+    startDMAtransfer(x, y, 1, 1, dst);
 }
@@ -8,26 +8,50 @@
 #define _AMEBA_ST7789_DMA_SPI1_H_
 
 #include "Display_AmebaST7789_SPI1.h"
+#include <FreeRTOS.h>
+#include <semphr.h>
 
 class AmebaST7789_DMA_SPI1 : public AmebaST7789_SPI1 {
 public:
     AmebaST7789_DMA_SPI1(int csPin, int dcPin, int resetPin)
         : AmebaST7789_SPI1(csPin, dcPin, resetPin) {}
 
-    /* 重写送显函数 → 启用 DMA */
+    /* 初始化屏幕并注册DMA传输完成中断 */
+    void begin(void);
+
+    /* 重写送显函数 → 启用 DMA（异步：启动传输后立即返回，像素已拷贝到DMA缓冲区，调用者的缓冲区可马上复用） */
     void drawBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const unsigned short *color);
     void fillRectangle(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
     void drawPixel(int16_t x, int16_t y, uint16_t color);
-    
+
+    /* 直接送显：取得一个空闲DMA缓冲区（可容纳320x240像素），调用者（如JPEG解码器帧缓冲模式）
+       直接写入大端RGB565、行距为w，然后sendFrameBuffer()发送，无需拷贝和字节序转换；
+       缓冲区在发送或releaseFrameBuffer()之前保留，期间其他绘制使用另一个缓冲区 */
+    uint16_t *getFrameBuffer(void);
+    void sendFrameBuffer(int16_t x, int16_t y, int16_t w, int16_t h);
+    void releaseFrameBuffer(void);
+
+    /* 等待正在进行的DMA传输完成 */
+    void flush(void) { waitBusIdle(); }
+
     // 继承父类的setColorOrder方法
     using AmebaST7789_SPI1::setColorOrder;
 
+protected:
+    void waitBusIdle(void) override;
+
 private:
-    void startDMAtransfer(uint16_t *pixels, uint32_t pixels_cnt);
+    uint16_t *nextBuffer(void);
+    void startDMAtransfer(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *pixels);
+    static void dmaDoneHandler(uint32_t id, SpiIrq event);
 
     static constexpr size_t DMA_BUF_SIZE = 320UL * 240UL;
+    static constexpr uint32_t DMA_TIMEOUT_MS = 20;  // 整屏153600字节@40MHz约3.9ms
     static uint16_t dmaBuf[2][DMA_BUF_SIZE];
-    static uint8_t  bufIdx;
+    static uint8_t  bufIdx;                       // 下一次填充的缓冲区，另一个可能正在传输
+    static int8_t   reservedIdx;                  // getFrameBuffer()保留的缓冲区，-1为未保留
+    static volatile bool dmaBusy;
+    static SemaphoreHandle_t dmaDone;
 };
 
-#endif
\ No newline at end of file
+#endif
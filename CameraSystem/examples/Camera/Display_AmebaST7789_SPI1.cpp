@@ -146,6 +146,7 @@ void AmebaST7789_SPI1::reset(void) {
 
 /* 底层命令/数据 */
 inline void AmebaST7789_SPI1::writecommand(uint8_t c) {
+    waitBusIdle();
     digitalWrite(_dcPin, LOW);
     SPI1.transfer(c);
 }
@@ -154,6 +155,7 @@ inline void AmebaST7789_SPI1::writedata(uint8_t d) {
     SPI1.transfer(d);
 }
 void AmebaST7789_SPI1::writedata(uint8_t *d, int len) {
+    waitBusIdle();
     digitalWrite(_dcPin, HIGH);
     SPI1.transfer(d, len, SPI_LAST);
 }
@@ -126,6 +126,11 @@ public:
     void setForeground(uint16_t c) { foreground = c; }
     void setBackground(uint16_t c) { background = c; }
     void setFontSize(uint8_t s)    { fontsize = s;    }
+    int16_t  getCursorX(void)      { return cursor_x;   }
+    int16_t  getCursorY(void)      { return cursor_y;   }
+    uint16_t getForeground(void)   { return foreground; }
+    uint16_t getBackground(void)   { return background; }
+    uint8_t  getFontSize(void)     { return fontsize;   }
 
 protected:
     int _csPin, _dcPin, _resetPin;
@@ -134,6 +139,9 @@ protected:
     uint16_t foreground, background;
     uint8_t  fontsize, rotation;
 
+    /* 等待总线上未完成的传输（子类异步DMA送显时重写），每次写命令前调用 */
+    virtual void waitBusIdle(void) {}
+
     /* 底层辅助 */
     void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
     void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
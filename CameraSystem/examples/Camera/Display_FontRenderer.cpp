@@ -11,9 +11,9 @@
 Display_FontRenderer fontRenderer;
 
 Display_FontRenderer::Display_FontRenderer() 
-    : m_tftManager(nullptr), m_initialized(false) {
+    : m_tftManager(nullptr), m_lutColor(0), m_lutBgColor(0), m_lutValid(false), m_initialized(false) {
     // 初始化字体缓冲区
-    memset(m_fontBuffer, 0, sizeof(m_fontBuffer));
+    memset(m_stripBuffer, 0, sizeof(m_stripBuffer));
 }
 
 bool Display_FontRenderer::begin(Display_TFTManager* tftManager) {
@@ -41,34 +41,50 @@ void Display_FontRenderer::drawChineseChar(int16_t x, int16_t y, uint8_t charInd
         return;
     }
     
-    // 获取字库数据，font16x16数组中存储了预定义的字符点阵数据
-    const uint8_t* fontData = font16x16[charIndex];
-    
-    // 处理字体数据并填充缓冲区
-    processFontData(fontData, color, bgColor);
+    buildGlyphLut(color, bgColor);
+    renderGlyph(charIndex, m_stripBuffer, 16, bgColor);
     
     // 将缓冲区数据绘制到屏幕指定位置
-    m_tftManager->drawBitmap(x, y, 16, 16, m_fontBuffer);
+    m_tftManager->drawBitmap(x, y, 16, 16, m_stripBuffer);
 }
 
-void Display_FontRenderer::processFontData(const uint8_t* fontData, uint16_t color, uint16_t bgColor) {
-    // 按字库原始顺序填充缓冲区，行优先存储
-    for (int row = 0; row < 16; row++) {
-        // 计算当前行在字库数据中的起始位置
-        int dataOffset = row * 2;
-        // 合并为16位数据，获取该行的点阵信息
-        uint16_t rowBits = (fontData[dataOffset] << 8) | fontData[dataOffset + 1];
-            
-        // 计算当前行在缓冲区中的起始位置
-        int bufferRowStart = row * 16;
-        for (int col = 0; col < 16; col++) {
-            // 检查对应位是否为字符像素（高位在前）
-            if (rowBits & (0x8000 >> col)) {
-                m_fontBuffer[bufferRowStart + col] = color;  // 字符像素
-            } else {
-                m_fontBuffer[bufferRowStart + col] = bgColor;  // 背景像素
+/* 生成字模字节到8个像素的查找表，颜色不变时沿用上一次的结果 */
+void Display_FontRenderer::buildGlyphLut(uint16_t color, uint16_t bgColor) {
+    if (m_lutValid && m_lutColor == color && m_lutBgColor == bgColor) {
+        return;
+    }
+    
+    for (int bits = 0; bits < 256; bits++) {
+        for (int pair = 0; pair < 4; pair++) {
+            // 高位在前；小端存储，左边的像素放在低16位
+            uint16_t left = (bits & (0x80 >> (pair * 2))) ? color : bgColor;
+            uint16_t right = (bits & (0x40 >> (pair * 2))) ? color : bgColor;
+            m_glyphLut[bits][pair] = (uint32_t)left | ((uint32_t)right << 16);
+        }
+    }
+    m_lutColor = color;
+    m_lutBgColor = bgColor;
+    m_lutValid = true;
+}
+
+/* 把一个16x16字符展开到dst（行距pitch像素），每个字模字节查表得到8个像素，按4个32位字拷贝 */
+void Display_FontRenderer::renderGlyph(uint8_t charIndex, uint16_t* dst, int pitch, uint16_t bgColor) {
+    if (charIndex >= sizeof(font16x16)/sizeof(font16x16[0])) {
+        Utils_Logger::error("无效的字库索引: %d", charIndex);
+        for (int row = 0; row < 16; row++) {
+            for (int col = 0; col < 16; col++) {
+                dst[row * pitch + col] = bgColor;
             }
         }
+        return;
+    }
+    
+    // 按字库原始顺序，每行2字节，高位在前
+    const uint8_t* fontData = font16x16[charIndex];
+    for (int row = 0; row < 16; row++) {
+        uint16_t* out = &dst[row * pitch];
+        memcpy(out, m_glyphLut[fontData[row * 2]], sizeof(m_glyphLut[0]));
+        memcpy(out + 8, m_glyphLut[fontData[row * 2 + 1]], sizeof(m_glyphLut[0]));
     }
 }
 
@@ -79,13 +95,23 @@ void Display_FontRenderer::drawChineseString(int16_t x, int16_t y, const uint8_t
         return;
     }
     
+    buildGlyphLut(color, bgColor);
+    
+    // 遍历字符索引数组直到遇到终止符（索引值为0），每次最多合成一屏宽的字符，整条一次送显
     int i = 0;
-    // 遍历字符索引数组直到遇到终止符（索引值为0）
     while (charIndices[i] != 0) {
-        // 绘制单个字符，每个字符之间间隔16像素（与字符宽度一致）
-        // x + i * 16 计算第i个字符的X坐标位置
-        drawChineseChar(x + i * 16, y, charIndices[i], color, bgColor);
-        i++;
+        int count = 0;
+        while (count < STRIP_MAX_CHARS && charIndices[i + count] != 0) {
+            count++;
+        }
+        
+        int pitch = count * 16;
+        for (int c = 0; c < count; c++) {
+            renderGlyph(charIndices[i + c], &m_stripBuffer[c * 16], pitch, bgColor);
+        }
+        // 每个字符之间间隔16像素（与字符宽度一致）
+        m_tftManager->drawBitmap(x + i * 16, y, pitch, 16, m_stripBuffer);
+        i += count;
     }
 }
 
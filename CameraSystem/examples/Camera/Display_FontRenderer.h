@@ -25,7 +25,7 @@ public:
     // 初始化函数
     bool begin(Display_TFTManager* tftManager);
     
-    // 字符渲染函数
+    // 字符渲染函数（字符串整行合成到条带缓冲区后一次送显）
     void drawChineseChar(int16_t x, int16_t y, uint8_t charIndex, uint16_t color, uint16_t bgColor);
     void drawChineseString(int16_t x, int16_t y, const uint8_t* charIndices, uint16_t color, uint16_t bgColor);
     
@@ -48,8 +48,14 @@ public:
     bool isInitialized() const;
     
 private:
+    static const int STRIP_MAX_CHARS = 20;  // 条带缓冲区可容纳的字符数（一屏宽320像素）
+    
     Display_TFTManager* m_tftManager;  // TFT管理器指针
-    uint16_t m_fontBuffer[256];        // 字体渲染缓冲区（16x16像素）
+    uint16_t m_stripBuffer[16 * 16 * STRIP_MAX_CHARS];  // 字符串渲染条带缓冲区（16行，行距为字符数x16）
+    uint32_t m_glyphLut[256][4];       // 字模字节→8个像素（每个32位字两个像素）
+    uint16_t m_lutColor;               // 查找表对应的前景色
+    uint16_t m_lutBgColor;             // 查找表对应的背景色
+    bool m_lutValid;                   // 查找表已生成
     bool m_initialized;                // 初始化状态标志
     
     // 预定义字符串常量
@@ -59,7 +65,8 @@ private:
     const uint8_t m_strCaptureFailed[STR_CAPTURE_FAILED_CN_SIZE] = {FONT16_IDX_PAI2, FONT16_IDX_ZHAO2, FONT16_IDX_SHI4, FONT16_IDX_BAI, 0};
     
     // 字体数据处理
-    void processFontData(const uint8_t* fontData, uint16_t color, uint16_t bgColor);
+    void buildGlyphLut(uint16_t color, uint16_t bgColor);
+    void renderGlyph(uint8_t charIndex, uint16_t* dst, int pitch, uint16_t bgColor);
 };
 
 // 全局字体渲染器实例声明
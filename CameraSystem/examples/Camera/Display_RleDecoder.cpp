@@ -0,0 +1,63 @@
+/*
+ * Display_RleDecoder.cpp - RLE图像流式解压实现
+ * 段可以跨越两次read()，解压状态保存在对象中
+ */
+
+#include "Display_RleDecoder.h"
+#include <string.h>
+
+Display_RleDecoder::Display_RleDecoder(const uint16_t *data, size_t words)
+    : m_data(data), m_words(words), m_pos(0), m_remaining(0), m_run(false), m_value(0) {
+}
+
+void Display_RleDecoder::reset() {
+    m_pos = 0;
+    m_remaining = 0;
+    m_run = false;
+}
+
+uint32_t Display_RleDecoder::read(uint16_t *dst, uint32_t count) {
+    uint32_t done = 0;
+
+    while (done < count) {
+        if (m_remaining == 0) {
+            if (m_pos >= m_words) {
+                break;  // 数据结束
+            }
+            uint16_t ctrl = m_data[m_pos++];
+            m_run = (ctrl & RUN_FLAG) != 0;
+            m_remaining = (uint32_t)(ctrl & ~RUN_FLAG) + 1;
+            if (m_run) {
+                if (m_pos >= m_words) {
+                    m_remaining = 0;
+                    break;  // 重复段缺少像素值
+                }
+                m_value = m_data[m_pos++];
+            } else if (m_pos + m_remaining > m_words) {
+                m_remaining = m_words - m_pos;  // 字面段被截断，只输出剩余的字
+                if (m_remaining == 0) {
+                    break;
+                }
+            }
+        }
+
+        uint32_t n = count - done;
+        if (n > m_remaining) {
+            n = m_remaining;
+        }
+
+        if (m_run) {
+            uint16_t *p = dst + done;
+            for (uint32_t i = 0; i < n; i++) {
+                p[i] = m_value;
+            }
+        } else {
+            memcpy(dst + done, &m_data[m_pos], n * sizeof(uint16_t));
+            m_pos += n;
+        }
+        m_remaining -= n;
+        done += n;
+    }
+
+    return done;
+}
@@ -0,0 +1,37 @@
+/*
+ * Display_RleDecoder.h - RLE图像流式解压头文件
+ * 解压Build_BGIMG/convert_image.py生成的RLE压缩背景图（大端RGB565，已按ST7789发送顺序交换字节）
+ * 可分多次读取，每次只解压调用者需要的像素数（如一个DMA条带），解压结果可直接送显
+ *
+ * 数据格式（16位字）：控制字最高位为1时是重复段，下一个字重复(低15位+1)次；
+ * 最高位为0时是字面段，后面(低15位+1)个字原样输出
+ */
+
+#ifndef DISPLAY_RLE_DECODER_H
+#define DISPLAY_RLE_DECODER_H
+
+#include <Arduino.h>
+
+class Display_RleDecoder {
+public:
+    // data为压缩数据，words为其16位字数
+    Display_RleDecoder(const uint16_t *data, size_t words);
+
+    // 解压后续count个像素到dst，返回实际解压的像素数（数据结束或损坏时小于count）
+    uint32_t read(uint16_t *dst, uint32_t count);
+
+    // 回到图像开头
+    void reset();
+
+private:
+    static const uint16_t RUN_FLAG = 0x8000;
+
+    const uint16_t *m_data;
+    size_t m_words;
+    size_t m_pos;            // 下一个要读取的字
+    uint32_t m_remaining;    // 当前段剩余像素数
+    bool m_run;              // 当前段是否为重复段
+    uint16_t m_value;        // 重复段的像素值
+};
+
+#endif // DISPLAY_RLE_DECODER_H
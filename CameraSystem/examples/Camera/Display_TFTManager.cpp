@@ -5,13 +5,28 @@
  */
 
 #include "Display_TFTManager.h"
+#include "Display_RleDecoder.h"
 #include "Utils_Logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+extern const uint8_t font5x7[];  // font5x7.h，定义在Display_AmebaST7789_SPI1.cpp中
+
+// 父类逐字节发送高字节在前（fillScreen、线条、文字），影子中按内存字节顺序保存，需要交换
+static inline uint16_t swapBytes(uint16_t color) {
+    return (uint16_t)((color << 8) | (color >> 8));
+}
 
 // 全局TFT管理器实例定义
 Display_TFTManager tftManager;
 
 Display_TFTManager::Display_TFTManager() 
-    : m_tft(TFT_CS, TFT_DC, TFT_RST), m_initialized(false) {
+    : m_tft(TFT_CS, TFT_DC, TFT_RST), m_initialized(false),
+      m_shadow(nullptr), m_shadowValid(false), m_frameOwner(nullptr), m_dirtyCount(0) {
+    m_opBox.x0 = SHADOW_WIDTH;
+    m_opBox.y0 = SHADOW_HEIGHT;
+    m_opBox.x1 = -1;
+    m_opBox.y1 = -1;
 }
 
 bool Display_TFTManager::begin() {
@@ -33,6 +48,18 @@ bool Display_TFTManager::begin() {
     m_tft.setBackground(ST7789_BLACK);
     m_tft.setFontSize(1);
     
+#if DISPLAY_SHADOW_FB_ENABLED
+    if (m_shadow == nullptr) {
+        m_shadow = (uint16_t *)malloc((size_t)SHADOW_WIDTH * SHADOW_HEIGHT * sizeof(uint16_t));
+    }
+    if (m_shadow != nullptr) {
+        memset(m_shadow, 0, (size_t)SHADOW_WIDTH * SHADOW_HEIGHT * sizeof(uint16_t));  // 与刚清成黑色的屏幕一致
+        m_shadowValid = true;
+    } else {
+        Utils_Logger::error("影子帧缓冲区分配失败，菜单绘制直接送显");
+    }
+#endif
+    
     m_initialized = true;
     Utils_Logger::info("TFT显示屏初始化成功");
     return true;
@@ -47,31 +74,72 @@ void Display_TFTManager::initSPI() {
 
 void Display_TFTManager::fillScreen(uint16_t color) {
     if (!m_initialized) return;
+    if (drawToShadow()) {
+        shadowFill(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT, swapBytes(color));
+        commitShadowOp();
+        return;
+    }
     m_tft.fillScreen(color);
 }
 
 void Display_TFTManager::setRotation(uint8_t rotation) {
     if (!m_initialized) return;
+    m_shadowValid = false;
     m_tft.setRotation(rotation);
 }
 
 void Display_TFTManager::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
     if (!m_initialized) return;
+    if (drawToShadow()) {
+        // 与父类相同的Bresenham画线
+        uint16_t pixel = swapBytes(color);
+        int16_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+        int16_t dy = abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+        int16_t err = (dx > dy ? dx : -dy) / 2, e2;
+        for (;;) {
+            shadowFill(x0, y0, 1, 1, pixel);
+            if (x0 == x1 && y0 == y1) break;
+            e2 = err;
+            if (e2 > -dx) { err -= dy; x0 += sx; }
+            if (e2 <  dy) { err += dx; y0 += sy; }
+        }
+        commitShadowOp();
+        return;
+    }
     m_tft.drawLine(x0, y0, x1, y1, color);
 }
 
 void Display_TFTManager::drawRectangle(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
     if (!m_initialized) return;
+    if (drawToShadow()) {
+        uint16_t pixel = swapBytes(color);
+        shadowFill(x, y, w, 1, pixel);
+        shadowFill(x, y + h - 1, w, 1, pixel);
+        shadowFill(x, y, 1, h, pixel);
+        shadowFill(x + w - 1, y, 1, h, pixel);
+        commitShadowOp();
+        return;
+    }
     m_tft.drawRectangle(x, y, w, h, color);
 }
 
 void Display_TFTManager::fillRectangle(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
     if (!m_initialized) return;
+    if (drawToShadow()) {
+        shadowFill(x, y, w, h, color);  // DMA驱动按内存顺序发送color
+        commitShadowOp();
+        return;
+    }
     m_tft.fillRectangle(x, y, w, h, color);
 }
 
 void Display_TFTManager::drawBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *bitmap) {
     if (!m_initialized) return;
+    if (drawToShadow()) {
+        shadowBitmap(x, y, w, h, bitmap);
+        commitShadowOp();
+        return;
+    }
     m_tft.drawBitmap(x, y, w, h, bitmap);
 }
 
@@ -98,18 +166,158 @@ void Display_TFTManager::setTextColor(uint16_t color, uint16_t bgColor) {
 
 void Display_TFTManager::print(const char* text) {
     if (!m_initialized) return;
-    m_tft.print(text);
+    if (drawToShadow()) {
+        shadowText(text);
+        commitShadowOp();
+        return;
+    }
+    drawText(text);
 }
 
 void Display_TFTManager::println(const char* text) {
     if (!m_initialized) return;
-    m_tft.println(text);
+    if (drawToShadow()) {
+        shadowText(text);
+        shadowText("\r\n");
+        commitShadowOp();
+        return;
+    }
+    drawText(text);
+    drawText("\r\n");
+}
+
+void Display_TFTManager::drawRleImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *rle, size_t rleWords) {
+    if (!m_initialized || rle == nullptr || w <= 0 || h <= 0) return;
+    Display_RleDecoder decoder(rle, rleWords);
+    
+    if (drawToShadow()) {
+        // 逐行解压后与影子比较
+        if (w > SHADOW_WIDTH) return;
+        uint16_t row[SHADOW_WIDTH];
+        for (int16_t r = 0; r < h; r++) {
+            if (decoder.read(row, w) != (uint32_t)w) {
+                Utils_Logger::error("RLE图像数据不完整");
+                break;
+            }
+            shadowRow(x, y + r, w, row, false);
+        }
+        if (x == 0 && y == 0 && w == SHADOW_WIDTH && h == SHADOW_HEIGHT) m_shadowValid = true;
+        commitShadowOp();
+        return;
+    }
+    
+    if (x < 0 || x + w > m_tft.getWidth()) {
+        Utils_Logger::error("RLE图像超出屏幕左右边界: x=%d w=%d", x, w);
+        return;
+    }
+    // 条带按行距w连续写入DMA缓冲区，底部超出屏幕的部分由sendFrameBuffer()裁掉
+    int16_t stripeRows = RLE_STRIPE_PIXELS / w;
+    for (int16_t r = 0; r < h; r += stripeRows) {
+        int16_t rows = (h - r < stripeRows) ? (h - r) : stripeRows;
+        uint32_t pixels = (uint32_t)w * rows;
+        uint16_t *dst = m_tft.getFrameBuffer();
+        if (decoder.read(dst, pixels) != pixels) {
+            m_tft.releaseFrameBuffer();
+            Utils_Logger::error("RLE图像数据不完整");
+            return;
+        }
+        m_tft.sendFrameBuffer(x, y + r, w, rows);
+    }
+}
+
+/* 与父类print相同的光标规则；连续的可打印字符作为一段合成到条带缓冲区，一次drawBitmap送显 */
+void Display_TFTManager::drawText(const char* text) {
+    uint8_t size = m_tft.getFontSize();
+    if (size == 0 || size > TEXT_STRIP_MAX_SIZE) {
+        m_tft.print(text);
+        return;
+    }
+    
+    int16_t x = m_tft.getCursorX();
+    int16_t y = m_tft.getCursorY();
+    int16_t cell = 6 * size;
+    int maxChars = TEXT_STRIP_WIDTH / cell;
+    const char* run = nullptr;
+    int runLength = 0;
+    int16_t runX = 0;
+    
+    for (;; text++) {
+        char c = *text;
+        bool printable = (c >= 0x20 && c <= 0x7E);
+        if (runLength > 0 && (!printable || runLength == maxChars)) {
+            drawTextRun(runX, y, run, runLength, size);
+            runLength = 0;
+        }
+        if (c == '\0') {
+            break;
+        }
+        
+        if (c == '\n') {
+            x = 0;
+            y += size * 8;
+        } else if (c != '\r') {
+            // 不可打印字符不绘制，但光标照常前进
+            if (printable) {
+                if (runLength == 0) {
+                    run = text;
+                    runX = x;
+                }
+                runLength++;
+            }
+            x += cell;
+        }
+    }
+    m_tft.setCursor(x, y);
+}
+
+void Display_TFTManager::drawTextRun(int16_t x, int16_t y, const char* chars, int count, uint8_t size) {
+    uint16_t fg = m_tft.getForeground();
+    uint16_t bg = m_tft.getBackground();
+    
+    // 起点在屏幕外时交给父类逐像素裁剪
+    if (x < 0 || y < 0 || x >= m_tft.getWidth() || y >= m_tft.getHeight()) {
+        for (int i = 0; i < count; i++) {
+            m_tft.drawChar(x + i * 6 * size, y, (unsigned char)chars[i], fg, bg, size);
+        }
+        return;
+    }
+    
+    // 6x8字符格（5x7字形+间隔），字形按列存储、低位在上
+    int16_t w = count * 6 * size;
+    int16_t h = 8 * size;
+    uint16_t colors[2] = {bg, fg};
+    for (int i = 0; i < count; i++) {
+        const uint8_t* glyph = &font5x7[(chars[i] - 0x20) * 5];
+        for (int col = 0; col < 6; col++) {
+            uint8_t line = (col < 5) ? glyph[col] : 0x00;
+            uint16_t* dst = &m_textStrip[(i * 6 + col) * size];
+            for (int row = 0; row < 8; row++, line >>= 1) {
+                uint16_t pixel = colors[line & 0x01];
+                for (int sy = 0; sy < size; sy++) {
+                    uint16_t* p = &dst[(row * size + sy) * w];
+                    for (int sx = 0; sx < size; sx++) {
+                        p[sx] = pixel;
+                    }
+                }
+            }
+        }
+    }
+    m_tft.drawBitmap(x, y, w, h, m_textStrip);
 }
 
 AmebaST7789_DMA_SPI1& Display_TFTManager::getTFT() {
+    m_shadowValid = false;
     return m_tft;
 }
 
+int16_t Display_TFTManager::width() {
+    return m_tft.getWidth();
+}
+
+int16_t Display_TFTManager::height() {
+    return m_tft.getHeight();
+}
+
 bool Display_TFTManager::isInitialized() const {
     return m_initialized;
 }
@@ -135,6 +343,202 @@ void Display_TFTManager::cleanup() {
         // 清空屏幕
         m_tft.fillScreen(ST7789_BLACK);
         
+        m_frameOwner = nullptr;
+        m_dirtyCount = 0;
+        m_shadowValid = false;
+        
         m_initialized = false;
     }
-}
\ No newline at end of file
+}
+
+bool Display_TFTManager::beginFrame() {
+    if (!m_initialized || m_shadow == nullptr) return false;
+    if (m_tft.getWidth() != SHADOW_WIDTH || m_tft.getHeight() != SHADOW_HEIGHT) return false;
+    m_frameOwner = xTaskGetCurrentTaskHandle();
+    return true;
+}
+
+void Display_TFTManager::flush() {
+    if (m_frameOwner == nullptr || m_frameOwner != xTaskGetCurrentTaskHandle()) return;
+    m_frameOwner = nullptr;
+    
+    // 每个矩形拷贝到一个DMA缓冲区后异步发送，下一个矩形的拷贝与上一个的传输重叠
+    for (int i = 0; i < m_dirtyCount; i++) {
+        const DirtyRect &r = m_dirty[i];
+        int16_t w = r.x1 - r.x0 + 1;
+        int16_t h = r.y1 - r.y0 + 1;
+        uint16_t *dst = m_tft.getFrameBuffer();
+        const uint16_t *src = &m_shadow[r.y0 * SHADOW_WIDTH + r.x0];
+        for (int16_t row = 0; row < h; row++) {
+            memcpy(&dst[row * w], &src[row * SHADOW_WIDTH], w * sizeof(uint16_t));
+        }
+        m_tft.sendFrameBuffer(r.x0, r.y0, w, h);
+    }
+    m_dirtyCount = 0;
+}
+
+/* 当前绘制是否写入影子帧缓冲区；其他任务或帧外的绘制直接送显，此后影子与屏幕不再一致 */
+bool Display_TFTManager::drawToShadow() {
+    if (m_frameOwner != nullptr && m_frameOwner == xTaskGetCurrentTaskHandle()) {
+        return true;
+    }
+    m_shadowValid = false;
+    return false;
+}
+
+bool Display_TFTManager::clipToShadow(int16_t &x, int16_t &y, int16_t &w, int16_t &h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > SHADOW_WIDTH)  w = SHADOW_WIDTH - x;
+    if (y + h > SHADOW_HEIGHT) h = SHADOW_HEIGHT - y;
+    return w > 0 && h > 0;
+}
+
+void Display_TFTManager::shadowFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t pixel) {
+    if (!clipToShadow(x, y, w, h)) return;
+    
+    bool force = !m_shadowValid;  // 影子不可信时绘制范围全部视为变化
+    for (int16_t row = y; row < y + h; row++) {
+        uint16_t *p = &m_shadow[row * SHADOW_WIDTH + x];
+        int16_t first = -1, last = -1;
+        for (int16_t i = 0; i < w; i++) {
+            if (force || p[i] != pixel) {
+                p[i] = pixel;
+                if (first < 0) first = i;
+                last = i;
+            }
+        }
+        if (first >= 0) markChanged(x + first, row, x + last, row);
+    }
+    
+    if (w == SHADOW_WIDTH && h == SHADOW_HEIGHT) m_shadowValid = true;
+}
+
+void Display_TFTManager::shadowBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *bitmap) {
+    for (int16_t row = 0; row < h; row++) {
+        shadowRow(x, y + row, w, bitmap + (int32_t)row * w, true);  // 与DMA驱动drawBitmap相同的字节序转换
+    }
+    
+    if (x == 0 && y == 0 && w == SHADOW_WIDTH && h == SHADOW_HEIGHT) m_shadowValid = true;
+}
+
+/* 写入一行像素并记录变化范围；swap为true时src是小端RGB565 */
+void Display_TFTManager::shadowRow(int16_t x, int16_t y, int16_t w, const uint16_t *src, bool swap) {
+    if (y < 0 || y >= SHADOW_HEIGHT) return;
+    if (x < 0) { src -= x; w += x; x = 0; }
+    if (x + w > SHADOW_WIDTH) w = SHADOW_WIDTH - x;
+    if (w <= 0) return;
+    
+    bool force = !m_shadowValid;
+    uint16_t *p = &m_shadow[y * SHADOW_WIDTH + x];
+    int16_t first = -1, last = -1;
+    for (int16_t i = 0; i < w; i++) {
+        uint16_t pixel = swap ? swapBytes(src[i]) : src[i];
+        if (force || p[i] != pixel) {
+            p[i] = pixel;
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first >= 0) markChanged(x + first, y, x + last, y);
+}
+
+/* 与父类drawChar相同：6x8字符格（5x7字形+间隔），背景填充 */
+void Display_TFTManager::shadowChar(int16_t x, int16_t y, unsigned char c, uint16_t fg, uint16_t bg, uint8_t size) {
+    if ((x >= SHADOW_WIDTH) || (y >= SHADOW_HEIGHT) || (x + 6 * size - 1) < 0 || (y + 8 * size - 1) < 0) return;
+    if (c < 0x20 || c > 0x7E) return;
+    for (int i = 0; i < 6; i++) {
+        uint8_t line = (i < 5) ? font5x7[(c - 0x20) * 5 + i] : 0x00;
+        for (int j = 0; j < 8; j++, line >>= 1) {
+            shadowFill(x + i * size, y + j * size, size, size, (line & 0x01) ? fg : bg);
+        }
+    }
+}
+
+/* 文字属性和光标仍保存在TFT对象中，帧内外的print可以交替使用 */
+void Display_TFTManager::shadowText(const char* text) {
+    int16_t x = m_tft.getCursorX();
+    int16_t y = m_tft.getCursorY();
+    uint8_t size = m_tft.getFontSize();
+    uint16_t fg = swapBytes(m_tft.getForeground());
+    uint16_t bg = swapBytes(m_tft.getBackground());
+    
+    for (; *text != '\0'; text++) {
+        if (*text == '\n') {
+            x = 0;
+            y += size * 8;
+        } else if (*text != '\r') {
+            shadowChar(x, y, (unsigned char)*text, fg, bg, size);
+            x += size * 6;
+        }
+    }
+    m_tft.setCursor(x, y);
+}
+
+void Display_TFTManager::markChanged(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    if (x0 < m_opBox.x0) m_opBox.x0 = x0;
+    if (y0 < m_opBox.y0) m_opBox.y0 = y0;
+    if (x1 > m_opBox.x1) m_opBox.x1 = x1;
+    if (y1 > m_opBox.y1) m_opBox.y1 = y1;
+}
+
+/* 一次绘制调用结束：把其中实际变化的范围加入待发送区域 */
+void Display_TFTManager::commitShadowOp() {
+    if (m_opBox.x1 >= m_opBox.x0) {
+        addDirtyRect(m_opBox);
+    }
+    m_opBox.x0 = SHADOW_WIDTH;
+    m_opBox.y0 = SHADOW_HEIGHT;
+    m_opBox.x1 = -1;
+    m_opBox.y1 = -1;
+}
+
+static inline int32_t rectArea(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    return (int32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+}
+
+/* 合并后的包围矩形不比分开发送多（含窗口设置开销）时合并；区域数已满时并入面积增加最少的区域 */
+void Display_TFTManager::addDirtyRect(DirtyRect r) {
+    int i = 0;
+    while (i < m_dirtyCount) {
+        const DirtyRect &d = m_dirty[i];
+        int16_t ux0 = (r.x0 < d.x0) ? r.x0 : d.x0;
+        int16_t uy0 = (r.y0 < d.y0) ? r.y0 : d.y0;
+        int16_t ux1 = (r.x1 > d.x1) ? r.x1 : d.x1;
+        int16_t uy1 = (r.y1 > d.y1) ? r.y1 : d.y1;
+        if (rectArea(ux0, uy0, ux1, uy1) <= rectArea(r.x0, r.y0, r.x1, r.y1) + rectArea(d.x0, d.y0, d.x1, d.y1) + RECT_SETUP_PIXELS) {
+            r.x0 = ux0; r.y0 = uy0; r.x1 = ux1; r.y1 = uy1;
+            m_dirty[i] = m_dirty[--m_dirtyCount];
+            i = 0;  // 变大后可能与已检查过的区域可以合并
+        } else {
+            i++;
+        }
+    }
+    
+    if (m_dirtyCount == MAX_DIRTY_RECTS) {
+        int best = 0;
+        int32_t bestGrowth = 0;
+        for (i = 0; i < m_dirtyCount; i++) {
+            const DirtyRect &d = m_dirty[i];
+            int16_t ux0 = (r.x0 < d.x0) ? r.x0 : d.x0;
+            int16_t uy0 = (r.y0 < d.y0) ? r.y0 : d.y0;
+            int16_t ux1 = (r.x1 > d.x1) ? r.x1 : d.x1;
+            int16_t uy1 = (r.y1 > d.y1) ? r.y1 : d.y1;
+            int32_t growth = rectArea(ux0, uy0, ux1, uy1) - rectArea(d.x0, d.y0, d.x1, d.y1);
+            if (i == 0 || growth < bestGrowth) {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+        const DirtyRect d = m_dirty[best];
+        r.x0 = (r.x0 < d.x0) ? r.x0 : d.x0;
+        r.y0 = (r.y0 < d.y0) ? r.y0 : d.y0;
+        r.x1 = (r.x1 > d.x1) ? r.x1 : d.x1;
+        r.y1 = (r.y1 > d.y1) ? r.y1 : d.y1;
+        m_dirty[best] = m_dirty[--m_dirtyCount];
+        addDirtyRect(r);  // 合并结果可能还能与其他区域合并
+        return;
+    }
+    
+    m_dirty[m_dirtyCount++] = r;
+}
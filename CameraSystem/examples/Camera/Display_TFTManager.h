@@ -10,6 +10,7 @@
 #include <Arduino.h>
 #include "Display_AmebaST7789_DMA_SPI1.h"
 #include "Shared_GlobalDefines.h"
+#include <task.h>
 
 // TFT颜色定义
 #define ST7789_BLACK       0x0000
@@ -54,8 +55,10 @@ public:
     void drawRectangle(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
     void fillRectangle(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
     void drawBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *bitmap);
+    // RLE压缩的大端图像（Display_RleDecoder.h）：按条带解压到DMA缓冲区直接发送，不交换字节；图像不能超出屏幕左右边界
+    void drawRleImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *rle, size_t rleWords);
     
-    // 文本操作
+    // 文本操作（连续字符合成到条带缓冲区后一次送显）
     void setTextSize(uint8_t size);
     void setCursor(int16_t x, int16_t y);
     void setTextColor(uint16_t color);
@@ -63,9 +66,18 @@ public:
     void print(const char* text);
     void println(const char* text);
     
-    // 获取TFT对象引用（用于特殊操作）
+    // 影子帧缓冲区：beginFrame()之后，本任务经管理器的绘制只写入RAM中的整屏副本并记录变化区域，
+    // flush()合并变化区域后只发送这些矩形；未启用或分配失败时beginFrame()返回false，绘制照常直接送显
+    bool beginFrame();
+    void flush();
+    
+    // 获取TFT对象引用（用于特殊操作，调用后影子帧缓冲区视为与屏幕不一致）
     AmebaST7789_DMA_SPI1& getTFT();
     
+    // 屏幕尺寸（只读，不影响影子帧缓冲区）
+    int16_t width();
+    int16_t height();
+    
     // 状态检查
     bool isInitialized() const;
     
@@ -82,8 +94,44 @@ private:
     AmebaST7789_DMA_SPI1 m_tft;  // TFT显示对象
     bool m_initialized;          // 初始化状态标志
     
+    // 影子帧缓冲区（按发送到屏幕的字节顺序保存像素）
+    struct DirtyRect {
+        int16_t x0, y0, x1, y1;  // 包含边界
+    };
+    static const int16_t SHADOW_WIDTH = 320;
+    static const int16_t SHADOW_HEIGHT = 240;
+    static const int MAX_DIRTY_RECTS = 8;
+    static const int32_t RECT_SETUP_PIXELS = 32;  // 多发送一个矩形的窗口设置开销，折算为像素数
+    static const uint32_t RLE_STRIPE_PIXELS = 320UL * 40;  // RLE图像每次解压送显的像素数，解压下一条带与上一条带的传输重叠
+    static const int16_t TEXT_STRIP_WIDTH = 320;             // 文字条带最大宽度（像素）
+    static const uint8_t TEXT_STRIP_MAX_SIZE = 2;            // 条带合成支持的最大字号，更大的字号逐字符绘制
+    
+    uint16_t *m_shadow;
+    bool m_shadowValid;                        // 影子内容与屏幕一致，可按比较结果只发送变化部分
+    TaskHandle_t m_frameOwner;                 // 调用beginFrame()的任务，nullptr表示直接送显
+    DirtyRect m_dirty[MAX_DIRTY_RECTS];
+    int m_dirtyCount;
+    DirtyRect m_opBox;                         // 当前绘制操作中实际变化的像素范围
+    uint16_t m_textStrip[TEXT_STRIP_WIDTH * 8 * TEXT_STRIP_MAX_SIZE];  // 文字条带缓冲区
+    
     // 初始化SPI配置
     void initSPI();
+    
+    // 文字直接送显
+    void drawText(const char* text);
+    void drawTextRun(int16_t x, int16_t y, const char* chars, int count, uint8_t size);
+    
+    // 影子帧缓冲区绘制
+    bool drawToShadow();
+    bool clipToShadow(int16_t &x, int16_t &y, int16_t &w, int16_t &h);
+    void shadowFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t pixel);
+    void shadowBitmap(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *bitmap);
+    void shadowRow(int16_t x, int16_t y, int16_t w, const uint16_t *src, bool swap);
+    void shadowChar(int16_t x, int16_t y, unsigned char c, uint16_t fg, uint16_t bg, uint8_t size);
+    void shadowText(const char* text);
+    void markChanged(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+    void commitShadowOp();
+    void addDirtyRect(DirtyRect r);
 };
 
 // 全局TFT管理器实例声明
@@ -204,7 +204,6 @@ void taskISPConfig(void* pvParameters)
     
     extern Display_TFTManager tftManager;
     extern Display_FontRenderer fontRenderer;
-    extern JPEGDEC jpeg;
     extern CameraManager cameraManager;
     extern SDCardManager sdCardManager;
     extern EncoderControl encoder;
@@ -212,7 +211,7 @@ void taskISPConfig(void* pvParameters)
     
     if (!cameraManager.isInitialized()) {
         Utils_Logger::info("相机管理器未初始化，正在重新初始化...");
-        if (!cameraManager.init(tftManager, fontRenderer, jpeg)) {
+        if (!cameraManager.init(tftManager, fontRenderer)) {
             Utils_Logger::error("相机管理器重新初始化失败");
             vTaskDelete(NULL);
             return;
@@ -98,6 +98,20 @@ Inmp441MicrophoneManager::Inmp441MicrophoneManager()
     , m_recordedSamples(0)
     , m_writeBufferIndex(0)
     , m_audioQueue(NULL)
+    , m_playbackBuffer(nullptr)
+    , m_playbackSize(0)
+    , m_playbackHead(0)
+    , m_playbackTail(0)
+    , m_playbackRate(AUDIO_PLAYBACK_SAMPLE_RATE)
+    , m_playbackActive(false)
+    , m_playbackEnded(false)
+    , m_playbackStarved(false)
+    , m_pageHead(0)
+    , m_pageTail(0)
+    , m_playbackPlayed(0)
+    , m_playbackPageTime(0)
+    , m_playbackUnderruns(0)
+    , m_playbackUnderrunSamples(0)
 {
     s_microphoneManagerPtr = this;
 }
@@ -110,6 +124,7 @@ Inmp441MicrophoneManager::~Inmp441MicrophoneManager() {
         vQueueDelete(m_audioQueue);
         m_audioQueue = NULL;
     }
+    stopPlayback();
     s_microphoneManagerPtr = nullptr;
 }
 
@@ -571,6 +586,19 @@ void i2s_rx_callback(uint32_t id, char *pbuf) {
 void i2s_tx_callback(uint32_t id, char *pbuf) {
     (void)id;
     (void)pbuf;
+    
+    if (!s_microphoneManagerPtr || !s_microphoneManagerPtr->m_playbackActive) {
+        return;
+    }
+    
+    // 一页播放完成：计入已播放的有效样本，并补充下一页
+    Inmp441MicrophoneManager* mgr = s_microphoneManagerPtr;
+    if (mgr->m_pageTail != mgr->m_pageHead) {
+        mgr->m_playbackPlayed += mgr->m_pageSamples[mgr->m_pageTail % DMA_PAGE_NUM];
+        mgr->m_pageTail++;
+    }
+    mgr->m_playbackPageTime = micros();
+    mgr->sendPlaybackPage();
 }
 
 }
@@ -685,3 +713,143 @@ size_t Inmp441MicrophoneManager::getAudioQueueFree() {
     
     return uxQueueSpacesAvailable(m_audioQueue);
 }
+
+// ===============================================
+// 回放音频输出实现
+// ===============================================
+
+bool Inmp441MicrophoneManager::preparePlayback(size_t bufferSamples, uint32_t sampleRate) {
+    stopPlayback();
+    if (!m_i2sInitialized) {
+        return false;
+    }
+    // I2S时钟按录音配置（16kHz单声道）运行，回放与录音共用
+    if (sampleRate != AUDIO_PLAYBACK_SAMPLE_RATE) {
+        Utils_Logger::info("[Playback] 不支持的采样率: %u Hz", sampleRate);
+        return false;
+    }
+    
+    m_playbackBuffer = (int16_t*)malloc(bufferSamples * sizeof(int16_t));
+    if (!m_playbackBuffer) {
+        Utils_Logger::error("[Playback] 回放缓冲区分配失败: %u 样本", (uint32_t)bufferSamples);
+        return false;
+    }
+    m_playbackSize = bufferSamples;
+    m_playbackHead = 0;
+    m_playbackTail = 0;
+    m_playbackRate = sampleRate;
+    m_playbackEnded = false;
+    m_playbackStarved = false;
+    m_pageHead = 0;
+    m_pageTail = 0;
+    m_playbackPlayed = 0;
+    m_playbackUnderruns = 0;
+    m_playbackUnderrunSamples = 0;
+    return true;
+}
+
+bool Inmp441MicrophoneManager::startPlayback() {
+    if (!m_playbackBuffer || m_playbackActive) {
+        return false;
+    }
+    
+    // 切换为收发同时工作，录音侧的RX页继续循环
+    i2s_disable(&m_i2sObj);
+    i2s_set_direction(&m_i2sObj, I2S_DIR_TXRX);
+    m_playbackActive = true;
+    m_playbackPageTime = micros();
+    for (int i = 0; i < DMA_PAGE_NUM; i++) {
+        sendPlaybackPage();
+    }
+    i2s_enable(&m_i2sObj);
+    for (int i = 0; i < DMA_PAGE_NUM; i++) {
+        i2s_recv_page(&m_i2sObj);
+    }
+    return true;
+}
+
+void Inmp441MicrophoneManager::stopPlayback() {
+    if (m_playbackActive) {
+        m_playbackActive = false;
+        i2s_disable(&m_i2sObj);
+        i2s_set_direction(&m_i2sObj, I2S_DIR_RX);
+        i2s_enable(&m_i2sObj);
+        for (int i = 0; i < DMA_PAGE_NUM; i++) {
+            i2s_recv_page(&m_i2sObj);
+        }
+    }
+    if (m_playbackBuffer) {
+        free(m_playbackBuffer);
+        m_playbackBuffer = nullptr;
+    }
+    m_playbackSize = 0;
+    m_playbackHead = 0;
+    m_playbackTail = 0;
+}
+
+size_t Inmp441MicrophoneManager::writePlaybackSamples(const int16_t* samples, size_t count) {
+    if (!m_playbackBuffer) {
+        return 0;
+    }
+    size_t space = getPlaybackFree();
+    if (count > space) {
+        count = space;
+    }
+    uint32_t head = m_playbackHead;
+    for (size_t i = 0; i < count; i++) {
+        m_playbackBuffer[(head + i) % m_playbackSize] = samples[i];
+    }
+    // 数据写完后再发布新的写入位置，TX回调只读取已发布的样本
+    m_playbackHead = head + count;
+    return count;
+}
+
+// 从回放缓冲区取一页送入DMA，不足部分补静音（在TX回调或startPlayback中调用）
+void Inmp441MicrophoneManager::sendPlaybackPage() {
+    int16_t* page = (int16_t*)i2s_get_tx_page(&m_i2sObj);
+    if (!page) {
+        return;
+    }
+    
+    const uint32_t pageSamples = DMA_PAGE_SIZE / sizeof(int16_t);
+    uint32_t available = m_playbackHead - m_playbackTail;
+    uint32_t count = (available < pageSamples) ? available : pageSamples;
+    uint32_t tail = m_playbackTail;
+    for (uint32_t i = 0; i < count; i++) {
+        page[i] = m_playbackBuffer[(tail + i) % m_playbackSize];
+    }
+    if (count < pageSamples) {
+        memset(page + count, 0, (pageSamples - count) * sizeof(int16_t));
+        // 数据未结束却取不到完整一页即为欠载，连续欠载只计一次
+        if (!m_playbackEnded) {
+            if (!m_playbackStarved) {
+                m_playbackUnderruns++;
+            }
+            m_playbackUnderrunSamples += pageSamples - count;
+        }
+        m_playbackStarved = true;
+    } else {
+        m_playbackStarved = false;
+    }
+    m_playbackTail = tail + count;
+    
+    m_pageSamples[m_pageHead % DMA_PAGE_NUM] = (uint16_t)count;
+    m_pageHead++;
+    i2s_send_page(&m_i2sObj, (uint32_t*)page);
+}
+
+uint32_t Inmp441MicrophoneManager::getPlaybackPosition() {
+    if (!m_playbackActive) {
+        return m_playbackPlayed;
+    }
+    
+    taskENTER_CRITICAL();
+    uint32_t played = m_playbackPlayed;
+    uint32_t pageTime = m_playbackPageTime;
+    uint32_t current = (m_pageTail != m_pageHead) ? m_pageSamples[m_pageTail % DMA_PAGE_NUM] : 0;
+    taskEXIT_CRITICAL();
+    
+    // 当前正在播放的页只计入其中的有效样本，欠载时时钟停止前进
+    uint32_t elapsed = (uint32_t)((uint64_t)(micros() - pageTime) * m_playbackRate / 1000000);
+    return played + ((elapsed < current) ? elapsed : current);
+}
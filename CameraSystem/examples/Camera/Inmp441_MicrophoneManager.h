@@ -32,6 +32,7 @@
 #define I2S_SAMPLE_RATE   I2S_SR_16KHZ
 #define I2S_BITS_PER_SAMPLE I2S_WL_16
 #define I2S_CHANNELS      I2S_CH_MONO
+#define AUDIO_PLAYBACK_SAMPLE_RATE 16000  // 回放输出采样率（与I2S_SAMPLE_RATE一致）
 #define SERIAL_BAUD_RATE  115200
 #define DMA_PAGE_NUM   4
 #define DMA_PAGE_SIZE 1280
@@ -144,6 +145,23 @@ public:
     size_t getAudioQueueAvailable();
     size_t getAudioQueueFree();
     
+    // 回放音频输出（I2S TX）：DMA每播完一页，回调从回放缓冲区补下一页，已播放的采样数作为回放主时钟
+    // 调用顺序：preparePlayback分配缓冲区 → writePlaybackSamples预填 → startPlayback开始输出 → stopPlayback
+    bool preparePlayback(size_t bufferSamples, uint32_t sampleRate);
+    bool startPlayback();
+    void stopPlayback();
+    bool isPlaybackActive() const { return m_playbackActive; }
+    // 写入回放缓冲区（单一写入者），返回实际写入的样本数
+    size_t writePlaybackSamples(const int16_t* samples, size_t count);
+    size_t getPlaybackBuffered() const { return m_playbackHead - m_playbackTail; }
+    size_t getPlaybackFree() const { return m_playbackSize - getPlaybackBuffered(); }
+    // 音频数据已全部写入，之后缓冲区为空不再计为欠载
+    void setPlaybackEnded(bool ended) { m_playbackEnded = ended; }
+    // 已播放的采样数，按当前页开始播放后经过的时间插值
+    uint32_t getPlaybackPosition();
+    uint32_t getPlaybackUnderruns() const { return m_playbackUnderruns; }
+    uint32_t getPlaybackUnderrunSamples() const { return m_playbackUnderrunSamples; }
+    
     // 让回调函数可以访问私有成员
     friend void i2s_rx_callback(uint32_t id, char *pbuf);
     friend void i2s_tx_callback(uint32_t id, char *pbuf);
@@ -185,7 +203,25 @@ private:
     // RTOS音频队列
     QueueHandle_t m_audioQueue;
     
+    // 回放输出：m_playbackHead由写入者推进，m_playbackTail只在TX回调中推进
+    int16_t* m_playbackBuffer;
+    size_t m_playbackSize;
+    volatile uint32_t m_playbackHead;
+    volatile uint32_t m_playbackTail;
+    uint32_t m_playbackRate;
+    volatile bool m_playbackActive;
+    volatile bool m_playbackEnded;
+    volatile bool m_playbackStarved;
+    uint16_t m_pageSamples[DMA_PAGE_NUM];   // 已提交DMA的各页中的有效样本数（按提交顺序）
+    uint32_t m_pageHead;
+    uint32_t m_pageTail;
+    volatile uint32_t m_playbackPlayed;
+    volatile uint32_t m_playbackPageTime;   // 最近一页播放完成的时间（us）
+    uint32_t m_playbackUnderruns;
+    uint32_t m_playbackUnderrunSamples;
+    
     // 私有方法
+    void sendPlaybackPage();
     bool initI2S();
     bool initSDCard();
     void processAudioData();
@@ -0,0 +1,685 @@
+/*
+ * MJPEG_AVIRecovery.cpp - 未正常结束的AVI录像修复实现
+ * 录制中断电/复位会留下未回写长度字段、没有idx1的AVI文件，以及.idx临时索引文件
+ * 启动时以.idx临时文件为标记找到这些录像，遍历movi重建索引并原地修正各长度字段
+ * 重复帧只存在于索引中：帧数取自已写出ix##块的条目数，首段尾部和idx1由.idx中的条目重建
+ */
+
+#include "MJPEG_AVIRecovery.h"
+#include "Camera_SDCardManager.h"
+#include "Utils_Logger.h"
+
+extern SDCardManager sdCardManager;
+
+static void putLE32(uint8_t* buffer, uint32_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = (value >> 24) & 0xFF;
+}
+
+static void putLE64(uint8_t* buffer, uint64_t value) {
+    putLE32(buffer, (uint32_t)(value & 0xFFFFFFFF));
+    putLE32(buffer + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t getLE32(const uint8_t* buffer) {
+    return (uint32_t)buffer[0] |
+           (uint32_t)buffer[1] << 8 |
+           (uint32_t)buffer[2] << 16 |
+           (uint32_t)buffer[3] << 24;
+}
+
+bool AVIRecovery::readAt(FIL* file, uint64_t offset, void* data, uint32_t size) {
+    UINT bytesRead = 0;
+    return (f_lseek(file, offset) == FR_OK) &&
+           (f_read(file, data, size, &bytesRead) == FR_OK) &&
+           (bytesRead == size);
+}
+
+bool AVIRecovery::writeAt(FIL* file, uint64_t offset, const void* data, uint32_t size) {
+    UINT written = 0;
+    return (f_lseek(file, offset) == FR_OK) &&
+           (f_write(file, data, size, &written) == FR_OK) &&
+           (written == size);
+}
+
+uint32_t AVIRecovery::recoverUnfinishedRecordings() {
+    if (!sdCardManager.isInitialized()) {
+        return 0;
+    }
+
+    // 先收集文件名再修复，避免遍历目录时修改目录项
+    static char names[AVI_RECOVERY_MAX_FILES][64];
+    uint32_t nameCount = 0;
+
+    DIR dir;
+    FILINFO fno;
+    if (f_opendir(&dir, sdCardManager.getRootPath()) != FR_OK) {
+        Utils_Logger::error("AVI recovery: cannot open root directory");
+        return 0;
+    }
+
+    while (nameCount < AVI_RECOVERY_MAX_FILES) {
+        if (f_readdir(&dir, &fno) != FR_OK || fno.fname[0] == 0) {
+            break;
+        }
+        if (fno.fattrib & AM_DIR) {
+            continue;
+        }
+        const char* ext = strrchr(fno.fname, '.');
+        if (ext && strcasecmp(ext, ".idx") == 0 && strlen(fno.fname) < sizeof(names[0])) {
+            strcpy(names[nameCount++], fno.fname);
+        }
+    }
+    f_closedir(&dir);
+
+    if (nameCount == 0) {
+        return 0;
+    }
+
+    Utils_Logger::info("AVI recovery: found %d unfinished recording(s)", nameCount);
+
+    uint32_t recovered = 0;
+    char indexPath[128];
+    char aviPath[128];
+    for (uint32_t i = 0; i < nameCount; i++) {
+        snprintf(indexPath, sizeof(indexPath), "%s%s", sdCardManager.getRootPath(), names[i]);
+        strcpy(aviPath, indexPath);
+        strcpy(strrchr(aviPath, '.'), ".avi");
+
+        FILINFO aviInfo;
+        if (f_stat(aviPath, &aviInfo) != FR_OK) {
+            Utils_Logger::info("AVI recovery: orphan index %s removed", names[i]);
+        } else if (recoverFile(aviPath)) {
+            recovered++;
+        }
+
+        // 无论修复是否成功都删除标记，避免每次启动重复处理同一损坏文件
+        f_unlink(indexPath);
+    }
+
+    return recovered;
+}
+
+// 解析文件头：定位movi、avih/strh/dmlh长度字段所在位置以及两路indx
+// 长度字段位置通过header内容回填，返回的header缓冲区在修复完成后整体回写
+// 找到检查点记录时syncedEnd取其中的已同步长度，否则保持调用者给定的值
+bool AVIRecovery::parseHeader(FIL* file, uint8_t* header, uint32_t headerSize,
+                              AVIRecoveryStream* streams, uint32_t* moviPos, uint64_t* syncedEnd) {
+    if (!readAt(file, 0, header, headerSize)) {
+        return false;
+    }
+    if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "AVI ", 4) != 0) {
+        return false;
+    }
+
+    uint32_t strlIndex = 0;
+    uint32_t pos = 12;
+    while (pos + 12 <= headerSize) {
+        uint32_t size = getLE32(header + pos + 4);
+
+        if (memcmp(header + pos, "LIST", 4) == 0) {
+            if (memcmp(header + pos + 8, "movi", 4) == 0) {
+                *moviPos = pos;
+                return true;
+            }
+            if (memcmp(header + pos + 8, "strl", 4) == 0) {
+                strlIndex++;
+            }
+            // 进入hdrl/strl/odml列表内部
+            pos += 12;
+            continue;
+        }
+
+        if (memcmp(header + pos, "indx", 4) == 0 && strlIndex >= 1 && strlIndex <= AVI_STREAM_COUNT) {
+            streams[strlIndex - 1].indxOffset = pos;
+        }
+
+        if (memcmp(header + pos, "JUNK", 4) == 0 && size >= 12 && pos + 8 + 12 <= headerSize &&
+            memcmp(header + pos + 8, AVI_CHECKPOINT_TAG, 4) == 0) {
+            *syncedEnd = (uint64_t)getLE32(header + pos + 12) | ((uint64_t)getLE32(header + pos + 16) << 32);
+        }
+
+        // 音频nBlockAlign决定时长单位：PCM每2字节一个采样，IMA-ADPCM每块一个单位
+        if (memcmp(header + pos, "strf", 4) == 0 && strlIndex == AVI_STREAM_AUDIO + 1 && size >= 14) {
+            uint32_t blockAlign = header[pos + 8 + 12] | (header[pos + 8 + 13] << 8);
+            if (blockAlign > 0) {
+                streams[AVI_STREAM_AUDIO].blockAlign = blockAlign;
+            }
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    return false;
+}
+
+// 遍历movi（含后续RIFF AVIX段），重建超级索引并记录最后一个ix##之后的数据块，返回最后一个完整块的结束位置
+// 已写出的ix##块包含只写索引的重复帧，时长和帧数按其条目数累计，不按实际数据块计数
+bool AVIRecovery::walkMovi(FIL* file, uint64_t fileSize, uint32_t moviPos, AVIRecoveryStream* streams,
+                           AVIRiffSegment* segments, uint32_t* segmentCount,
+                           bool* hasIdx1, uint32_t* firstSegmentFrames, uint64_t* validEnd) {
+    memset(segments, 0, sizeof(AVIRiffSegment) * AVI_MAX_RIFF_SEGMENTS);
+    segments[0].riffPos = 0;
+    segments[0].moviPos = moviPos;
+    *segmentCount = 1;
+    *hasIdx1 = false;
+    *firstSegmentFrames = 0;
+
+    uint64_t pos = moviPos + 12;
+    *validEnd = pos;
+
+    uint8_t chunk[24];
+    while (pos + 8 <= fileSize) {
+        uint32_t headerSize = (fileSize - pos >= sizeof(chunk)) ? sizeof(chunk) : 8;
+        if (!readAt(file, pos, chunk, headerSize)) {
+            return false;
+        }
+
+        uint32_t size = getLE32(chunk + 4);
+        uint64_t end = pos + 8 + size + (size & 1);
+        AVIRiffSegment& segment = segments[*segmentCount - 1];
+
+        int streamId = -1;
+        for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+            if (memcmp(chunk, streams[i].chunkId, 4) == 0) {
+                streamId = i;
+            }
+        }
+
+        if (streamId >= 0) {
+            // 数据块不完整说明断电发生在写入过程中，从此处截断
+            if (end > fileSize) {
+                break;
+            }
+            AVIRecoveryStream& stream = streams[streamId];
+            uint32_t duration = (streamId == AVI_STREAM_VIDEO) ? 1 : (size + (size & 1)) / stream.blockAlign;
+            if (stream.tailCount < AVI_STD_INDEX_ENTRIES) {
+                uint8_t* entry = stream.tailEntries + stream.tailCount * 8;
+                putLE32(entry, (uint32_t)(pos + 8 - segment.moviPos));
+                putLE32(entry + 4, size);
+                stream.tailCount++;
+                stream.tailDuration += duration;
+            }
+            stream.chunkCount++;
+        } else if (chunk[0] == 'i' && chunk[1] == 'x') {
+            uint32_t entries = (headerSize == sizeof(chunk)) ? getLE32(chunk + 12) : 0;
+            if (end > fileSize || size < 24 || entries > AVI_STD_INDEX_ENTRIES || 24 + entries * 8 > size) {
+                break;
+            }
+            // ix##块覆盖自上一个ix##以来该流的全部条目；视频条目含重复帧，时长即条目数
+            int ixStream = (chunk[3] == '1') ? AVI_STREAM_AUDIO : AVI_STREAM_VIDEO;
+            AVIRecoveryStream& stream = streams[ixStream];
+            uint32_t duration = (ixStream == AVI_STREAM_VIDEO) ? entries : stream.tailDuration;
+            if (stream.superCount < AVI_SUPER_INDEX_ENTRIES) {
+                AVISuperIndexEntry& super = stream.superEntries[stream.superCount++];
+                super.offset = pos;
+                super.size = 8 + size;
+                super.duration = duration;
+            }
+            stream.indexedCount += entries;
+            stream.totalDuration += duration;
+            if (ixStream == AVI_STREAM_VIDEO && *segmentCount == 1) {
+                *firstSegmentFrames += entries;
+            }
+            stream.tailCount = 0;
+            stream.tailDuration = 0;
+        } else if (memcmp(chunk, "idx1", 4) == 0) {
+            if (end > fileSize || *segmentCount != 1) {
+                break;
+            }
+            segment.moviEnd = pos;
+            segment.riffEnd = end;
+            *hasIdx1 = true;
+        } else if (memcmp(chunk, "RIFF", 4) == 0 && headerSize == sizeof(chunk) &&
+                   memcmp(chunk + 8, "AVIX", 4) == 0 && memcmp(chunk + 20, "movi", 4) == 0) {
+            if (*segmentCount >= AVI_MAX_RIFF_SEGMENTS) {
+                break;
+            }
+            if (segment.moviEnd == 0) {
+                segment.moviEnd = pos;
+            }
+            segment.riffEnd = pos;
+
+            AVIRiffSegment& next = segments[(*segmentCount)++];
+            next.riffPos = pos;
+            next.moviPos = pos + 12;
+            next.moviEnd = 0;
+            next.riffEnd = 0;
+            for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+                streams[i].tailCount = 0;
+                streams[i].tailDuration = 0;
+            }
+            end = pos + 24;
+        } else if (memcmp(chunk, "JUNK", 4) == 0) {
+            if (end > fileSize) {
+                break;
+            }
+        } else {
+            Utils_Logger::info("AVI recovery: unknown chunk at %llu, truncating", pos);
+            break;
+        }
+
+        pos = end;
+        *validEnd = pos;
+    }
+
+    return true;
+}
+
+// 为最后一个ix##之后的数据块补写标准索引（写在文件末尾，仍位于当前段movi内）
+bool AVIRecovery::writeTailIndex(FIL* file, AVIRecoveryStream& stream, uint64_t moviPos) {
+    if (stream.tailCount == 0) {
+        return true;
+    }
+
+    uint64_t indexPos = f_tell(file);
+    uint32_t dataSize = 24 + stream.tailCount * 8;
+
+    uint8_t header[32];
+    header[0] = 'i';
+    header[1] = 'x';
+    header[2] = stream.chunkId[0];
+    header[3] = stream.chunkId[1];
+    putLE32(header + 4, dataSize);
+    header[8] = 2;                     // wLongsPerEntry
+    header[9] = 0;
+    header[10] = 0;                    // bIndexSubType
+    header[11] = 0x01;                 // bIndexType = AVI_INDEX_OF_CHUNKS
+    putLE32(header + 12, stream.tailCount);
+    memcpy(header + 16, stream.chunkId, 4);
+    putLE64(header + 20, moviPos);
+    putLE32(header + 28, 0);
+
+    UINT written = 0;
+    if (f_write(file, header, sizeof(header), &written) != FR_OK || written != sizeof(header) ||
+        f_write(file, stream.tailEntries, stream.tailCount * 8, &written) != FR_OK ||
+        written != stream.tailCount * 8) {
+        return false;
+    }
+
+    if (stream.superCount < AVI_SUPER_INDEX_ENTRIES) {
+        AVISuperIndexEntry& super = stream.superEntries[stream.superCount++];
+        super.offset = indexPos;
+        super.size = 8 + dataSize;
+        super.duration = stream.tailDuration;
+    }
+    stream.indexedCount += stream.tailCount;
+    stream.totalDuration += stream.tailDuration;
+    stream.tailCount = 0;
+    stream.tailDuration = 0;
+    return true;
+}
+
+// 用.idx临时索引重建首段最后一个ix##之后的视频条目
+// walkMovi得到的尾部条目只有实际数据块；.idx按写入顺序记录了全部条目，其中与上一个视频条目位置相同的是重复帧
+// 跳过已写出ix##块覆盖的条目后逐条对照，遇到越界或与movi不一致的条目即停止，之后的数据块沿用walkMovi结果
+// usableEntries返回可信的.idx条目数（两路流合计），idx1只复制这些条目
+bool AVIRecovery::mergeTempIndex(FIL* file, const char* indexPath, uint32_t moviPos, uint64_t dataEnd,
+                                 AVIRecoveryStream& video, uint32_t* usableEntries) {
+    *usableEntries = 0;
+
+    FIL indexFile;
+    if (f_open(&indexFile, indexPath, FA_READ) != FR_OK) {
+        return true;
+    }
+
+    uint8_t* batch = (uint8_t*)malloc(AVI_INDEX_BUFFER_SIZE);
+    uint8_t* merged = (uint8_t*)malloc(AVI_STD_INDEX_ENTRIES * 8);
+    if (!batch || !merged) {
+        free(batch);
+        free(merged);
+        f_close(&indexFile);
+        return false;
+    }
+
+    uint64_t moviDataStart = moviPos + 12;
+    uint32_t videoSeen = 0;
+    uint32_t walkIndex = 0;
+    uint32_t mergedCount = 0;
+    uint64_t lastVideoPos = 0;
+    bool consistent = true;
+    bool ok = true;
+
+    while (ok && consistent) {
+        UINT bytesRead = 0;
+        ok = (f_read(&indexFile, batch, AVI_INDEX_BUFFER_SIZE, &bytesRead) == FR_OK);
+        if (!ok) {
+            break;
+        }
+
+        for (uint32_t i = 0; i + 16 <= bytesRead; i += 16) {
+            const uint8_t* entry = batch + i;
+            bool isVideo = memcmp(entry, "00db", 4) == 0;
+            uint64_t pos = moviDataStart + getLE32(entry + 8);
+            if ((!isVideo && memcmp(entry, "01wb", 4) != 0) || pos + 8 + getLE32(entry + 12) > dataEnd) {
+                consistent = false;
+                break;
+            }
+
+            if (isVideo && videoSeen >= video.indexedCount) {
+                uint32_t relative = (uint32_t)(pos + 8 - moviPos);
+                uint8_t* out = merged + mergedCount * 8;
+                if (mergedCount >= AVI_STD_INDEX_ENTRIES) {
+                    consistent = false;
+                } else if (walkIndex < video.tailCount && getLE32(video.tailEntries + walkIndex * 8) == relative) {
+                    memcpy(out, video.tailEntries + walkIndex * 8, 8);
+                    walkIndex++;
+                } else if (videoSeen > 0 && pos == lastVideoPos) {
+                    // 重复帧：与上一个视频条目指向同一数据块，数据块位于上一个ix##之前时读块头取得实际大小
+                    uint8_t chunk[8];
+                    if (mergedCount > 0) {
+                        memcpy(out, out - 8, 8);
+                    } else if (readAt(file, pos, chunk, 8)) {
+                        putLE32(out, relative);
+                        memcpy(out + 4, chunk + 4, 4);
+                    } else {
+                        consistent = false;
+                    }
+                } else {
+                    consistent = false;
+                }
+                if (!consistent) {
+                    break;
+                }
+                mergedCount++;
+            }
+            if (isVideo) {
+                lastVideoPos = pos;
+                videoSeen++;
+            }
+            (*usableEntries)++;
+        }
+
+        if (bytesRead < AVI_INDEX_BUFFER_SIZE) {
+            break;
+        }
+    }
+    f_close(&indexFile);
+
+    if (videoSeen < video.indexedCount) {
+        Utils_Logger::info("AVI recovery: temp index behind ix## blocks (%u < %u video entries)",
+                          videoSeen, video.indexedCount);
+    }
+
+    // .idx未覆盖的数据块（最后一次同步之后写入）按walkMovi结果追加
+    while (walkIndex < video.tailCount && mergedCount < AVI_STD_INDEX_ENTRIES) {
+        memcpy(merged + mergedCount * 8, video.tailEntries + walkIndex * 8, 8);
+        walkIndex++;
+        mergedCount++;
+    }
+
+    Utils_Logger::info("AVI recovery: tail video entries %u -> %u (duplicates restored from temp index)",
+                      video.tailCount, mergedCount);
+    free(video.tailEntries);
+    video.tailEntries = merged;
+    video.tailCount = mergedCount;
+    video.tailDuration = mergedCount;
+
+    free(batch);
+    return ok;
+}
+
+// 在首段movi之后写入idx1：先复制.idx中可信的条目（含重复帧），再遍历其后的movi补齐最后一次同步之后写入的数据块
+bool AVIRecovery::writeIdx1(FIL* file, const char* indexPath, uint32_t usableEntries, uint32_t moviPos,
+                            uint64_t moviEnd, uint32_t* videoEntries) {
+    *videoEntries = 0;
+
+    uint8_t* batch = (uint8_t*)malloc(AVI_INDEX_BUFFER_SIZE);
+    if (!batch) {
+        return false;
+    }
+
+    uint64_t headerPos = moviEnd;
+    uint64_t writePos = headerPos + 8;
+    uint32_t entryCount = 0;
+    uint32_t moviDataStart = moviPos + 12;
+    uint64_t resumePos = moviDataStart;
+    bool ok = true;
+
+    FIL indexFile;
+    if (usableEntries > 0 && f_open(&indexFile, indexPath, FA_READ) == FR_OK) {
+        while (ok && entryCount < usableEntries) {
+            uint32_t count = usableEntries - entryCount;
+            if (count > AVI_INDEX_BUFFER_SIZE / 16) {
+                count = AVI_INDEX_BUFFER_SIZE / 16;
+            }
+            UINT bytesRead = 0;
+            ok = (f_read(&indexFile, batch, count * 16, &bytesRead) == FR_OK) && (bytesRead == count * 16) &&
+                 writeAt(file, writePos, batch, count * 16);
+            for (uint32_t i = 0; ok && i < count; i++) {
+                const uint8_t* entry = batch + i * 16;
+                uint64_t end = moviDataStart + getLE32(entry + 8) + 8 + getLE32(entry + 12);
+                if (end > resumePos) {
+                    resumePos = end;
+                }
+                if (memcmp(entry, "00db", 4) == 0) {
+                    (*videoEntries)++;
+                }
+            }
+            writePos += count * 16;
+            entryCount += count;
+        }
+        f_close(&indexFile);
+    }
+
+    uint32_t batchPos = 0;
+    uint64_t pos = resumePos;
+    uint8_t chunk[8];
+    while (ok && pos + 8 <= moviEnd) {
+        ok = readAt(file, pos, chunk, 8);
+        if (!ok) {
+            break;
+        }
+        uint32_t size = getLE32(chunk + 4);
+        uint32_t paddedSize = size + (size & 1);
+
+        bool isVideo = memcmp(chunk, "00db", 4) == 0;
+        if (isVideo || memcmp(chunk, "01wb", 4) == 0) {
+            uint8_t* entry = batch + batchPos;
+            memcpy(entry, chunk, 4);
+            putLE32(entry + 4, isVideo ? 0x00000010 : 0x00000000);
+            putLE32(entry + 8, (uint32_t)(pos - moviDataStart));
+            putLE32(entry + 12, paddedSize);
+            batchPos += 16;
+            entryCount++;
+            if (isVideo) {
+                (*videoEntries)++;
+            }
+
+            if (batchPos == AVI_INDEX_BUFFER_SIZE) {
+                ok = writeAt(file, writePos, batch, batchPos);
+                writePos += batchPos;
+                batchPos = 0;
+            }
+        }
+        pos += 8 + paddedSize;
+    }
+
+    if (ok && batchPos > 0) {
+        ok = writeAt(file, writePos, batch, batchPos);
+        writePos += batchPos;
+    }
+
+    // 条目总数在复制和遍历之后才确定，最后回写idx1块头
+    memcpy(batch, "idx1", 4);
+    putLE32(batch + 4, entryCount * 16);
+    ok = ok && writeAt(file, headerPos, batch, 8);
+
+    free(batch);
+    return ok && f_lseek(file, writePos) == FR_OK;
+}
+
+bool AVIRecovery::recoverFile(const char* aviPath) {
+    uint32_t startTime = millis();
+    Utils_Logger::info("AVI recovery: repairing %s", aviPath);
+
+    FIL file;
+    if (f_open(&file, aviPath, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK) {
+        Utils_Logger::error("AVI recovery: cannot open %s", aviPath);
+        return false;
+    }
+    uint64_t fileSize = f_size(&file);
+
+    // 对应的.idx临时索引（首段idx1条目，含重复帧）
+    char indexPath[128];
+    strncpy(indexPath, aviPath, sizeof(indexPath) - 5);
+    indexPath[sizeof(indexPath) - 5] = '\0';
+    char* dot = strrchr(indexPath, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    strcat(indexPath, ".idx");
+
+    AVIRecoveryStream streams[AVI_STREAM_COUNT];
+    memset(streams, 0, sizeof(streams));
+    memcpy(streams[AVI_STREAM_VIDEO].chunkId, "00db", 4);
+    memcpy(streams[AVI_STREAM_AUDIO].chunkId, "01wb", 4);
+    streams[AVI_STREAM_VIDEO].blockAlign = 1;
+    streams[AVI_STREAM_AUDIO].blockAlign = 2;
+
+    uint32_t headerSize = fileSize < AVI_HEADER_BUFFER_SIZE ? (uint32_t)fileSize : AVI_HEADER_BUFFER_SIZE;
+    uint8_t* header = (uint8_t*)malloc(AVI_HEADER_BUFFER_SIZE);
+    AVIRiffSegment* segments = (AVIRiffSegment*)malloc(sizeof(AVIRiffSegment) * AVI_MAX_RIFF_SEGMENTS);
+    bool allocated = header && segments;
+    for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+        streams[i].superEntries = (AVISuperIndexEntry*)malloc(sizeof(AVISuperIndexEntry) * AVI_SUPER_INDEX_ENTRIES);
+        streams[i].tailEntries = (uint8_t*)malloc(AVI_STD_INDEX_ENTRIES * 8);
+        allocated = allocated && streams[i].superEntries && streams[i].tailEntries;
+    }
+
+    bool ok = false;
+    uint32_t moviPos = 0;
+    uint32_t segmentCount = 0;
+    uint32_t firstSegmentFrames = 0;
+    bool hasIdx1 = false;
+    bool removed = false;
+    uint64_t validEnd = 0;
+    // 遍历上限：最后一次检查点已同步的长度（旧文件没有检查点记录时为文件大小）
+    uint64_t scanEnd = fileSize;
+
+    if (!allocated) {
+        Utils_Logger::error("AVI recovery: out of memory");
+    } else if (!parseHeader(&file, header, headerSize, streams, &moviPos, &scanEnd)) {
+        Utils_Logger::error("AVI recovery: invalid header in %s", aviPath);
+    } else if (!walkMovi(&file, scanEnd < fileSize ? scanEnd : fileSize, moviPos, streams, segments, &segmentCount,
+                         &hasIdx1, &firstSegmentFrames, &validEnd)) {
+        Utils_Logger::error("AVI recovery: read error while scanning movi");
+    } else {
+        ok = true;
+    }
+
+    AVIRecoveryStream& video = streams[AVI_STREAM_VIDEO];
+    AVIRecoveryStream& audio = streams[AVI_STREAM_AUDIO];
+
+    if (ok && video.chunkCount == 0) {
+        // 断电前没有任何完整视频帧，文件没有保留价值
+        Utils_Logger::info("AVI recovery: no complete frame, removing %s", aviPath);
+        f_close(&file);
+        f_unlink(aviPath);
+        ok = false;
+        removed = true;
+    }
+
+    if (ok) {
+        Utils_Logger::info("AVI recovery: %u video chunks, %u audio chunks, %u segment(s), valid %llu/%llu bytes",
+                          video.chunkCount, audio.chunkCount, segmentCount, validEnd, fileSize);
+
+        // 截掉末尾不完整的数据块
+        ok = (f_lseek(&file, validEnd) == FR_OK) && (f_truncate(&file) == FR_OK);
+
+        AVIRiffSegment& last = segments[segmentCount - 1];
+        bool lastClosed = (segmentCount == 1 && hasIdx1);
+        if (ok && !lastClosed) {
+            // 首段尚未写出idx1时.idx覆盖全部条目：用它补回尾部的重复帧，idx1也从它复制
+            uint32_t usableEntries = 0;
+            if (segmentCount == 1) {
+                // 合并时可能读取movi中的块头，之后回到截断位置继续追加
+                ok = mergeTempIndex(&file, indexPath, moviPos, validEnd, video, &usableEntries) &&
+                     (f_lseek(&file, validEnd) == FR_OK);
+            }
+            ok = ok && writeTailIndex(&file, video, last.moviPos) && writeTailIndex(&file, audio, last.moviPos);
+            last.moviEnd = f_tell(&file);
+            if (ok && segmentCount == 1) {
+                ok = writeIdx1(&file, indexPath, usableEntries, moviPos, last.moviEnd, &firstSegmentFrames);
+                if (ok && firstSegmentFrames != video.totalDuration) {
+                    Utils_Logger::info("AVI recovery: idx1 has %u video entries, ix## %u", firstSegmentFrames, video.totalDuration);
+                }
+            }
+            last.riffEnd = f_tell(&file);
+        }
+
+        // 回写各RIFF段的RIFF/movi大小
+        for (uint32_t i = 1; ok && i < segmentCount; i++) {
+            uint8_t value[4];
+            putLE32(value, (uint32_t)(segments[i].riffEnd - segments[i].riffPos - 8));
+            ok = writeAt(&file, segments[i].riffPos + 4, value, 4);
+            putLE32(value, (uint32_t)(segments[i].moviEnd - segments[i].moviPos - 8));
+            ok = ok && writeAt(&file, segments[i].moviPos + 4, value, 4);
+        }
+
+        // 文件头中的长度、帧数和超级索引在内存中更新后一次回写
+        if (ok) {
+            putLE32(header + 4, (uint32_t)(segments[0].riffEnd - 8));
+            putLE32(header + moviPos + 4, (uint32_t)(segments[0].moviEnd - moviPos - 8));
+
+            uint32_t strhIndex = 0;
+            uint32_t pos = 12;
+            while (pos + 12 <= moviPos) {
+                uint32_t size = getLE32(header + pos + 4);
+                if (memcmp(header + pos, "LIST", 4) == 0) {
+                    pos += 12;
+                    continue;
+                }
+                if (memcmp(header + pos, "avih", 4) == 0) {
+                    putLE32(header + pos + 8 + 16, firstSegmentFrames);
+                } else if (memcmp(header + pos, "strh", 4) == 0 && strhIndex < AVI_STREAM_COUNT) {
+                    putLE32(header + pos + 8 + 32, streams[strhIndex++].totalDuration);
+                } else if (memcmp(header + pos, "dmlh", 4) == 0) {
+                    putLE32(header + pos + 8, video.totalDuration);
+                }
+                pos += 8 + size + (size & 1);
+            }
+
+            for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+                if (streams[i].indxOffset == 0) {
+                    continue;
+                }
+                uint8_t* chunk = header + streams[i].indxOffset;
+                putLE32(chunk + 12, streams[i].superCount);
+                uint8_t* entry = chunk + 32;
+                for (uint32_t j = 0; j < streams[i].superCount; j++) {
+                    putLE64(entry, streams[i].superEntries[j].offset);
+                    putLE32(entry + 8, streams[i].superEntries[j].size);
+                    putLE32(entry + 12, streams[i].superEntries[j].duration);
+                    entry += 16;
+                }
+            }
+
+            ok = writeAt(&file, 0, header, moviPos + 12);
+        }
+
+        if (f_sync(&file) != FR_OK) {
+            ok = false;
+        }
+    }
+
+    if (!removed) {
+        f_close(&file);
+    }
+
+    free(header);
+    free(segments);
+    for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+        free(streams[i].superEntries);
+        free(streams[i].tailEntries);
+    }
+
+    if (ok) {
+        Utils_Logger::info("AVI recovery: %s repaired in %u ms", aviPath, millis() - startTime);
+    } else if (!removed) {
+        Utils_Logger::error("AVI recovery: failed to repair %s", aviPath);
+    }
+    return ok;
+}
@@ -0,0 +1,54 @@
+/*
+ * MJPEG_AVIRecovery.h - 未正常结束的AVI录像修复
+ * 录制中断电/复位会留下未回写长度字段、没有idx1的AVI文件，以及.idx临时索引文件
+ * 启动时以.idx临时文件为标记找到这些录像，遍历movi重建索引并原地修正各长度字段
+ * 重复帧只存在于索引中：帧数取自已写出ix##块的条目数，首段尾部和idx1由.idx中的条目重建
+ */
+
+#ifndef MJPEG_AVI_RECOVERY_H
+#define MJPEG_AVI_RECOVERY_H
+
+#include <Arduino.h>
+#include "AmebaFatFS.h"
+#include "MJPEG_Encoder.h"
+
+#define AVI_RECOVERY_MAX_FILES  8      // 单次启动最多修复的录像数
+
+// 单路流的修复状态
+struct AVIRecoveryStream {
+    char chunkId[4];
+    uint32_t indxOffset;               // 文件头中indx块位置（0表示未找到）
+    uint32_t blockAlign;               // 时长单位字节数（音频取strf.nBlockAlign，视频按帧计为1）
+    AVISuperIndexEntry* superEntries;  // 重建的超级索引
+    uint32_t superCount;
+    uint8_t* tailEntries;              // 最后一个ix##块之后尚未建立标准索引的条目
+    uint32_t tailCount;
+    uint32_t tailDuration;
+    uint32_t chunkCount;               // movi中完整的数据块数（不含只写索引的重复帧）
+    uint32_t indexedCount;             // 已写出ix##块中的条目数（视频含重复帧）
+    uint32_t totalDuration;
+};
+
+class AVIRecovery {
+public:
+    // 扫描根目录，修复所有留有.idx临时文件的录像，返回修复成功的文件数
+    static uint32_t recoverUnfinishedRecordings();
+    // 修复单个AVI文件（aviPath为完整路径）
+    static bool recoverFile(const char* aviPath);
+
+private:
+    static bool parseHeader(FIL* file, uint8_t* header, uint32_t headerSize,
+                            AVIRecoveryStream* streams, uint32_t* moviPos, uint64_t* syncedEnd);
+    static bool walkMovi(FIL* file, uint64_t fileSize, uint32_t moviPos, AVIRecoveryStream* streams,
+                         AVIRiffSegment* segments, uint32_t* segmentCount,
+                         bool* hasIdx1, uint32_t* firstSegmentFrames, uint64_t* validEnd);
+    static bool mergeTempIndex(FIL* file, const char* indexPath, uint32_t moviPos, uint64_t dataEnd,
+                               AVIRecoveryStream& video, uint32_t* usableEntries);
+    static bool writeTailIndex(FIL* file, AVIRecoveryStream& stream, uint64_t moviPos);
+    static bool writeIdx1(FIL* file, const char* indexPath, uint32_t usableEntries, uint32_t moviPos,
+                          uint64_t moviEnd, uint32_t* videoEntries);
+    static bool readAt(FIL* file, uint64_t offset, void* data, uint32_t size);
+    static bool writeAt(FIL* file, uint64_t offset, const void* data, uint32_t size);
+};
+
+#endif // MJPEG_AVI_RECOVERY_H
@@ -25,6 +25,12 @@ void writeLE16(uint8_t* buffer, uint16_t value) {
     buffer[1] = (value >> 8) & 0xFF;
 }
 
+// 辅助函数：以小端字节序写入64位整数
+static void writeLE64(uint8_t* buffer, uint64_t value) {
+    writeLE32(buffer, (uint32_t)(value & 0xFFFFFFFF));
+    writeLE32(buffer + 4, (uint32_t)(value >> 32));
+}
+
 MJPEGEncoder::MJPEGEncoder()
     : m_recording(false)
     , m_width(0)
@@ -33,29 +39,57 @@ MJPEGEncoder::MJPEGEncoder()
     , m_frameCount(0)
     , m_audioFrameCount(0)
     , m_totalAudioSamples(0)
+    , m_audioLength(0)
     , m_fileSize(0)
+    , m_audioCodec(AVI_AUDIO_PCM)
+    , m_audioStageCount(0)
+    , m_videoStarted(false)
+    , m_videoStartTime(0)
+    , m_lastVideoChunkPos(0)
+    , m_lastVideoChunkSize(0)
+    , m_duplicatedFrames(0)
+    , m_droppedEarlyFrames(0)
+    , m_audioPaddedSamples(0)
+    , m_audioDroppedSamples(0)
     , m_buffer(nullptr)
-    , m_bufferSize(0)
+    , m_bufferSize(AVI_HEADER_BUFFER_SIZE)
     , m_bufferPos(0)
-    , m_maxBufferSize(15 * 1024 * 1024)
     , m_moviStartPos(0)
     , m_moviDataStart(0)
     , m_totalFramesOffset(0)
     , m_videoStrhLengthOffset(0)
     , m_audioStrhLengthOffset(0)
-    , m_indexEntries(nullptr)
+    , m_dmlhFramesOffset(0)
+    , m_checkpointEndOffset(0)
     , m_indexEntryCount(0)
-    , m_indexCapacity(0)
+    , m_segmentCount(0)
+    , m_firstSegmentFrames(0)
+    , m_lastCheckpointTime(0)
+    , m_checkpointCount(0)
+    , m_preallocateSeconds(0)
     , m_mutex(nullptr)
 {
     memset(m_fileName, 0, sizeof(m_fileName));
+    memset(m_indexFileName, 0, sizeof(m_indexFileName));
+    memset(m_streams, 0, sizeof(m_streams));
+    memset(m_segments, 0, sizeof(m_segments));
+    memcpy(m_streams[AVI_STREAM_VIDEO].chunkId, "00db", 4);
+    memcpy(m_streams[AVI_STREAM_VIDEO].indexId, "ix00", 4);
+    memcpy(m_streams[AVI_STREAM_AUDIO].chunkId, "01wb", 4);
+    memcpy(m_streams[AVI_STREAM_AUDIO].indexId, "ix01", 4);
     m_mutex = xSemaphoreCreateMutex();
 }
 
 MJPEGEncoder::~MJPEGEncoder() {
-    if (m_indexEntries) {
-        free(m_indexEntries);
-        m_indexEntries = nullptr;
+    if (m_buffer) {
+        free(m_buffer);
+        m_buffer = nullptr;
+    }
+    for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+        if (m_streams[i].entries) {
+            free(m_streams[i].entries);
+            m_streams[i].entries = nullptr;
+        }
     }
     if (m_mutex) {
         vSemaphoreDelete(m_mutex);
@@ -63,12 +97,19 @@ MJPEGEncoder::~MJPEGEncoder() {
     }
 }
 
-bool MJPEGEncoder::begin(const char* fileName, uint32_t width, uint32_t height, uint32_t fps) {
+bool MJPEGEncoder::begin(const char* fileName, uint32_t width, uint32_t height, uint32_t fps,
+                         AVIAudioCodec audioCodec) {
     if (m_recording) {
         Utils_Logger::error("MJPEGEncoder already recording");
         return false;
     }
     
+    // 上次结束时未排空的写入器先尝试关闭，否则无法重新打开
+    if (hasOpenWriters() && !retryCloseWriters()) {
+        Utils_Logger::error("MJPEGEncoder previous file still draining");
+        return false;
+    }
+    
     if (!sdCardManager.isInitialized()) {
         Utils_Logger::error("SDCardManager not initialized");
         return false;
@@ -81,106 +122,353 @@ bool MJPEGEncoder::begin(const char* fileName, uint32_t width, uint32_t height,
     m_frameCount = 0;
     m_audioFrameCount = 0;
     m_totalAudioSamples = 0;
+    m_audioLength = 0;
+    m_audioCodec = audioCodec;
+    if (m_audioCodec == AVI_AUDIO_IMA_ADPCM && AUDIO_CHANNELS != 1) {
+        Utils_Logger::info("IMA-ADPCM encoder supports mono only, recording PCM audio");
+        m_audioCodec = AVI_AUDIO_PCM;
+    }
+    m_adpcmEncoder.reset();
+    m_audioStageCount = 0;
+    m_videoStarted = false;
+    m_videoStartTime = 0;
+    m_lastVideoChunkPos = 0;
+    m_lastVideoChunkSize = 0;
+    m_duplicatedFrames = 0;
+    m_droppedEarlyFrames = 0;
+    m_audioPaddedSamples = 0;
+    m_audioDroppedSamples = 0;
     m_fileSize = 0;
     m_bufferPos = 0;
-    m_recording = true;
     m_indexEntryCount = 0;
-    m_indexCapacity = 2000;
-    
-    m_bufferSize = m_maxBufferSize + 131072;
+    m_segmentCount = 0;
+    m_firstSegmentFrames = 0;
+    
+    // 临时索引文件名：把扩展名替换为.idx
+    strncpy(m_indexFileName, fileName, sizeof(m_indexFileName) - 5);
+    char* dot = strrchr(m_indexFileName, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    strcat(m_indexFileName, ".idx");
     
-    m_buffer = (uint8_t*)malloc(m_bufferSize);
     if (!m_buffer) {
-        Utils_Logger::error("Failed to allocate buffer memory");
-        m_recording = false;
+        m_buffer = (uint8_t*)malloc(m_bufferSize);
+        if (!m_buffer) {
+            Utils_Logger::error("Failed to allocate header buffer");
+            return false;
+        }
+    }
+    memset(m_buffer, 0, m_bufferSize);
+    
+    for (int i = 0; i < AVI_STREAM_COUNT; i++) {
+        AVIStreamIndex& stream = m_streams[i];
+        if (!stream.entries) {
+            stream.entries = (uint8_t*)malloc(AVI_STD_INDEX_ENTRIES * 8);
+            if (!stream.entries) {
+                Utils_Logger::error("Failed to allocate standard index memory");
+                return false;
+            }
+        }
+        stream.entryCount = 0;
+        stream.duration = 0;
+        stream.superCount = 0;
+    }
+    
+    if (!m_writer.open(m_fileName)) {
+        Utils_Logger::error("Failed to open AVI stream: %s", m_fileName);
         return false;
     }
     
-    m_indexEntries = (AVIIndexEntry*)malloc(m_indexCapacity * sizeof(AVIIndexEntry));
-    if (!m_indexEntries) {
-        Utils_Logger::error("Failed to allocate index memory");
-        free(m_buffer);
-        m_buffer = nullptr;
-        m_recording = false;
+    // 写缓冲按簇边界提交，FatFs可绕过扇区缓存直接多扇区写入
+    uint32_t clusterSize = sdCardManager.getClusterSize();
+    if (clusterSize > 0) {
+        m_writer.setAlignment(clusterSize);
+    }
+    
+    if (m_preallocateSeconds > 0) {
+        // 预分配在开始录制的调用路径上同步执行，记录耗时（含剩余空间查询）
+        uint32_t preallocStart = millis();
+        uint64_t preallocSize = (uint64_t)estimateBytesPerSecond() * m_preallocateSeconds;
+        if (preallocSize > AVI_PREALLOC_MAX_BYTES) {
+            preallocSize = AVI_PREALLOC_MAX_BYTES;
+        }
+        SDCardManager::StorageInfo info;
+        if (sdCardManager.getStorageInfo(&info)) {
+            uint64_t available = info.freeBytes > AVI_PREALLOC_FREE_RESERVE ? info.freeBytes - AVI_PREALLOC_FREE_RESERVE : 0;
+            if (preallocSize > available) {
+                preallocSize = available;
+            }
+        }
+        if (preallocSize > 0 && m_writer.preallocate(preallocSize)) {
+            Utils_Logger::info("Preallocated %llu bytes contiguous (%u s requested) in %u ms, cluster %u bytes",
+                              preallocSize, m_preallocateSeconds, millis() - preallocStart, clusterSize);
+        } else {
+            Utils_Logger::info("Preallocation unavailable after %u ms, falling back to normal allocation",
+                              millis() - preallocStart);
+        }
+    }
+    
+    if (!m_indexWriter.open(m_indexFileName, AVI_INDEX_BUFFER_SIZE, 2)) {
+        Utils_Logger::error("Failed to open index stream: %s", m_indexFileName);
+        m_writer.close();
         return false;
     }
     
-    if (!writeAVIHeader()) {
+    if (!writeAVIHeader() || !m_writer.append(m_buffer, m_bufferPos)) {
         Utils_Logger::error("Failed to write AVI header");
-        free(m_buffer);
-        m_buffer = nullptr;
-        if (m_indexEntries) {
-            free(m_indexEntries);
-            m_indexEntries = nullptr;
-        }
-        m_recording = false;
+        m_indexWriter.close();
+        m_writer.close();
         return false;
     }
+    
+    // 第一个RIFF段即文件头所在的RIFF AVI
+    m_segments[0].riffPos = 0;
+    m_segments[0].moviPos = m_moviStartPos;
+    m_segmentCount = 1;
 
-    Utils_Logger::info("After writeAVIHeader: m_moviStartPos=%d, m_bufferPos=%d", m_moviStartPos, m_bufferPos);
-    Utils_Logger::info("Verify movi at %d: '%c%c%c%c', size at %d",
-                      m_moviStartPos, m_buffer[m_moviStartPos], m_buffer[m_moviStartPos+1],
-                      m_buffer[m_moviStartPos+2], m_buffer[m_moviStartPos+3],
-                      m_moviStartPos+4);
+    m_lastCheckpointTime = millis();
+    m_checkpointCount = 0;
+    m_recording = true;
 
-    Utils_Logger::info("MJPEGEncoder started: %s, %dx%d, %dfps", fileName, width, height, fps);
+    Utils_Logger::info("After writeAVIHeader: m_moviStartPos=%d, m_moviDataStart=%d", m_moviStartPos, m_moviDataStart);
+    Utils_Logger::info("MJPEGEncoder started: %s, %dx%d, %dfps, audio %s", fileName, width, height, fps,
+                      (m_audioCodec == AVI_AUDIO_IMA_ADPCM) ? "IMA-ADPCM" : "PCM");
     return true;
 }
 
-bool MJPEGEncoder::addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp) {
-    if (!m_recording || !m_buffer || !m_indexEntries) {
+// 把当前ix##标准索引块写入movi，并登记到该流的indx超级索引
+bool MJPEGEncoder::writeStdIndex(AVIStreamIndex& stream) {
+    if (stream.entryCount == 0) {
+        return true;
+    }
+    
+    uint64_t indexPos = m_writer.tell();
+    uint32_t dataSize = 24 + stream.entryCount * 8;
+    
+    uint8_t header[32];
+    memcpy(header, stream.indexId, 4);
+    writeLE32(header + 4, dataSize);
+    writeLE16(header + 8, 2);          // wLongsPerEntry
+    header[10] = 0;                    // bIndexSubType
+    header[11] = 0x01;                 // bIndexType = AVI_INDEX_OF_CHUNKS
+    writeLE32(header + 12, stream.entryCount);
+    memcpy(header + 16, stream.chunkId, 4);
+    writeLE64(header + 20, m_segments[m_segmentCount - 1].moviPos);  // qwBaseOffset
+    writeLE32(header + 28, 0);
+    
+    bool ok = m_writer.append(header, sizeof(header)) &&
+              m_writer.append(stream.entries, stream.entryCount * 8);
+    
+    if (stream.superCount < AVI_SUPER_INDEX_ENTRIES) {
+        AVISuperIndexEntry& entry = stream.superEntries[stream.superCount++];
+        entry.offset = indexPos;
+        entry.size = 8 + dataSize;
+        entry.duration = stream.duration;
+    } else {
+        Utils_Logger::error("Super index full for stream %c%c%c%c",
+                          stream.chunkId[0], stream.chunkId[1], stream.chunkId[2], stream.chunkId[3]);
+    }
+    
+    stream.entryCount = 0;
+    stream.duration = 0;
+    return ok;
+}
+
+// 结束当前RIFF段：记录movi结束位置，首段额外写入传统idx1
+bool MJPEGEncoder::closeSegment() {
+    bool ok = writeStdIndex(m_streams[AVI_STREAM_VIDEO]) &&
+              writeStdIndex(m_streams[AVI_STREAM_AUDIO]);
+    
+    AVIRiffSegment& segment = m_segments[m_segmentCount - 1];
+    segment.moviEnd = m_writer.tell();
+    
+    if (m_segmentCount == 1) {
+        m_firstSegmentFrames = m_frameCount;
+        if (!writeIndex()) {
+            Utils_Logger::error("Failed to write index");
+            ok = false;
+        }
+    }
+    
+    segment.riffEnd = m_writer.tell();
+    return ok;
+}
+
+// 当前RIFF段接近上限时切换到新的RIFF AVIX段
+bool MJPEGEncoder::startNewSegment() {
+    if (m_segmentCount >= AVI_MAX_RIFF_SEGMENTS) {
+        Utils_Logger::error("RIFF segment limit reached (%d)", AVI_MAX_RIFF_SEGMENTS);
         return false;
     }
     
-    if (m_mutex && xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+    if (!closeSegment()) {
         return false;
     }
     
-    uint32_t chunkStartPos = m_bufferPos;
+    AVIRiffSegment& segment = m_segments[m_segmentCount];
+    segment.riffPos = m_writer.tell();
+    segment.moviPos = segment.riffPos + 12;
+    segment.moviEnd = 0;
+    segment.riffEnd = 0;
+    
+    uint8_t header[24];
+    memcpy(header, "RIFF", 4);
+    writeLE32(header + 4, 0);
+    memcpy(header + 8, "AVIX", 4);
+    memcpy(header + 12, "LIST", 4);
+    writeLE32(header + 16, 0);
+    memcpy(header + 20, "movi", 4);
+    if (!m_writer.append(header, sizeof(header))) {
+        return false;
+    }
     
-    uint32_t requiredSize = jpegSize + 8 + 1;
-    if (m_bufferPos + requiredSize > m_bufferSize) {
-        Utils_Logger::error("Buffer overflow");
-        if (m_mutex) xSemaphoreGive(m_mutex);
+    m_segmentCount++;
+    Utils_Logger::info("Started RIFF AVIX segment %d at %llu", m_segmentCount - 1, segment.riffPos);
+    return true;
+}
+
+// 写入JUNK填充块，使下一个块的数据（跳过8字节块头）从alignUnit边界开始
+bool MJPEGEncoder::appendAlignmentJunk(uint32_t alignUnit) {
+    uint32_t gap = (uint32_t)((alignUnit - (m_writer.tell() + 8) % alignUnit) % alignUnit);
+    if (gap == 0) {
+        return true;
+    }
+    // JUNK块至少需要8字节块头
+    if (gap < 8) {
+        gap += alignUnit;
+    }
+    
+    uint8_t header[8];
+    memcpy(header, "JUNK", 4);
+    writeLE32(header + 4, gap - 8);
+    return m_writer.append(header, 8) && m_writer.appendZeros(gap - 8);
+}
+
+// 追加一个数据块（块头+数据+填充字节），并记录idx1（仅首段）和ix##标准索引条目
+// zeroCopy时先用JUNK块把数据对齐到扇区，扇区整数倍部分由写入任务直接从data写入
+bool MJPEGEncoder::appendChunk(AVIStreamIndex& stream, const uint8_t* data, uint32_t size, uint32_t flags, uint32_t duration,
+                               bool zeroCopy) {
+    uint32_t paddedSize = size + (size % 2);
+    zeroCopy = zeroCopy && m_writer.isDirectCandidate(data, size);
+    
+    // 预留当前块（含对齐填充）、两路未写出的标准索引以及首段idx1的空间，超出段上限则切换RIFF段
+    uint64_t reserve = 8 + paddedSize + 2 * (32 + AVI_STD_INDEX_ENTRIES * 8);
+    if (zeroCopy) {
+        reserve += AVI_DIRECT_WRITE_UNIT + 8;
+    }
+    if (m_segmentCount == 1) {
+        reserve += 8 + (m_indexEntryCount + 1) * 16;
+    }
+    if (m_writer.tell() + reserve - m_segments[m_segmentCount - 1].riffPos > AVI_RIFF_SEGMENT_LIMIT) {
+        if (!startNewSegment()) {
+            return false;
+        }
+    }
+    
+    if (zeroCopy && !appendAlignmentJunk(AVI_DIRECT_WRITE_UNIT)) {
+        return false;
+    }
+    
+    uint64_t chunkStartPos = m_writer.tell();
+    
+    uint8_t header[8];
+    memcpy(header, stream.chunkId, 4);
+    writeLE32(header + 4, size);
+    
+    if (!m_writer.append(header, 8)) {
+        return false;
+    }
+    if (zeroCopy ? !m_writer.appendDirect(data, size) : !m_writer.append(data, size)) {
+        return false;
+    }
+    if (paddedSize != size && !m_writer.appendZeros(1)) {
         return false;
     }
     
-    if (m_indexEntryCount >= m_indexCapacity) {
-        uint32_t newCapacity = m_indexCapacity * 2;
-        AVIIndexEntry* newEntries = (AVIIndexEntry*)realloc(m_indexEntries, newCapacity * sizeof(AVIIndexEntry));
-        if (!newEntries) {
-            Utils_Logger::error("Failed to expand index memory");
-            if (m_mutex) xSemaphoreGive(m_mutex);
+    if (&stream == &m_streams[AVI_STREAM_VIDEO]) {
+        m_lastVideoChunkPos = chunkStartPos;
+        m_lastVideoChunkSize = size;
+    }
+    return addIndexEntry(stream, chunkStartPos, size, flags, duration);
+}
+
+// 登记一个数据块的idx1（仅首段）和ix##标准索引条目
+bool MJPEGEncoder::addIndexEntry(AVIStreamIndex& stream, uint64_t chunkStartPos, uint32_t size, uint32_t flags, uint32_t duration) {
+    if (m_segmentCount == 1) {
+        uint8_t entry[16];
+        memcpy(entry, stream.chunkId, 4);
+        writeLE32(entry + 4, flags);
+        writeLE32(entry + 8, (uint32_t)chunkStartPos - m_moviDataStart);
+        writeLE32(entry + 12, size + (size % 2));
+        if (!m_indexWriter.append(entry, sizeof(entry))) {
+            Utils_Logger::error("Failed to append index entry");
             return false;
         }
-        m_indexEntries = newEntries;
-        m_indexCapacity = newCapacity;
+        m_indexEntryCount++;
     }
     
-    AVIIndexEntry& entry = m_indexEntries[m_indexEntryCount++];
-    memcpy(entry.fourcc, "00db", 4);
-    entry.flags = 0x00000010;
-    entry.chunkOffset = chunkStartPos - m_moviDataStart;
-    entry.chunkSize = jpegSize;
+    // ix##条目：偏移指向块数据（跳过8字节块头），相对于本段movi位置
+    uint8_t* stdEntry = stream.entries + stream.entryCount * 8;
+    writeLE32(stdEntry, (uint32_t)(chunkStartPos + 8 - m_segments[m_segmentCount - 1].moviPos));
+    writeLE32(stdEntry + 4, size);
+    stream.entryCount++;
+    stream.duration += duration;
     
-    memcpy(m_buffer + m_bufferPos, "00db", 4);
-    m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, jpegSize);
-    m_bufferPos += 4;
+    if (stream.entryCount >= AVI_STD_INDEX_ENTRIES) {
+        return writeStdIndex(stream);
+    }
+    return true;
+}
+
+bool MJPEGEncoder::addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp, bool zeroCopy) {
+    if (!m_recording) {
+        return false;
+    }
     
-    memcpy(m_buffer + m_bufferPos, jpegData, jpegSize);
-    m_bufferPos += jpegSize;
+    if (m_mutex && xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
     
-    if (jpegSize % 2 != 0) {
-        m_buffer[m_bufferPos++] = 0;
-        entry.chunkSize = jpegSize + 1;
+    // 按时间戳计算帧位（首帧为0，间隔1/fps），文件时间轴与采集时间一致
+    if (!m_videoStarted) {
+        m_videoStarted = true;
+        m_videoStartTime = timestamp;
+    }
+    int32_t elapsed = (int32_t)(timestamp - m_videoStartTime);
+    uint32_t slot = (elapsed > 0) ? (uint32_t)(((uint64_t)elapsed * m_fps + 500) / 1000) : 0;
+    
+    if (slot < m_frameCount) {
+        // 早到的帧：所在帧位已有帧，丢弃
+        m_droppedEarlyFrames++;
+        if (m_mutex) xSemaphoreGive(m_mutex);
+        return true;
+    }
+    
+    // 漏掉的帧位用重复帧补齐（只写索引，不写数据）
+    while (m_frameCount < slot && duplicateLastVideoFrame()) {
+    }
+    
+    if (!appendChunk(m_streams[AVI_STREAM_VIDEO], jpegData, jpegSize, 0x00000010, 1, zeroCopy)) {
+        Utils_Logger::error("Failed to write video frame %d", m_frameCount);
+        if (m_mutex) xSemaphoreGive(m_mutex);
+        return false;
     }
     
     m_frameCount++;
     
+    // 每个视频帧之后写出期间暂存的音频，音视频按帧交织
+    if (!flushAudioStage()) {
+        Utils_Logger::error("Failed to write audio after frame %d", m_frameCount);
+    }
+    
+    if (millis() - m_lastCheckpointTime >= AVI_CHECKPOINT_INTERVAL_MS) {
+        checkpoint();
+    }
+    
     if (m_frameCount % 10 == 0) {
-        Utils_Logger::info("Added video frame %d: offset=%d, size=%d", 
-                          m_frameCount, entry.chunkOffset, entry.chunkSize);
+        Utils_Logger::info("Added video frame %d: size=%d, file=%llu, pending=%u",
+                          m_frameCount, jpegSize, m_writer.tell(), m_writer.getQueuedBufferCount());
     }
     
     if (m_mutex) xSemaphoreGive(m_mutex);
@@ -188,7 +476,7 @@ bool MJPEGEncoder::addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uin
 }
 
 bool MJPEGEncoder::addAudioFrame(const uint8_t* audioData, uint32_t audioSize, uint32_t timestamp) {
-    if (!m_recording || !m_buffer || !m_indexEntries) {
+    if (!m_recording) {
         return false;
     }
     
@@ -196,58 +484,121 @@ bool MJPEGEncoder::addAudioFrame(const uint8_t* audioData, uint32_t audioSize, u
         return false;
     }
     
-    uint32_t chunkStartPos = m_bufferPos;
+    const int16_t* pcm = (const int16_t*)audioData;
+    uint32_t samples = audioSize / 2;
     
-    uint32_t requiredSize = audioSize + 8 + 1;
-    if (m_bufferPos + requiredSize > m_bufferSize) {
-        Utils_Logger::error("Buffer overflow for audio");
+    if (!m_videoStarted) {
+        // 时间轴以首个视频帧为起点，之前到达的音频不写入
+        m_audioDroppedSamples += samples;
         if (m_mutex) xSemaphoreGive(m_mutex);
-        return false;
+        return true;
     }
     
-    if (m_indexEntryCount >= m_indexCapacity) {
-        uint32_t newCapacity = m_indexCapacity * 2;
-        AVIIndexEntry* newEntries = (AVIIndexEntry*)realloc(m_indexEntries, newCapacity * sizeof(AVIIndexEntry));
-        if (!newEntries) {
-            Utils_Logger::error("Failed to expand index memory for audio");
-            if (m_mutex) xSemaphoreGive(m_mutex);
-            return false;
-        }
-        m_indexEntries = newEntries;
-        m_indexCapacity = newCapacity;
+    // 本块起点在时间轴上应处的采样位置与已写入采样数之差，超过一帧时长才修正
+    int64_t expected = (int64_t)(int32_t)(timestamp - m_videoStartTime) * AUDIO_SAMPLE_RATE / 1000;
+    int64_t drift = expected - (int64_t)m_totalAudioSamples;
+    int64_t tolerance = AUDIO_SAMPLE_RATE / m_fps;
+    bool ok = true;
+    if (drift > tolerance) {
+        // 音频落后（采集丢块或停顿）：补静音
+        ok = stageAudio(nullptr, (uint32_t)drift);
+        m_audioPaddedSamples += (uint32_t)drift;
+    } else if (drift < -tolerance) {
+        // 音频超前：丢弃本块开头多出的采样
+        uint32_t skip = (-drift < (int64_t)samples) ? (uint32_t)(-drift) : samples;
+        pcm += skip;
+        samples -= skip;
+        m_audioDroppedSamples += skip;
     }
+    ok = ok && stageAudio(pcm, samples);
     
-    AVIIndexEntry& entry = m_indexEntries[m_indexEntryCount++];
-    memcpy(entry.fourcc, "01wb", 4);
-    entry.flags = 0x00000000;
-    entry.chunkOffset = chunkStartPos - m_moviDataStart;
-    entry.chunkSize = audioSize;
-    
-    memcpy(m_buffer + m_bufferPos, "01wb", 4);
-    m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, audioSize);
-    m_bufferPos += 4;
-    
-    memcpy(m_buffer + m_bufferPos, audioData, audioSize);
-    m_bufferPos += audioSize;
-    
-    if (audioSize % 2 != 0) {
-        m_buffer[m_bufferPos++] = 0;
-        entry.chunkSize = audioSize + 1;
+    if (!ok) {
+        Utils_Logger::error("Failed to write audio frame %d", m_audioFrameCount);
+        if (m_mutex) xSemaphoreGive(m_mutex);
+        return false;
     }
     
     m_audioFrameCount++;
-    m_totalAudioSamples += (entry.chunkSize / 2);
     
     if (m_audioFrameCount % 20 == 0) {
-        Utils_Logger::info("Added audio frame %d: offset=%d, size=%d, totalSamples=%d", 
-                          m_audioFrameCount, entry.chunkOffset, entry.chunkSize, m_totalAudioSamples);
+        Utils_Logger::info("Added audio frame %d: size=%d, totalSamples=%d", 
+                          m_audioFrameCount, audioSize, m_totalAudioSamples);
     }
     
     if (m_mutex) xSemaphoreGive(m_mutex);
     return true;
 }
 
+// 音频写入暂存区（samples为nullptr时写入静音），暂存满时先写出
+bool MJPEGEncoder::stageAudio(const int16_t* samples, uint32_t count) {
+    while (count > 0) {
+        if (m_audioStageCount == AVI_AUDIO_STAGE_SAMPLES && !flushAudioStage()) {
+            return false;
+        }
+        uint32_t n = AVI_AUDIO_STAGE_SAMPLES - m_audioStageCount;
+        if (n > count) {
+            n = count;
+        }
+        if (samples) {
+            memcpy(m_audioStage + m_audioStageCount, samples, n * sizeof(int16_t));
+            samples += n;
+        } else {
+            memset(m_audioStage + m_audioStageCount, 0, n * sizeof(int16_t));
+        }
+        m_audioStageCount += n;
+        m_totalAudioSamples += n;
+        count -= n;
+    }
+    return true;
+}
+
+// 把暂存的音频写为一个01wb块；ADPCM时不足一块的样本留在编码器中
+bool MJPEGEncoder::flushAudioStage() {
+    if (m_audioStageCount == 0) {
+        return true;
+    }
+    
+    bool ok;
+    if (m_audioCodec == AVI_AUDIO_IMA_ADPCM) {
+        uint32_t blocks = m_adpcmEncoder.encode(m_audioStage, m_audioStageCount, m_adpcmBuffer, AVI_ADPCM_MAX_BLOCKS, nullptr);
+        ok = appendAudioBlocks(m_adpcmBuffer, blocks);
+    } else {
+        ok = appendChunk(m_streams[AVI_STREAM_AUDIO], (const uint8_t*)m_audioStage,
+                         m_audioStageCount * sizeof(int16_t), 0x00000000, m_audioStageCount);
+        if (ok) {
+            m_audioLength += m_audioStageCount;
+        }
+    }
+    m_audioStageCount = 0;
+    return ok;
+}
+
+// 补一个重复帧：只追加指向上一个视频块的索引条目，不写数据
+// 上一帧位于之前的RIFF段时ix##无法引用，此时不补（每个RIFF段边界最多影响一次）
+bool MJPEGEncoder::duplicateLastVideoFrame() {
+    if (m_frameCount == 0 || m_lastVideoChunkPos < m_segments[m_segmentCount - 1].moviPos) {
+        return false;
+    }
+    if (!addIndexEntry(m_streams[AVI_STREAM_VIDEO], m_lastVideoChunkPos, m_lastVideoChunkSize, 0x00000010, 1)) {
+        return false;
+    }
+    m_frameCount++;
+    m_duplicatedFrames++;
+    return true;
+}
+
+// 写入若干个完整的ADPCM块，索引时长以块为单位
+bool MJPEGEncoder::appendAudioBlocks(const uint8_t* data, uint32_t blocks) {
+    if (blocks == 0) {
+        return true;
+    }
+    if (!appendChunk(m_streams[AVI_STREAM_AUDIO], data, blocks * IMA_ADPCM_BLOCK_ALIGN, 0x00000000, blocks)) {
+        return false;
+    }
+    m_audioLength += blocks;
+    return true;
+}
+
 uint32_t MJPEGEncoder::readLE32(const uint8_t* buffer) {
     return (uint32_t)buffer[0] | 
            (uint32_t)buffer[1] << 8 | 
@@ -255,122 +606,184 @@ uint32_t MJPEGEncoder::readLE32(const uint8_t* buffer) {
            (uint32_t)buffer[3] << 24;
 }
 
-bool MJPEGEncoder::end(const DS3231_Time* fileTime) {
-    if (!m_recording || !m_buffer) {
+bool MJPEGEncoder::patchLE32(uint64_t offset, uint32_t value) {
+    uint8_t data[4];
+    writeLE32(data, value);
+    return m_writer.patch(offset, data, 4);
+}
+
+// 检查点：提交已缓冲数据，并在写队列中按顺序排入临时长度回写和f_sync
+// 回写内容对应提交时的逻辑文件末尾，写入任务执行到此处时之前的数据已全部落盘
+// 断电后文件头可被容错播放器直接识别，完整修复由AVIRecovery在启动时完成
+bool MJPEGEncoder::checkpoint() {
+    m_lastCheckpointTime = millis();
+    
+    if (!m_writer.flush()) {
         return false;
     }
     
-    Utils_Logger::info("Ending MJPEG recording: video=%d frames, audio=%d chunks", 
-                     m_frameCount, m_audioFrameCount);
+    uint64_t position = m_writer.tell();
+    const AVIRiffSegment& segment = m_segments[m_segmentCount - 1];
+    bool ok = m_writer.queuePatch32(segment.riffPos + 4, (uint32_t)(position - segment.riffPos - 8)) &&
+              m_writer.queuePatch32(segment.moviPos + 4, (uint32_t)(position - segment.moviPos - 8));
     
-    bool success = true;
-    
-    uint32_t moviDataSize = m_bufferPos - m_moviDataStart;
-    uint32_t moviListSize = 4 + moviDataSize;
-    writeLE32(m_buffer + m_moviStartPos + 4, moviListSize);
+    if (m_segmentCount == 1) {
+        ok = ok && m_writer.queuePatch32(m_totalFramesOffset, m_frameCount);
+    }
+    ok = ok && m_writer.queuePatch32(m_videoStrhLengthOffset, m_frameCount) &&
+         m_writer.queuePatch32(m_audioStrhLengthOffset, m_audioLength) &&
+         m_writer.queuePatch32(m_dmlhFramesOffset, m_frameCount) &&
+         m_writer.queuePatch32(m_checkpointEndOffset, (uint32_t)position) &&
+         m_writer.queuePatch32(m_checkpointEndOffset + 4, (uint32_t)(position >> 32)) &&
+         m_writer.queueSync();
+    
+    // 首段的idx1临时文件同步提交，恢复时作为录制未完成的标记
+    if (m_indexWriter.isOpen()) {
+        ok = ok && m_indexWriter.flush() && m_indexWriter.queueSync();
+    }
     
-    Utils_Logger::info("movi debug: startPos=%d, dataStart=%d, dataSize=%d, listSize=%d",
-                      m_moviStartPos, m_moviDataStart, moviDataSize, moviListSize);
-    Utils_Logger::info("movi header check: '%c%c%c%c' at %d, size at %d, '%c%c%c%c' at %d",
-                      m_buffer[m_moviStartPos], m_buffer[m_moviStartPos+1],
-                      m_buffer[m_moviStartPos+2], m_buffer[m_moviStartPos+3],
-                      m_moviStartPos,
-                      m_moviStartPos+4,
-                      m_buffer[m_moviStartPos+8], m_buffer[m_moviStartPos+9],
-                      m_buffer[m_moviStartPos+10], m_buffer[m_moviStartPos+11],
-                      m_moviStartPos+8);
-
-    uint32_t storedMoviSize = readLE32(m_buffer + m_moviStartPos + 4);
-    Utils_Logger::info("MOVI size verification: expected=%d, stored=%d", moviListSize, storedMoviSize);
+    m_checkpointCount++;
+    if (!ok) {
+        Utils_Logger::error("AVI checkpoint %d failed", m_checkpointCount);
+    }
+    return ok;
+}
 
-    if (storedMoviSize != moviListSize) {
-        Utils_Logger::error("MOVI size mismatch! Fixing...");
-        writeLE32(m_buffer + m_moviStartPos + 4, moviListSize);
+bool MJPEGEncoder::end(const DS3231_Time* fileTime) {
+    if (!m_recording) {
+        return false;
     }
     
-    if (!writeIndex()) {
-        Utils_Logger::error("Failed to write index");
-        success = false;
+    if (m_mutex && xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
     }
+    m_recording = false;
     
-    m_fileSize = m_bufferPos;
+    Utils_Logger::info("Ending MJPEG recording: video=%d frames, audio=%d chunks, segments=%d", 
+                     m_frameCount, m_audioFrameCount, m_segmentCount);
     
-    uint32_t riffSize = m_fileSize - 8;
-    writeLE32(m_buffer + 4, riffSize);
-
-    uint32_t hdrlSize = m_moviStartPos - 20;
-    writeLE32(m_buffer + 16, hdrlSize);
-    Utils_Logger::info("hdrl size updated: %d (m_moviStartPos=%d)", hdrlSize, m_moviStartPos);
+    bool success = !m_writer.hasError();
     
-    if (m_totalFramesOffset > 0) {
-        writeLE32(m_buffer + m_totalFramesOffset, m_frameCount);
-        Utils_Logger::info("Updated total video frames to %d", m_frameCount);
+    // 写出暂存的音频；ADPCM编码器中不足一块的剩余样本补齐为最后一块
+    if (!flushAudioStage()) {
+        success = false;
+    }
+    if (m_audioCodec == AVI_AUDIO_IMA_ADPCM && !appendAudioBlocks(m_adpcmBuffer, m_adpcmEncoder.flush(m_adpcmBuffer))) {
+        success = false;
     }
     
-    if (m_videoStrhLengthOffset > 0) {
-        writeLE32(m_buffer + m_videoStrhLengthOffset, m_frameCount);
-        Utils_Logger::info("Updated video strh length to %d", m_frameCount);
+    // 写出剩余ix##标准索引，首段同时写出idx1
+    if (!closeSegment()) {
+        success = false;
     }
     
-    if (m_audioStrhLengthOffset > 0) {
-        writeLE32(m_buffer + m_audioStrhLengthOffset, m_totalAudioSamples);
-        Utils_Logger::info("Updated audio strh length to %d samples (was %d frames)", m_totalAudioSamples, m_audioFrameCount);
+    // 等待所有数据落盘后，回写文件头和各RIFF段的长度字段
+    if (!m_writer.flush() || !m_writer.waitIdle(AVI_WRITE_WAIT_MS * AVI_WRITE_BUFFER_COUNT)) {
+        Utils_Logger::error("Failed to drain AVI stream");
+        success = false;
     }
     
-    Utils_Logger::info("Final file size: %d bytes", m_fileSize);
-    Utils_Logger::info("Index entries: %d", m_indexEntryCount);
+    m_fileSize = m_writer.tell();
     
-    debugAVIStructure();
+    const AVIRiffSegment& first = m_segments[0];
+    uint32_t moviListSize = (uint32_t)(first.moviEnd - first.moviPos - 8);
+    Utils_Logger::info("movi debug: startPos=%d, dataStart=%d, listSize=%d",
+                      m_moviStartPos, m_moviDataStart, moviListSize);
     
-    if (memcmp(m_buffer, "RIFF", 4) != 0) {
-        Utils_Logger::error("RIFF marker missing");
+    // 文件头（含首段RIFF/movi大小、avih、strh、dmlh、indx）在内存中更新后一次回写
+    writeLE32(m_buffer + 4, (uint32_t)(first.riffEnd - 8));
+    writeLE32(m_buffer + m_moviStartPos + 4, moviListSize);
+    writeLE32(m_buffer + m_totalFramesOffset, m_firstSegmentFrames);
+    writeLE32(m_buffer + m_videoStrhLengthOffset, m_frameCount);
+    writeLE32(m_buffer + m_audioStrhLengthOffset, m_audioLength);
+    writeLE32(m_buffer + m_dmlhFramesOffset, m_frameCount);
+    writeLE64(m_buffer + m_checkpointEndOffset, m_fileSize);
+    fillSuperIndexChunk(m_streams[AVI_STREAM_VIDEO]);
+    fillSuperIndexChunk(m_streams[AVI_STREAM_AUDIO]);
+    if (!m_writer.patch(0, m_buffer, m_bufferPos)) {
         success = false;
     }
-    
-    if (memcmp(m_buffer + 8, "AVI ", 4) != 0) {
-        Utils_Logger::error("AVI marker missing");
-        success = false;
+    Utils_Logger::info("Updated header: first RIFF frames=%d, total frames=%d, audio samples=%d, audio length=%d",
+                      m_firstSegmentFrames, m_frameCount, m_totalAudioSamples, m_audioLength);
+    
+    // RIFF AVIX段只需回写RIFF和movi大小
+    for (uint32_t i = 1; i < m_segmentCount; i++) {
+        const AVIRiffSegment& segment = m_segments[i];
+        success &= patchLE32(segment.riffPos + 4, (uint32_t)(segment.riffEnd - segment.riffPos - 8));
+        success &= patchLE32(segment.moviPos + 4, (uint32_t)(segment.moviEnd - segment.moviPos - 8));
     }
     
-    bool idx1Found = false;
-    for (uint32_t i = m_moviStartPos; i < m_bufferPos - 4; i++) {
-        if (memcmp(m_buffer + i, "idx1", 4) == 0) {
-            Utils_Logger::info("idx1 found at offset %d", i);
-            idx1Found = true;
-            break;
-        }
-    }
+    Utils_Logger::info("Final file size: %llu bytes", m_fileSize);
+    Utils_Logger::info("Index entries: idx1=%d, indx video=%d, indx audio=%d", m_indexEntryCount,
+                      m_streams[AVI_STREAM_VIDEO].superCount, m_streams[AVI_STREAM_AUDIO].superCount);
+    Utils_Logger::info("SD write stats: %u KB/s sustained, max latency %u us over %u writes, buffer waits %u, checkpoints %u, preallocated %d",
+                      m_writer.getWriteThroughputKBps(), m_writer.getMaxWriteLatencyUs(), m_writer.getWriteCount(),
+                      m_writer.getBufferWaitCount(), m_checkpointCount, m_writer.isPreallocated());
+    Utils_Logger::info("A/V sync: %u duplicated frames, %u early frames dropped, audio padded %u / dropped %u samples",
+                      m_duplicatedFrames, m_droppedEarlyFrames, m_audioPaddedSamples, m_audioDroppedSamples);
+    Utils_Logger::info("Zero-copy video payload: %llu KB of %llu KB written",
+                      m_writer.getDirectBytes() / 1024, m_writer.getBytesWritten() / 1024);
     
-    if (!idx1Found) {
-        Utils_Logger::error("idx1 index block not found!");
-        success = false;
-    }
+    debugAVIStructure();
     
-    // 写入文件时直接传递时间参数，避免额外的时间戳设置调用
-    int32_t writtenBytes = sdCardManager.writeFile(m_fileName, m_buffer, m_fileSize, fileTime);
-    if (writtenBytes != (int32_t)m_fileSize) {
-        Utils_Logger::error("Failed to write file: expected %d, wrote %d", 
-                          m_fileSize, writtenBytes);
+    if (!m_writer.close()) {
+        Utils_Logger::error("Failed to close file: %s", m_fileName);
         success = false;
     } else {
-        Utils_Logger::info("Successfully wrote %d bytes", writtenBytes);
+        Utils_Logger::info("Successfully wrote %llu bytes", m_fileSize);
     }
     
-    free(m_buffer);
-    m_buffer = nullptr;
-    
-    if (m_indexEntries) {
-        free(m_indexEntries);
-        m_indexEntries = nullptr;
+    // 文件关闭后设置最后修改时间
+    if (fileTime) {
+        sdCardManager.setLastModTime(m_fileName, *fileTime);
     }
     
-    m_recording = false;
+    // .idx是未完成录像的恢复标记：只有文件头回写和两个写入器都成功关闭后才删除，否则留给下次启动时修复
+    if (success && !hasOpenWriters()) {
+        f_unlink(m_indexFileName);
+    } else {
+        Utils_Logger::error("MJPEGEncoder: %s not finalized, index kept for recovery", m_fileName);
+    }
     
     Utils_Logger::info("MJPEGEncoder ended: %s", m_fileName);
     
+    if (m_mutex) xSemaphoreGive(m_mutex);
     return success;
 }
 
+// 在文件头缓冲区中写入一个空的indx超级索引块（结束时由fillSuperIndexChunk填充）
+void MJPEGEncoder::writeSuperIndexChunk(AVIStreamIndex& stream) {
+    stream.indxOffset = m_bufferPos;
+    
+    memcpy(m_buffer + m_bufferPos, "indx", 4);
+    m_bufferPos += 4;
+    writeLE32(m_buffer + m_bufferPos, 24 + AVI_SUPER_INDEX_ENTRIES * 16);
+    m_bufferPos += 4;
+    writeLE16(m_buffer + m_bufferPos, 4);       // wLongsPerEntry
+    m_bufferPos += 2;
+    m_buffer[m_bufferPos++] = 0;                // bIndexSubType
+    m_buffer[m_bufferPos++] = 0x00;             // bIndexType = AVI_INDEX_OF_INDEXES
+    writeLE32(m_buffer + m_bufferPos, 0);       // nEntriesInUse
+    m_bufferPos += 4;
+    memcpy(m_buffer + m_bufferPos, stream.chunkId, 4);
+    m_bufferPos += 4;
+    memset(m_buffer + m_bufferPos, 0, 12 + AVI_SUPER_INDEX_ENTRIES * 16);
+    m_bufferPos += 12 + AVI_SUPER_INDEX_ENTRIES * 16;
+}
+
+void MJPEGEncoder::fillSuperIndexChunk(const AVIStreamIndex& stream) {
+    uint8_t* chunk = m_buffer + stream.indxOffset;
+    writeLE32(chunk + 12, stream.superCount);
+    
+    uint8_t* entry = chunk + 32;
+    for (uint32_t i = 0; i < stream.superCount; i++) {
+        writeLE64(entry, stream.superEntries[i].offset);
+        writeLE32(entry + 8, stream.superEntries[i].size);
+        writeLE32(entry + 12, stream.superEntries[i].duration);
+        entry += 16;
+    }
+}
+
 bool MJPEGEncoder::writeAVIHeader() {
     if (!m_buffer) {
         return false;
@@ -432,9 +845,10 @@ bool MJPEGEncoder::writeAVIHeader() {
         m_bufferPos += 4;
     }
     
+    uint32_t videoStrlPos = m_bufferPos;
     memcpy(m_buffer + m_bufferPos, "LIST", 4);
     m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, 116);
+    writeLE32(m_buffer + m_bufferPos, 0);
     m_bufferPos += 4;
     memcpy(m_buffer + m_bufferPos, "strl", 4);
     m_bufferPos += 4;
@@ -516,9 +930,14 @@ bool MJPEGEncoder::writeAVIHeader() {
         m_bufferPos += 4;
     }
     
+    // 视频strl末尾附加OpenDML indx超级索引
+    writeSuperIndexChunk(m_streams[AVI_STREAM_VIDEO]);
+    writeLE32(m_buffer + videoStrlPos + 4, m_bufferPos - videoStrlPos - 8);
+    
+    uint32_t audioStrlPos = m_bufferPos;
     memcpy(m_buffer + m_bufferPos, "LIST", 4);
     m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, 94);
+    writeLE32(m_buffer + m_bufferPos, 0);
     m_bufferPos += 4;
     memcpy(m_buffer + m_bufferPos, "strl", 4);
     m_bufferPos += 4;
@@ -528,9 +947,15 @@ bool MJPEGEncoder::writeAVIHeader() {
     writeLE32(m_buffer + m_bufferPos, 56);
     m_bufferPos += 4;
     
+    // PCM：dwScale/dwRate为1/采样率，dwLength为采样数
+    // IMA-ADPCM：dwScale为每块采样数，dwSampleSize为块字节数，dwLength为块数
+    bool adpcm = (m_audioCodec == AVI_AUDIO_IMA_ADPCM);
+    uint32_t audioScale = adpcm ? IMA_ADPCM_SAMPLES_PER_BLOCK : 1;
+    uint32_t audioSampleSize = adpcm ? IMA_ADPCM_BLOCK_ALIGN : 0;
+    
     memcpy(m_buffer + m_bufferPos, "auds", 4);
     m_bufferPos += 4;
-    memcpy(m_buffer + m_bufferPos, "\x01\x00\x00\x00", 4);
+    memcpy(m_buffer + m_bufferPos, adpcm ? "\x00\x00\x00\x00" : "\x01\x00\x00\x00", 4);
     m_bufferPos += 4;
     
     writeLE32(m_buffer + m_bufferPos, 0);
@@ -541,7 +966,7 @@ bool MJPEGEncoder::writeAVIHeader() {
     m_bufferPos += 2;
     writeLE32(m_buffer + m_bufferPos, 0);
     m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, 1);
+    writeLE32(m_buffer + m_bufferPos, audioScale);
     m_bufferPos += 4;
     writeLE32(m_buffer + m_bufferPos, AUDIO_SAMPLE_RATE);
     m_bufferPos += 4;
@@ -554,12 +979,16 @@ bool MJPEGEncoder::writeAVIHeader() {
     
     uint32_t bytesPerSec = AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * (AUDIO_BITS_PER_SAMPLE / 8);
     uint16_t blockAlign = AUDIO_CHANNELS * (AUDIO_BITS_PER_SAMPLE / 8);
+    if (adpcm) {
+        bytesPerSec = AUDIO_SAMPLE_RATE * IMA_ADPCM_BLOCK_ALIGN / IMA_ADPCM_SAMPLES_PER_BLOCK;
+        blockAlign = IMA_ADPCM_BLOCK_ALIGN;
+    }
     
     writeLE32(m_buffer + m_bufferPos, 4096);
     m_bufferPos += 4;
     writeLE32(m_buffer + m_bufferPos, 0);
     m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, 0);
+    writeLE32(m_buffer + m_bufferPos, audioSampleSize);
     m_bufferPos += 4;
     writeLE16(m_buffer + m_bufferPos, 0);
     m_bufferPos += 2;
@@ -570,12 +999,13 @@ bool MJPEGEncoder::writeAVIHeader() {
     writeLE16(m_buffer + m_bufferPos, 0);
     m_bufferPos += 2;
     
+    // WAVEFORMATEX；IMA-ADPCM附加cbSize=2的扩展字段wSamplesPerBlock
     memcpy(m_buffer + m_bufferPos, "strf", 4);
     m_bufferPos += 4;
-    writeLE32(m_buffer + m_bufferPos, 18);
+    writeLE32(m_buffer + m_bufferPos, adpcm ? 20 : 18);
     m_bufferPos += 4;
     
-    writeLE16(m_buffer + m_bufferPos, 0x0001);
+    writeLE16(m_buffer + m_bufferPos, adpcm ? IMA_ADPCM_FORMAT_TAG : 0x0001);
     m_bufferPos += 2;
     writeLE16(m_buffer + m_bufferPos, AUDIO_CHANNELS);
     m_bufferPos += 2;
@@ -585,10 +1015,43 @@ bool MJPEGEncoder::writeAVIHeader() {
     m_bufferPos += 4;
     writeLE16(m_buffer + m_bufferPos, blockAlign);
     m_bufferPos += 2;
-    writeLE16(m_buffer + m_bufferPos, AUDIO_BITS_PER_SAMPLE);
+    writeLE16(m_buffer + m_bufferPos, adpcm ? IMA_ADPCM_BITS_PER_SAMPLE : AUDIO_BITS_PER_SAMPLE);
     m_bufferPos += 2;
-    writeLE16(m_buffer + m_bufferPos, 0);
+    writeLE16(m_buffer + m_bufferPos, adpcm ? 2 : 0);
     m_bufferPos += 2;
+    if (adpcm) {
+        writeLE16(m_buffer + m_bufferPos, IMA_ADPCM_SAMPLES_PER_BLOCK);
+        m_bufferPos += 2;
+    }
+    
+    // 音频strl末尾附加OpenDML indx超级索引
+    writeSuperIndexChunk(m_streams[AVI_STREAM_AUDIO]);
+    writeLE32(m_buffer + audioStrlPos + 4, m_bufferPos - audioStrlPos - 8);
+    
+    // OpenDML扩展头：LIST odml / dmlh，dwTotalFrames为全部RIFF段的视频总帧数
+    memcpy(m_buffer + m_bufferPos, "LIST", 4);
+    m_bufferPos += 4;
+    writeLE32(m_buffer + m_bufferPos, 4 + 8 + 248);
+    m_bufferPos += 4;
+    memcpy(m_buffer + m_bufferPos, "odml", 4);
+    m_bufferPos += 4;
+    memcpy(m_buffer + m_bufferPos, "dmlh", 4);
+    m_bufferPos += 4;
+    writeLE32(m_buffer + m_bufferPos, 248);
+    m_bufferPos += 4;
+    m_dmlhFramesOffset = m_bufferPos;
+    memset(m_buffer + m_bufferPos, 0, 248);
+    m_bufferPos += 248;
+    
+    // 检查点记录：已同步长度在每次检查点时回写，0表示尚未完成检查点
+    memcpy(m_buffer + m_bufferPos, "JUNK", 4);
+    m_bufferPos += 4;
+    writeLE32(m_buffer + m_bufferPos, AVI_CHECKPOINT_JUNK_SIZE);
+    m_bufferPos += 4;
+    memset(m_buffer + m_bufferPos, 0, AVI_CHECKPOINT_JUNK_SIZE);
+    memcpy(m_buffer + m_bufferPos, AVI_CHECKPOINT_TAG, 4);
+    m_checkpointEndOffset = m_bufferPos + 4;
+    m_bufferPos += AVI_CHECKPOINT_JUNK_SIZE;
     
     m_moviStartPos = m_bufferPos;
     Utils_Logger::info("BEFORE movi write: m_bufferPos=%d", m_bufferPos);
@@ -607,47 +1070,89 @@ bool MJPEGEncoder::writeAVIHeader() {
     
     m_moviDataStart = m_bufferPos;
     
+    // 文件头长度固定，hdrl大小在此直接写入
+    uint32_t hdrlSize = m_moviStartPos - 20;
+    writeLE32(m_buffer + 16, hdrlSize);
+    
     return true;
 }
 
 bool MJPEGEncoder::writeIndex() {
-    if (!m_buffer || !m_indexEntries || m_indexEntryCount == 0) {
+    // 关闭临时索引文件，再把其中的idx1条目整体复制到AVI文件末尾
+    if (!m_indexWriter.close()) {
+        Utils_Logger::error("Failed to close index stream");
         return false;
     }
     
-    uint32_t requiredSize = m_indexEntryCount * 16 + 8;
-    if (m_bufferPos + requiredSize + 2 > m_bufferSize) {
-        Utils_Logger::error("Not enough buffer space for index");
+    if (m_indexEntryCount == 0) {
         return false;
     }
     
-    memcpy(m_buffer + m_bufferPos, "idx1", 4);
-    m_bufferPos += 4;
-    
     uint32_t indexSize = m_indexEntryCount * 16;
-    writeLE32(m_buffer + m_bufferPos, indexSize);
-    m_bufferPos += 4;
+    uint8_t header[8];
+    memcpy(header, "idx1", 4);
+    writeLE32(header + 4, indexSize);
+    if (!m_writer.append(header, 8)) {
+        return false;
+    }
     
-    for (uint32_t i = 0; i < m_indexEntryCount; i++) {
-        const AVIIndexEntry& entry = m_indexEntries[i];
-        
-        memcpy(m_buffer + m_bufferPos, entry.fourcc, 4);
-        m_bufferPos += 4;
-        writeLE32(m_buffer + m_bufferPos, entry.flags);
-        m_bufferPos += 4;
-        writeLE32(m_buffer + m_bufferPos, entry.chunkOffset);
-        m_bufferPos += 4;
-        writeLE32(m_buffer + m_bufferPos, entry.chunkSize);
-        m_bufferPos += 4;
+    FIL indexFile;
+    if (f_open(&indexFile, m_indexFileName, FA_READ) != FR_OK) {
+        Utils_Logger::error("Failed to reopen index file: %s", m_indexFileName);
+        return false;
+    }
+    
+    uint8_t* copyBuffer = (uint8_t*)malloc(AVI_INDEX_BUFFER_SIZE);
+    if (!copyBuffer) {
+        f_close(&indexFile);
+        return false;
     }
     
-    if (m_bufferPos % 2 != 0) {
-        m_buffer[m_bufferPos++] = 0;
+    bool ok = true;
+    uint32_t remaining = indexSize;
+    while (remaining > 0 && ok) {
+        UINT toRead = remaining > AVI_INDEX_BUFFER_SIZE ? AVI_INDEX_BUFFER_SIZE : remaining;
+        UINT bytesRead = 0;
+        ok = (f_read(&indexFile, copyBuffer, toRead, &bytesRead) == FR_OK) && (bytesRead == toRead) &&
+             m_writer.append(copyBuffer, bytesRead);
+        remaining -= toRead;
     }
     
-    Utils_Logger::info("idx1 written: %d entries", m_indexEntryCount);
+    free(copyBuffer);
+    f_close(&indexFile);
     
-    return true;
+    if (ok) {
+        Utils_Logger::info("idx1 written: %d entries", m_indexEntryCount);
+    }
+    return ok;
+}
+
+bool MJPEGEncoder::retryCloseWriters() {
+    if (!hasOpenWriters()) {
+        return true;
+    }
+    
+    bool ok = true;
+    if (m_indexWriter.isOpen()) {
+        ok = m_indexWriter.close() && ok;
+    }
+    if (m_writer.isOpen()) {
+        ok = m_writer.close() && ok;
+    }
+    if (ok) {
+        // 结束时文件头未能回写，保留.idx由下次启动时的AVI恢复修正
+        Utils_Logger::info("MJPEGEncoder writers closed on retry: %s", m_fileName);
+    }
+    return ok;
+}
+
+void MJPEGEncoder::abortWriters() {
+    if (!hasOpenWriters()) {
+        return;
+    }
+    // 保留.idx，已落盘部分由下次启动时的AVI恢复修正
+    m_indexWriter.abort();
+    m_writer.abort();
 }
 
 bool MJPEGEncoder::isRecording() const {
@@ -659,25 +1164,38 @@ uint32_t MJPEGEncoder::getFrameCount() const {
 }
 
 uint32_t MJPEGEncoder::getFileSize() const {
-    return m_fileSize;
+    return (uint32_t)m_fileSize;
+}
+
+uint32_t MJPEGEncoder::getSegmentCount() const {
+    return m_segmentCount;
+}
+
+uint32_t MJPEGEncoder::estimateBytesPerSecond() const {
+    uint32_t videoBytes = (m_width * m_height / AVI_PREALLOC_PIXELS_PER_BYTE) * m_fps;
+    uint32_t audioBytes = AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * (AUDIO_BITS_PER_SAMPLE / 8);
+    if (m_audioCodec == AVI_AUDIO_IMA_ADPCM) {
+        audioBytes = AUDIO_SAMPLE_RATE / IMA_ADPCM_SAMPLES_PER_BLOCK * IMA_ADPCM_BLOCK_ALIGN + IMA_ADPCM_BLOCK_ALIGN;
+    }
+    return videoBytes + audioBytes;
 }
 
 void MJPEGEncoder::debugAVIStructure() {
     Utils_Logger::info("=== AVI Structure Debug ===");
     
-    if (m_bufferPos > 0) {
+    if (m_buffer && m_bufferPos > 0) {
         Utils_Logger::info("RIFF at 0: %c%c%c%c", 
                           m_buffer[0], m_buffer[1], m_buffer[2], m_buffer[3]);
-        Utils_Logger::info("File size: %u", readLE32(m_buffer + 4));
+        Utils_Logger::info("File size: %llu", m_fileSize);
         Utils_Logger::info("AVI at 8: %c%c%c%c", 
                           m_buffer[8], m_buffer[9], m_buffer[10], m_buffer[11]);
         Utils_Logger::info("movi LIST at %u", m_moviStartPos);
-        Utils_Logger::info("Total buffer: %u bytes", m_bufferPos);
+        Utils_Logger::info("Header size: %u bytes, RIFF segments: %u", m_bufferPos, m_segmentCount);
     }
     Utils_Logger::info("=== End AVI Structure Debug ===");
 }
 
-// MJPEGDecoder类实现（保持原样，仅调整构造函数和析构函数）
+// MJPEGDecoder类实现
 
 MJPEGDecoder::MJPEGDecoder()
     : m_open(false)
@@ -689,10 +1207,27 @@ MJPEGDecoder::MJPEGDecoder()
     , m_currentFrameIndex(0)
     , m_buffer(nullptr)
     , m_bufferSize(0)
+    , m_bufferedOffset(0)
     , m_moviStartPos(0)
+    , m_moviListSize(0)
     , m_indexStartPos(0)
+    , m_headerFrames(0)
+    , m_videoStream(-1)
+    , m_audioStream(-1)
+    , m_videoIndxPos(0)
+    , m_audioIndxPos(0)
+    , m_audioFormatTag(0)
+    , m_audioChannels(0)
+    , m_audioSampleRate(0)
+    , m_audioBlockAlign(0)
+    , m_audioSamplesPerBlock(0)
     , m_frameInfos(nullptr)
     , m_frameInfoCount(0)
+    , m_maxFrameSize(0)
+    , m_audioInfos(nullptr)
+    , m_audioInfoCount(0)
+    , m_indexSource("none")
+    , m_openTimeMs(0)
 {
     memset(m_fileName, 0, sizeof(m_fileName));
     memset(&m_file, 0, sizeof(m_file));
@@ -704,10 +1239,6 @@ MJPEGDecoder::~MJPEGDecoder() {
         free(m_buffer);
         m_buffer = nullptr;
     }
-    if (m_frameInfos) {
-        free(m_frameInfos);
-        m_frameInfos = nullptr;
-    }
 }
 
 bool MJPEGDecoder::open(const char* fileName) {
@@ -715,6 +1246,7 @@ bool MJPEGDecoder::open(const char* fileName) {
         close();
     }
     
+    uint32_t startTime = millis();
     strncpy(m_fileName, fileName, sizeof(m_fileName) - 1);
     
     FRESULT res = f_open(&m_file, fileName, FA_READ);
@@ -725,44 +1257,64 @@ bool MJPEGDecoder::open(const char* fileName) {
     
     m_fileSize = f_size(&m_file);
     
-    m_bufferSize = 1024 * 1024;
-    m_buffer = (uint8_t*)malloc(m_bufferSize);
+    // 读取缓冲区在多次打开之间复用
     if (!m_buffer) {
-        Utils_Logger::error("Failed to allocate buffer");
-        f_close(&m_file);
-        return false;
+        m_bufferSize = AVI_DECODER_BUFFER_SIZE;
+        m_buffer = (uint8_t*)malloc(m_bufferSize);
+        if (!m_buffer) {
+            Utils_Logger::error("Failed to allocate buffer");
+            f_close(&m_file);
+            return false;
+        }
     }
-    
-    bool success = false;
+    m_bufferedOffset = 0;
     
     m_width = 640;
     m_height = 480;
     m_fps = 15;
-    m_frameCount = 100;
-    
-    if (parseSimplifiedMovi()) {
+    m_frameCount = 0;
+    m_moviStartPos = 0;
+    m_moviListSize = 0;
+    m_indexStartPos = 0;
+    m_headerFrames = 0;
+    m_videoStream = -1;
+    m_audioStream = -1;
+    m_videoIndxPos = 0;
+    m_audioIndxPos = 0;
+    m_audioFormatTag = 0;
+    m_audioChannels = 0;
+    m_audioSampleRate = 0;
+    m_audioBlockAlign = 0;
+    m_audioSamplesPerBlock = 0;
+    m_indexSource = "none";
+    
+    // 优先使用文件内索引建立位置表，索引缺失或损坏时才遍历movi
+    bool success = false;
+    if (parseAVIHeader() && parseIndex()) {
         success = true;
-    }
-    
-    if (!success) {
-        if (parseAVIHeader()) {
-            if (parseIndex()) {
-                if (parseMoviList()) {
-                    success = true;
-                }
-            }
-        }
+    } else {
+        freeTables();
+        success = parseSimplifiedMovi();
     }
     
     if (success) {
         m_open = true;
         m_currentFrameIndex = 0;
-        Utils_Logger::info("MJPEGDecoder opened: %s", fileName);
+        m_frameCount = m_frameInfoCount;
+        m_maxFrameSize = 0;
+        for (uint32_t i = 0; i < m_frameInfoCount; i++) {
+            if (m_frameInfos[i].size > m_maxFrameSize) {
+                m_maxFrameSize = m_frameInfos[i].size;
+            }
+        }
+        m_openTimeMs = millis() - startTime;
+        Utils_Logger::info("MJPEGDecoder opened: %s, %ux%u %ufps, %u frames, %u audio chunks, index %s, %u ms",
+                          fileName, m_width, m_height, m_fps, m_frameInfoCount, m_audioInfoCount,
+                          m_indexSource, m_openTimeMs);
         return true;
     } else {
         f_close(&m_file);
-        free(m_buffer);
-        m_buffer = nullptr;
+        freeTables();
         return false;
     }
 }
@@ -773,34 +1325,35 @@ bool MJPEGDecoder::close() {
         m_open = false;
     }
     
-    if (m_frameInfos) {
-        free(m_frameInfos);
-        m_frameInfos = nullptr;
-    }
-    
-    m_frameInfoCount = 0;
+    freeTables();
     m_currentFrameIndex = 0;
     m_frameCount = 0;
+    m_maxFrameSize = 0;
+    m_bufferedOffset = 0;
     
     return true;
 }
 
-bool MJPEGDecoder::readNextFrame(uint8_t** frameData, uint32_t* frameSize) {
-    if (!m_open || !m_frameInfos) {
-        return false;
+void MJPEGDecoder::freeTables() {
+    if (m_frameInfos) {
+        free(m_frameInfos);
+        m_frameInfos = nullptr;
     }
-    
-    if (m_currentFrameIndex >= m_frameInfoCount) {
-        if (!parseMoreFrames()) {
-            return false;
-        }
+    if (m_audioInfos) {
+        free(m_audioInfos);
+        m_audioInfos = nullptr;
     }
-    
-    if (m_currentFrameIndex >= m_frameInfoCount) {
+    m_frameInfoCount = 0;
+    m_audioInfoCount = 0;
+}
+
+bool MJPEGDecoder::readNextFrame(uint8_t** frameData, uint32_t* frameSize) {
+    if (!m_open || !m_frameInfos || m_currentFrameIndex >= m_frameInfoCount) {
         return false;
     }
     
     FrameInfo& frameInfo = m_frameInfos[m_currentFrameIndex];
+    uint64_t offset = (uint64_t)frameInfo.offsetHalf << 1;
     
     if (frameInfo.size > m_bufferSize) {
         uint8_t* newBuffer = (uint8_t*)realloc(m_buffer, frameInfo.size);
@@ -809,11 +1362,17 @@ bool MJPEGDecoder::readNextFrame(uint8_t** frameData, uint32_t* frameSize) {
         }
         m_buffer = newBuffer;
         m_bufferSize = frameInfo.size;
+        m_bufferedOffset = 0;
     }
     
-    f_lseek(&m_file, frameInfo.offset);
-    UINT bytesRead;
-    f_read(&m_file, m_buffer, frameInfo.size, &bytesRead);
+    // 录制时补的重复帧索引指向同一数据块，缓冲区中已是该帧时不再读卡
+    if (offset != m_bufferedOffset) {
+        if (!readAt(offset, m_buffer, frameInfo.size)) {
+            m_bufferedOffset = 0;
+            return false;
+        }
+        m_bufferedOffset = offset;
+    }
     
     *frameData = m_buffer;
     *frameSize = frameInfo.size;
@@ -822,8 +1381,34 @@ bool MJPEGDecoder::readNextFrame(uint8_t** frameData, uint32_t* frameSize) {
     return true;
 }
 
-bool MJPEGDecoder::parseMoreFrames() {
-    return m_frameInfoCount < 999;
+bool MJPEGDecoder::getFrameInfo(uint32_t frameIndex, uint64_t* offset, uint32_t* size) const {
+    if (!m_open || !m_frameInfos || frameIndex >= m_frameInfoCount) {
+        return false;
+    }
+    *offset = (uint64_t)m_frameInfos[frameIndex].offsetHalf << 1;
+    *size = m_frameInfos[frameIndex].size;
+    return true;
+}
+
+bool MJPEGDecoder::readFrameAt(uint32_t frameIndex, uint8_t* buffer, uint32_t bufferSize, uint32_t* frameSize) {
+    uint64_t offset;
+    if (!getFrameInfo(frameIndex, &offset, frameSize) || *frameSize > bufferSize) {
+        return false;
+    }
+    return readAt(offset, buffer, *frameSize);
+}
+
+bool MJPEGDecoder::readAudioChunk(uint32_t index, uint8_t* buffer, uint32_t bufferSize, uint32_t* chunkSize) {
+    if (!m_open || !m_audioInfos || index >= m_audioInfoCount) {
+        return false;
+    }
+    
+    const FrameInfo& info = m_audioInfos[index];
+    *chunkSize = info.size;
+    if (info.size > bufferSize) {
+        return false;
+    }
+    return readAt((uint64_t)info.offsetHalf << 1, buffer, info.size);
 }
 
 bool MJPEGDecoder::seekToFrame(uint32_t frameIndex) {
@@ -862,86 +1447,405 @@ uint32_t MJPEGDecoder::getCurrentFrameIndex() const {
     return m_currentFrameIndex;
 }
 
+// 一次读入文件头，解析hdrl并定位首段movi
 bool MJPEGDecoder::parseAVIHeader() {
-    return true;
+    uint32_t headerLen = (m_fileSize < AVI_DECODER_HEADER_SIZE) ? m_fileSize : AVI_DECODER_HEADER_SIZE;
+    if (headerLen < 24 || !readAt(0, m_buffer, headerLen)) {
+        return false;
+    }
+    if (memcmp(m_buffer, "RIFF", 4) != 0 || memcmp(m_buffer + 8, "AVI ", 4) != 0) {
+        return false;
+    }
+    
+    bool hdrlFound = false;
+    uint32_t pos = 12;
+    while (pos + 12 <= headerLen) {
+        uint32_t size = readLE32(m_buffer + pos + 4);
+        if (memcmp(m_buffer + pos, "LIST", 4) == 0) {
+            if (memcmp(m_buffer + pos + 8, "hdrl", 4) == 0) {
+                uint32_t end = (pos + 8 + size < headerLen) ? pos + 8 + size : headerLen;
+                hdrlFound = parseHeaderList(pos + 12, end);
+            } else if (memcmp(m_buffer + pos + 8, "movi", 4) == 0) {
+                // 未正常结束的录像movi大小为0，位置仍然有效
+                m_moviStartPos = pos;
+                m_moviListSize = size;
+                return hdrlFound && m_videoStream >= 0;
+            }
+        }
+        uint64_t next = (uint64_t)pos + 8 + size + (size & 1);
+        if (next > headerLen) {
+            break;
+        }
+        pos = (uint32_t)next;
+    }
+    
+    Utils_Logger::error("MJPEGDecoder: movi list not found in header");
+    return false;
 }
 
+// 解析hdrl内容：avih、各路strl（strh/strf/indx）和odml/dmlh
+bool MJPEGDecoder::parseHeaderList(uint32_t pos, uint32_t end) {
+    int streamNumber = 0;
+    while (pos + 8 <= end) {
+        const uint8_t* chunk = m_buffer + pos;
+        uint32_t size = readLE32(chunk + 4);
+        uint32_t chunkEnd = (pos + 8 + size < end) ? pos + 8 + size : end;
+        
+        if (memcmp(chunk, "avih", 4) == 0 && size >= 40) {
+            uint32_t microSecPerFrame = readLE32(chunk + 8);
+            if (microSecPerFrame > 0) {
+                m_fps = (1000000 + microSecPerFrame / 2) / microSecPerFrame;
+            }
+            m_headerFrames = readLE32(chunk + 8 + 16);
+            m_width = readLE32(chunk + 8 + 32);
+            m_height = readLE32(chunk + 8 + 36);
+        } else if (memcmp(chunk, "LIST", 4) == 0 && size >= 4 && memcmp(chunk + 8, "strl", 4) == 0) {
+            bool isVideo = false;
+            bool isAudio = false;
+            uint32_t sub = pos + 12;
+            while (sub + 8 <= chunkEnd) {
+                const uint8_t* c = m_buffer + sub;
+                uint32_t cs = readLE32(c + 4);
+                if (memcmp(c, "strh", 4) == 0 && cs >= 28) {
+                    isVideo = (memcmp(c + 8, "vids", 4) == 0);
+                    isAudio = (memcmp(c + 8, "auds", 4) == 0);
+                    uint32_t scale = readLE32(c + 8 + 20);
+                    uint32_t rate = readLE32(c + 8 + 24);
+                    if (isVideo && scale > 0 && rate > 0) {
+                        m_fps = (rate + scale / 2) / scale;
+                    }
+                } else if (memcmp(c, "strf", 4) == 0) {
+                    if (isVideo && cs >= 12) {
+                        m_width = readLE32(c + 12);
+                        int32_t height = (int32_t)readLE32(c + 16);
+                        m_height = (height < 0) ? -height : height;
+                    } else if (isAudio && cs >= 16) {
+                        m_audioFormatTag = readLE16(c + 8);
+                        m_audioChannels = readLE16(c + 10);
+                        m_audioSampleRate = readLE32(c + 12);
+                        m_audioBlockAlign = readLE16(c + 20);
+                        // IMA-ADPCM扩展字段：cbSize=2，wSamplesPerBlock
+                        if (cs >= 20 && readLE16(c + 24) >= 2) {
+                            m_audioSamplesPerBlock = readLE16(c + 26);
+                        }
+                    }
+                } else if (memcmp(c, "indx", 4) == 0) {
+                    if (isVideo) {
+                        m_videoIndxPos = sub;
+                    } else if (isAudio) {
+                        m_audioIndxPos = sub;
+                    }
+                }
+                sub += 8 + cs + (cs & 1);
+            }
+            
+            if (isVideo && m_videoStream < 0) {
+                m_videoStream = streamNumber;
+            } else if (isAudio && m_audioStream < 0) {
+                m_audioStream = streamNumber;
+            }
+            streamNumber++;
+        } else if (memcmp(chunk, "LIST", 4) == 0 && size >= 16 && memcmp(chunk + 8, "odml", 4) == 0 &&
+                   memcmp(chunk + 12, "dmlh", 4) == 0) {
+            // dmlh记录全部RIFF段的视频总帧数，avih只记录首段
+            uint32_t totalFrames = readLE32(chunk + 20);
+            if (totalFrames > m_headerFrames) {
+                m_headerFrames = totalFrames;
+            }
+        }
+        
+        pos += 8 + size + (size & 1);
+    }
+    return m_videoStream >= 0;
+}
+
+// 建立位置表：OpenDML indx覆盖全部RIFF段，优先使用；否则使用首段idx1
 bool MJPEGDecoder::parseIndex() {
-    return true;
+    if (m_videoIndxPos && parseOpenDMLIndex(m_videoIndxPos, &m_frameInfos, &m_frameInfoCount)) {
+        if (m_audioIndxPos && !parseOpenDMLIndex(m_audioIndxPos, &m_audioInfos, &m_audioInfoCount)) {
+            Utils_Logger::error("MJPEGDecoder: audio indx unreadable, playing video only");
+        }
+        m_indexSource = "indx";
+        return true;
+    }
+    
+    freeTables();
+    if (parseIdx1()) {
+        m_indexSource = "idx1";
+        return true;
+    }
+    
+    freeTables();
+    return false;
 }
 
-bool MJPEGDecoder::parseMoviList() {
+// 读取indx超级索引，再逐个读入其指向的ix##标准索引块（每块最多AVI_STD_INDEX_ENTRIES条，一次读取）
+bool MJPEGDecoder::parseOpenDMLIndex(uint32_t indxPos, FrameInfo** table, uint32_t* count) {
+    uint8_t header[32];
+    if (!readAt(indxPos, header, sizeof(header)) || memcmp(header, "indx", 4) != 0) {
+        return false;
+    }
+    
+    uint16_t longsPerEntry = readLE16(header + 8);
+    uint8_t indexType = header[11];
+    uint32_t superCount = readLE32(header + 12);
+    if (longsPerEntry != 4 || indexType != 0x00 || superCount == 0 || superCount * 16 > m_bufferSize) {
+        return false;
+    }
+    
+    uint8_t* superEntries = (uint8_t*)malloc(superCount * 16);
+    if (!superEntries) {
+        return false;
+    }
+    if (!readAt(indxPos + 32, superEntries, superCount * 16)) {
+        free(superEntries);
+        return false;
+    }
+    
+    uint32_t capacity = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < superCount && ok; i++) {
+        const uint8_t* entry = superEntries + i * 16;
+        uint64_t indexPos = (uint64_t)readLE32(entry) | ((uint64_t)readLE32(entry + 4) << 32);
+        uint32_t indexSize = readLE32(entry + 8);
+        if (indexSize < 32 || indexSize > m_bufferSize || indexPos + indexSize > m_fileSize ||
+            !readAt(indexPos, m_buffer, indexSize)) {
+            ok = false;
+            break;
+        }
+        
+        // ix##标准索引：AVI_INDEX_OF_CHUNKS，每条8字节（相对qwBaseOffset的数据位置、大小|非关键帧标志）
+        if (memcmp(m_buffer, "ix", 2) != 0 || readLE16(m_buffer + 8) != 2 || m_buffer[11] != 0x01) {
+            ok = false;
+            break;
+        }
+        uint32_t entryCount = readLE32(m_buffer + 12);
+        if (32 + (uint64_t)entryCount * 8 > indexSize) {
+            entryCount = (indexSize - 32) / 8;
+        }
+        uint64_t baseOffset = (uint64_t)readLE32(m_buffer + 20) | ((uint64_t)readLE32(m_buffer + 24) << 32);
+        
+        const uint8_t* stdEntry = m_buffer + 32;
+        for (uint32_t j = 0; j < entryCount; j++, stdEntry += 8) {
+            if (!appendInfo(table, count, &capacity, baseOffset + readLE32(stdEntry),
+                            readLE32(stdEntry + 4) & 0x7FFFFFFF)) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    free(superEntries);
+    
+    if (!ok || *count == 0) {
+        Utils_Logger::error("MJPEGDecoder: OpenDML index invalid at %u", indxPos);
+        if (*table) {
+            free(*table);
+            *table = nullptr;
+        }
+        *count = 0;
+        return false;
+    }
+    
+    // 释放多余容量
+    FrameInfo* shrunk = (FrameInfo*)realloc(*table, *count * sizeof(FrameInfo));
+    if (shrunk) {
+        *table = shrunk;
+    }
     return true;
 }
 
-bool MJPEGDecoder::parseSimplifiedMovi() {
-    m_frameInfoCount = 0;
-    m_frameInfos = (FrameInfo*)malloc(10000 * sizeof(FrameInfo));
-    if (!m_frameInfos) {
+// 读取首段movi之后的idx1，按m_bufferSize分批读入（一般一次读完）
+bool MJPEGDecoder::parseIdx1() {
+    if (m_moviStartPos == 0 || m_moviListSize == 0) {
         return false;
     }
     
-    uint32_t pos = 0;
-    uint32_t foundFrames = 0;
+    uint64_t indexPos = (uint64_t)m_moviStartPos + 8 + m_moviListSize + (m_moviListSize & 1);
+    uint8_t header[8];
+    if (indexPos + 8 > m_fileSize || !readAt(indexPos, header, sizeof(header)) || memcmp(header, "idx1", 4) != 0) {
+        return false;
+    }
+    uint32_t indexSize = readLE32(header + 4);
+    if (indexPos + 8 + indexSize > m_fileSize) {
+        indexSize = (uint32_t)(m_fileSize - indexPos - 8);
+    }
+    m_indexStartPos = (uint32_t)indexPos;
+    
+    // idx1只覆盖首个RIFF段；后面还有RIFF AVIX段时交给遍历处理
+    uint64_t nextPos = indexPos + 8 + indexSize + (indexSize & 1);
+    if (nextPos + 12 <= m_fileSize && readAt(nextPos, header, 4) && memcmp(header, "RIFF", 4) == 0) {
+        Utils_Logger::info("MJPEGDecoder: idx1 covers first RIFF segment only");
+        return false;
+    }
     
-    // 先寻找 movi 块，跳过文件头部
-    while (pos < m_fileSize - 8) {
-        UINT bytesRead;
-        f_lseek(&m_file, pos);
-        f_read(&m_file, m_buffer, 8, &bytesRead);
+    // idx1偏移的基准位置因写入方而异（movi标识位置、其后4字节或文件开头），用首个条目探测
+    uint64_t base = 0;
+    bool baseKnown = false;
+    uint32_t videoCapacity = 0;
+    uint32_t audioCapacity = 0;
+    uint32_t entryCount = indexSize / 16;
+    uint32_t entriesPerRead = m_bufferSize / 16;
+    
+    for (uint32_t done = 0; done < entryCount; ) {
+        uint32_t batch = (entryCount - done < entriesPerRead) ? entryCount - done : entriesPerRead;
+        if (!readAt(indexPos + 8 + (uint64_t)done * 16, m_buffer, batch * 16)) {
+            return false;
+        }
         
-        if (memcmp(m_buffer, "movi", 4) == 0) {
-            pos += 8;
-            break;
+        for (uint32_t i = 0; i < batch; i++) {
+            const uint8_t* entry = m_buffer + i * 16;
+            int stream = chunkStream(entry);
+            if (stream < 0 || (stream != m_videoStream && stream != m_audioStream)) {
+                continue;
+            }
+            uint32_t offset = readLE32(entry + 8);
+            uint32_t size = readLE32(entry + 12);
+            
+            if (!baseKnown) {
+                const uint64_t candidates[3] = { (uint64_t)m_moviStartPos + 8, (uint64_t)m_moviStartPos + 12, 0 };
+                for (int c = 0; c < 3 && !baseKnown; c++) {
+                    uint8_t chunkId[4];
+                    if (readAt(candidates[c] + offset, chunkId, 4) && memcmp(chunkId, entry, 4) == 0) {
+                        base = candidates[c];
+                        baseKnown = true;
+                    }
+                }
+                if (!baseKnown) {
+                    Utils_Logger::error("MJPEGDecoder: idx1 offsets do not match movi");
+                    return false;
+                }
+            }
+            
+            bool ok = (stream == m_videoStream)
+                ? appendInfo(&m_frameInfos, &m_frameInfoCount, &videoCapacity, base + offset + 8, size)
+                : appendInfo(&m_audioInfos, &m_audioInfoCount, &audioCapacity, base + offset + 8, size);
+            if (!ok) {
+                return false;
+            }
+        }
+        done += batch;
+    }
+    
+    return m_frameInfoCount > 0;
+}
+
+// 无可用索引时遍历movi（含后续RIFF AVIX段），每个块读取一次块头
+bool MJPEGDecoder::parseSimplifiedMovi() {
+    freeTables();
+    if (m_videoStream < 0) {
+        m_videoStream = 0;
+    }
+    if (m_audioStream < 0) {
+        m_audioStream = 1;
+    }
+    
+    uint64_t pos = 0;
+    uint32_t videoCapacity = 0;
+    uint32_t audioCapacity = 0;
+    
+    if (m_moviStartPos > 0) {
+        pos = (uint64_t)m_moviStartPos + 12;
+    } else {
+        // 文件头无法解析：在文件头部查找movi
+        UINT bytesRead = 0;
+        uint32_t headerLen = (m_fileSize < AVI_DECODER_HEADER_SIZE) ? m_fileSize : AVI_DECODER_HEADER_SIZE;
+        f_lseek(&m_file, 0);
+        f_read(&m_file, m_buffer, headerLen, &bytesRead);
+        for (uint32_t i = 12; i + 4 <= bytesRead; i++) {
+            if (memcmp(m_buffer + i, "movi", 4) == 0) {
+                pos = i + 4;
+                break;
+            }
         }
-        pos += 1;
     }
     
-    // 从 movi 块开始查找所有视频帧
-    while (pos < m_fileSize - 8 && foundFrames < 10000) {
-        UINT bytesRead;
-        f_lseek(&m_file, pos);
-        f_read(&m_file, m_buffer, 8, &bytesRead);
+    while (pos + 8 < m_fileSize) {
+        uint8_t header[8];
+        if (!readAt(pos, header, sizeof(header))) {
+            break;
+        }
+        uint32_t chunkSize = readLE32(header + 4);
+        int stream = chunkStream(header);
         
-        if (memcmp(m_buffer, "00db", 4) == 0) {
-            // 找到视频帧
-            uint32_t frameSize = readLE32(m_buffer + 4);
-            if (frameSize > 100 && frameSize < 1000000) {
-                if (pos + 8 + frameSize <= m_fileSize) {
-                    m_frameInfos[m_frameInfoCount].offset = pos + 8;
-                    m_frameInfos[m_frameInfoCount].size = frameSize;
-                    m_frameInfoCount++;
-                    foundFrames++;
-                    pos += 8 + frameSize + (frameSize % 2);
-                    continue;
+        if (stream == m_videoStream && header[2] == 'd') {
+            // 视频帧
+            if (chunkSize > 100 && chunkSize < 1000000 && pos + 8 + chunkSize <= m_fileSize && (pos & 1) == 0) {
+                if (!appendInfo(&m_frameInfos, &m_frameInfoCount, &videoCapacity, pos + 8, chunkSize)) {
+                    break;
                 }
+                pos += 8 + chunkSize + (chunkSize % 2);
+                continue;
             }
             pos += 8;
-        } else if (memcmp(m_buffer, "01wb", 4) == 0) {
-            // 找到音频帧，跳过
-            uint32_t audioSize = readLE32(m_buffer + 4);
-            pos += 8 + audioSize + (audioSize % 2);
-        } else if (memcmp(m_buffer, "idx1", 4) == 0) {
-            // 找到索引块，停止解析
-            break;
+        } else if (stream == m_audioStream && header[2] == 'w' && header[3] == 'b') {
+            // 音频块
+            if (pos + 8 + chunkSize <= m_fileSize && (pos & 1) == 0) {
+                appendInfo(&m_audioInfos, &m_audioInfoCount, &audioCapacity, pos + 8, chunkSize);
+            }
+            pos += 8 + chunkSize + (chunkSize % 2);
+        } else if (memcmp(header, "idx1", 4) == 0 || memcmp(header, "ix", 2) == 0 ||
+                   memcmp(header, "JUNK", 4) == 0) {
+            // 索引块(idx1/ix##)或填充块，整块跳过，继续解析后续RIFF AVIX段
+            pos += 8 + chunkSize + (chunkSize % 2);
+        } else if (memcmp(header, "RIFF", 4) == 0 || memcmp(header, "LIST", 4) == 0) {
+            // OpenDML的RIFF AVIX段头和其中的movi列表头，进入列表内部
+            pos += 12;
         } else {
             // 其他块，向前移动
             pos += 1;
         }
     }
     
-    m_frameCount = m_frameInfoCount;
-    Utils_Logger::info("MJPEGDecoder found %d video frames", m_frameInfoCount);
+    m_indexSource = "scan";
+    Utils_Logger::info("MJPEGDecoder scanned movi: %u video frames, %u audio chunks", m_frameInfoCount, m_audioInfoCount);
     return m_frameInfoCount > 0;
 }
 
+// 位置表按需倍增扩容，不设帧数上限
+bool MJPEGDecoder::appendInfo(FrameInfo** table, uint32_t* count, uint32_t* capacity, uint64_t dataPos, uint32_t size) {
+    if ((dataPos & 1) || (dataPos >> 1) > 0xFFFFFFFFULL) {
+        return false;
+    }
+    if (*count >= *capacity) {
+        uint32_t newCapacity = (*capacity > 0) ? *capacity * 2 : 1024;
+        FrameInfo* newTable = (FrameInfo*)realloc(*table, newCapacity * sizeof(FrameInfo));
+        if (!newTable) {
+            Utils_Logger::error("MJPEGDecoder: failed to grow frame table to %u entries", newCapacity);
+            return false;
+        }
+        *table = newTable;
+        *capacity = newCapacity;
+    }
+    
+    FrameInfo& info = (*table)[(*count)++];
+    info.offsetHalf = (uint32_t)(dataPos >> 1);
+    info.size = size;
+    return true;
+}
+
+// 块标识前两位为流序号（00db/01wb/ix00），非数字返回-1
+int MJPEGDecoder::chunkStream(const uint8_t* chunkId) const {
+    if (chunkId[0] < '0' || chunkId[0] > '9' || chunkId[1] < '0' || chunkId[1] > '9') {
+        return -1;
+    }
+    return (chunkId[0] - '0') * 10 + (chunkId[1] - '0');
+}
+
+bool MJPEGDecoder::readAt(uint64_t offset, void* data, uint32_t size) {
+    UINT bytesRead = 0;
+    if (f_lseek(&m_file, (FSIZE_t)offset) != FR_OK) {
+        return false;
+    }
+    return f_read(&m_file, data, size, &bytesRead) == FR_OK && bytesRead == size;
+}
+
+uint16_t MJPEGDecoder::readLE16(const uint8_t* buffer) {
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
 uint32_t MJPEGDecoder::readLE32(const uint8_t* buffer) {
     return (uint32_t)buffer[0] | 
            (uint32_t)buffer[1] << 8 | 
            (uint32_t)buffer[2] << 16 | 
            (uint32_t)buffer[3] << 24;
 }
-
-bool MJPEGDecoder::readChunkHeader(char* chunkID, uint32_t* chunkSize) {
-    return true;
-}
\ No newline at end of file
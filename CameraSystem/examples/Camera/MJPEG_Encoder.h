@@ -3,6 +3,17 @@
  * 实现JPEG流编码为AVI格式视频文件
  * 支持双音视频流同步录制
  * V1.18: 添加互斥锁保护多任务并发访问
+ * V1.49: 改为流式写入，数据块经有限写缓冲区直接落盘，不再整段缓存在内存
+ * V1.50: 增加OpenDML(AVI 2.0)写入：indx超级索引、ix00/ix01标准索引、dmlh和RIFF AVIX分段
+ * V1.51: 周期性检查点（回写临时长度字段并f_sync），断电后可由AVIRecovery修复
+ * V1.52: 按预估码率预分配连续簇（f_expand），簇对齐多扇区写入，结束时截断
+ * V1.55: 视频帧零拷贝写入：JUNK填充使负载扇区对齐，负载直接从VOE帧缓冲写入文件
+ * V1.56: 音频流可选IMA-ADPCM编码（begin()参数），音频数据量降为PCM的约1/4
+ * V1.57: 按时间戳同步音视频：漏帧补重复索引、早到帧丢弃，音频补静音/丢采样，每个视频帧后交织一个音频块
+ * V1.58: 导出写队列积压供录制码率控制使用
+ * V1.59: 解码器按indx/ix##或idx1索引一次建立帧/音频位置表，无索引时才遍历movi，取消帧数上限
+ * V1.60: 解码器增加按帧号随机读取和最大帧大小，供回放预取任务使用
+ * V1.62: 解码器导出音频块大小，回放时按位置表定位音频起点
  */
 
 #ifndef MJPEG_ENCODER_H
@@ -14,6 +25,46 @@
 #include "Camera_SDCardManager.h"
 #include "DS3231_ClockModule.h"
 #include "AmebaFatFS.h"
+#include "MJPEG_StreamWriter.h"
+#include "MJPEG_ImaAdpcm.h"
+
+#define AVI_HEADER_BUFFER_SIZE  10240  // AVI文件头构建缓冲区大小（含两路indx超级索引）
+#define AVI_INDEX_BUFFER_SIZE   4096   // idx1临时索引文件写缓冲区大小
+#define AVI_DECODER_HEADER_SIZE 16384  // 解码器打开时一次读入的文件头长度
+#define AVI_DECODER_BUFFER_SIZE (1024 * 1024)  // 解码器帧/索引读取缓冲区大小
+
+// OpenDML (AVI 2.0) 配置
+#define AVI_RIFF_SEGMENT_LIMIT  (1000UL * 1024UL * 1024UL)  // 单个RIFF段上限，首段保持1GB以内兼容只认idx1的播放器
+#define AVI_MAX_RIFF_SEGMENTS   64     // RIFF段数上限（RIFF AVI + 多个RIFF AVIX）
+#define AVI_SUPER_INDEX_ENTRIES 256    // 每路流indx超级索引容量
+#define AVI_STD_INDEX_ENTRIES   4096   // 每个ix##标准索引块的条目数，写满即写入movi
+#define AVI_STREAM_VIDEO        0
+#define AVI_STREAM_AUDIO        1
+#define AVI_STREAM_COUNT        2
+
+// 崩溃保护：每隔该时间提交一次数据和临时文件头，断电最多丢失一个周期的内容
+#define AVI_CHECKPOINT_INTERVAL_MS  2000
+// 检查点记录：hdrl末尾的JUNK块（标记+64位长度），保存最后一次检查点已同步的文件长度
+// 预分配文件的f_size是预分配大小，断电修复时以该长度为遍历上限，不会误收之后残留的旧数据块
+#define AVI_CHECKPOINT_TAG          "CKPT"
+#define AVI_CHECKPOINT_JUNK_SIZE    16
+
+// 预分配：按约1bit/像素估算MJPEG码率，并为SD卡保留最小剩余空间
+#define AVI_PREALLOC_PIXELS_PER_BYTE  8
+#define AVI_PREALLOC_FREE_RESERVE     (64ULL * 1024ULL * 1024ULL)
+// 单次预分配上限：f_expand在开始录制路径上同步查找并分配连续簇，耗时随大小增长
+#define AVI_PREALLOC_MAX_BYTES        (256ULL * 1024ULL * 1024ULL)
+
+// 音频流编码格式
+typedef enum {
+    AVI_AUDIO_PCM = 0,        // 16位PCM，strh单位为采样
+    AVI_AUDIO_IMA_ADPCM = 1   // IMA-ADPCM 4bit，strh单位为块（IMA_ADPCM_SAMPLES_PER_BLOCK个采样）
+} AVIAudioCodec;
+
+// 音频暂存：两个视频帧之间到达的音频在下一帧写入后合并为一个音频块，暂存满时提前写出
+#define AVI_AUDIO_STAGE_SAMPLES  2048
+// ADPCM编码一次暂存数据（含编码器中不足一块的剩余样本）最多输出的块数
+#define AVI_ADPCM_MAX_BLOCKS  ((AVI_AUDIO_STAGE_SAMPLES + IMA_ADPCM_SAMPLES_PER_BLOCK - 1) / IMA_ADPCM_SAMPLES_PER_BLOCK + 1)
 
 // AVI索引条目结构体
 struct AVIIndexEntry {
@@ -23,54 +74,148 @@ struct AVIIndexEntry {
     uint32_t chunkSize;   // 块大小
 };
 
+// OpenDML超级索引条目（指向一个ix##标准索引块）
+struct AVISuperIndexEntry {
+    uint64_t offset;    // ix##块在文件中的绝对位置
+    uint32_t size;      // ix##块大小（含8字节块头）
+    uint32_t duration;  // 覆盖时长（视频:帧数，音频:strh单位，PCM为采样数、ADPCM为块数）
+};
+
+// 单路流的OpenDML索引状态
+struct AVIStreamIndex {
+    char chunkId[4];       // 数据块标识（00db/01wb）
+    char indexId[4];       // 标准索引块标识（ix00/ix01）
+    uint8_t* entries;      // 当前ix##条目缓冲（每条8字节，小端）
+    uint32_t entryCount;
+    uint32_t duration;
+    AVISuperIndexEntry superEntries[AVI_SUPER_INDEX_ENTRIES];
+    uint32_t superCount;
+    uint32_t indxOffset;   // 文件头中indx块的位置
+};
+
+// RIFF段位置记录（结束时回写各段RIFF/movi大小）
+struct AVIRiffSegment {
+    uint64_t riffPos;
+    uint64_t moviPos;
+    uint64_t moviEnd;
+    uint64_t riffEnd;
+};
+
 class MJPEGEncoder {
 public:
     MJPEGEncoder();
     ~MJPEGEncoder();
     
-    bool begin(const char* fileName, uint32_t width, uint32_t height, uint32_t fps);
-    bool addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp);
+    bool begin(const char* fileName, uint32_t width, uint32_t height, uint32_t fps,
+               AVIAudioCodec audioCodec = AVI_AUDIO_PCM);
+    // zeroCopy为true时JPEG负载不复制到写缓冲区，由写入任务直接从jpegData写入文件，
+    // 调用者在waitZeroCopyWrites()返回前不能释放或复用jpegData（VOE帧缓冲）
+    bool addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp, bool zeroCopy = false);
+    bool waitZeroCopyWrites(uint32_t timeoutMs) { return m_writer.waitDirectWrites(timeoutMs); }
     bool addAudioFrame(const uint8_t* audioData, uint32_t audioSize, uint32_t timestamp);
     bool end(const DS3231_Time* fileTime = nullptr);
+    // end()时写入任务未能排空（SD卡过慢），写入器保持打开；写入任务运行期间可重试关闭，
+    // 仍失败则在AVIStreamWriter::pauseWriteTask()成功后调用abortWriters()放弃，之后才能再次begin()
+    // 这两种情况下.idx都保留，文件由下次启动时的AVI恢复修正
+    bool hasOpenWriters() const { return m_writer.isOpen() || m_indexWriter.isOpen(); }
+    bool retryCloseWriters();
+    void abortWriters();
     
     bool isRecording() const;
     uint32_t getFrameCount() const;
     uint32_t getFileSize() const;
+    uint32_t getSegmentCount() const;
     void debugAVIStructure();
     
+    // 预分配时长（秒），0表示关闭；需在begin()之前设置
+    void setPreallocateSeconds(uint32_t seconds) { m_preallocateSeconds = seconds; }
+    uint32_t estimateBytesPerSecond() const;
+    // SD卡写入统计（录制结束后保留到下一次begin()）
+    uint32_t getWriteThroughputKBps() const { return m_writer.getWriteThroughputKBps(); }
+    uint32_t getMaxWriteLatencyUs() const { return m_writer.getMaxWriteLatencyUs(); }
+    AVIAudioCodec getAudioCodec() const { return m_audioCodec; }
+    // 音视频同步统计：补的重复帧、丢弃的早到帧、补的静音采样和丢弃的音频采样
+    uint32_t getDuplicatedFrames() const { return m_duplicatedFrames; }
+    uint32_t getDroppedEarlyFrames() const { return m_droppedEarlyFrames; }
+    uint32_t getAudioPaddedSamples() const { return m_audioPaddedSamples; }
+    uint32_t getAudioDroppedSamples() const { return m_audioDroppedSamples; }
+    
 private:
     bool writeAVIHeader();
+    void writeSuperIndexChunk(AVIStreamIndex& stream);
+    void fillSuperIndexChunk(const AVIStreamIndex& stream);
     bool writeIndex();
+    bool writeStdIndex(AVIStreamIndex& stream);
+    bool closeSegment();
+    bool startNewSegment();
+    bool appendChunk(AVIStreamIndex& stream, const uint8_t* data, uint32_t size, uint32_t flags, uint32_t duration,
+                     bool zeroCopy = false);
+    bool appendAlignmentJunk(uint32_t alignUnit);
+    bool addIndexEntry(AVIStreamIndex& stream, uint64_t chunkStartPos, uint32_t size, uint32_t flags, uint32_t duration);
+    bool duplicateLastVideoFrame();
+    bool stageAudio(const int16_t* samples, uint32_t count);
+    bool flushAudioStage();
+    bool patchLE32(uint64_t offset, uint32_t value);
+    bool checkpoint();
+    bool appendAudioBlocks(const uint8_t* data, uint32_t blocks);
     uint32_t readLE32(const uint8_t* buffer);
     
     char m_fileName[256];
+    char m_indexFileName[256];   // idx1临时索引文件（首段结束后并入AVI并删除）
     bool m_recording;
     uint32_t m_width;
     uint32_t m_height;
     uint32_t m_fps;
     uint32_t m_frameCount;
     uint32_t m_audioFrameCount;
-    uint32_t m_totalAudioSamples;
-    uint32_t m_fileSize;
+    uint32_t m_totalAudioSamples;   // 音频时间轴上的采样数（含补的静音）
+    uint32_t m_audioLength;       // 音频strh.dwLength（PCM为采样数，ADPCM为块数）
+    uint64_t m_fileSize;
     
-    uint8_t* m_buffer;
+    AVIAudioCodec m_audioCodec;
+    IMAADPCMEncoder m_adpcmEncoder;
+    uint8_t m_adpcmBuffer[AVI_ADPCM_MAX_BLOCKS * IMA_ADPCM_BLOCK_ALIGN];
+    int16_t m_audioStage[AVI_AUDIO_STAGE_SAMPLES];
+    uint32_t m_audioStageCount;
+    
+    // 时间戳同步：首个视频帧时间为时间轴起点，视频按1/fps帧位、音频按采样位置对齐
+    bool m_videoStarted;
+    uint32_t m_videoStartTime;
+    uint64_t m_lastVideoChunkPos;   // 上一个视频块位置（补重复帧时索引指向它）
+    uint32_t m_lastVideoChunkSize;
+    uint32_t m_duplicatedFrames;
+    uint32_t m_droppedEarlyFrames;
+    uint32_t m_audioPaddedSamples;
+    uint32_t m_audioDroppedSamples;
+    
+    uint8_t* m_buffer;           // AVI文件头构建缓冲区（结束时整体回写）
     uint32_t m_bufferSize;
     uint32_t m_bufferPos;
-    uint32_t m_maxBufferSize;
     uint32_t m_moviStartPos;
     uint32_t m_moviDataStart;
     uint32_t m_totalFramesOffset;
     uint32_t m_videoStrhLengthOffset;
     uint32_t m_audioStrhLengthOffset;
+    uint32_t m_dmlhFramesOffset;
+    uint32_t m_checkpointEndOffset;   // 检查点记录中已同步长度字段的位置
     
-    AVIIndexEntry* m_indexEntries;
+    AVIStreamWriter m_writer;       // AVI文件流式写入器
+    AVIStreamWriter m_indexWriter;  // idx1临时索引文件写入器（仅首段）
     uint32_t m_indexEntryCount;
-    uint32_t m_indexCapacity;
+    
+    AVIStreamIndex m_streams[AVI_STREAM_COUNT];
+    AVIRiffSegment m_segments[AVI_MAX_RIFF_SEGMENTS];
+    uint32_t m_segmentCount;
+    uint32_t m_firstSegmentFrames;  // 首个RIFF段内的视频帧数（avih.dwTotalFrames）
+    uint32_t m_lastCheckpointTime;
+    uint32_t m_checkpointCount;
+    uint32_t m_preallocateSeconds;
     
     SemaphoreHandle_t m_mutex;
 };
 
 // MJPEG解码器类
+// 打开时一次读入文件头，优先从OpenDML indx/ix##或idx1索引建立帧/音频位置表，无索引时才遍历movi
 class MJPEGDecoder {
 public:
     MJPEGDecoder();
@@ -88,14 +233,45 @@ public:
     uint32_t getFileSize() const;
     uint32_t getCurrentFrameIndex() const;
     
+    // 按帧号随机读取（不改变当前帧号），预取任务使用；与readNextFrame不能在不同任务中同时调用
+    bool getFrameInfo(uint32_t frameIndex, uint64_t* offset, uint32_t* size) const;
+    bool readFrameAt(uint32_t frameIndex, uint8_t* buffer, uint32_t bufferSize, uint32_t* frameSize);
+    uint32_t getMaxFrameSize() const { return m_maxFrameSize; }
+    
+    // 音频流（位置表与视频同时建立）；readAudioChunk读取第index个音频块
+    bool hasAudio() const { return m_audioInfoCount > 0; }
+    uint32_t getAudioChunkCount() const { return m_audioInfoCount; }
+    uint32_t getAudioChunkSize(uint32_t index) const { return (index < m_audioInfoCount) ? m_audioInfos[index].size : 0; }
+    uint16_t getAudioFormatTag() const { return m_audioFormatTag; }
+    uint16_t getAudioChannels() const { return m_audioChannels; }
+    uint32_t getAudioSampleRate() const { return m_audioSampleRate; }
+    uint16_t getAudioBlockAlign() const { return m_audioBlockAlign; }
+    uint16_t getAudioSamplesPerBlock() const { return m_audioSamplesPerBlock; }
+    bool readAudioChunk(uint32_t index, uint8_t* buffer, uint32_t bufferSize, uint32_t* chunkSize);
+    
+    // 打开统计：索引来源（"indx"/"idx1"/"scan"）和耗时
+    const char* getIndexSource() const { return m_indexSource; }
+    uint32_t getOpenTimeMs() const { return m_openTimeMs; }
+    
 private:
+    // 位置表条目：数据块（跳过8字节块头）在文件中的位置/2（块按2字节对齐，可寻址8GB）和大小
+    struct FrameInfo {
+        uint32_t offsetHalf;
+        uint32_t size;
+    };
+    
     bool parseAVIHeader();
+    bool parseHeaderList(uint32_t pos, uint32_t end);
     bool parseIndex();
-    bool parseMoviList();
+    bool parseOpenDMLIndex(uint32_t indxPos, FrameInfo** table, uint32_t* count);
+    bool parseIdx1();
     bool parseSimplifiedMovi();
-    bool parseMoreFrames();
+    bool appendInfo(FrameInfo** table, uint32_t* count, uint32_t* capacity, uint64_t dataPos, uint32_t size);
+    void freeTables();
+    int chunkStream(const uint8_t* chunkId) const;
+    bool readAt(uint64_t offset, void* data, uint32_t size);
+    uint16_t readLE16(const uint8_t* buffer);
     uint32_t readLE32(const uint8_t* buffer);
-    bool readChunkHeader(char* chunkID, uint32_t* chunkSize);
     
     char m_fileName[256];
     bool m_open;
@@ -108,18 +284,33 @@ private:
     
     uint8_t* m_buffer;
     uint32_t m_bufferSize;
+    uint64_t m_bufferedOffset;    // m_buffer中当前帧数据的文件位置（重复帧索引指向同一块时不重复读取）
     
     FIL m_file;
-    uint32_t m_moviStartPos;
-    uint32_t m_indexStartPos;
+    uint32_t m_moviStartPos;      // 首段movi LIST块位置
+    uint32_t m_moviListSize;
+    uint32_t m_indexStartPos;     // idx1块位置（0表示无）
+    uint32_t m_headerFrames;      // dmlh/avih记录的总帧数
     
-    struct FrameInfo {
-        uint32_t offset;
-        uint32_t size;
-    };
+    int m_videoStream;            // 流序号（块标识前两位），-1表示无
+    int m_audioStream;
+    uint32_t m_videoIndxPos;      // 文件头中indx超级索引位置（0表示无）
+    uint32_t m_audioIndxPos;
+    
+    uint16_t m_audioFormatTag;
+    uint16_t m_audioChannels;
+    uint32_t m_audioSampleRate;
+    uint16_t m_audioBlockAlign;
+    uint16_t m_audioSamplesPerBlock;
     
     FrameInfo* m_frameInfos;
     uint32_t m_frameInfoCount;
+    uint32_t m_maxFrameSize;
+    FrameInfo* m_audioInfos;
+    uint32_t m_audioInfoCount;
+    
+    const char* m_indexSource;
+    uint32_t m_openTimeMs;
 };
 
 #endif // MJPEG_ENCODER_H
\ No newline at end of file
@@ -0,0 +1,223 @@
+/*
+ * MJPEG_ImaAdpcm.cpp - IMA-ADPCM音频编解码器实现
+ * 16位PCM按WAVE_FORMAT_IMA_ADPCM（0x0011）块格式压缩为4bit，数据量约为原来的1/4
+ * 定点实现，每个样本只有移位、加减和查表，适合在录制路径中逐块编码、回放路径中逐块解码
+ */
+
+#include "MJPEG_ImaAdpcm.h"
+
+static const int16_t s_stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t s_indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+IMAADPCMEncoder::IMAADPCMEncoder()
+    : m_pendingCount(0)
+    , m_predictor(0)
+    , m_stepIndex(0)
+{
+}
+
+void IMAADPCMEncoder::reset() {
+    m_pendingCount = 0;
+    m_predictor = 0;
+    m_stepIndex = 0;
+}
+
+// 标准IMA量化：按步长逐位逼近差值，预测值用解码端相同的方式重建，编解码不会漂移
+uint8_t IMAADPCMEncoder::encodeSample(int32_t sample) {
+    int32_t step = s_stepTable[m_stepIndex];
+    int32_t diff = sample - m_predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+
+    int32_t delta = step >> 3;
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+        delta += step;
+    }
+
+    m_predictor += (code & 8) ? -delta : delta;
+    if (m_predictor > 32767) {
+        m_predictor = 32767;
+    } else if (m_predictor < -32768) {
+        m_predictor = -32768;
+    }
+
+    m_stepIndex += s_indexTable[code];
+    if (m_stepIndex < 0) {
+        m_stepIndex = 0;
+    } else if (m_stepIndex > 88) {
+        m_stepIndex = 88;
+    }
+    return code;
+}
+
+// 块格式：首样本(int16) + 步长索引(uint8) + 保留(0)，其后每字节两个样本，低4位在前
+void IMAADPCMEncoder::encodeBlock(const int16_t* samples, uint8_t* out) {
+    m_predictor = samples[0];
+    out[0] = (uint8_t)(samples[0] & 0xFF);
+    out[1] = (uint8_t)((samples[0] >> 8) & 0xFF);
+    out[2] = (uint8_t)m_stepIndex;
+    out[3] = 0;
+
+    uint8_t* data = out + 4;
+    for (uint32_t i = 1; i < IMA_ADPCM_SAMPLES_PER_BLOCK; i += 2) {
+        uint8_t low = encodeSample(samples[i]);
+        uint8_t high = encodeSample(samples[i + 1]);
+        *data++ = low | (high << 4);
+    }
+}
+
+uint32_t IMAADPCMEncoder::encode(const int16_t* samples, uint32_t count, uint8_t* out, uint32_t maxBlocks, uint32_t* consumed) {
+    uint32_t blocks = 0;
+    uint32_t used = 0;
+
+    while (used < count && blocks < maxBlocks) {
+        // 没有积压且输入够一整块时直接从输入编码，省去复制
+        if (m_pendingCount == 0 && count - used >= IMA_ADPCM_SAMPLES_PER_BLOCK) {
+            encodeBlock(samples + used, out + blocks * IMA_ADPCM_BLOCK_ALIGN);
+            used += IMA_ADPCM_SAMPLES_PER_BLOCK;
+            blocks++;
+            continue;
+        }
+
+        uint32_t take = IMA_ADPCM_SAMPLES_PER_BLOCK - m_pendingCount;
+        if (take > count - used) {
+            take = count - used;
+        }
+        memcpy(m_pending + m_pendingCount, samples + used, take * sizeof(int16_t));
+        m_pendingCount += take;
+        used += take;
+
+        if (m_pendingCount == IMA_ADPCM_SAMPLES_PER_BLOCK) {
+            encodeBlock(m_pending, out + blocks * IMA_ADPCM_BLOCK_ALIGN);
+            m_pendingCount = 0;
+            blocks++;
+        }
+    }
+
+    if (consumed) {
+        *consumed = used;
+    }
+    return blocks;
+}
+
+uint32_t IMAADPCMEncoder::flush(uint8_t* out) {
+    if (m_pendingCount == 0) {
+        return 0;
+    }
+
+    int16_t last = m_pending[m_pendingCount - 1];
+    while (m_pendingCount < IMA_ADPCM_SAMPLES_PER_BLOCK) {
+        m_pending[m_pendingCount++] = last;
+    }
+    encodeBlock(m_pending, out);
+    m_pendingCount = 0;
+    return 1;
+}
+
+uint32_t IMAADPCMDecoder::samplesInData(uint32_t size, uint32_t blockAlign) {
+    if (blockAlign <= 4) {
+        return 0;
+    }
+    uint32_t samples = (size / blockAlign) * ((blockAlign - 4) * 2 + 1);
+    uint32_t remain = size % blockAlign;
+    if (remain >= 4) {
+        samples += (remain - 4) * 2 + 1;
+    }
+    return samples;
+}
+
+// 与IMAADPCMEncoder::encodeSample相同的重建过程，逐个半字节还原样本
+uint32_t IMAADPCMDecoder::decodeBlock(const uint8_t* block, uint32_t size, int16_t* out, uint32_t maxSamples) {
+    if (size < 4 || maxSamples == 0) {
+        return 0;
+    }
+
+    int32_t predictor = (int16_t)(block[0] | (block[1] << 8));
+    int32_t stepIndex = block[2];
+    if (stepIndex > 88) {
+        stepIndex = 88;
+    }
+    out[0] = (int16_t)predictor;
+    uint32_t count = 1;
+
+    for (uint32_t i = 4; i < size; i++) {
+        for (uint32_t shift = 0; shift < 8; shift += 4) {
+            if (count >= maxSamples) {
+                return count;
+            }
+            uint8_t code = (block[i] >> shift) & 0x0F;
+            int32_t step = s_stepTable[stepIndex];
+            int32_t delta = step >> 3;
+            if (code & 4) {
+                delta += step;
+            }
+            if (code & 2) {
+                delta += step >> 1;
+            }
+            if (code & 1) {
+                delta += step >> 2;
+            }
+
+            predictor += (code & 8) ? -delta : delta;
+            if (predictor > 32767) {
+                predictor = 32767;
+            } else if (predictor < -32768) {
+                predictor = -32768;
+            }
+
+            stepIndex += s_indexTable[code];
+            if (stepIndex < 0) {
+                stepIndex = 0;
+            } else if (stepIndex > 88) {
+                stepIndex = 88;
+            }
+            out[count++] = (int16_t)predictor;
+        }
+    }
+    return count;
+}
+
+uint32_t IMAADPCMDecoder::decode(const uint8_t* data, uint32_t size, uint32_t blockAlign, int16_t* out, uint32_t maxSamples) {
+    if (blockAlign <= 4) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    while (size > 0 && count < maxSamples) {
+        uint32_t blockSize = (size < blockAlign) ? size : blockAlign;
+        count += decodeBlock(data, blockSize, out + count, maxSamples - count);
+        data += blockSize;
+        size -= blockSize;
+    }
+    return count;
+}
@@ -0,0 +1,54 @@
+/*
+ * MJPEG_ImaAdpcm.h - IMA-ADPCM音频编解码器头文件
+ * 16位PCM按WAVE_FORMAT_IMA_ADPCM（0x0011）块格式压缩为4bit，数据量约为原来的1/4
+ * 定点实现，每个样本只有移位、加减和查表，适合在录制路径中逐块编码、回放路径中逐块解码
+ */
+
+#ifndef MJPEG_IMA_ADPCM_H
+#define MJPEG_IMA_ADPCM_H
+
+#include <Arduino.h>
+
+#define IMA_ADPCM_FORMAT_TAG        0x0011
+#define IMA_ADPCM_BLOCK_ALIGN       256    // 单声道每块字节数（4字节块头 + 252字节数据）
+#define IMA_ADPCM_SAMPLES_PER_BLOCK ((IMA_ADPCM_BLOCK_ALIGN - 4) * 2 + 1)  // 505，块头含第一个样本
+#define IMA_ADPCM_BITS_PER_SAMPLE   4
+
+// 单声道IMA-ADPCM块编码器：输入任意长度的PCM，凑满一块即输出，不足一块的样本留到下次
+class IMAADPCMEncoder {
+public:
+    IMAADPCMEncoder();
+
+    void reset();
+
+    // 编码count个样本，输出完整块到out（容量maxBlocks块），返回输出块数
+    // 输出空间不足时剩余样本不消耗，*consumed返回实际使用的样本数
+    uint32_t encode(const int16_t* samples, uint32_t count, uint8_t* out, uint32_t maxBlocks, uint32_t* consumed);
+    // 录制结束时把不足一块的剩余样本以最后一个样本补齐输出，返回输出块数（0或1）
+    uint32_t flush(uint8_t* out);
+
+    uint32_t getPendingSamples() const { return m_pendingCount; }
+
+private:
+    void encodeBlock(const int16_t* samples, uint8_t* out);
+    uint8_t encodeSample(int32_t sample);
+
+    int16_t m_pending[IMA_ADPCM_SAMPLES_PER_BLOCK];
+    uint32_t m_pendingCount;
+    int32_t m_predictor;
+    int32_t m_stepIndex;
+};
+
+// 单声道IMA-ADPCM块解码器：每块独立（块头携带首样本和步长索引），无需保存块间状态
+class IMAADPCMDecoder {
+public:
+    // 解码size字节的数据（可含末尾不完整的块），输出到out（容量maxSamples），返回样本数
+    static uint32_t decode(const uint8_t* data, uint32_t size, uint32_t blockAlign, int16_t* out, uint32_t maxSamples);
+    // size字节数据解码后的样本数
+    static uint32_t samplesInData(uint32_t size, uint32_t blockAlign);
+
+private:
+    static uint32_t decodeBlock(const uint8_t* block, uint32_t size, int16_t* out, uint32_t maxSamples);
+};
+
+#endif // MJPEG_IMA_ADPCM_H
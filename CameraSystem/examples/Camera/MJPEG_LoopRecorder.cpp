@@ -0,0 +1,335 @@
+/*
+ * MJPEG_LoopRecorder.cpp - 循环分段录制（行车记录仪模式）实现
+ * 连续录制按固定时长切分为多个AVI文件，剩余空间低于阈值时自动删除最早的分段
+ * 两个MJPEGEncoder交替使用：新分段开始接收帧之后，旧分段才在后台收尾，切换时不丢帧
+ */
+
+#include "MJPEG_LoopRecorder.h"
+#include "Camera_SDCardManager.h"
+#include "Utils_Logger.h"
+#include "Shared_GlobalDefines.h"
+
+extern SDCardManager sdCardManager;
+
+MJPEGLoopRecorder::MJPEGLoopRecorder()
+    : m_activeIndex(-1)
+    , m_width(0)
+    , m_height(0)
+    , m_fps(0)
+    , m_audioCodec(AVI_AUDIO_PCM)
+    , m_nextRolloverTime(0)
+    , m_rolloverPending(false)
+    , m_mutex(nullptr)
+    , m_rolloverLock(nullptr)
+    , m_rolloverSignal(nullptr)
+    , m_segmentCount(0)
+    , m_deletedSegmentCount(0)
+    , m_droppedVideoFrames(0)
+    , m_droppedAudioBlocks(0)
+    , m_rolloverFailures(0)
+    , m_maxRolloverTimeMs(0)
+{
+    m_config.segmentSeconds = VIDEO_LOOP_SEGMENT_SECONDS;
+    m_config.minFreeBytes = (uint64_t)VIDEO_LOOP_MIN_FREE_MB * 1024ULL * 1024ULL;
+    m_config.maxSegments = VIDEO_LOOP_MAX_SEGMENTS;
+    memset(m_fileNames, 0, sizeof(m_fileNames));
+    m_mutex = xSemaphoreCreateMutex();
+    m_rolloverLock = xSemaphoreCreateMutex();
+    m_rolloverSignal = xSemaphoreCreateBinary();
+}
+
+MJPEGLoopRecorder::~MJPEGLoopRecorder() {
+    if (m_mutex) {
+        vSemaphoreDelete(m_mutex);
+        m_mutex = nullptr;
+    }
+    if (m_rolloverLock) {
+        vSemaphoreDelete(m_rolloverLock);
+        m_rolloverLock = nullptr;
+    }
+    if (m_rolloverSignal) {
+        vSemaphoreDelete(m_rolloverSignal);
+        m_rolloverSignal = nullptr;
+    }
+}
+
+void MJPEGLoopRecorder::setConfig(const Config& config) {
+    if (isActive()) {
+        Utils_Logger::error("Loop recorder config can only be changed while stopped");
+        return;
+    }
+    m_config = config;
+    if (m_config.segmentSeconds == 0) {
+        m_config.segmentSeconds = VIDEO_LOOP_SEGMENT_SECONDS;
+    }
+}
+
+const char* MJPEGLoopRecorder::getCurrentFileName() const {
+    int index = m_activeIndex;
+    return (index >= 0) ? m_fileNames[index] : "";
+}
+
+// 打开指定编码器上的新分段（文件名按打开时间生成）
+bool MJPEGLoopRecorder::startSegment(int index) {
+    char* fileName = m_fileNames[index];
+    if (sdCardManager.generateTimestampFileName(fileName, sizeof(m_fileNames[index]), ".avi", LOOP_FILE_PREFIX) == nullptr) {
+        return false;
+    }
+
+    // 预分配略大于一个分段，分段结束时截断到实际大小
+    MJPEGEncoder& encoder = m_encoders[index];
+    encoder.setPreallocateSeconds(VIDEO_PREALLOCATE_ENABLED ? m_config.segmentSeconds + m_config.segmentSeconds / 10 : 0);
+    if (!encoder.begin(fileName, m_width, m_height, m_fps, m_audioCodec)) {
+        Utils_Logger::error("Loop recorder: failed to open segment %s", fileName);
+        return false;
+    }
+
+    m_segmentCount++;
+    Utils_Logger::info("Loop segment %d started: %s", m_segmentCount, fileName);
+    return true;
+}
+
+bool MJPEGLoopRecorder::begin(uint32_t width, uint32_t height, uint32_t fps, AVIAudioCodec audioCodec) {
+    if (isActive()) {
+        Utils_Logger::error("Loop recorder already recording");
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_fps = fps;
+    m_audioCodec = audioCodec;
+    m_segmentCount = 0;
+    m_deletedSegmentCount = 0;
+    m_droppedVideoFrames = 0;
+    m_droppedAudioBlocks = 0;
+    m_rolloverFailures = 0;
+    m_maxRolloverTimeMs = 0;
+    m_rolloverPending = false;
+    xSemaphoreTake(m_rolloverSignal, 0);
+
+    // 开始前先腾出空间，保证第一个分段可以写满
+    enforceRetention();
+
+    if (!startSegment(0)) {
+        return false;
+    }
+
+    m_nextRolloverTime = millis() + m_config.segmentSeconds * 1000;
+    m_activeIndex = 0;
+
+    Utils_Logger::info("Loop recording started: %u s segments, min free %llu MB, max segments %u",
+                      m_config.segmentSeconds, m_config.minFreeBytes / (1024 * 1024), m_config.maxSegments);
+    return true;
+}
+
+bool MJPEGLoopRecorder::addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp, bool zeroCopy) {
+    if (xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+        m_droppedVideoFrames++;
+        return false;
+    }
+
+    bool ok = false;
+    int index = m_activeIndex;
+    if (index >= 0) {
+        ok = m_encoders[index].addVideoFrame(jpegData, jpegSize, timestamp, zeroCopy);
+
+        // 分段到时后通知收尾任务切换，在新分段就绪前当前分段继续接收帧
+        if (!m_rolloverPending && (int32_t)(millis() - m_nextRolloverTime) >= 0) {
+            m_rolloverPending = true;
+            xSemaphoreGive(m_rolloverSignal);
+        }
+    }
+
+    xSemaphoreGive(m_mutex);
+
+    if (!ok) {
+        m_droppedVideoFrames++;
+    }
+    return ok;
+}
+
+bool MJPEGLoopRecorder::waitZeroCopyWrites(uint32_t timeoutMs) {
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        ok &= m_encoders[i].waitZeroCopyWrites(timeoutMs);
+    }
+    return ok;
+}
+
+bool MJPEGLoopRecorder::addAudioFrame(const uint8_t* audioData, uint32_t audioSize, uint32_t timestamp) {
+    if (xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+        m_droppedAudioBlocks++;
+        return false;
+    }
+
+    bool ok = false;
+    int index = m_activeIndex;
+    if (index >= 0) {
+        ok = m_encoders[index].addAudioFrame(audioData, audioSize, timestamp);
+    }
+
+    xSemaphoreGive(m_mutex);
+
+    if (!ok) {
+        m_droppedAudioBlocks++;
+    }
+    return ok;
+}
+
+void MJPEGLoopRecorder::service(uint32_t timeoutMs) {
+    if (xSemaphoreTake(m_rolloverSignal, timeoutMs / portTICK_PERIOD_MS) != pdTRUE) {
+        return;
+    }
+
+    xSemaphoreTake(m_rolloverLock, portMAX_DELAY);
+    if (isActive() && m_rolloverPending) {
+        rollover();
+    }
+    xSemaphoreGive(m_rolloverLock);
+}
+
+// 分段切换：先打开新分段，切换后旧分段在本任务中写索引并关闭
+void MJPEGLoopRecorder::rollover() {
+    uint32_t startTime = millis();
+    int oldIndex = m_activeIndex;
+    int newIndex = 1 - oldIndex;
+
+    if (!startSegment(newIndex)) {
+        // 打开失败时继续写当前分段，稍后重试
+        m_rolloverFailures++;
+        m_nextRolloverTime = millis() + LOOP_ROLLOVER_RETRY_MS;
+        m_rolloverPending = false;
+        return;
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_activeIndex = newIndex;
+    m_nextRolloverTime += m_config.segmentSeconds * 1000;
+    if ((int32_t)(millis() - m_nextRolloverTime) >= 0) {
+        m_nextRolloverTime = millis() + m_config.segmentSeconds * 1000;
+    }
+    m_rolloverPending = false;
+    xSemaphoreGive(m_mutex);
+
+    uint32_t switchTime = millis() - startTime;
+    if (switchTime > m_maxRolloverTimeMs) {
+        m_maxRolloverTimeMs = switchTime;
+    }
+
+    DS3231_Time endTime;
+    readDS3231Time(endTime);
+    if (!m_encoders[oldIndex].end(&endTime)) {
+        Utils_Logger::error("Loop recorder: failed to finalize %s", m_fileNames[oldIndex]);
+    }
+
+    Utils_Logger::info("Loop rollover: switch %u ms, finalize %u ms, dropped video=%u audio=%u",
+                      switchTime, millis() - startTime, m_droppedVideoFrames, m_droppedAudioBlocks);
+
+    enforceRetention();
+}
+
+bool MJPEGLoopRecorder::end(const DS3231_Time* fileTime) {
+    // 等待进行中的切换完成，保证两个编码器都处于确定状态
+    xSemaphoreTake(m_rolloverLock, portMAX_DELAY);
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int index = m_activeIndex;
+    m_activeIndex = -1;
+    m_rolloverPending = false;
+    xSemaphoreGive(m_mutex);
+
+    bool ok = false;
+    if (index >= 0) {
+        ok = m_encoders[index].end(fileTime);
+    }
+    xSemaphoreTake(m_rolloverSignal, 0);
+
+    xSemaphoreGive(m_rolloverLock);
+
+    Utils_Logger::info("Loop recording stopped: %u segments, %u deleted, dropped video=%u audio=%u, rollover failures=%u, max switch %u ms",
+                      m_segmentCount, m_deletedSegmentCount, m_droppedVideoFrames, m_droppedAudioBlocks,
+                      m_rolloverFailures, m_maxRolloverTimeMs);
+    return ok;
+}
+
+bool MJPEGLoopRecorder::hasOpenWriters() const {
+    return m_encoders[0].hasOpenWriters() || m_encoders[1].hasOpenWriters();
+}
+
+bool MJPEGLoopRecorder::retryCloseWriters() {
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        if (m_encoders[i].hasOpenWriters()) {
+            ok = m_encoders[i].retryCloseWriters() && ok;
+        }
+    }
+    return ok;
+}
+
+void MJPEGLoopRecorder::abortWriters() {
+    for (int i = 0; i < 2; i++) {
+        m_encoders[i].abortWriters();
+    }
+}
+
+// 保留策略：剩余空间低于阈值或分段数超过上限时，删除文件名最早（时间戳最小）的分段
+void MJPEGLoopRecorder::enforceRetention() {
+    const char* rootPath = sdCardManager.getRootPath();
+    size_t rootLength = strlen(rootPath);
+    size_t prefixLength = strlen(LOOP_FILE_PREFIX);
+
+    for (uint32_t pass = 0; pass < LOOP_RETENTION_MAX_DELETES; pass++) {
+        DIR dir;
+        FILINFO fno;
+        if (f_opendir(&dir, rootPath) != FR_OK) {
+            return;
+        }
+
+        char oldest[64] = {0};
+        uint32_t count = 0;
+        while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0) {
+            if (fno.fattrib & AM_DIR) {
+                continue;
+            }
+            const char* ext = strrchr(fno.fname, '.');
+            if (strncmp(fno.fname, LOOP_FILE_PREFIX, prefixLength) != 0 || !ext || strcasecmp(ext, ".avi") != 0) {
+                continue;
+            }
+            count++;
+
+            // 正在录制的分段不参与删除
+            bool inUse = false;
+            for (int i = 0; i < 2; i++) {
+                if (m_encoders[i].isRecording() && strlen(m_fileNames[i]) > rootLength &&
+                    strcmp(m_fileNames[i] + rootLength, fno.fname) == 0) {
+                    inUse = true;
+                }
+            }
+            if (!inUse && strlen(fno.fname) < sizeof(oldest) &&
+                (oldest[0] == 0 || strcmp(fno.fname, oldest) < 0)) {
+                strcpy(oldest, fno.fname);
+            }
+        }
+        f_closedir(&dir);
+
+        SDCardManager::StorageInfo info;
+        bool lowSpace = sdCardManager.getStorageInfo(&info) && info.freeBytes < m_config.minFreeBytes;
+        bool tooMany = m_config.maxSegments > 0 && count > m_config.maxSegments;
+        if ((!lowSpace && !tooMany) || oldest[0] == 0) {
+            if (lowSpace && oldest[0] == 0) {
+                Utils_Logger::error("Loop recorder: free space below threshold, no segment left to delete");
+            }
+            return;
+        }
+
+        char path[128];
+        snprintf(path, sizeof(path), "%s%s", rootPath, oldest);
+        if (f_unlink(path) != FR_OK) {
+            Utils_Logger::error("Loop recorder: failed to delete %s", path);
+            return;
+        }
+        m_deletedSegmentCount++;
+        Utils_Logger::info("Loop recorder: deleted oldest segment %s (%s)", oldest, lowSpace ? "low space" : "segment limit");
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * MJPEG_LoopRecorder.h - 循环分段录制（行车记录仪模式）头文件
+ * 连续录制按固定时长切分为多个AVI文件，剩余空间低于阈值时自动删除最早的分段
+ * 两个MJPEGEncoder交替使用：新分段开始接收帧之后，旧分段才在后台收尾，切换时不丢帧
+ */
+
+#ifndef MJPEG_LOOP_RECORDER_H
+#define MJPEG_LOOP_RECORDER_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include "MJPEG_Encoder.h"
+#include "DS3231_ClockModule.h"
+
+#define LOOP_FILE_PREFIX            "LOOP_"   // 循环录制分段文件名前缀，保留策略只删除此类文件
+#define LOOP_ROLLOVER_RETRY_MS      5000      // 新分段打开失败后，在当前分段继续录制并延后重试
+#define LOOP_RETENTION_MAX_DELETES  16        // 单次保留策略检查最多删除的分段数
+
+class MJPEGLoopRecorder {
+public:
+    typedef struct {
+        uint32_t segmentSeconds;   // 分段时长（秒），常用60/180/300
+        uint64_t minFreeBytes;     // 剩余空间低于该值时删除最早的分段
+        uint32_t maxSegments;      // 最多保留的分段数，0表示只按剩余空间限制
+    } Config;
+
+    MJPEGLoopRecorder();
+    ~MJPEGLoopRecorder();
+
+    void setConfig(const Config& config);
+    const Config& getConfig() const { return m_config; }
+
+    bool begin(uint32_t width, uint32_t height, uint32_t fps, AVIAudioCodec audioCodec = AVI_AUDIO_PCM);
+    bool addVideoFrame(const uint8_t* jpegData, uint32_t jpegSize, uint32_t timestamp, bool zeroCopy = false);
+    // 等待两个编码器上的零拷贝写入完成（分段切换后旧分段可能仍有未完成的直写）
+    bool waitZeroCopyWrites(uint32_t timeoutMs);
+    bool addAudioFrame(const uint8_t* audioData, uint32_t audioSize, uint32_t timestamp);
+    bool end(const DS3231_Time* fileTime = nullptr);
+    // 两个编码器中未排空写入器的重试关闭和终止路径（见MJPEGEncoder）
+    bool hasOpenWriters() const;
+    bool retryCloseWriters();
+    void abortWriters();
+
+    // 分段收尾任务接口：等待切换请求，打开新分段、切换后结束旧分段并执行保留策略
+    void service(uint32_t timeoutMs);
+
+    bool isActive() const { return m_activeIndex >= 0; }
+    const char* getCurrentFileName() const;
+
+    // 统计信息
+    uint32_t getSegmentCount() const { return m_segmentCount; }
+    uint32_t getDeletedSegmentCount() const { return m_deletedSegmentCount; }
+    uint32_t getDroppedVideoFrames() const { return m_droppedVideoFrames; }
+    uint32_t getDroppedAudioBlocks() const { return m_droppedAudioBlocks; }
+    uint32_t getRolloverFailureCount() const { return m_rolloverFailures; }
+    uint32_t getMaxRolloverTimeMs() const { return m_maxRolloverTimeMs; }
+
+private:
+    bool startSegment(int index);
+    void rollover();
+    void enforceRetention();
+
+    Config m_config;
+    MJPEGEncoder m_encoders[2];
+    char m_fileNames[2][128];
+    volatile int m_activeIndex;        // 当前接收帧的编码器，-1表示未录制
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_fps;
+    AVIAudioCodec m_audioCodec;
+    uint32_t m_nextRolloverTime;
+    volatile bool m_rolloverPending;
+
+    SemaphoreHandle_t m_mutex;          // 保护m_activeIndex切换与帧写入
+    SemaphoreHandle_t m_rolloverLock;   // 切换过程与end()互斥
+    SemaphoreHandle_t m_rolloverSignal; // 采集任务通知收尾任务切换分段
+
+    uint32_t m_segmentCount;
+    uint32_t m_deletedSegmentCount;
+    volatile uint32_t m_droppedVideoFrames;
+    volatile uint32_t m_droppedAudioBlocks;
+    uint32_t m_rolloverFailures;
+    uint32_t m_maxRolloverTimeMs;
+};
+
+#endif // MJPEG_LOOP_RECORDER_H
@@ -0,0 +1,255 @@
+/*
+ * MJPEG_PlaybackAudio.cpp - 回放音频输出实现
+ * 读取任务按音频位置表读入音频块（PCM或IMA-ADPCM），解码后写入I2S TX回放缓冲区
+ * I2S DMA已播放的采样数作为回放主时钟，视频帧按该时钟显示或丢弃以保持音画同步
+ */
+
+#include "MJPEG_PlaybackAudio.h"
+#include "MJPEG_ImaAdpcm.h"
+#include "Inmp441_MicrophoneManager.h"
+#include "Utils_Logger.h"
+
+MJPEGPlaybackAudio::MJPEGPlaybackAudio()
+    : m_decoder(nullptr)
+    , m_active(false)
+    , m_started(false)
+    , m_adpcm(false)
+    , m_blockAlign(0)
+    , m_sampleRate(0)
+    , m_startMs(0)
+    , m_startSample(0)
+    , m_nextChunk(0)
+    , m_skipSamples(0)
+    , m_endOfStream(false)
+    , m_chunkBuffer(nullptr)
+    , m_chunkBufferSize(0)
+    , m_pcm(nullptr)
+    , m_pcmCapacity(0)
+    , m_pcmCount(0)
+    , m_pcmPos(0)
+    , m_bufferSamples(0)
+    , m_prerollSamples(0)
+    , m_minBufferedMs(0)
+    , m_readChunks(0)
+    , m_readErrors(0)
+    , m_maxReadTimeUs(0)
+{
+    m_lock = xSemaphoreCreateMutex();
+}
+
+MJPEGPlaybackAudio::~MJPEGPlaybackAudio() {
+    end();
+    if (m_lock) {
+        vSemaphoreDelete(m_lock);
+        m_lock = nullptr;
+    }
+}
+
+// size字节的音频块解码后的样本数
+uint32_t MJPEGPlaybackAudio::chunkSamples(uint32_t size) const {
+    return m_adpcm ? IMAADPCMDecoder::samplesInData(size, m_blockAlign) : size / sizeof(int16_t);
+}
+
+bool MJPEGPlaybackAudio::begin(MJPEGDecoder* decoder, uint32_t startMs, uint32_t bufferMs) {
+    end();
+    if (!decoder || !decoder->isOpen() || !decoder->hasAudio() || !m_lock) {
+        return false;
+    }
+
+    // 只支持录制时写出的单声道16位PCM和IMA-ADPCM
+    uint16_t formatTag = decoder->getAudioFormatTag();
+    if (decoder->getAudioChannels() != 1 ||
+        !((formatTag == 0x0001 && decoder->getAudioBlockAlign() == 2) || formatTag == IMA_ADPCM_FORMAT_TAG)) {
+        Utils_Logger::info("Playback audio: unsupported format 0x%04X, %u ch", formatTag, decoder->getAudioChannels());
+        return false;
+    }
+
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_decoder = decoder;
+    m_adpcm = (formatTag == IMA_ADPCM_FORMAT_TAG);
+    m_blockAlign = decoder->getAudioBlockAlign();
+    m_sampleRate = decoder->getAudioSampleRate();
+
+    // 按位置表定位起始音频块，块内多余的样本在首次解码后跳过（不读取文件）
+    uint32_t chunkCount = decoder->getAudioChunkCount();
+    uint32_t maxChunkSize = 0;
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        uint32_t size = decoder->getAudioChunkSize(i);
+        if (size > maxChunkSize) {
+            maxChunkSize = size;
+        }
+    }
+    uint64_t target = (uint64_t)startMs * m_sampleRate / 1000;
+    uint64_t position = 0;
+    m_nextChunk = 0;
+    while (m_nextChunk < chunkCount) {
+        uint32_t samples = chunkSamples(decoder->getAudioChunkSize(m_nextChunk));
+        if (position + samples > target) {
+            break;
+        }
+        position += samples;
+        m_nextChunk++;
+    }
+
+    m_chunkBufferSize = maxChunkSize;
+    m_pcmCapacity = chunkSamples(maxChunkSize);
+    m_chunkBuffer = (uint8_t*)malloc(m_chunkBufferSize);
+    m_pcm = (int16_t*)malloc(m_pcmCapacity * sizeof(int16_t));
+    m_bufferSamples = (uint32_t)((uint64_t)bufferMs * m_sampleRate / 1000);
+    if (!m_chunkBuffer || !m_pcm || m_bufferSamples == 0 ||
+        !g_microphoneManager.preparePlayback(m_bufferSamples, m_sampleRate)) {
+        Utils_Logger::error("Playback audio: setup failed (%u Hz, buffer %u ms)", m_sampleRate, bufferMs);
+        free(m_chunkBuffer);
+        free(m_pcm);
+        m_chunkBuffer = nullptr;
+        m_pcm = nullptr;
+        m_decoder = nullptr;
+        xSemaphoreGive(m_lock);
+        return false;
+    }
+
+    m_startMs = startMs;
+    m_startSample = target;
+    m_pcmCount = 0;
+    m_pcmPos = 0;
+    m_skipSamples = (uint32_t)(target - position);
+    m_endOfStream = false;
+    m_started = false;
+    m_prerollSamples = m_bufferSamples / 2;
+    m_minBufferedMs = bufferMs;
+    m_readChunks = 0;
+    m_readErrors = 0;
+    m_maxReadTimeUs = 0;
+    m_active = true;
+    xSemaphoreGive(m_lock);
+
+    Utils_Logger::info("Playback audio: %s %u Hz, buffer %u ms, start %u ms (chunk %u)",
+                      m_adpcm ? "IMA-ADPCM" : "PCM", m_sampleRate, bufferMs, startMs, m_nextChunk);
+    return true;
+}
+
+void MJPEGPlaybackAudio::end() {
+    if (!m_lock) {
+        return;
+    }
+
+    // 等待读取任务完成当前音频块，之后不再访问解码器
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    if (m_active) {
+        g_microphoneManager.stopPlayback();
+        m_active = false;
+    }
+    m_started = false;
+    m_decoder = nullptr;
+    if (m_chunkBuffer) {
+        free(m_chunkBuffer);
+        m_chunkBuffer = nullptr;
+    }
+    if (m_pcm) {
+        free(m_pcm);
+        m_pcm = nullptr;
+    }
+    m_pcmCount = 0;
+    m_pcmPos = 0;
+    xSemaphoreGive(m_lock);
+}
+
+// 读入并解码下一个音频块；读取失败时以等长静音代替，保持时间轴不变
+bool MJPEGPlaybackAudio::decodeNextChunk() {
+    if (m_nextChunk >= m_decoder->getAudioChunkCount()) {
+        m_endOfStream = true;
+        g_microphoneManager.setPlaybackEnded(true);
+        return false;
+    }
+
+    uint32_t index = m_nextChunk++;
+    uint32_t size = 0;
+    uint32_t startTime = micros();
+    bool ok = m_decoder->readAudioChunk(index, m_chunkBuffer, m_chunkBufferSize, &size);
+    uint32_t elapsed = micros() - startTime;
+    if (elapsed > m_maxReadTimeUs) {
+        m_maxReadTimeUs = elapsed;
+    }
+    m_readChunks++;
+
+    if (!ok) {
+        m_readErrors++;
+        m_pcmCount = chunkSamples(m_decoder->getAudioChunkSize(index));
+        memset(m_pcm, 0, m_pcmCount * sizeof(int16_t));
+    } else if (m_adpcm) {
+        m_pcmCount = IMAADPCMDecoder::decode(m_chunkBuffer, size, m_blockAlign, m_pcm, m_pcmCapacity);
+    } else {
+        m_pcmCount = size / sizeof(int16_t);
+        memcpy(m_pcm, m_chunkBuffer, m_pcmCount * sizeof(int16_t));
+    }
+
+    m_pcmPos = (m_skipSamples < m_pcmCount) ? m_skipSamples : m_pcmCount;
+    m_skipSamples = 0;
+    return true;
+}
+
+// 把已解码的样本写入回放缓冲区，直到缓冲区写满或音频结束（调用者持有m_lock）
+bool MJPEGPlaybackAudio::fill() {
+    while (true) {
+        if (m_pcmPos >= m_pcmCount) {
+            if (m_endOfStream || !decodeNextChunk()) {
+                return false;
+            }
+            continue;
+        }
+        m_pcmPos += g_microphoneManager.writePlaybackSamples(m_pcm + m_pcmPos, m_pcmCount - m_pcmPos);
+        if (m_pcmPos < m_pcmCount) {
+            return true;
+        }
+    }
+}
+
+void MJPEGPlaybackAudio::service() {
+    if (!m_active || xSemaphoreTake(m_lock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    if (!m_active) {
+        xSemaphoreGive(m_lock);
+        return;
+    }
+
+    // 补充前的缓冲量即两次补充之间的最低水位
+    uint32_t buffered = g_microphoneManager.getPlaybackBuffered();
+    if (m_started) {
+        uint32_t bufferedMs = (uint32_t)((uint64_t)buffered * 1000 / m_sampleRate);
+        if (bufferedMs < m_minBufferedMs) {
+            m_minBufferedMs = bufferedMs;
+        }
+    }
+
+    fill();
+
+    // 预填达到一半缓冲区（或音频已全部读入）后才开始输出，避免开头立即欠载
+    if (!m_started && (g_microphoneManager.getPlaybackBuffered() >= m_prerollSamples || m_endOfStream)) {
+        m_started = g_microphoneManager.startPlayback();
+    }
+    xSemaphoreGive(m_lock);
+}
+
+uint32_t MJPEGPlaybackAudio::getClockMs() const {
+    if (!m_active || !m_started) {
+        return m_startMs;
+    }
+    uint64_t position = m_startSample + g_microphoneManager.getPlaybackPosition();
+    return (uint32_t)(position * 1000 / m_sampleRate);
+}
+
+bool MJPEGPlaybackAudio::isFinished() const {
+    return m_active && m_endOfStream && g_microphoneManager.getPlaybackBuffered() == 0;
+}
+
+uint32_t MJPEGPlaybackAudio::getUnderruns() const {
+    return m_active ? g_microphoneManager.getPlaybackUnderruns() : 0;
+}
+
+uint32_t MJPEGPlaybackAudio::getUnderrunMs() const {
+    if (!m_active || m_sampleRate == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)g_microphoneManager.getPlaybackUnderrunSamples() * 1000 / m_sampleRate);
+}
@@ -0,0 +1,77 @@
+/*
+ * MJPEG_PlaybackAudio.h - 回放音频输出头文件
+ * 读取任务按音频位置表读入音频块（PCM或IMA-ADPCM），解码后写入I2S TX回放缓冲区
+ * I2S DMA已播放的采样数作为回放主时钟，视频帧按该时钟显示或丢弃以保持音画同步
+ */
+
+#ifndef MJPEG_PLAYBACK_AUDIO_H
+#define MJPEG_PLAYBACK_AUDIO_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include "MJPEG_Encoder.h"
+
+class MJPEGPlaybackAudio {
+public:
+    MJPEGPlaybackAudio();
+    ~MJPEGPlaybackAudio();
+
+    // 从startMs处开始输出音频：按位置表定位音频块（不读文件），由service()预填半个缓冲区后启动I2S TX
+    // 文件无音频或格式/采样率不支持时返回false，调用者按墙上时钟播放视频
+    bool begin(MJPEGDecoder* decoder, uint32_t startMs, uint32_t bufferMs);
+    // 停止输出并释放缓冲区（须在解码器close()之前调用）
+    void end();
+    bool isActive() const { return m_active; }
+
+    // 读取任务接口：回放缓冲区有空间时读入并解码后续音频块
+    void service();
+
+    // 音频主时钟（文件时间轴上的毫秒数），开始输出前停在起始位置，欠载时停止前进
+    uint32_t getClockMs() const;
+    // 音频已全部播放完（视频比音频长时，剩余部分改按墙上时钟播放）
+    bool isFinished() const;
+
+    // 统计信息
+    uint32_t getUnderruns() const;
+    uint32_t getUnderrunMs() const;
+    uint32_t getMinBufferedMs() const { return m_minBufferedMs; }
+    uint32_t getReadChunks() const { return m_readChunks; }
+    uint32_t getReadErrors() const { return m_readErrors; }
+    uint32_t getMaxReadTimeUs() const { return m_maxReadTimeUs; }
+
+private:
+    uint32_t chunkSamples(uint32_t size) const;
+    bool decodeNextChunk();
+    bool fill();
+
+    MJPEGDecoder* m_decoder;
+    volatile bool m_active;
+    bool m_started;              // I2S TX已开始输出
+    bool m_adpcm;
+    uint16_t m_blockAlign;
+    uint32_t m_sampleRate;
+    uint32_t m_startMs;
+    uint64_t m_startSample;      // 起始位置在音频时间轴上的采样序号
+    uint32_t m_nextChunk;
+    uint32_t m_skipSamples;      // 起始块中位于起始位置之前的样本数
+    bool m_endOfStream;
+
+    uint8_t* m_chunkBuffer;      // 原始音频块（按最大块分配）
+    uint32_t m_chunkBufferSize;
+    int16_t* m_pcm;              // 已解码、尚未写入回放缓冲区的样本
+    uint32_t m_pcmCapacity;
+    uint32_t m_pcmCount;
+    uint32_t m_pcmPos;
+
+    SemaphoreHandle_t m_lock;    // service()与begin()/end()互斥
+
+    uint32_t m_bufferSamples;
+    uint32_t m_prerollSamples;
+    uint32_t m_minBufferedMs;
+    uint32_t m_readChunks;
+    uint32_t m_readErrors;
+    uint32_t m_maxReadTimeUs;
+};
+
+#endif // MJPEG_PLAYBACK_AUDIO_H
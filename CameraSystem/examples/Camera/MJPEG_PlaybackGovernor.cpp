@@ -0,0 +1,166 @@
+/*
+ * MJPEG_PlaybackGovernor.cpp - 回放实时调度器实现
+ * 统计读取/解码/传输各阶段耗时，已落后于播放时钟的帧不再解码，保证回放按实时速度进行
+ * 持续过载时把解码比例从1/4降到1/8（2倍放大显示），负载恢复后再切回
+ */
+
+#include "MJPEG_PlaybackGovernor.h"
+#include "JPEGDEC.h"
+#include "Utils_Logger.h"
+
+MJPEGPlaybackGovernor::MJPEGPlaybackGovernor() {
+    reset(67, false);
+}
+
+void MJPEGPlaybackGovernor::reset(uint32_t frameIntervalMs, bool scaleFallback) {
+    m_frameIntervalMs = (frameIntervalMs > 0) ? frameIntervalMs : 67;
+    m_scaleFallback = scaleFallback;
+    m_scale = JPEG_SCALE_QUARTER;
+
+    memset(m_histogram, 0, sizeof(m_histogram));
+    memset(m_stageCount, 0, sizeof(m_stageCount));
+    memset(m_stageMaxUs, 0, sizeof(m_stageMaxUs));
+
+    m_presentedFrames = 0;
+    m_droppedFrames = 0;
+    m_consecutiveDrops = 0;
+    m_startTime = millis();
+    m_pausedTime = 0;
+    m_pauseStart = 0;
+    m_paused = false;
+
+    m_windowStart = m_startTime;
+    m_windowPresented = 0;
+    m_windowDropped = 0;
+    m_windowWorkUs = 0;
+    m_overloadWindows = 0;
+    m_idleWindows = 0;
+    m_recoverWindows = PLAYBACK_GOVERNOR_RECOVER_WINDOWS;
+    m_lastRecoverTime = 0;
+    m_scaleFallbacks = 0;
+}
+
+void MJPEGPlaybackGovernor::recordStage(Stage stage, uint32_t elapsedUs) {
+    if (stage >= STAGE_COUNT) {
+        return;
+    }
+    uint32_t bucket = elapsedUs / 1000;
+    if (bucket >= PLAYBACK_GOVERNOR_HISTOGRAM_MS) {
+        bucket = PLAYBACK_GOVERNOR_HISTOGRAM_MS - 1;
+    }
+    m_histogram[stage][bucket]++;
+    m_stageCount[stage]++;
+    if (elapsedUs > m_stageMaxUs[stage]) {
+        m_stageMaxUs[stage] = elapsedUs;
+    }
+    if (stage != STAGE_READ) {
+        m_windowWorkUs += elapsedUs;
+    }
+}
+
+bool MJPEGPlaybackGovernor::shouldDrop(uint32_t lateMs) {
+    return lateMs > m_frameIntervalMs && m_consecutiveDrops < PLAYBACK_GOVERNOR_MAX_DROPS;
+}
+
+void MJPEGPlaybackGovernor::onFramePresented() {
+    m_presentedFrames++;
+    m_windowPresented++;
+    m_consecutiveDrops = 0;
+    evaluateWindow(millis());
+}
+
+void MJPEGPlaybackGovernor::onFrameDropped() {
+    m_droppedFrames++;
+    m_windowDropped++;
+    m_consecutiveDrops++;
+    evaluateWindow(millis());
+}
+
+// 每个评估窗口结束时判断负载：丢帧超过1/4或平均解码+传输耗时超过显示间隔为过载
+// 降级后窗口内无丢帧且平均耗时低于显示间隔的1/3为空闲（1/4比例的解码量约为1/8的3~4倍）
+void MJPEGPlaybackGovernor::evaluateWindow(uint32_t now) {
+    if (now - m_windowStart < PLAYBACK_GOVERNOR_WINDOW_MS) {
+        return;
+    }
+
+    uint32_t frames = m_windowPresented + m_windowDropped;
+    uint32_t avgWorkUs = (m_windowPresented > 0) ? m_windowWorkUs / m_windowPresented : 0;
+    bool overloaded = (m_windowDropped * 4 > frames) || avgWorkUs > m_frameIntervalMs * 1000;
+    bool idle = (m_windowDropped == 0) && avgWorkUs * 3 < m_frameIntervalMs * 1000;
+
+    if (m_scaleFallback && m_scale == JPEG_SCALE_QUARTER) {
+        m_overloadWindows = overloaded ? m_overloadWindows + 1 : 0;
+        if (m_overloadWindows >= PLAYBACK_GOVERNOR_OVERLOAD_WINDOWS) {
+            // 恢复后很快又过载时加倍下次所需的空闲窗口数，避免来回切换
+            if (m_scaleFallbacks > 0 && now - m_lastRecoverTime < PLAYBACK_GOVERNOR_WINDOW_MS * 10 &&
+                m_recoverWindows < PLAYBACK_GOVERNOR_RECOVER_WINDOWS * 8) {
+                m_recoverWindows *= 2;
+            }
+            m_scale = JPEG_SCALE_EIGHTH;
+            m_scaleFallbacks++;
+            m_overloadWindows = 0;
+            m_idleWindows = 0;
+            Utils_Logger::info("Playback governor: overloaded (%u/%u dropped, %u us/frame), decoding at 1/8",
+                              m_windowDropped, frames, avgWorkUs);
+        }
+    } else if (m_scaleFallback) {
+        m_idleWindows = idle ? m_idleWindows + 1 : 0;
+        if (m_idleWindows >= m_recoverWindows) {
+            m_scale = JPEG_SCALE_QUARTER;
+            m_idleWindows = 0;
+            m_lastRecoverTime = now;
+            Utils_Logger::info("Playback governor: load %u us/frame, back to 1/4", avgWorkUs);
+        }
+    }
+
+    m_windowStart = now;
+    m_windowPresented = 0;
+    m_windowDropped = 0;
+    m_windowWorkUs = 0;
+}
+
+void MJPEGPlaybackGovernor::pause() {
+    if (!m_paused) {
+        m_paused = true;
+        m_pauseStart = millis();
+    }
+}
+
+void MJPEGPlaybackGovernor::resume() {
+    if (m_paused) {
+        uint32_t now = millis();
+        m_pausedTime += now - m_pauseStart;
+        m_paused = false;
+        // 暂停前后的帧不放在同一个评估窗口
+        m_windowStart = now;
+        m_windowPresented = 0;
+        m_windowDropped = 0;
+        m_windowWorkUs = 0;
+        m_consecutiveDrops = 0;
+    }
+}
+
+uint32_t MJPEGPlaybackGovernor::getAchievedFpsX10() const {
+    uint32_t end = m_paused ? m_pauseStart : millis();
+    uint32_t elapsed = end - m_startTime - m_pausedTime;
+    if (elapsed == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)m_presentedFrames * 10000 / elapsed);
+}
+
+uint32_t MJPEGPlaybackGovernor::getStagePercentileMs(Stage stage, uint32_t percent) const {
+    if (stage >= STAGE_COUNT || m_stageCount[stage] == 0) {
+        return 0;
+    }
+    // 取累计计数首次达到目标的格，返回该格上界
+    uint32_t target = (uint32_t)(((uint64_t)m_stageCount[stage] * percent + 99) / 100);
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < PLAYBACK_GOVERNOR_HISTOGRAM_MS; i++) {
+        sum += m_histogram[stage][i];
+        if (sum >= target) {
+            return i + 1;
+        }
+    }
+    return PLAYBACK_GOVERNOR_HISTOGRAM_MS;
+}
@@ -0,0 +1,87 @@
+/*
+ * MJPEG_PlaybackGovernor.h - 回放实时调度器头文件
+ * 统计读取/解码/传输各阶段耗时，已落后于播放时钟的帧不再解码，保证回放按实时速度进行
+ * 持续过载时把解码比例从1/4降到1/8（2倍放大显示），负载恢复后再切回
+ */
+
+#ifndef MJPEG_PLAYBACK_GOVERNOR_H
+#define MJPEG_PLAYBACK_GOVERNOR_H
+
+#include <Arduino.h>
+
+#define PLAYBACK_GOVERNOR_HISTOGRAM_MS     128  // 阶段耗时直方图范围（1ms一格，超出计入最后一格）
+#define PLAYBACK_GOVERNOR_MAX_DROPS        4    // 连续丢帧上限，解码持续跟不上时仍保证画面更新
+#define PLAYBACK_GOVERNOR_WINDOW_MS        1000 // 负载评估窗口
+#define PLAYBACK_GOVERNOR_OVERLOAD_WINDOWS 2    // 连续过载窗口数达到该值时降低解码比例
+#define PLAYBACK_GOVERNOR_RECOVER_WINDOWS  3    // 降级后连续空闲窗口数达到该值时恢复（再次过载时加倍）
+
+class MJPEGPlaybackGovernor {
+public:
+    typedef enum {
+        STAGE_READ = 0,   // 取帧（同步读取时为读卡耗时，预取时为等待就绪帧的耗时）
+        STAGE_DECODE = 1, // jpeg.decode（含写入回放帧缓冲）
+        STAGE_DRAW = 2,   // drawBitmap传输到屏幕
+        STAGE_COUNT = 3
+    } Stage;
+
+    MJPEGPlaybackGovernor();
+
+    // 开始回放时调用：frameIntervalMs为一帧的显示间隔，scaleFallback为是否允许降低解码比例
+    void reset(uint32_t frameIntervalMs, bool scaleFallback);
+
+    void recordStage(Stage stage, uint32_t elapsedUs);
+
+    // 帧落后于播放时钟lateMs毫秒时是否丢弃（超过一个显示间隔且未达连续丢帧上限）
+    bool shouldDrop(uint32_t lateMs);
+    void onFramePresented();
+    void onFrameDropped();
+
+    // 当前应使用的解码比例（JPEG_SCALE_QUARTER或JPEG_SCALE_EIGHTH）
+    int getScale() const { return m_scale; }
+
+    // 统计信息
+    uint32_t getPresentedFrames() const { return m_presentedFrames; }
+    uint32_t getDroppedFrames() const { return m_droppedFrames; }
+    uint32_t getScaleFallbacks() const { return m_scaleFallbacks; }
+    // 实际显示帧率（x10，包含暂停之外的全部播放时间）
+    uint32_t getAchievedFpsX10() const;
+    // 阶段耗时百分位（ms）和最大值（us）
+    uint32_t getStagePercentileMs(Stage stage, uint32_t percent) const;
+    uint32_t getStageMaxUs(Stage stage) const { return m_stageMaxUs[stage]; }
+
+    // 暂停期间不计入帧率统计
+    void pause();
+    void resume();
+
+private:
+    void evaluateWindow(uint32_t now);
+
+    uint32_t m_frameIntervalMs;
+    bool m_scaleFallback;
+    int m_scale;
+
+    uint32_t m_histogram[STAGE_COUNT][PLAYBACK_GOVERNOR_HISTOGRAM_MS];
+    uint32_t m_stageCount[STAGE_COUNT];
+    uint32_t m_stageMaxUs[STAGE_COUNT];
+
+    uint32_t m_presentedFrames;
+    uint32_t m_droppedFrames;
+    uint32_t m_consecutiveDrops;
+    uint32_t m_startTime;
+    uint32_t m_pausedTime;
+    uint32_t m_pauseStart;
+    bool m_paused;
+
+    // 负载评估窗口
+    uint32_t m_windowStart;
+    uint32_t m_windowPresented;
+    uint32_t m_windowDropped;
+    uint32_t m_windowWorkUs;       // 窗口内解码+传输总耗时
+    uint32_t m_overloadWindows;
+    uint32_t m_idleWindows;
+    uint32_t m_recoverWindows;     // 当前所需的空闲窗口数
+    uint32_t m_lastRecoverTime;
+    uint32_t m_scaleFallbacks;
+};
+
+#endif // MJPEG_PLAYBACK_GOVERNOR_H
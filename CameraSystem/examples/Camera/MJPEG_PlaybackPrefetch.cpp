@@ -0,0 +1,279 @@
+/*
+ * MJPEG_PlaybackPrefetch.cpp - 回放预取实现
+ * 读取任务按索引提前把后续帧读入固定的帧缓冲池，播放循环只负责解码和显示
+ * SD卡读取延迟尖峰由池中已缓存的帧吸收，不再直接造成卡顿
+ */
+
+#include "MJPEG_PlaybackPrefetch.h"
+#include "Utils_Logger.h"
+
+MJPEGPlaybackPrefetcher::MJPEGPlaybackPrefetcher()
+    : m_decoder(nullptr)
+    , m_poolFrames(0)
+    , m_slotSize(0)
+    , m_active(false)
+    , m_readerDone(false)
+    , m_nextFrame(0)
+    , m_stride(1)
+    , m_framesRemaining(0)
+    , m_frameLimited(false)
+    , m_waitingFirst(true)
+    , m_lastOffset(0)
+    , m_deliveredFrames(0)
+    , m_minBuffered(0)
+    , m_bufferedSum(0)
+    , m_stallCount(0)
+    , m_stallTimeMs(0)
+    , m_readFrames(0)
+    , m_repeatFrames(0)
+    , m_readErrors(0)
+    , m_maxReadTimeUs(0)
+{
+    memset(m_slots, 0, sizeof(m_slots));
+    m_freeQueue = xQueueCreate(PLAYBACK_PREFETCH_MAX_FRAMES, sizeof(uint8_t));
+    m_readyQueue = xQueueCreate(PLAYBACK_PREFETCH_MAX_FRAMES, sizeof(uint8_t));
+    m_readLock = xSemaphoreCreateMutex();
+}
+
+MJPEGPlaybackPrefetcher::~MJPEGPlaybackPrefetcher() {
+    end();
+    if (m_freeQueue) {
+        vQueueDelete(m_freeQueue);
+        m_freeQueue = nullptr;
+    }
+    if (m_readyQueue) {
+        vQueueDelete(m_readyQueue);
+        m_readyQueue = nullptr;
+    }
+    if (m_readLock) {
+        vSemaphoreDelete(m_readLock);
+        m_readLock = nullptr;
+    }
+}
+
+bool MJPEGPlaybackPrefetcher::begin(MJPEGDecoder* decoder, uint32_t startFrame, uint32_t poolFrames) {
+    end();
+    if (!decoder || !decoder->isOpen() || !m_freeQueue || !m_readyQueue || !m_readLock) {
+        return false;
+    }
+    if (poolFrames > PLAYBACK_PREFETCH_MAX_FRAMES) {
+        poolFrames = PLAYBACK_PREFETCH_MAX_FRAMES;
+    }
+
+    // 每个帧缓冲按文件中最大帧分配（32字节对齐），内存不足时减少帧数
+    m_slotSize = (decoder->getMaxFrameSize() + 31) & ~31u;
+    m_poolFrames = 0;
+    for (uint32_t i = 0; i < poolFrames; i++) {
+        m_slots[i].data = (uint8_t*)malloc(m_slotSize);
+        if (!m_slots[i].data) {
+            break;
+        }
+        m_poolFrames++;
+    }
+    if (m_poolFrames < PLAYBACK_PREFETCH_MIN_FRAMES) {
+        Utils_Logger::error("Playback prefetch: failed to allocate %u x %u bytes", poolFrames, m_slotSize);
+        for (uint32_t i = 0; i < m_poolFrames; i++) {
+            free(m_slots[i].data);
+            m_slots[i].data = nullptr;
+        }
+        m_poolFrames = 0;
+        return false;
+    }
+
+    xQueueReset(m_freeQueue);
+    xQueueReset(m_readyQueue);
+    for (uint8_t i = 0; i < m_poolFrames; i++) {
+        xQueueSend(m_freeQueue, &i, 0);
+    }
+
+    m_decoder = decoder;
+    m_nextFrame = startFrame;
+    m_stride = 1;
+    m_framesRemaining = 0;
+    m_frameLimited = false;
+    m_waitingFirst = true;
+    m_lastOffset = 0;
+    m_readerDone = false;
+    m_deliveredFrames = 0;
+    m_minBuffered = m_poolFrames;
+    m_bufferedSum = 0;
+    m_stallCount = 0;
+    m_stallTimeMs = 0;
+    m_readFrames = 0;
+    m_repeatFrames = 0;
+    m_readErrors = 0;
+    m_maxReadTimeUs = 0;
+    m_active = true;
+
+    Utils_Logger::info("Playback prefetch: %u frames x %u KB", m_poolFrames, m_slotSize / 1024);
+    return true;
+}
+
+void MJPEGPlaybackPrefetcher::end() {
+    if (!m_readLock) {
+        return;
+    }
+
+    // 等待读取任务完成当前帧，之后不再访问解码器
+    xSemaphoreTake(m_readLock, portMAX_DELAY);
+    m_active = false;
+    m_decoder = nullptr;
+    xQueueReset(m_freeQueue);
+    xQueueReset(m_readyQueue);
+    for (uint32_t i = 0; i < PLAYBACK_PREFETCH_MAX_FRAMES; i++) {
+        if (m_slots[i].data) {
+            free(m_slots[i].data);
+            m_slots[i].data = nullptr;
+        }
+    }
+    m_poolFrames = 0;
+    xSemaphoreGive(m_readLock);
+}
+
+// 已就绪的帧放回空闲队列（调用者持有m_readLock）
+void MJPEGPlaybackPrefetcher::flushReadyQueue() {
+    uint8_t slot;
+    while (xQueueReceive(m_readyQueue, &slot, 0) == pdTRUE) {
+        xQueueSend(m_freeQueue, &slot, 0);
+    }
+}
+
+void MJPEGPlaybackPrefetcher::restart(uint32_t frameIndex, int32_t stride, uint32_t frameLimit) {
+    if (!m_active) {
+        return;
+    }
+    xSemaphoreTake(m_readLock, portMAX_DELAY);
+    flushReadyQueue();
+    m_nextFrame = frameIndex;
+    m_stride = (stride != 0) ? stride : 1;
+    m_framesRemaining = frameLimit;
+    m_frameLimited = (frameLimit > 0);
+    m_waitingFirst = true;
+    m_lastOffset = 0;
+    m_readerDone = false;
+    xSemaphoreGive(m_readLock);
+}
+
+void MJPEGPlaybackPrefetcher::service(uint32_t timeoutMs) {
+    if (!m_active) {
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        return;
+    }
+
+    // 没有空闲帧缓冲说明池已满（暂停或显示跟不上），等待播放侧归还
+    uint8_t slot;
+    if (xQueueReceive(m_freeQueue, &slot, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return;
+    }
+
+    xSemaphoreTake(m_readLock, portMAX_DELAY);
+    bool limitReached = m_frameLimited && m_framesRemaining == 0;
+    if (!m_active || limitReached || m_nextFrame >= m_decoder->getFrameCount()) {
+        if (m_active) {
+            xQueueSend(m_freeQueue, &slot, 0);
+            m_readerDone = !limitReached;
+        }
+        xSemaphoreGive(m_readLock);
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        return;
+    }
+
+    Slot& buffer = m_slots[slot];
+    uint64_t offset = 0;
+    bool ok = m_decoder->getFrameInfo(m_nextFrame, &offset, &buffer.size);
+    buffer.frameIndex = m_nextFrame;
+    buffer.repeat = ok && (offset == m_lastOffset);
+    buffer.readTimeUs = 0;
+
+    if (ok && buffer.repeat) {
+        m_repeatFrames++;
+    } else if (ok) {
+        uint32_t startTime = micros();
+        ok = m_decoder->readFrameAt(m_nextFrame, buffer.data, m_slotSize, &buffer.size);
+        uint32_t elapsed = micros() - startTime;
+        buffer.readTimeUs = elapsed;
+        if (elapsed > m_maxReadTimeUs) {
+            m_maxReadTimeUs = elapsed;
+        }
+        m_lastOffset = ok ? offset : 0;
+        m_readFrames++;
+    }
+    // 快退越过第一帧时置为越界，下次进入时标记读取结束
+    int64_t next = (int64_t)m_nextFrame + m_stride;
+    m_nextFrame = (next >= 0) ? (uint32_t)next : UINT32_MAX;
+    if (m_frameLimited) {
+        m_framesRemaining--;
+    }
+
+    if (ok) {
+        xQueueSend(m_readyQueue, &slot, 0);
+    } else {
+        // 读取失败的帧跳过，播放侧显示下一帧
+        m_readErrors++;
+        xQueueSend(m_freeQueue, &slot, 0);
+    }
+    xSemaphoreGive(m_readLock);
+}
+
+bool MJPEGPlaybackPrefetcher::acquireFrame(Frame* frame, uint32_t timeoutMs) {
+    if (!m_active) {
+        return false;
+    }
+
+    uint8_t slot;
+    if (xQueueReceive(m_readyQueue, &slot, 0) != pdTRUE) {
+        if (isFinished() || timeoutMs == 0) {
+            return false;
+        }
+        // 就绪队列为空：读取跟不上播放，计一次停顿（开始和跳转后的首帧等待不计）
+        uint32_t startTime = millis();
+        bool received = (xQueueReceive(m_readyQueue, &slot, pdMS_TO_TICKS(timeoutMs)) == pdTRUE);
+        if (!m_waitingFirst) {
+            m_stallCount++;
+            m_stallTimeMs += millis() - startTime;
+        }
+        if (!received) {
+            return false;
+        }
+    }
+
+    uint32_t buffered = uxQueueMessagesWaiting(m_readyQueue);
+    if (!m_waitingFirst && !m_frameLimited) {
+        if (buffered < m_minBuffered) {
+            m_minBuffered = buffered;
+        }
+        m_bufferedSum += buffered;
+        m_deliveredFrames++;
+    }
+    m_waitingFirst = false;
+
+    const Slot& buffer = m_slots[slot];
+    frame->data = buffer.data;
+    frame->size = buffer.size;
+    frame->frameIndex = buffer.frameIndex;
+    frame->readTimeUs = buffer.readTimeUs;
+    frame->repeat = buffer.repeat;
+    frame->slot = slot;
+    return true;
+}
+
+void MJPEGPlaybackPrefetcher::releaseFrame(const Frame& frame) {
+    if (m_active && frame.slot < m_poolFrames) {
+        xQueueSend(m_freeQueue, &frame.slot, 0);
+    }
+}
+
+bool MJPEGPlaybackPrefetcher::isFinished() const {
+    return m_readerDone && uxQueueMessagesWaiting(m_readyQueue) == 0;
+}
+
+uint32_t MJPEGPlaybackPrefetcher::getBufferedFrames() const {
+    return m_active ? uxQueueMessagesWaiting(m_readyQueue) : 0;
+}
+
+uint32_t MJPEGPlaybackPrefetcher::getAverageBufferedPercent() const {
+    if (m_deliveredFrames == 0 || m_poolFrames == 0) {
+        return 0;
+    }
+    return (uint32_t)(m_bufferedSum * 100 / ((uint64_t)m_deliveredFrames * m_poolFrames));
+}
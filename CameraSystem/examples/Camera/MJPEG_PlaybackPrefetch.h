@@ -0,0 +1,106 @@
+/*
+ * MJPEG_PlaybackPrefetch.h - 回放预取头文件
+ * 读取任务按索引提前把后续帧读入固定的帧缓冲池，播放循环只负责解码和显示
+ * SD卡读取延迟尖峰由池中已缓存的帧吸收，不再直接造成卡顿
+ */
+
+#ifndef MJPEG_PLAYBACK_PREFETCH_H
+#define MJPEG_PLAYBACK_PREFETCH_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include "MJPEG_Encoder.h"
+
+#define PLAYBACK_PREFETCH_MAX_FRAMES  8    // 帧缓冲池上限
+#define PLAYBACK_PREFETCH_MIN_FRAMES  2    // 内存不足时至少需要的帧缓冲数
+
+class MJPEGPlaybackPrefetcher {
+public:
+    // 取出的帧；repeat为true表示与上一帧是同一数据块（录制时补的重复帧），无需重新解码，data无效
+    // readTimeUs为读取任务读入该帧的耗时（重复帧为0）
+    typedef struct {
+        uint8_t* data;
+        uint32_t size;
+        uint32_t frameIndex;
+        uint32_t readTimeUs;
+        bool repeat;
+        uint8_t slot;
+    } Frame;
+
+    MJPEGPlaybackPrefetcher();
+    ~MJPEGPlaybackPrefetcher();
+
+    // 按解码器的最大帧大小分配poolFrames个帧缓冲，从startFrame开始预取
+    bool begin(MJPEGDecoder* decoder, uint32_t startFrame, uint32_t poolFrames);
+    // 等待进行中的读取完成后释放帧缓冲（须在解码器close()之前调用）
+    void end();
+    bool isActive() const { return m_active; }
+
+    // 丢弃已预取的帧，从frameIndex重新读取；stride为每次前进的帧数（快进>1，快退<0）
+    // frameLimit非0时只读取该数量的帧后暂停（拖动定位只需要一帧）
+    void restart(uint32_t frameIndex, int32_t stride = 1, uint32_t frameLimit = 0);
+    int32_t getStride() const { return m_stride; }
+
+    // 读取任务接口：取一个空闲帧缓冲，读入下一帧后放入就绪队列
+    void service(uint32_t timeoutMs);
+
+    // 播放侧接口：取出下一帧，最多等待timeoutMs；返回false时用isFinished()区分播放结束和读取跟不上
+    // timeoutMs为0时只查询是否有就绪帧，不计入停顿统计（按音频时钟轮询时使用）
+    bool acquireFrame(Frame* frame, uint32_t timeoutMs);
+    void releaseFrame(const Frame& frame);
+    bool isFinished() const;
+
+    // 统计信息
+    uint32_t getPoolFrames() const { return m_poolFrames; }
+    uint32_t getBufferedFrames() const;
+    uint32_t getMinBufferedFrames() const { return m_minBuffered; }
+    uint32_t getAverageBufferedPercent() const;
+    uint32_t getStallCount() const { return m_stallCount; }
+    uint32_t getStallTimeMs() const { return m_stallTimeMs; }
+    uint32_t getReadFrames() const { return m_readFrames; }
+    uint32_t getRepeatFrames() const { return m_repeatFrames; }
+    uint32_t getReadErrors() const { return m_readErrors; }
+    uint32_t getMaxReadTimeUs() const { return m_maxReadTimeUs; }
+
+private:
+    struct Slot {
+        uint8_t* data;
+        uint32_t size;
+        uint32_t frameIndex;
+        uint32_t readTimeUs;
+        bool repeat;
+    };
+
+    void flushReadyQueue();
+
+    MJPEGDecoder* m_decoder;
+    Slot m_slots[PLAYBACK_PREFETCH_MAX_FRAMES];
+    uint32_t m_poolFrames;
+    uint32_t m_slotSize;
+    volatile bool m_active;
+    volatile bool m_readerDone;      // 已读到最后一帧
+    uint32_t m_nextFrame;            // 读取任务下一个要读的帧号
+    int32_t m_stride;                // 帧号步长
+    uint32_t m_framesRemaining;      // 限量读取时剩余帧数
+    bool m_frameLimited;
+    bool m_waitingFirst;             // 开始或跳转后尚未取出第一帧（此时等待不计停顿）
+    uint64_t m_lastOffset;           // 上一次读取的数据位置（识别重复帧）
+
+    QueueHandle_t m_freeQueue;       // 空闲帧缓冲序号
+    QueueHandle_t m_readyQueue;      // 已读入、按帧号顺序等待解码的帧缓冲序号
+    SemaphoreHandle_t m_readLock;    // 读取过程与restart()/end()互斥
+
+    uint32_t m_deliveredFrames;
+    uint32_t m_minBuffered;
+    uint64_t m_bufferedSum;
+    uint32_t m_stallCount;
+    uint32_t m_stallTimeMs;
+    uint32_t m_readFrames;
+    uint32_t m_repeatFrames;
+    uint32_t m_readErrors;
+    uint32_t m_maxReadTimeUs;
+};
+
+#endif // MJPEG_PLAYBACK_PREFETCH_H
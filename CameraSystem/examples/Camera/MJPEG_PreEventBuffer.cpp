@@ -0,0 +1,271 @@
+/*
+ * MJPEG_PreEventBuffer.cpp - 录制预录缓冲区实现
+ * 空闲时把录制通道的JPEG帧和音频块按时间顺序存入一块固定内存（变长记录环形区，无逐帧malloc）
+ * 开始录制时最早的记录作为AVI的首批数据块写出，之后新数据在缓冲区排空前继续排队，保证顺序
+ */
+
+#include "MJPEG_PreEventBuffer.h"
+#include "Utils_Logger.h"
+
+MJPEGPreEventBuffer::MJPEGPreEventBuffer()
+    : m_arena(nullptr)
+    , m_arenaSize(0)
+    , m_windowMs(0)
+    , m_head(0)
+    , m_tail(0)
+    , m_wrapEnd(0)
+    , m_count(0)
+    , m_videoCount(0)
+    , m_usedBytes(0)
+    , m_newestTimestamp(0)
+    , m_mode(MODE_BUFFERING)
+    , m_inFlight(false)
+    , m_droppedChunks(0)
+    , m_flushedChunks(0)
+{
+    m_mutex = xSemaphoreCreateMutex();
+    m_drainLock = xSemaphoreCreateMutex();
+}
+
+MJPEGPreEventBuffer::~MJPEGPreEventBuffer() {
+    deinit();
+    if (m_mutex) {
+        vSemaphoreDelete(m_mutex);
+        m_mutex = nullptr;
+    }
+    if (m_drainLock) {
+        vSemaphoreDelete(m_drainLock);
+        m_drainLock = nullptr;
+    }
+}
+
+bool MJPEGPreEventBuffer::init(uint32_t arenaSize, uint32_t windowMs) {
+    if (m_arena && m_arenaSize == arenaSize) {
+        m_windowMs = windowMs;
+        reset();
+        return true;
+    }
+
+    deinit();
+    m_arena = (uint8_t*)malloc(arenaSize);
+    if (!m_arena) {
+        Utils_Logger::error("Pre-event buffer: failed to allocate %u bytes", arenaSize);
+        return false;
+    }
+
+    m_arenaSize = arenaSize & ~3u;
+    m_windowMs = windowMs;
+    reset();
+    Utils_Logger::info("Pre-event buffer: %u KB, window %u ms", m_arenaSize / 1024, m_windowMs);
+    return true;
+}
+
+void MJPEGPreEventBuffer::deinit() {
+    xSemaphoreTake(m_drainLock, portMAX_DELAY);
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (m_arena) {
+        free(m_arena);
+        m_arena = nullptr;
+    }
+    m_arenaSize = 0;
+    m_count = 0;
+    m_videoCount = 0;
+    m_usedBytes = 0;
+    xSemaphoreGive(m_mutex);
+    xSemaphoreGive(m_drainLock);
+}
+
+void MJPEGPreEventBuffer::reset() {
+    xSemaphoreTake(m_drainLock, portMAX_DELAY);
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_head = 0;
+    m_tail = 0;
+    m_wrapEnd = m_arenaSize;
+    m_count = 0;
+    m_videoCount = 0;
+    m_usedBytes = 0;
+    m_newestTimestamp = 0;
+    m_mode = MODE_BUFFERING;
+    m_inFlight = false;
+    m_droppedChunks = 0;
+    m_flushedChunks = 0;
+    xSemaphoreGive(m_mutex);
+    xSemaphoreGive(m_drainLock);
+}
+
+uint32_t MJPEGPreEventBuffer::getBufferedDurationMs() const {
+    if (m_count == 0) {
+        return 0;
+    }
+    return m_newestTimestamp - oldest()->timestamp;
+}
+
+// 淘汰最早的记录（调用者持有m_mutex）
+void MJPEGPreEventBuffer::dropOldest() {
+    RecordHeader* record = oldest();
+    uint32_t size = recordSize(record->size);
+    if (record->type == PREEVENT_CHUNK_VIDEO) {
+        m_videoCount--;
+    }
+    m_tail += size;
+    m_usedBytes -= size;
+    m_count--;
+
+    if (m_count == 0) {
+        m_head = 0;
+        m_tail = 0;
+        m_wrapEnd = m_arenaSize;
+    } else if (m_tail >= m_wrapEnd) {
+        // 高段数据已全部出队，回到未回绕状态
+        m_tail = 0;
+        m_wrapEnd = m_arenaSize;
+    }
+}
+
+// 追加一条记录（调用者持有m_mutex）；allowEvict为false时空间不足直接丢弃新记录
+bool MJPEGPreEventBuffer::append(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp, bool allowEvict) {
+    uint32_t needed = recordSize(size);
+    if (!m_arena || needed > m_arenaSize) {
+        m_droppedChunks++;
+        return false;
+    }
+
+    uint32_t writePos = 0;
+    while (true) {
+        if (m_count == 0) {
+            m_head = 0;
+            m_tail = 0;
+            m_wrapEnd = m_arenaSize;
+            writePos = 0;
+            break;
+        }
+        if (m_head > m_tail) {
+            // 未回绕：数据位于[tail, head)
+            if (m_head + needed <= m_arenaSize) {
+                writePos = m_head;
+                break;
+            }
+            if (needed <= m_tail) {
+                m_wrapEnd = m_head;
+                writePos = 0;
+                break;
+            }
+        } else if (m_head + needed <= m_tail) {
+            // 已回绕：数据位于[tail, wrapEnd)和[0, head)
+            writePos = m_head;
+            break;
+        }
+
+        // 正在写出的最早记录不能被淘汰
+        if (!allowEvict || m_inFlight) {
+            m_droppedChunks++;
+            return false;
+        }
+        dropOldest();
+        m_droppedChunks++;
+    }
+
+    RecordHeader* record = (RecordHeader*)(m_arena + writePos);
+    record->size = size;
+    record->timestamp = timestamp;
+    record->type = type;
+    memcpy(m_arena + writePos + sizeof(RecordHeader), data, size);
+
+    m_head = writePos + needed;
+    m_count++;
+    m_usedBytes += needed;
+    m_newestTimestamp = timestamp;
+    if (type == PREEVENT_CHUNK_VIDEO) {
+        m_videoCount++;
+    }
+    return true;
+}
+
+bool MJPEGPreEventBuffer::push(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp) {
+    if (xSemaphoreTake(m_mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    bool buffering = (m_mode == MODE_BUFFERING);
+    bool ok = append(type, data, size, timestamp, buffering);
+
+    // 预录模式只保留最近windowMs的数据（时间窗口淘汰不计入丢弃）
+    while (buffering && m_count > 1 && (int32_t)(m_newestTimestamp - oldest()->timestamp) > (int32_t)m_windowMs) {
+        dropOldest();
+    }
+
+    xSemaphoreGive(m_mutex);
+    return ok;
+}
+
+void MJPEGPreEventBuffer::beginDrain() {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+
+    // AVI以视频帧开始，丢弃首个视频帧之前的音频块
+    while (m_count > 0 && oldest()->type != PREEVENT_CHUNK_VIDEO) {
+        dropOldest();
+    }
+
+    m_mode = MODE_DRAINING;
+    m_flushedChunks = 0;
+    Utils_Logger::info("Pre-event flush: %u chunks, %u video frames, %u ms, %u KB",
+                      m_count, m_videoCount, getBufferedDurationMs(), m_usedBytes / 1024);
+    xSemaphoreGive(m_mutex);
+}
+
+bool MJPEGPreEventBuffer::pushIfDraining(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp) {
+    if (m_mode != MODE_DRAINING) {
+        return false;
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    bool queued = false;
+    if (m_mode == MODE_DRAINING) {
+        if (m_count > 0 || m_inFlight) {
+            // 积压尚未排空：排到末尾保证各路流顺序，空间不足时丢弃新数据
+            append(type, data, size, timestamp, false);
+            queued = true;
+        } else {
+            m_mode = MODE_PASSTHROUGH;
+            Utils_Logger::info("Pre-event buffer drained: %u chunks flushed, %u dropped", m_flushedChunks, m_droppedChunks);
+        }
+    }
+    xSemaphoreGive(m_mutex);
+    return queued;
+}
+
+uint32_t MJPEGPreEventBuffer::drain(PreEventSink sink, uint32_t budgetMs) {
+    if (!sink || xSemaphoreTake(m_drainLock, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    uint32_t startTime = millis();
+    uint32_t written = 0;
+    while (budgetMs == 0 || millis() - startTime < budgetMs) {
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+        if (m_count == 0) {
+            xSemaphoreGive(m_mutex);
+            break;
+        }
+        RecordHeader* record = oldest();
+        m_inFlight = true;
+        xSemaphoreGive(m_mutex);
+
+        // 写入期间不持有锁，生产者可以继续排队；m_inFlight保证该记录不会被覆盖
+        bool ok = sink(record->type, (const uint8_t*)record + sizeof(RecordHeader), record->size, record->timestamp);
+
+        // 丢弃计数也由生产者在append()中更新，必须在锁内修改
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+        if (!ok) {
+            m_droppedChunks++;
+        }
+        dropOldest();
+        m_inFlight = false;
+        m_flushedChunks++;
+        xSemaphoreGive(m_mutex);
+        written++;
+    }
+
+    xSemaphoreGive(m_drainLock);
+    return written;
+}
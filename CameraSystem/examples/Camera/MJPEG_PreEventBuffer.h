@@ -0,0 +1,91 @@
+/*
+ * MJPEG_PreEventBuffer.h - 录制预录缓冲区头文件
+ * 空闲时把录制通道的JPEG帧和音频块按时间顺序存入一块固定内存（变长记录环形区，无逐帧malloc）
+ * 开始录制时最早的记录作为AVI的首批数据块写出，之后新数据在缓冲区排空前继续排队，保证顺序
+ */
+
+#ifndef MJPEG_PRE_EVENT_BUFFER_H
+#define MJPEG_PRE_EVENT_BUFFER_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+#define PREEVENT_CHUNK_VIDEO  0
+#define PREEVENT_CHUNK_AUDIO  1
+
+// 数据块输出回调（写入编码器），返回false表示写入失败
+typedef bool (*PreEventSink)(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp);
+
+class MJPEGPreEventBuffer {
+public:
+    MJPEGPreEventBuffer();
+    ~MJPEGPreEventBuffer();
+
+    // 分配固定大小的记录区，windowMs为空闲时保留的时长
+    bool init(uint32_t arenaSize, uint32_t windowMs);
+    void deinit();
+    bool isInitialized() const { return m_arena != nullptr; }
+
+    // 清空并回到预录模式
+    void reset();
+
+    // 预录模式：追加记录，超出时间窗口或空间不足时淘汰最早的记录
+    bool push(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp);
+
+    // 开始录制：丢弃首个视频帧之前的音频，进入排空模式
+    void beginDrain();
+    // 排空模式下缓冲区仍有数据时把新数据排到末尾并返回true；已排空则返回false，调用者直接写编码器
+    bool pushIfDraining(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp);
+    // 按时间顺序把记录写入sink，budgetMs为0时全部写出；返回写出的记录数
+    uint32_t drain(PreEventSink sink, uint32_t budgetMs);
+    bool isDraining() const { return m_mode == MODE_DRAINING; }
+
+    // 统计信息
+    uint32_t getBufferedVideoFrames() const { return m_videoCount; }
+    uint32_t getBufferedBytes() const { return m_usedBytes; }
+    uint32_t getBufferedDurationMs() const;
+    uint32_t getDroppedChunks() const { return m_droppedChunks; }
+    uint32_t getFlushedChunks() const { return m_flushedChunks; }
+
+private:
+    typedef enum {
+        MODE_BUFFERING = 0,   // 空闲预录，按时间窗口淘汰
+        MODE_DRAINING = 1,    // 录制开始后排空积压数据，不再淘汰
+        MODE_PASSTHROUGH = 2  // 已排空，新数据直接写编码器
+    } Mode;
+
+    // 记录头（记录整体4字节对齐）
+    struct RecordHeader {
+        uint32_t size;
+        uint32_t timestamp;
+        uint8_t type;
+        uint8_t reserved[3];
+    };
+
+    bool append(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp, bool allowEvict);
+    void dropOldest();
+    uint32_t recordSize(uint32_t payloadSize) const { return (sizeof(RecordHeader) + payloadSize + 3) & ~3u; }
+    RecordHeader* oldest() const { return (RecordHeader*)(m_arena + m_tail); }
+
+    uint8_t* m_arena;
+    uint32_t m_arenaSize;
+    uint32_t m_windowMs;
+    uint32_t m_head;        // 下一条记录写入位置
+    uint32_t m_tail;        // 最早记录位置
+    uint32_t m_wrapEnd;     // 回绕后高段有效数据的结束位置
+    uint32_t m_count;
+    uint32_t m_videoCount;
+    uint32_t m_usedBytes;
+    uint32_t m_newestTimestamp;
+    volatile Mode m_mode;
+    bool m_inFlight;        // 最早记录正在写入编码器，尚未出队
+
+    uint32_t m_droppedChunks;
+    uint32_t m_flushedChunks;
+
+    SemaphoreHandle_t m_mutex;      // 保护记录区索引
+    SemaphoreHandle_t m_drainLock;  // 同一时刻只允许一个任务排空
+};
+
+#endif // MJPEG_PRE_EVENT_BUFFER_H
@@ -0,0 +1,565 @@
+/*
+ * MJPEG_StreamWriter.cpp - AVI流式写入器实现
+ * 使用固定数量的写缓冲区把AVI数据块流式追加到已打开的FatFs文件
+ * 写满的缓冲区交给AVI写入任务落盘，录制内存占用与视频时长无关
+ */
+
+#include "MJPEG_StreamWriter.h"
+#include "Utils_Logger.h"
+
+QueueHandle_t AVIStreamWriter::s_writeQueue = nullptr;
+volatile bool AVIStreamWriter::s_pauseRequested = false;
+volatile bool AVIStreamWriter::s_taskPaused = false;
+
+// 待完成请求计数在提交者任务中递增、在写入任务中递减，读改写必须在临界区内完成
+static inline void pendingInc(volatile uint32_t& counter) {
+    taskENTER_CRITICAL();
+    counter++;
+    taskEXIT_CRITICAL();
+}
+
+static inline void pendingDec(volatile uint32_t& counter) {
+    taskENTER_CRITICAL();
+    counter--;
+    taskEXIT_CRITICAL();
+}
+
+AVIStreamWriter::AVIStreamWriter()
+    : m_open(false)
+    , m_error(false)
+    , m_buffers(nullptr)
+    , m_bufferCount(0)
+    , m_bufferSize(0)
+    , m_freeQueue(nullptr)
+    , m_current(nullptr)
+    , m_currentPos(0)
+    , m_currentLimit(0)
+    , m_position(0)
+    , m_alignUnit(0)
+    , m_preallocated(false)
+    , m_bytesWritten(0)
+    , m_totalWriteTimeUs(0)
+    , m_maxWriteTimeUs(0)
+    , m_writeCount(0)
+    , m_bufferWaitCount(0)
+    , m_pendingControlJobs(0)
+    , m_pendingDirectJobs(0)
+    , m_directBytes(0)
+{
+    memset(&m_file, 0, sizeof(m_file));
+}
+
+AVIStreamWriter::~AVIStreamWriter() {
+    if (m_open && !close()) {
+        // 写入任务仍可能访问缓冲区，宁可泄漏也不释放
+        return;
+    }
+    releaseBuffers();
+}
+
+bool AVIStreamWriter::initWriteQueue() {
+    if (s_writeQueue == nullptr) {
+        s_writeQueue = xQueueCreate(AVI_WRITE_QUEUE_SIZE, sizeof(WriteJob));
+        if (s_writeQueue == nullptr) {
+            Utils_Logger::error("AVI write queue creation failed");
+            return false;
+        }
+    }
+    return true;
+}
+
+void AVIStreamWriter::processWriteQueue(uint32_t timeoutMs) {
+    if (s_writeQueue == nullptr) {
+        vTaskDelay(timeoutMs / portTICK_PERIOD_MS);
+        return;
+    }
+
+    // 暂停期间不取新请求；确认标志只在两次请求之间设置，此时没有请求处于执行中
+    if (s_pauseRequested) {
+        s_taskPaused = true;
+        vTaskDelay(2 / portTICK_PERIOD_MS);
+        return;
+    }
+    s_taskPaused = false;
+
+    WriteJob job;
+    if (xQueueReceive(s_writeQueue, &job, timeoutMs / portTICK_PERIOD_MS) == pdTRUE) {
+        job.owner->completeJob(job);
+    }
+}
+
+bool AVIStreamWriter::pauseWriteTask(uint32_t timeoutMs) {
+    s_taskPaused = false;
+    s_pauseRequested = true;
+
+    uint32_t startTime = millis();
+    while (!s_taskPaused) {
+        if (millis() - startTime > timeoutMs) {
+            // 写入任务仍在执行请求（可能持有文件系统锁），撤销暂停请求
+            s_pauseRequested = false;
+            Utils_Logger::error("AVIStreamWriter: write task did not pause within %u ms", timeoutMs);
+            return false;
+        }
+        vTaskDelay(2 / portTICK_PERIOD_MS);
+    }
+    return true;
+}
+
+void AVIStreamWriter::resumeWriteTask() {
+    s_pauseRequested = false;
+}
+
+void AVIStreamWriter::completeJob(const WriteJob& job) {
+    if (job.type == JOB_PATCH32) {
+        uint8_t data[4];
+        data[0] = job.size & 0xFF;
+        data[1] = (job.size >> 8) & 0xFF;
+        data[2] = (job.size >> 16) & 0xFF;
+        data[3] = (job.size >> 24) & 0xFF;
+        FSIZE_t endPos = f_tell(&m_file);
+        UINT written = 0;
+        if (f_lseek(&m_file, job.offset) != FR_OK || f_write(&m_file, data, 4, &written) != FR_OK || written != 4) {
+            Utils_Logger::error("AVI checkpoint patch at %llu failed", job.offset);
+        }
+        f_lseek(&m_file, endPos);
+        pendingDec(m_pendingControlJobs);
+        return;
+    }
+
+    if (job.type == JOB_SYNC) {
+        if (f_sync(&m_file) != FR_OK) {
+            Utils_Logger::error("AVI checkpoint sync failed");
+        }
+        pendingDec(m_pendingControlJobs);
+        return;
+    }
+
+    uint32_t startTime = micros();
+    UINT written = 0;
+    FRESULT res = f_write(&m_file, job.data, job.size, &written);
+    uint32_t elapsed = micros() - startTime;
+
+    if (res != FR_OK || written != job.size) {
+        Utils_Logger::error("AVI write failed: res=%d, wrote %u/%u", res, written, job.size);
+        m_error = true;
+    }
+
+    m_bytesWritten += written;
+    m_totalWriteTimeUs += elapsed;
+    m_writeCount++;
+    if (elapsed > m_maxWriteTimeUs) {
+        m_maxWriteTimeUs = elapsed;
+    }
+
+    if (job.type == JOB_WRITE_DIRECT) {
+        // 数据属于调用者，写完即可复用
+        pendingDec(m_pendingDirectJobs);
+        return;
+    }
+
+    // 缓冲区归还给所属写入器
+    uint8_t* buffer = job.data;
+    xQueueSend(m_freeQueue, &buffer, 0);
+}
+
+bool AVIStreamWriter::open(const char* path, uint32_t bufferSize, uint32_t bufferCount) {
+    if (m_open) {
+        Utils_Logger::error("AVIStreamWriter already open");
+        return false;
+    }
+
+    if (!initWriteQueue()) {
+        return false;
+    }
+
+    releaseBuffers();
+
+    m_buffers = (uint8_t**)malloc(bufferCount * sizeof(uint8_t*));
+    m_freeQueue = xQueueCreate(bufferCount, sizeof(uint8_t*));
+    if (!m_buffers || !m_freeQueue) {
+        Utils_Logger::error("AVIStreamWriter: failed to allocate buffer pool");
+        releaseBuffers();
+        return false;
+    }
+
+    m_bufferSize = bufferSize;
+    m_bufferCount = 0;
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        m_buffers[i] = (uint8_t*)malloc(bufferSize);
+        if (!m_buffers[i]) {
+            Utils_Logger::error("AVIStreamWriter: failed to allocate write buffer %u", i);
+            releaseBuffers();
+            return false;
+        }
+        m_bufferCount++;
+        xQueueSend(m_freeQueue, &m_buffers[i], 0);
+    }
+
+    FRESULT res = f_open(&m_file, path, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res != FR_OK) {
+        Utils_Logger::error("AVIStreamWriter: cannot create %s (res=%d)", path, res);
+        releaseBuffers();
+        return false;
+    }
+
+    m_open = true;
+    m_error = false;
+    m_current = nullptr;
+    m_currentPos = 0;
+    m_currentLimit = 0;
+    m_position = 0;
+    m_alignUnit = 0;
+    m_preallocated = false;
+    m_bytesWritten = 0;
+    m_totalWriteTimeUs = 0;
+    m_maxWriteTimeUs = 0;
+    m_writeCount = 0;
+    m_bufferWaitCount = 0;
+    m_pendingControlJobs = 0;
+    m_pendingDirectJobs = 0;
+    m_directBytes = 0;
+    return true;
+}
+
+bool AVIStreamWriter::acquireBuffer() {
+    if (uxQueueMessagesWaiting(m_freeQueue) == 0) {
+        m_bufferWaitCount++;
+    }
+    if (xQueueReceive(m_freeQueue, &m_current, AVI_WRITE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE) {
+        Utils_Logger::error("AVIStreamWriter: no free write buffer (SD too slow?)");
+        m_current = nullptr;
+        m_error = true;
+        return false;
+    }
+    m_currentPos = 0;
+    // 上次提交了未写满的缓冲区（检查点）时，本缓冲区缩短到下一个对齐边界，之后恢复整块对齐写入
+    m_currentLimit = m_bufferSize;
+    if (m_alignUnit > 0) {
+        m_currentLimit -= (uint32_t)(m_position % m_alignUnit);
+    }
+    return true;
+}
+
+bool AVIStreamWriter::preallocate(uint64_t size) {
+    if (!m_open || m_position > 0) {
+        Utils_Logger::error("AVIStreamWriter: preallocate must follow open()");
+        return false;
+    }
+
+    // FF_USE_EXPAND由SDK的ffconf.h决定（本仓库不含FatFs配置），未开启时编译为退回普通分配的分支
+#if FF_USE_EXPAND
+    if (sizeof(FSIZE_t) < 8 && size > 0xFFFFFFFFULL) {
+        size = 0xFFFFFFFFULL;
+    }
+    // opt=1：立即分配连续簇，写入时无需查找和扩展FAT链
+    FRESULT res = f_expand(&m_file, (FSIZE_t)size, 1);
+    if (res != FR_OK) {
+        Utils_Logger::error("AVIStreamWriter: no contiguous space for %llu bytes (res=%d)", size, res);
+        return false;
+    }
+    m_preallocated = true;
+    return true;
+#else
+    Utils_Logger::info("AVIStreamWriter: f_expand not enabled (FF_USE_EXPAND=0), using normal allocation");
+    return false;
+#endif
+}
+
+void AVIStreamWriter::setAlignment(uint32_t alignUnit) {
+    // 对齐单位不能超过缓冲区大小，否则每个缓冲区都无法在边界结束
+    if (alignUnit > m_bufferSize) {
+        alignUnit = m_bufferSize;
+    }
+    m_alignUnit = alignUnit;
+}
+
+uint32_t AVIStreamWriter::getWriteThroughputKBps() const {
+    if (m_totalWriteTimeUs == 0) {
+        return 0;
+    }
+    return (uint32_t)((m_bytesWritten * 1000000ULL / 1024) / m_totalWriteTimeUs);
+}
+
+bool AVIStreamWriter::submitCurrent() {
+    if (!m_current || m_currentPos == 0) {
+        return true;
+    }
+
+    WriteJob job;
+    job.owner = this;
+    job.type = JOB_WRITE;
+    job.data = m_current;
+    job.size = m_currentPos;
+    job.offset = 0;
+    if (!submitJob(job)) {
+        return false;
+    }
+
+    m_current = nullptr;
+    m_currentPos = 0;
+    return true;
+}
+
+bool AVIStreamWriter::submitJob(const WriteJob& job) {
+    if (xQueueSend(s_writeQueue, &job, AVI_WRITE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE) {
+        Utils_Logger::error("AVIStreamWriter: write queue full");
+        m_error = true;
+        return false;
+    }
+    return true;
+}
+
+bool AVIStreamWriter::queuePatch32(uint64_t offset, uint32_t value) {
+    if (!m_open || m_error) {
+        return false;
+    }
+
+    WriteJob job;
+    job.owner = this;
+    job.type = JOB_PATCH32;
+    job.data = nullptr;
+    job.size = value;
+    job.offset = offset;
+    pendingInc(m_pendingControlJobs);
+    if (!submitJob(job)) {
+        pendingDec(m_pendingControlJobs);
+        return false;
+    }
+    return true;
+}
+
+bool AVIStreamWriter::queueSync() {
+    if (!m_open || m_error) {
+        return false;
+    }
+
+    WriteJob job;
+    job.owner = this;
+    job.type = JOB_SYNC;
+    job.data = nullptr;
+    job.size = 0;
+    job.offset = 0;
+    pendingInc(m_pendingControlJobs);
+    if (!submitJob(job)) {
+        pendingDec(m_pendingControlJobs);
+        return false;
+    }
+    return true;
+}
+
+bool AVIStreamWriter::append(const void* data, uint32_t size) {
+    if (!m_open || m_error) {
+        return false;
+    }
+
+    const uint8_t* src = (const uint8_t*)data;
+    while (size > 0) {
+        if (!m_current && !acquireBuffer()) {
+            return false;
+        }
+
+        uint32_t chunk = m_currentLimit - m_currentPos;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(m_current + m_currentPos, src, chunk);
+        m_currentPos += chunk;
+        m_position += chunk;
+        src += chunk;
+        size -= chunk;
+
+        if (m_currentPos == m_currentLimit && !submitCurrent()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AVIStreamWriter::isDirectCandidate(const void* data, uint32_t size) const {
+    return size >= AVI_DIRECT_MIN_SIZE && ((uintptr_t)data % AVI_DIRECT_ADDR_ALIGN) == 0;
+}
+
+bool AVIStreamWriter::appendDirect(const void* data, uint32_t size) {
+    if (!m_open || m_error) {
+        return false;
+    }
+
+    const uint8_t* src = (const uint8_t*)data;
+    uint32_t directSize = size & ~(uint32_t)(AVI_DIRECT_WRITE_UNIT - 1);
+    if (!isDirectCandidate(data, size) || (m_position % AVI_DIRECT_WRITE_UNIT) != 0) {
+        return append(data, size);
+    }
+
+    // 先提交已缓冲的数据，写队列按顺序执行，保证文件内容顺序
+    if (!submitCurrent()) {
+        return false;
+    }
+
+    WriteJob job;
+    job.owner = this;
+    job.type = JOB_WRITE_DIRECT;
+    job.data = (uint8_t*)src;
+    job.size = directSize;
+    job.offset = 0;
+    pendingInc(m_pendingDirectJobs);
+    if (!submitJob(job)) {
+        pendingDec(m_pendingDirectJobs);
+        return false;
+    }
+    m_position += directSize;
+    m_directBytes += directSize;
+
+    // 不足一个扇区的尾部照常进入写缓冲区
+    return append(src + directSize, size - directSize);
+}
+
+bool AVIStreamWriter::waitDirectWrites(uint32_t timeoutMs) {
+    uint32_t startTime = millis();
+    while (m_pendingDirectJobs > 0) {
+        if (millis() - startTime > timeoutMs) {
+            Utils_Logger::error("AVIStreamWriter: direct write still pending after %u ms", timeoutMs);
+            return false;
+        }
+        vTaskDelay(1 / portTICK_PERIOD_MS);
+    }
+    return true;
+}
+
+bool AVIStreamWriter::appendZeros(uint32_t size) {
+    static const uint8_t zeros[64] = {0};
+    while (size > 0) {
+        uint32_t chunk = size > sizeof(zeros) ? sizeof(zeros) : size;
+        if (!append(zeros, chunk)) {
+            return false;
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+bool AVIStreamWriter::flush() {
+    if (!m_open) {
+        return false;
+    }
+    return submitCurrent();
+}
+
+uint32_t AVIStreamWriter::getQueuedBufferCount() const {
+    if (!m_freeQueue) {
+        return 0;
+    }
+    uint32_t idle = uxQueueMessagesWaiting(m_freeQueue) + (m_current ? 1 : 0);
+    return (idle < m_bufferCount) ? (m_bufferCount - idle) : 0;
+}
+
+bool AVIStreamWriter::waitIdle(uint32_t timeoutMs) {
+    uint32_t startTime = millis();
+    while (getQueuedBufferCount() > 0 || m_pendingControlJobs > 0 || m_pendingDirectJobs > 0) {
+        if (millis() - startTime > timeoutMs) {
+            Utils_Logger::error("AVIStreamWriter: wait idle timeout, %u buffers pending", getQueuedBufferCount());
+            return false;
+        }
+        vTaskDelay(2 / portTICK_PERIOD_MS);
+    }
+    return true;
+}
+
+bool AVIStreamWriter::patch(uint64_t offset, const void* data, uint32_t size) {
+    if (!m_open || getQueuedBufferCount() > 0 || m_currentPos > 0 || m_pendingControlJobs > 0 || m_pendingDirectJobs > 0) {
+        Utils_Logger::error("AVIStreamWriter: patch requires drained writer");
+        return false;
+    }
+
+    FSIZE_t endPos = f_tell(&m_file);
+    UINT written = 0;
+    bool ok = (f_lseek(&m_file, offset) == FR_OK) &&
+              (f_write(&m_file, data, size, &written) == FR_OK) &&
+              (written == size);
+    // 恢复到文件末尾，保证后续追加位置正确
+    f_lseek(&m_file, endPos);
+
+    if (!ok) {
+        Utils_Logger::error("AVIStreamWriter: patch at %llu failed", offset);
+        m_error = true;
+    }
+    return ok;
+}
+
+bool AVIStreamWriter::close() {
+    if (!m_open) {
+        return false;
+    }
+
+    if (!flush() || !waitIdle(AVI_WRITE_WAIT_MS * m_bufferCount)) {
+        // 写入任务仍持有缓冲区，此时不能关闭文件或释放内存；保持打开，由调用者重试或停止写入任务后abort()
+        Utils_Logger::error("AVIStreamWriter: close deferred, writer not drained");
+        return false;
+    }
+
+    // 预分配的文件截断到实际写入位置（最后一次写入后文件指针即在逻辑末尾）
+    bool ok = true;
+    if (m_preallocated) {
+        ok = (f_lseek(&m_file, m_position) == FR_OK) && (f_truncate(&m_file) == FR_OK);
+        if (!ok) {
+            Utils_Logger::error("AVIStreamWriter: truncate to %llu failed", m_position);
+        }
+    }
+
+    ok = (f_close(&m_file) == FR_OK) && ok;
+    m_open = false;
+    releaseBuffers();
+    return ok && !m_error;
+}
+
+void AVIStreamWriter::abort() {
+    if (!m_open) {
+        return;
+    }
+
+    // 写入任务已暂停，队列中剩余的本写入器请求引用的缓冲区即将释放，必须先移除
+    discardJobs(this);
+
+    // 已落盘部分保留；预分配的文件不截断，尾部由AVI恢复流程按检查点位置处理
+    f_close(&m_file);
+    m_open = false;
+    m_error = true;
+    m_pendingControlJobs = 0;
+    m_pendingDirectJobs = 0;
+    releaseBuffers();
+    Utils_Logger::error("AVIStreamWriter: writer aborted at %llu bytes written", m_bytesWritten);
+}
+
+void AVIStreamWriter::discardJobs(const AVIStreamWriter* owner) {
+    if (s_writeQueue == nullptr) {
+        return;
+    }
+
+    // 逐个取出当前排队的请求，其他写入器的请求按原顺序放回队尾
+    UBaseType_t count = uxQueueMessagesWaiting(s_writeQueue);
+    WriteJob job;
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (xQueueReceive(s_writeQueue, &job, 0) != pdTRUE) {
+            break;
+        }
+        if (job.owner != owner) {
+            xQueueSend(s_writeQueue, &job, 0);
+        }
+    }
+}
+
+void AVIStreamWriter::releaseBuffers() {
+    if (m_buffers) {
+        for (uint32_t i = 0; i < m_bufferCount; i++) {
+            free(m_buffers[i]);
+        }
+        free(m_buffers);
+        m_buffers = nullptr;
+    }
+    if (m_freeQueue) {
+        vQueueDelete(m_freeQueue);
+        m_freeQueue = nullptr;
+    }
+    m_bufferCount = 0;
+    m_current = nullptr;
+    m_currentPos = 0;
+}
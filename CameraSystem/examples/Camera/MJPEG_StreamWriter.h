@@ -0,0 +1,132 @@
+/*
+ * MJPEG_StreamWriter.h - AVI流式写入器头文件
+ * 使用固定数量的写缓冲区把AVI数据块流式追加到已打开的FatFs文件
+ * 写满的缓冲区交给AVI写入任务落盘，录制内存占用与视频时长无关
+ */
+
+#ifndef MJPEG_STREAM_WRITER_H
+#define MJPEG_STREAM_WRITER_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <queue.h>
+#include "AmebaFatFS.h"
+
+// 写缓冲区配置（默认4 x 64KB = 256KB）
+#define AVI_WRITE_BUFFER_SIZE   (64 * 1024)
+#define AVI_WRITE_BUFFER_COUNT  4
+#define AVI_WRITE_QUEUE_SIZE    16     // 写入任务队列深度（所有写入器共享）
+#define AVI_WRITE_WAIT_MS       2000   // 等待空闲缓冲区的最长时间（毫秒）
+#define AVI_DIRECT_WRITE_UNIT   512    // 零拷贝直写的长度和文件位置对齐单位（扇区）
+#define AVI_DIRECT_ADDR_ALIGN   32     // 源地址满足SD DMA对齐时才直写，否则退回复制
+#define AVI_DIRECT_MIN_SIZE     (8 * AVI_DIRECT_WRITE_UNIT) // 小于该长度的数据直接复制更划算
+
+class AVIStreamWriter {
+public:
+    AVIStreamWriter();
+    ~AVIStreamWriter();
+
+    // 打开（新建/覆盖）输出文件并分配写缓冲区
+    bool open(const char* path, uint32_t bufferSize = AVI_WRITE_BUFFER_SIZE,
+              uint32_t bufferCount = AVI_WRITE_BUFFER_COUNT);
+    // 追加数据，缓冲区写满后自动提交给写入任务
+    bool append(const void* data, uint32_t size);
+    bool appendZeros(uint32_t size);
+    // 零拷贝追加：扇区整数倍的部分不经写缓冲区，由写入任务直接从调用者内存写入文件，余下部分复制
+    // 要求逻辑位置按AVI_DIRECT_WRITE_UNIT对齐（否则整体复制）；waitDirectWrites()返回前调用者不能释放data
+    bool appendDirect(const void* data, uint32_t size);
+    bool isDirectCandidate(const void* data, uint32_t size) const;
+    bool waitDirectWrites(uint32_t timeoutMs);
+    // 提交当前未写满的缓冲区
+    bool flush();
+    // 等待所有已提交缓冲区落盘
+    bool waitIdle(uint32_t timeoutMs);
+    // 预分配连续簇（须在open()之后、首次append()之前调用），close()时截断到实际大小
+    bool preallocate(uint64_t size);
+    // 写入对齐单位（通常为簇大小）：提交的缓冲区都在该边界结束，保证多扇区直写
+    void setAlignment(uint32_t alignUnit);
+    // 回写已落盘区域（调用前必须flush()+waitIdle()）
+    bool patch(uint64_t offset, const void* data, uint32_t size);
+    // 异步检查点：在写队列中排入32位回写和f_sync，由写入任务按顺序执行，不阻塞调用者
+    bool queuePatch32(uint64_t offset, uint32_t value);
+    bool queueSync();
+    // 落盘剩余数据并关闭文件；写入任务未能排空时返回false且保持打开，可稍后重试
+    bool close();
+    // 终止路径（须在pauseWriteTask()成功后调用）：丢弃队列中本写入器的请求，关闭文件、释放缓冲区并标记失败
+    void abort();
+
+    bool isOpen() const { return m_open; }
+    bool hasError() const { return m_error; }
+    // 逻辑写入位置（包含尚未落盘的缓冲数据）
+    uint64_t tell() const { return m_position; }
+
+    // 统计信息
+    uint64_t getBytesWritten() const { return m_bytesWritten; }
+    uint32_t getWriteCount() const { return m_writeCount; }
+    uint32_t getMaxWriteLatencyUs() const { return m_maxWriteTimeUs; }
+    uint32_t getWriteThroughputKBps() const;   // 持续写入速度（落盘字节/写入耗时）
+    uint32_t getBufferWaitCount() const { return m_bufferWaitCount; }
+    uint64_t getDirectBytes() const { return m_directBytes; }
+    bool isPreallocated() const { return m_preallocated; }
+    uint32_t getQueuedBufferCount() const;
+
+    // AVI写入任务接口：创建共享写队列，并循环处理写请求
+    static bool initWriteQueue();
+    static void processWriteQueue(uint32_t timeoutMs);
+    // 暂停写入任务：等待正在执行的请求完成后不再取新请求，超时返回false（任务仍在写入）
+    static bool pauseWriteTask(uint32_t timeoutMs);
+    static void resumeWriteTask();
+
+private:
+    typedef enum {
+        JOB_WRITE = 0,    // 追加写缓冲区
+        JOB_PATCH32 = 1,  // 回写32位字段后回到文件末尾
+        JOB_SYNC = 2,     // f_sync提交FAT和目录项
+        JOB_WRITE_DIRECT = 3 // 直接从调用者内存写入，完成后不归还缓冲区
+    } JobType;
+
+    struct WriteJob {
+        AVIStreamWriter* owner;
+        JobType type;
+        uint8_t* data;
+        uint32_t size;
+        uint64_t offset;
+    };
+
+    bool acquireBuffer();
+    bool submitCurrent();
+    bool submitJob(const WriteJob& job);
+    void completeJob(const WriteJob& job);
+    void releaseBuffers();
+    static void discardJobs(const AVIStreamWriter* owner);
+
+    FIL m_file;
+    bool m_open;
+    volatile bool m_error;
+
+    uint8_t** m_buffers;
+    uint32_t m_bufferCount;
+    uint32_t m_bufferSize;
+    QueueHandle_t m_freeQueue;   // 空闲缓冲区队列
+    uint8_t* m_current;          // 正在填充的缓冲区
+    uint32_t m_currentPos;
+    uint32_t m_currentLimit;     // 当前缓冲区可填充上限（保证在对齐边界结束）
+    uint64_t m_position;
+    uint32_t m_alignUnit;
+    bool m_preallocated;
+
+    volatile uint64_t m_bytesWritten;
+    volatile uint64_t m_totalWriteTimeUs;
+    volatile uint32_t m_maxWriteTimeUs;
+    volatile uint32_t m_writeCount;
+    uint32_t m_bufferWaitCount;
+    volatile uint32_t m_pendingControlJobs;   // 尚未执行的回写/同步请求数
+    volatile uint32_t m_pendingDirectJobs;    // 尚未完成的零拷贝直写请求数
+    uint64_t m_directBytes;
+
+    static QueueHandle_t s_writeQueue;
+    static volatile bool s_pauseRequested;   // 调用者请求写入任务暂停
+    static volatile bool s_taskPaused;       // 写入任务已确认暂停，没有进行中的请求
+};
+
+#endif // MJPEG_STREAM_WRITER_H
@@ -14,16 +14,18 @@
 const MenuPageData menuPages[MENU_PAGE_COUNT] = {
     {
         // 主菜单页面
-        .imageData = MM_PIC,
-        .dataSize = MM_WIDTH * MM_HEIGHT * sizeof(uint16_t),
+        .imageData = MM_RLE,
+        .dataSize = sizeof(MM_RLE),
+        .compressed = true,
         .width = MM_WIDTH,
         .height = MM_HEIGHT,
         .type = MENU_PAGE_MAIN
     },
     {
         // 子菜单页面
-        .imageData = SM_PIC,
-        .dataSize = SM_WIDTH * SM_HEIGHT * sizeof(uint16_t),
+        .imageData = SM_RLE,
+        .dataSize = sizeof(SM_RLE),
+        .compressed = true,
         .width = SM_WIDTH,
         .height = SM_HEIGHT,
         .type = MENU_PAGE_SUB
@@ -19,7 +19,8 @@ typedef enum {
 // 菜单页面数据结构
 typedef struct {
     const uint16_t *imageData;    // 页面图像数据
-    size_t dataSize;             // 数据大小
+    size_t dataSize;             // 数据大小（字节）
+    bool compressed;             // imageData为RLE压缩的大端数据（Display_RleDecoder.h），否则为未压缩的小端数据
     int width;                   // 宽度
     int height;                  // 高度
     MenuPageType type;           // 页面类型
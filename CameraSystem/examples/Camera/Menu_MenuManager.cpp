@@ -5,6 +5,7 @@
  */
 
 #include "Menu_MenuManager.h"
+#include "Display_RleDecoder.h"
 
 // 初始化菜单管理器
 bool MenuManager::init()
@@ -17,6 +18,11 @@ bool MenuManager::init()
     // 根据当前页面类型设置默认菜单项配置
     updateMenuConfigForPage(currentPageIndex);
     
+#if MENU_BG_BENCH_ENABLED
+    // 主菜单随后就会显示，测试绘制不会造成闪烁
+    benchmarkPageDraw(menuPages[0]);
+#endif
+    
     Utils_Logger::info("[MenuManager] 初始化完成");
     return true;
 }
@@ -93,18 +99,69 @@ void MenuManager::showCurrentMenu()
         return;
     }
     
-    if (page.width != tftManager.getTFT().getWidth() || page.height != tftManager.getTFT().getHeight()) {
+    if (page.width != tftManager.width() || page.height != tftManager.height()) {
         Utils_Logger::info("[MenuManager] 菜单尺寸不匹配 %dx%d vs 屏幕 %dx%d", 
                              page.width, page.height, 
-                             tftManager.getTFT().getWidth(), tftManager.getTFT().getHeight());
+                             tftManager.width(), tftManager.height());
     }
     
     Utils_Logger::info("[MenuManager] 显示菜单页面 %d/%d (类型: %d)", 
                       currentPageIndex + 1, menuCount, page.type);
     
     // 使用DMA方式显示图像
-    tftManager.drawBitmap(0, 0, page.width, page.height, page.imageData);
+    if (page.compressed) {
+        tftManager.drawRleImage(0, 0, page.width, page.height, page.imageData, page.dataSize / sizeof(uint16_t));
+    } else {
+        tftManager.drawBitmap(0, 0, page.width, page.height, page.imageData);
+    }
+}
+
+#if MENU_BG_BENCH_ENABLED
+void MenuManager::benchmarkPageDraw(const MenuPageData &page)
+{
+    if (!page.compressed || page.imageData == nullptr) {
+        return;
+    }
+    
+    // 解压到RAM并换回小端，作为原来未压缩数组的替身
+    // 注意：未压缩一项从RAM读取源数据，不含原来从Flash读取数组的开销，只能作为下限参考
+    uint32_t pixelCount = (uint32_t)page.width * page.height;
+    uint16_t *raw = (uint16_t *)malloc(pixelCount * sizeof(uint16_t));
+    if (raw == nullptr) {
+        Utils_Logger::error("[MenuManager] 背景图测试缓冲区分配失败");
+        return;
+    }
+    Display_RleDecoder decoder(page.imageData, page.dataSize / sizeof(uint16_t));
+    if (decoder.read(raw, pixelCount) != pixelCount) {
+        Utils_Logger::error("[MenuManager] 背景图RLE数据不完整");
+        free(raw);
+        return;
+    }
+    for (uint32_t i = 0; i < pixelCount; i++) {
+        raw[i] = (uint16_t)((raw[i] << 8) | (raw[i] >> 8));
+    }
+    
+    // 两种方式都等待DMA传输结束后计时
+    AmebaST7789_DMA_SPI1 &tft = tftManager.getTFT();
+    tft.flush();
+    uint32_t start = micros();
+    tftManager.drawBitmap(0, 0, page.width, page.height, raw);
+    tft.flush();
+    uint32_t rawUs = micros() - start;
+    
+    start = micros();
+    tftManager.drawRleImage(0, 0, page.width, page.height, page.imageData, page.dataSize / sizeof(uint16_t));
+    tft.flush();
+    uint32_t rleUs = micros() - start;
+    
+    free(raw);
+    
+    Utils_Logger::info("[MenuManager] 背景图%dx%d 未压缩(RAM源): %u字节 %lu us, RLE(Flash源): %u字节 %lu us",
+                      page.width, page.height,
+                      (unsigned)(pixelCount * sizeof(uint16_t)), (unsigned long)rawUs,
+                      (unsigned)page.dataSize, (unsigned long)rleUs);
 }
+#endif
 
 // 切换到下一个菜单页面
 void MenuManager::nextMenu()
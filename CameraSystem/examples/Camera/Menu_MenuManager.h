@@ -31,6 +31,11 @@ private:
     // 内部方法：根据页面索引更新菜单项配置
     void updateMenuConfigForPage(int pageIndex);
     
+#if MENU_BG_BENCH_ENABLED
+    // 比较未压缩数据（drawBitmap逐像素交换字节）与RLE条带解压的整页绘制耗时和数据大小
+    void benchmarkPageDraw(const MenuPageData &page);
+#endif
+    
 public:
     // 通过引用接收TFT管理器实例
     MenuManager(Display_TFTManager &tftManager) : tftManager(tftManager) {}
@@ -14,6 +14,10 @@
 #include "Inmp441_MicrophoneManager.h"
 #include "VideoRecorder.h"
 #include "MJPEG_Encoder.h"
+#include "MJPEG_LoopRecorder.h"
+#include "MJPEG_PreEventBuffer.h"
+#include "MJPEG_PlaybackPrefetch.h"
+#include "MJPEG_PlaybackAudio.h"
 #include "ISP_ConfigTask.h"
 #include "ISP_ConfigManager.h"
 #include "ISP_ConfigUI.h"
@@ -29,7 +33,6 @@ extern MenuContext menuContext;
 extern EncoderControl encoder;
 extern SDCardManager sdCardManager;
 extern Display_FontRenderer fontRenderer;
-extern JPEGDEC jpeg;
 extern Inmp441MicrophoneManager g_microphoneManager;
 
 // JPEG解码回调函数
@@ -47,6 +50,16 @@ bool jpegDrawCallback(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bi
 
 // 拍照功能：编码器旋转处理函数
 void capturePhotoHandleEncoderRotation(RotationDirection direction) {
+#if PREVIEW_ZOOM_ENABLED
+    // 顺时针放大预览，逆时针缩小；1x时逆时针返回主菜单
+    if (direction == ROTATION_CW) {
+        cameraManager.zoomInPreview();
+        return;
+    }
+    if (direction == ROTATION_CCW && cameraManager.zoomOutPreview()) {
+        return;
+    }
+#endif
     // 拍照功能中旋转编码器用于返回主菜单
     // Utils_Logger::info("拍照模式：检测到编码器旋转，返回主菜单");
     TaskManager::setEvent(EVENT_RETURN_TO_MENU);
@@ -78,7 +91,7 @@ void taskCameraPreview(void* pvParameters) {
     // 检查相机管理器是否已初始化，如果没有则重新初始化
     if (!cameraManager.isInitialized()) {
         Utils_Logger::info("相机管理器未初始化，正在重新初始化...");
-        if (!cameraManager.init(tftManager, fontRenderer, jpeg)) {
+        if (!cameraManager.init(tftManager, fontRenderer)) {
             Utils_Logger::error("相机管理器重新初始化失败");
             // 清理任务参数
             if (params != NULL) {
@@ -98,6 +111,9 @@ void taskCameraPreview(void* pvParameters) {
     
     // 选项A（拍照片）：设置预览为全屏显示
     cameraManager.setPreviewDisplayMode(true);
+
+    // 预览帧分片解码，解码一帧期间也能及时响应编码器
+    cameraManager.setPreviewSliceRows(PREVIEW_DECODE_SLICE_ROWS);
     
     // Utils_Logger::info("拍照功能初始化完成，等待用户操作");
     
@@ -107,18 +123,18 @@ void taskCameraPreview(void* pvParameters) {
         cameraManager.processPreviewFrame();
         
         // 检查是否有拍照请求
-        if (cameraManager.hasCaptureRequest() && !cameraManager.isCapturing()) {
-            // 只在空闲时处理拍照请求，减少对预览的影响
+        if (cameraManager.hasCaptureRequest() && !cameraManager.isCapturing() && !cameraManager.isPreviewDecodePending()) {
+            // 只在空闲（预览帧已解码完）时处理拍照请求，减少对预览的影响
             // Utils_Logger::info("Capture request detected, starting capture...");
             cameraManager.clearCaptureRequest();
             cameraManager.capturePhoto();
         }
         
-        // 检查是否需要退出任务
+        // 检查是否需要退出任务（预览帧未解码完时不等待，尽快解码下一片）
         uint32_t uxBits = TaskManager::waitForEvent(
             EVENT_RETURN_TO_MENU,
             true,
-            10 / portTICK_PERIOD_MS
+            cameraManager.isPreviewDecodePending() ? 0 : 10 / portTICK_PERIOD_MS
         );
         
         if ((uxBits & EVENT_RETURN_TO_MENU) != 0) {
@@ -171,6 +187,16 @@ void taskCameraPreview(void* pvParameters) {
 
 // 拍视频功能：编码器旋转处理函数
 void captureVideoHandleEncoderRotation(RotationDirection direction) {
+#if PREVIEW_ZOOM_ENABLED
+    // 顺时针放大预览，逆时针缩小；1x时逆时针返回主菜单
+    if (direction == ROTATION_CW) {
+        previewZoomIn();
+        return;
+    }
+    if (direction == ROTATION_CCW && previewZoomOut()) {
+        return;
+    }
+#endif
     // 拍视频功能中旋转编码器用于返回主菜单
     Utils_Logger::info("拍视频模式：检测到编码器旋转，返回主菜单");
     TaskManager::setEvent(EVENT_RETURN_TO_MENU);
@@ -207,6 +233,9 @@ void taskFunctionB(void* pvParameters) {
     Utils_Logger::info("初始化视频录制器...");
     videoRecorderInit();
     
+    // 启动预录缓存（录制通道和音频在预览期间保持运行）
+    startPreEventCapture();
+    
     // 设置编码器回调函数
     encoder.setRotationCallback(captureVideoHandleEncoderRotation);
     encoder.setButtonCallback(captureVideoHandleEncoderButton);
@@ -233,7 +262,8 @@ void taskFunctionB(void* pvParameters) {
         // 根据当前状态执行不同的处理
         switch (g_recorderState) {
             case REC_IDLE:
-                // 空闲状态：只处理预览帧
+                // 空闲状态：处理预览帧，预录开启时把音频块存入预录缓冲区
+                videoRecorderLoop();
                 processPreviewFrame();
                 break;
             case REC_RECORDING:
@@ -263,6 +293,9 @@ void taskFunctionB(void* pvParameters) {
         stopVideoRecording();
     }
     
+    // 停止预录缓存，释放录制通道和缓冲区
+    stopPreEventCapture();
+    
     // 清理视频录制器资源（关键修复！）
     videoRecorderCleanup();
     
@@ -441,14 +474,13 @@ void taskParamSettings(void* pvParameters) {
     
     extern Display_TFTManager tftManager;
     extern Display_FontRenderer fontRenderer;
-    extern JPEGDEC jpeg;
     extern CameraManager cameraManager;
     extern EncoderControl encoder;
     extern MenuContext menuContext;
     
     if (!cameraManager.isInitialized()) {
         Utils_Logger::info("相机管理器未初始化，正在重新初始化...");
-        if (!cameraManager.init(tftManager, fontRenderer, jpeg)) {
+        if (!cameraManager.init(tftManager, fontRenderer)) {
             Utils_Logger::error("相机管理器重新初始化失败");
             vTaskDelete(NULL);
             return;
@@ -909,8 +941,8 @@ void taskAudioProcessing(void* params) {
     size_t accumulatedSamples = 0;
     
     while (1) {
-        // 只有在录制状态下才处理音频数据
-        if (g_recorderState != REC_RECORDING) {
+        // 只有在录制状态（或预录开启的空闲状态）下才处理音频数据
+        if (g_recorderState != REC_RECORDING && !(g_recorderState == REC_IDLE && isPreEventArmed())) {
             vTaskDelay(10 / portTICK_PERIOD_MS);
             continue;
         }
@@ -971,14 +1003,15 @@ void taskVideoFrameCapture(void* params) {
     Utils_Logger::info("视频帧获取任务 %c 启动 - 优先级: %d", 
         (char)('A' + taskId), uxTaskPriorityGet(NULL));
     
-    extern MJPEGEncoder mjpegEncoder;
     const uint32_t VIDEO_CHANNEL_RECORD = 0;
     const unsigned long FRAME_INTERVAL = 67;
     unsigned long lastFrameTime = 0;
     uint32_t frameCount = 0;
     
     while (1) {
-        if (g_recorderState != REC_RECORDING) {
+        // 预录开启时空闲状态也持续取帧，存入预录缓冲区
+        bool recording = (g_recorderState == REC_RECORDING);
+        if (!recording && !(g_recorderState == REC_IDLE && isPreEventArmed())) {
             vTaskDelay(10 / portTICK_PERIOD_MS);
             lastFrameTime = 0;
             frameCount = 0;
@@ -991,15 +1024,22 @@ void taskVideoFrameCapture(void* params) {
             uint32_t imgAddr;
             uint32_t imgLen;
             
+            // 上一帧负载直接从VOE帧缓冲写盘，下一次getImage()会回收该缓冲，必须等直写完成
+            // 采集因此受SD卡写入延迟节拍限制；超时说明写入任务仍在读取该缓冲，本周期不取帧
+            if (!waitRecordFrameWritten()) {
+                lastFrameTime = currentTime;
+                Utils_Logger::error("视频帧获取: 上一帧仍在写入，跳过本周期");
+                vTaskDelay(1 / portTICK_PERIOD_MS);
+                continue;
+            }
             Camera.getImage(VIDEO_CHANNEL_RECORD, &imgAddr, &imgLen);
             
             lastFrameTime = currentTime;
             
             if (imgLen > 0) {
-                mjpegEncoder.addVideoFrame((uint8_t*)imgAddr, imgLen, currentTime);
-                frameCount++;
+                submitRecordChunk(PREEVENT_CHUNK_VIDEO, (uint8_t*)imgAddr, imgLen, currentTime);
                 
-                if (frameCount % 15 == 0) {
+                if (recording && ++frameCount % 15 == 0) {
                     Utils_Logger::info("视频帧获取: %d 帧", frameCount);
                 }
             }
@@ -1016,6 +1056,100 @@ void taskVideoFrameCapture(void* params) {
     vTaskDelete(NULL);
 }
 
+/**
+ * AVI写入任务 (TASK_AVI_WRITER)
+ * 优先级: 3 (低于视频帧获取和音频处理任务，SD卡写入不阻塞采集)
+ * 功能: 从共享写队列取出写满的录制缓冲区并写入SD卡文件
+ * 注意: 任务创建后常驻，不在停止录制时删除，避免删除时持有文件系统锁或已出队的写请求；
+ *       需要放弃写入器时先用AVIStreamWriter::pauseWriteTask()等待任务空闲
+ */
+void taskAviWriter(void* params) {
+    TaskFactory::TaskParams* taskParams = static_cast<TaskFactory::TaskParams*>(params);
+    uint32_t taskId = (taskParams != NULL) ? taskParams->param1 : 0;
+    
+    Utils_Logger::info("AVI写入任务 %c 启动 - 优先级: %d", 
+        (char)('A' + taskId), uxTaskPriorityGet(NULL));
+    
+    if (!AVIStreamWriter::initWriteQueue()) {
+        Utils_Logger::error("AVI写队列初始化失败，任务退出");
+        if (taskParams != NULL) {
+            delete taskParams;
+        }
+        vTaskDelete(NULL);
+        return;
+    }
+    
+    while (1) {
+        AVIStreamWriter::processWriteQueue(100);
+    }
+    
+    if (taskParams != NULL) {
+        delete taskParams;
+    }
+    
+    Utils_Logger::info("AVI写入任务 %c 退出", (char)('A' + taskId));
+    vTaskDelete(NULL);
+}
+
+/**
+ * 循环录制分段收尾任务 (TASK_LOOP_FINALIZER)
+ * 优先级: 2 (低于采集和写入任务，切换期间采集任务继续向当前分段写帧)
+ * 功能: 分段到时后打开新分段并切换，再结束旧分段、删除最早的分段
+ * 注意: 任务创建后常驻，不在停止录制时删除，避免删除时持有分段切换锁
+ */
+void taskLoopFinalizer(void* params) {
+    TaskFactory::TaskParams* taskParams = static_cast<TaskFactory::TaskParams*>(params);
+    uint32_t taskId = (taskParams != NULL) ? taskParams->param1 : 0;
+    
+    Utils_Logger::info("分段收尾任务 %c 启动 - 优先级: %d", 
+        (char)('A' + taskId), uxTaskPriorityGet(NULL));
+    
+    extern MJPEGLoopRecorder loopRecorder;
+    
+    while (1) {
+        loopRecorder.service(100);
+    }
+    
+    if (taskParams != NULL) {
+        delete taskParams;
+    }
+    
+    Utils_Logger::info("分段收尾任务 %c 退出", (char)('A' + taskId));
+    vTaskDelete(NULL);
+}
+
+/**
+ * 回放预取任务 (TASK_PLAYBACK_READER)
+ * 优先级: 3 (高于回放任务，读卡等待期间回放任务继续解码显示)
+ * 功能: 按帧索引把后续视频帧读入预取帧缓冲池，并补充回放音频缓冲
+ * 注意: 任务创建后常驻，停止回放时由预取器等待当前读取完成，不删除任务，避免删除时持有文件系统锁
+ */
+void taskPlaybackReader(void* params) {
+    TaskFactory::TaskParams* taskParams = static_cast<TaskFactory::TaskParams*>(params);
+    uint32_t taskId = (taskParams != NULL) ? taskParams->param1 : 0;
+    
+    Utils_Logger::info("回放预取任务 %c 启动 - 优先级: %d", 
+        (char)('A' + taskId), uxTaskPriorityGet(NULL));
+    
+    extern MJPEGPlaybackPrefetcher playbackPrefetcher;
+    extern MJPEGPlaybackAudio playbackAudio;
+    
+    while (1) {
+        // 音频块与视频帧在同一任务中读取，文件访问不会交错；预取不可用时音频由播放循环补充
+        if (playbackPrefetcher.isActive()) {
+            playbackAudio.service();
+        }
+        playbackPrefetcher.service(100);
+    }
+    
+    if (taskParams != NULL) {
+        delete taskParams;
+    }
+    
+    Utils_Logger::info("回放预取任务 %c 退出", (char)('A' + taskId));
+    vTaskDelete(NULL);
+}
+
 bool TaskFactory::isValidTaskID(TaskManager::TaskID id) {
     return (id >= 0 && id < TaskManager::TASK_MAX);
 }
\ No newline at end of file
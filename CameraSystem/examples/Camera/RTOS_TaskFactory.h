@@ -103,5 +103,8 @@ extern void taskFunctionE(void* pvParameters);
 extern void taskSystemSettings(void* pvParameters);
 extern void taskAudioProcessing(void* pvParameters);
 extern void taskVideoFrameCapture(void* pvParameters);
+extern void taskAviWriter(void* pvParameters);
+extern void taskLoopFinalizer(void* pvParameters);
+extern void taskPlaybackReader(void* pvParameters);
 
 #endif // RTOS_TASKFACTORY_H
\ No newline at end of file
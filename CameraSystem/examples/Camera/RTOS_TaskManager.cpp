@@ -113,6 +113,33 @@ void TaskManager::initTaskInfos() {
     taskInfos[TASK_VIDEO_FRAME_CAPTURE].handle = NULL;
     taskInfos[TASK_VIDEO_FRAME_CAPTURE].state = TASK_STATE_INACTIVE;
     
+    // AVI写入任务（把录制写缓冲区落盘到SD卡）
+    taskInfos[TASK_AVI_WRITER].id = TASK_AVI_WRITER;
+    taskInfos[TASK_AVI_WRITER].name = "AVIWriter";
+    taskInfos[TASK_AVI_WRITER].function = taskAviWriter;
+    taskInfos[TASK_AVI_WRITER].stackSize = 4096;
+    taskInfos[TASK_AVI_WRITER].priority = 3;
+    taskInfos[TASK_AVI_WRITER].handle = NULL;
+    taskInfos[TASK_AVI_WRITER].state = TASK_STATE_INACTIVE;
+    
+    // 循环录制分段收尾任务（切换分段、结束旧分段并执行保留策略）
+    taskInfos[TASK_LOOP_FINALIZER].id = TASK_LOOP_FINALIZER;
+    taskInfos[TASK_LOOP_FINALIZER].name = "LoopFinalizer";
+    taskInfos[TASK_LOOP_FINALIZER].function = taskLoopFinalizer;
+    taskInfos[TASK_LOOP_FINALIZER].stackSize = 4096;
+    taskInfos[TASK_LOOP_FINALIZER].priority = 2;
+    taskInfos[TASK_LOOP_FINALIZER].handle = NULL;
+    taskInfos[TASK_LOOP_FINALIZER].state = TASK_STATE_INACTIVE;
+    
+    // 回放预取任务（提前读入后续视频帧）
+    taskInfos[TASK_PLAYBACK_READER].id = TASK_PLAYBACK_READER;
+    taskInfos[TASK_PLAYBACK_READER].name = "PlaybackReader";
+    taskInfos[TASK_PLAYBACK_READER].function = taskPlaybackReader;
+    taskInfos[TASK_PLAYBACK_READER].stackSize = 4096;
+    taskInfos[TASK_PLAYBACK_READER].priority = 3;
+    taskInfos[TASK_PLAYBACK_READER].handle = NULL;
+    taskInfos[TASK_PLAYBACK_READER].state = TASK_STATE_INACTIVE;
+    
     for (uint32_t i = 0; i < TASK_MAX; i++) {
         taskParams[i] = NULL;
     }
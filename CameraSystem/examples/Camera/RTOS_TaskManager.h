@@ -22,6 +22,9 @@ public:
         TASK_TIME_SYNC = 6,
         TASK_AUDIO_PROCESSING = 7,
         TASK_VIDEO_FRAME_CAPTURE = 8,
+        TASK_AVI_WRITER = 9,
+        TASK_LOOP_FINALIZER = 10,
+        TASK_PLAYBACK_READER = 11,
         TASK_MAX
     } TaskID;
 
@@ -11,8 +11,8 @@
 // 系统版本号定义
 // ===============================================
 #define SYSTEM_VERSION_MAJOR 1
-#define SYSTEM_VERSION_MINOR 48
-#define SYSTEM_VERSION_STRING "V1.48"
+#define SYSTEM_VERSION_MINOR 88
+#define SYSTEM_VERSION_STRING "V1.88"
 
 // ===============================================
 // 音频录制配置
@@ -23,6 +23,53 @@
 #define AUDIO_BITS_PER_SAMPLE 16  // 16位采样
 #define AUDIO_FRAME_SIZE 2048     // 音频帧大小(采样数)
 
+// ===============================================
+// 视频录制存储配置
+// ===============================================
+#define VIDEO_PREALLOCATE_ENABLED 1    // 录制文件预分配连续簇（f_expand），结束时截断到实际大小
+#define VIDEO_PREALLOCATE_SECONDS VIDEO_LOOP_SEGMENT_SECONDS // 按一个分段时长预分配（受AVI_PREALLOC_MAX_BYTES限制），超出后按普通方式扩展
+#define VIDEO_AUDIO_ADPCM_ENABLED 1    // 音频流使用IMA-ADPCM（约8KB/s），0为16位PCM（32KB/s）
+
+// 循环分段录制（行车记录仪模式）
+#define VIDEO_LOOP_RECORDING_ENABLED 0 // 1: 录制按固定时长分段并自动删除最早分段
+#define VIDEO_LOOP_SEGMENT_SECONDS 180 // 分段时长（秒），可选60/180/300
+#define VIDEO_LOOP_MIN_FREE_MB 512     // 剩余空间低于该值（MB）时删除最早的分段
+#define VIDEO_LOOP_MAX_SEGMENTS 0      // 最多保留的分段数，0表示只按剩余空间限制
+
+// 预录缓冲区
+#define VIDEO_PREEVENT_ENABLED 0       // 预录：空闲预览时缓存录制通道数据，开始录制时一并写入文件开头（开启后空闲时录制通道、采集任务、麦克风和预录缓冲区常驻）
+#define VIDEO_PREEVENT_SECONDS 5       // 预录时长（秒）
+#define VIDEO_PREEVENT_BUFFER_SIZE (8 * 1024 * 1024) // 预录缓冲区大小（720p约80KB/帧 x 15fps x 5s）
+#define VIDEO_PREEVENT_DRAIN_BUDGET_MS 30 // 录制开始后每个视频帧周期内写出积压数据的时间预算
+#define VIDEO_PREEVENT_STOP_DRAIN_MS 1000 // 停止录制时在UI任务中写出剩余积压数据的最长时间，超时未写出的末尾数据丢弃
+
+// 回放预取
+#define VIDEO_PLAYBACK_PREFETCH_ENABLED 1 // 回放时由读取任务提前读入后续帧，解码显示不等待SD卡
+#define VIDEO_PLAYBACK_PREFETCH_FRAMES 6  // 预取帧数（每帧缓冲按文件中最大帧分配）
+#define VIDEO_PLAYBACK_SCALE_FALLBACK 1   // 解码持续跟不上时改为1/8比例解码（2倍放大显示），负载恢复后切回1/4
+
+// 回放音频
+#define VIDEO_PLAYBACK_AUDIO_ENABLED 1      // 正常速度回放时经I2S TX输出音频，并以音频为主时钟同步视频
+#define VIDEO_PLAYBACK_AUDIO_BUFFER_MS 1000 // 回放音频缓冲时长（预填一半后开始输出，吸收SD卡读取延迟）
+#define VIDEO_PLAYBACK_DECODE_SLICE_ROWS 8   // 回放每解码该数量的MCU行补充一次音频缓冲（无预取任务时），0为整帧一次解码
+
+// JPEG解码
+#define JPEG_DSP_SELFTEST_ENABLED 0 // 1: 启动时比较JPEGDEC的DSP内核（IDCT输出限幅、YCbCr转RGB565）与C实现并记录周期数（会打开DWT周期计数器）
+#define JPEG_TABLE_REUSE_BENCH_FRAMES 0 // 进入拍照预览后交替强制重建/复用哈夫曼表各该帧数，记录每帧open()平均耗时，0为关闭
+#define JPEG_DECODER_POOL_SIZE 2            // 解码器池中的解码上下文数量（每个约18KB），前台预览/回放与后台缩略图可同时解码
+#define JPEG_DECODER_ACQUIRE_TIMEOUT_MS 100 // 借用解码器的默认等待时间（毫秒）
+
+// 预览数字变焦（只解码屏幕上可见区域的MCU）
+#define PREVIEW_ZOOM_ENABLED 1       // 拍照/拍视频预览中编码器顺时针放大、逆时针缩小，1x时逆时针返回主菜单
+#define PREVIEW_ZOOM_MAX_LEVEL 4     // 最大变焦倍数（1x/2x/4x）
+#define PREVIEW_ZOOM_STATS_FRAMES 30 // 切换倍数后统计该帧数的平均解码耗时并记录日志
+#define PREVIEW_DECODE_SLICE_ROWS 4   // 拍照预览每次循环最多解码的MCU行数（分片间处理编码器输入），0为整帧一次解码
+#define PREVIEW_DIRECT_DMA_ENABLED 1  // 输出正好铺满预览区域时（1x），解码器直接输出大端RGB565到屏幕DMA缓冲区，省去清屏、回调拷贝和字节序转换
+
+// 菜单界面显示
+#define DISPLAY_SHADOW_FB_ENABLED 1   // 菜单绘制先写入RAM中的整屏影子帧缓冲区（150KB），与原内容比较后只把变化的矩形经DMA发送到屏幕
+#define MENU_BG_BENCH_ENABLED 0       // 菜单管理器初始化时比较主菜单背景图未压缩（RAM源）与RLE压缩（Flash源）两种绘制方式的耗时和数据大小并记录日志
+
 // ===============================================
 // TFT屏幕引脚定义
 // ===============================================
@@ -0,0 +1,144 @@
+/*
+ * Utils_JpegDecoderPool.cpp - JPEG解码器池实现
+ * 管理固定数量的JPEGDEC解码上下文，按借出/归还使用，不同任务可同时解码（如预览解码时后台生成缩略图）
+ * 解码输出通过每个上下文的用户指针（JpegFrameTarget）写入调用者自己的帧缓冲区，不依赖文件级静态变量
+ */
+
+#include "Utils_JpegDecoderPool.h"
+#include "Utils_Logger.h"
+
+// 静态成员初始化
+JPEGDEC Utils_JpegDecoderPool::decoders[POOL_SIZE];
+bool Utils_JpegDecoderPool::inUse[POOL_SIZE];
+const char* Utils_JpegDecoderPool::lastOwner[POOL_SIZE];
+SemaphoreHandle_t Utils_JpegDecoderPool::freeSlots = nullptr;
+SemaphoreHandle_t Utils_JpegDecoderPool::lock = nullptr;
+bool Utils_JpegDecoderPool::initialized = false;
+
+bool Utils_JpegDecoderPool::init() {
+    if (initialized) {
+        return true;
+    }
+
+    freeSlots = xSemaphoreCreateCounting(POOL_SIZE, POOL_SIZE);
+    lock = xSemaphoreCreateMutex();
+    if (freeSlots == nullptr || lock == nullptr) {
+        Utils_Logger::error("JPEG解码器池信号量创建失败");
+        return false;
+    }
+    for (int i = 0; i < POOL_SIZE; i++) {
+        inUse[i] = false;
+        lastOwner[i] = nullptr;
+    }
+    initialized = true;
+
+    Utils_Logger::info("JPEG解码器池初始化完成，解码器数: %d，每个%d字节", POOL_SIZE, (int)sizeof(JPEGDEC));
+    return true;
+}
+
+JPEGDEC* Utils_JpegDecoderPool::acquire(const char* owner, uint32_t timeoutMs) {
+    if (!initialized) {
+        Utils_Logger::error("JPEG解码器池未初始化");
+        return nullptr;
+    }
+    if (xSemaphoreTake(freeSlots, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        return nullptr;
+    }
+
+    // 计数信号量保证至少有一个空闲解码器
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = -1;
+    for (int i = 0; i < POOL_SIZE; i++) {
+        if (inUse[i]) {
+            continue;
+        }
+        if (slot < 0) {
+            slot = i;
+        }
+        if (owner != nullptr && lastOwner[i] != nullptr && strcmp(lastOwner[i], owner) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    inUse[slot] = true;
+    lastOwner[slot] = owner;
+    xSemaphoreGive(lock);
+
+    return &decoders[slot];
+}
+
+void Utils_JpegDecoderPool::release(JPEGDEC* decoder) {
+    if (!initialized || decoder == nullptr) {
+        return;
+    }
+
+    int slot = decoder - decoders;
+    if (slot < 0 || slot >= POOL_SIZE) {
+        Utils_Logger::error("归还的JPEG解码器不属于解码器池: %p", decoder);
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool wasInUse = inUse[slot];
+    inUse[slot] = false;
+    xSemaphoreGive(lock);
+
+    if (!wasInUse) {
+        Utils_Logger::error("JPEG解码器%d重复归还", slot);
+        return;
+    }
+    decoder->setUserPointer(nullptr);
+    xSemaphoreGive(freeSlots);
+}
+
+int Utils_JpegDecoderPool::getFreeCount() {
+    if (!initialized) {
+        return 0;
+    }
+    return (int)uxSemaphoreGetCount(freeSlots);
+}
+
+int Utils_JpegDecoderPool::drawToFrameTarget(JPEGDRAW* pDraw) {
+    JpegFrameTarget* target = (JpegFrameTarget*)pDraw->pUser;
+    if (target == nullptr || target->pixels == nullptr) {
+        return 0;  // 没有设置解码目标，停止解码
+    }
+    drawBlock(pDraw, target->pixels, target->width, target->height, target->upscale);
+    target->ready = true;
+    return 1;
+}
+
+void Utils_JpegDecoderPool::drawBlock(const JPEGDRAW* pDraw, uint16_t* frameBuffer, int fbWidth, int fbHeight, int upscale) {
+    // 块在帧缓冲区中的范围
+    int x = pDraw->x * upscale;
+    int y = pDraw->y * upscale;
+    int x0 = (x < 0) ? 0 : x;
+    int y0 = (y < 0) ? 0 : y;
+    int x1 = x + pDraw->iWidthUsed * upscale;
+    int y1 = y + pDraw->iHeight * upscale;
+    if (x1 > fbWidth) {
+        x1 = fbWidth;
+    }
+    if (y1 > fbHeight) {
+        y1 = fbHeight;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    if (upscale == 1) {
+        for (int row = y0; row < y1; row++) {
+            memcpy(&frameBuffer[row * fbWidth + x0], &pDraw->pPixels[(row - y) * pDraw->iWidth + (x0 - x)],
+                   (x1 - x0) * sizeof(uint16_t));
+        }
+        return;
+    }
+
+    for (int row = y0; row < y1; row++) {
+        const uint16_t* src = &pDraw->pPixels[((row - y) / upscale) * pDraw->iWidth];
+        uint16_t* dst = &frameBuffer[row * fbWidth];
+        for (int col = x0; col < x1; col++) {
+            dst[col] = src[(col - x) / upscale];
+        }
+    }
+}
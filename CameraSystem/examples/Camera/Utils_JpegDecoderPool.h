@@ -0,0 +1,56 @@
+/*
+ * Utils_JpegDecoderPool.h - JPEG解码器池头文件
+ * 管理固定数量的JPEGDEC解码上下文，按借出/归还使用，不同任务可同时解码（如预览解码时后台生成缩略图）
+ * 解码输出通过每个上下文的用户指针（JpegFrameTarget）写入调用者自己的帧缓冲区，不依赖文件级静态变量
+ */
+
+#ifndef UTILS_JPEG_DECODER_POOL_H
+#define UTILS_JPEG_DECODER_POOL_H
+
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <JPEGDEC.h>
+#include "Shared_GlobalDefines.h"
+
+// 帧缓冲区解码目标：decoder->setUserPointer(&target)后用drawToFrameTarget作为绘制回调
+typedef struct {
+    uint16_t* pixels;   // 帧缓冲区
+    int width;          // 帧缓冲区宽度（像素）
+    int height;         // 帧缓冲区高度（像素）
+    int upscale;        // 像素复制倍数（1为不放大）
+    bool ready;         // 已写入至少一个块
+} JpegFrameTarget;
+
+class Utils_JpegDecoderPool {
+public:
+    // 初始化解码器池（创建信号量）
+    static bool init();
+
+    // 借出一个空闲解码器，timeoutMs内没有空闲时返回nullptr
+    // 优先借出上次由同一owner归还的解码器，连续解码同类帧时保留其哈夫曼表
+    static JPEGDEC* acquire(const char* owner, uint32_t timeoutMs = JPEG_DECODER_ACQUIRE_TIMEOUT_MS);
+
+    // 归还解码器（清除用户指针）
+    static void release(JPEGDEC* decoder);
+
+    // 当前空闲的解码器数量
+    static int getFreeCount();
+
+    // 通用绘制回调：把JPEGDRAW块写入pDraw->pUser指向的JpegFrameTarget
+    static int drawToFrameTarget(JPEGDRAW* pDraw);
+
+    // 把JPEGDRAW块写入帧缓冲区：块坐标可为负，超出缓冲区的部分裁掉，upscale>1时按倍数复制像素
+    static void drawBlock(const JPEGDRAW* pDraw, uint16_t* frameBuffer, int fbWidth, int fbHeight, int upscale);
+
+private:
+    static const int POOL_SIZE = JPEG_DECODER_POOL_SIZE;
+    static JPEGDEC decoders[POOL_SIZE];
+    static bool inUse[POOL_SIZE];
+    static const char* lastOwner[POOL_SIZE];
+    static SemaphoreHandle_t freeSlots;  // 计数信号量：空闲解码器数量
+    static SemaphoreHandle_t lock;       // 保护inUse/lastOwner
+    static bool initialized;
+};
+
+#endif // UTILS_JPEG_DECODER_POOL_H
@@ -11,6 +11,14 @@
 #include "JPEGDEC.h"
 #include "Encoder_Control.h"
 #include "MJPEG_Encoder.h"
+#include "MJPEG_AVIRecovery.h"
+#include "MJPEG_LoopRecorder.h"
+#include "MJPEG_PreEventBuffer.h"
+#include "MJPEG_PlaybackPrefetch.h"
+#include "MJPEG_PlaybackAudio.h"
+#include "MJPEG_PlaybackGovernor.h"
+#include "Camera_PreviewZoom.h"
+#include "Utils_JpegDecoderPool.h"
 #include "Shared_GlobalDefines.h"
 #include "Inmp441_MicrophoneManager.h"
 #include "RTOS_TaskFactory.h"
@@ -18,7 +26,6 @@
 
 // 外部对象引用
 extern Display_TFTManager tftManager;
-extern JPEGDEC jpeg;
 extern EncoderControl encoder;
 
 // 媒体文件列表最大数量（定义在文件顶部，确保所有函数可用）
@@ -30,6 +37,11 @@ void cleanupThumbnailCacheItems(uint32_t count);
 void cleanupExcessThumbnailCache(void);
 bool initThumbnailCache(uint32_t size);
 bool resizeThumbnailCache(uint32_t newSize);
+static bool writeRecordChunk(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp);
+static void releaseHeldFrame(void);
+static void restartPlaybackFrom(uint32_t nextFrame);
+static void syncPlaybackAudio(uint32_t frameIndex);
+static void stopPlaybackAudio(void);
 
 // 全局变量声明
 extern uint32_t currentVideoIndex;
@@ -74,6 +86,19 @@ VideoSetting configVPreview(VIDEO_VGA, 15, VIDEO_JPEG, 1); // snapshot=1表示
 // MJPEG编码器对象
 MJPEGEncoder mjpegEncoder;
 
+// 循环分段录制器（开启时代替mjpegEncoder接收音视频帧）
+MJPEGLoopRecorder loopRecorder;
+static bool s_loopRecordingEnabled = (VIDEO_LOOP_RECORDING_ENABLED != 0);
+
+// 录制音频编码格式
+#define VIDEO_AUDIO_CODEC (VIDEO_AUDIO_ADPCM_ENABLED ? AVI_AUDIO_IMA_ADPCM : AVI_AUDIO_PCM)
+
+// 预录缓冲区：空闲预览期间录制通道和音频保持运行，数据缓存在内存中
+MJPEGPreEventBuffer preEventBuffer;
+static bool s_preEventArmed = false;
+static bool s_recordInputPaused = false;          // 结束录制期间暂停接收采集数据
+static SemaphoreHandle_t s_recordInputLock = nullptr; // 采集任务提交数据与结束录制互斥
+
 // 录制状态跟踪
 bool updatemodifiedtime = false;
 char recordingFileName[128];
@@ -114,7 +139,8 @@ static int JPEGDraw(JPEGDRAW *pDraw) {
 #define PREVIEW_FB_HEIGHT  240
 
 static uint16_t s_previewFrameBuffer[PREVIEW_FB_WIDTH * PREVIEW_FB_HEIGHT];
-static bool s_previewFrameReady = false;
+static JpegFrameTarget s_previewTarget = { s_previewFrameBuffer, PREVIEW_FB_WIDTH, PREVIEW_FB_HEIGHT, 1, false };
+static CameraPreviewZoom s_previewZoom;   // 预览数字变焦（只解码可见区域）
 
 // ============================================
 // 视频回放帧缓冲区系统（高性能回放，整帧一次DMA传输）
@@ -124,65 +150,8 @@ static bool s_previewFrameReady = false;
 #define PLAYBACK_FB_HEIGHT  180
 
 static uint16_t s_playbackFrameBuffer[PLAYBACK_FB_WIDTH * PLAYBACK_FB_HEIGHT];
-static bool s_playbackFrameReady = false;
-
-static int JPEGDrawForPlayback(JPEGDRAW *pDraw) {
-    int x = pDraw->x;
-    int y = pDraw->y;
-    int width = pDraw->iWidth;
-    int height = pDraw->iHeight;
-
-    if (x >= PLAYBACK_FB_WIDTH) return 1;
-    if (y >= PLAYBACK_FB_HEIGHT) return 1;
-    if (x < 0) { width += x; x = 0; }
-    if (width <= 0 || height <= 0) return 1;
-
-    int drawWidth = width;
-    int drawHeight = height;
-    if (x + drawWidth > PLAYBACK_FB_WIDTH) drawWidth = PLAYBACK_FB_WIDTH - x;
-    if (y + drawHeight > PLAYBACK_FB_HEIGHT) drawHeight = PLAYBACK_FB_HEIGHT - y;
-
-    for (int row = 0; row < drawHeight; row++) {
-        int srcOffset = row * width;
-        int dstOffset = (y + row) * PLAYBACK_FB_WIDTH + x;
-        for (int col = 0; col < drawWidth; col++) {
-            s_playbackFrameBuffer[dstOffset + col] = pDraw->pPixels[srcOffset + col];
-        }
-    }
-
-    s_playbackFrameReady = true;
-    return 1;
-}
-
-// 视频预览专用JPEGDraw回调 - 将MCU块写入帧缓冲区
-static int JPEGDrawForPreview(JPEGDRAW *pDraw) {
-    int x = pDraw->x;
-    int y = pDraw->y;
-    int width = pDraw->iWidth;
-    int height = pDraw->iHeight;
-    
-    if (x >= PREVIEW_FB_WIDTH) return 1;
-    if (y >= PREVIEW_FB_HEIGHT) return 1;
-    
-    if (x < 0) { width += x; x = 0; }
-    if (width <= 0 || height <= 0) return 1;
-    
-    int drawWidth = width;
-    int drawHeight = height;
-    if (x + drawWidth > PREVIEW_FB_WIDTH) drawWidth = PREVIEW_FB_WIDTH - x;
-    if (y + drawHeight > PREVIEW_FB_HEIGHT) drawHeight = PREVIEW_FB_HEIGHT - y;
-    
-    for (int row = 0; row < drawHeight; row++) {
-        int srcOffset = row * width;
-        int dstOffset = (y + row) * PREVIEW_FB_WIDTH + x;
-        for (int col = 0; col < drawWidth; col++) {
-            s_previewFrameBuffer[dstOffset + col] = pDraw->pPixels[srcOffset + col];
-        }
-    }
-    
-    s_previewFrameReady = true;
-    return 1;
-}
+// 拖动时以1/8缩放快速解码，upscale为2按像素复制铺满回放区域
+static JpegFrameTarget s_playbackTarget = { s_playbackFrameBuffer, PLAYBACK_FB_WIDTH, PLAYBACK_FB_HEIGHT, 1, false };
 
 // 格式化时间戳
 void formatTimeStamp(char* buffer, uint32_t bufferSize, const DS3231_Time& time) {
@@ -219,6 +188,14 @@ void videoRecorderInit(void) {
         // Utils_Logger::info("SD card already initialized");
     }
     
+    // 修复上次断电/复位时未正常结束的录像（以残留的.idx临时索引文件为标记）
+    if (sdCardManager.isInitialized()) {
+        uint32_t recovered = AVIRecovery::recoverUnfinishedRecordings();
+        if (recovered > 0) {
+            Utils_Logger::info("Recovered %d unfinished recording(s)", recovered);
+        }
+    }
+    
     // 配置相机视频通道
     // Utils_Logger::info("Configuring Camera Video Channels...");
     // 配置录制通道（JPEG编码）
@@ -234,6 +211,7 @@ void videoRecorderInit(void) {
     // 启动预览通道，确保idle状态下也能显示预览画面
     // Utils_Logger::info("Starting Preview Channel...");
     Camera.channelBegin(VIDEO_CHANNEL_PREVIEW);
+    s_previewZoom.reset();
     
     // 在 channelBegin() 之后应用 ISP 参数，确保 VOE 完全就绪
     cameraManager.applyISPSettings();
@@ -289,29 +267,52 @@ void startVideoRecording(void) {
     // 复制文件名用于后续使用
     strncpy(recordingFileName, fileName, sizeof(recordingFileName));
     
-    // 启动MJPEG录制（先初始化编码器）
-    if (!mjpegEncoder.begin(fileName, 1280, 720, 15)) {
-        Utils_Logger::error("Failed to start MJPEG encoder");
-        return;
+    // 先创建AVI写入任务，录制数据经写缓冲区由该任务流式落盘（任务常驻，已存在时直接复用）
+    TaskManager::createTask(TaskManager::TASK_AVI_WRITER);
+    
+    if (s_loopRecordingEnabled) {
+        // 循环录制：分段文件名由录制器生成，收尾任务负责分段切换
+        TaskManager::createTask(TaskManager::TASK_LOOP_FINALIZER);
+        if (!loopRecorder.begin(1280, 720, 15, VIDEO_AUDIO_CODEC)) {
+            Utils_Logger::error("Failed to start loop recorder");
+            return;
+        }
+        strncpy(recordingFileName, loopRecorder.getCurrentFileName(), sizeof(recordingFileName));
+    } else {
+        // 按预估码率预分配连续簇，减少持续写入时的FAT链查找和扩展
+        mjpegEncoder.setPreallocateSeconds(VIDEO_PREALLOCATE_ENABLED ? VIDEO_PREALLOCATE_SECONDS : 0);
+        
+        // 启动MJPEG录制（先初始化编码器）
+        if (!mjpegEncoder.begin(fileName, 1280, 720, 15, VIDEO_AUDIO_CODEC)) {
+            Utils_Logger::error("Failed to start MJPEG encoder");
+            return;
+        }
+    }
+    
+    // 预录已就绪：采集任务已在运行，缓存的数据作为文件开头写出
+    if (s_preEventArmed) {
+        preEventBuffer.beginDrain();
     }
     
     // 先更新录制状态，确保音频处理任务创建后能正确检测状态
     g_recorderState = REC_RECORDING;
     updatemodifiedtime = false;
     
-    // 启动视频通道（先启动视频，确保视频帧开始采集）
-    Camera.channelBegin(VIDEO_CHANNEL_RECORD);
-    
-    // 创建视频帧获取RTOS任务（优先级5，高于音频处理任务的优先级4）
-    TaskManager::createTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
-    // Utils_Logger::info("Video frame capture RTOS task created (priority 5)");
-    
-    // 启动音频采集（在视频通道启动后再启动音频，确保同步开始）
-    if (!g_microphoneManager.startAVIRecording()) {
-        Utils_Logger::info("Audio recording init failed, continuing with video only");
-    } else {
-        TaskManager::createTask(TaskManager::TASK_AUDIO_PROCESSING);
-        // Utils_Logger::info("Audio processing RTOS task created (priority 4)");
+    if (!s_preEventArmed) {
+        // 启动视频通道（先启动视频，确保视频帧开始采集）
+        Camera.channelBegin(VIDEO_CHANNEL_RECORD);
+        
+        // 创建视频帧获取RTOS任务（优先级5，高于音频处理任务的优先级4）
+        TaskManager::createTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
+        // Utils_Logger::info("Video frame capture RTOS task created (priority 5)");
+        
+        // 启动音频采集（在视频通道启动后再启动音频，确保同步开始）
+        if (!g_microphoneManager.startAVIRecording()) {
+            Utils_Logger::info("Audio recording init failed, continuing with video only");
+        } else {
+            TaskManager::createTask(TaskManager::TASK_AUDIO_PROCESSING);
+            // Utils_Logger::info("Audio processing RTOS task created (priority 4)");
+        }
     }
     
     // 读取DS3231获取录制开始时间戳
@@ -333,33 +334,74 @@ void stopVideoRecording(void) {
     
     Utils_Logger::info("Stopping Video Recording with Audio...");
     
-    // 先停止视频通道（确保视频采集停止）
-    Camera.channelEnd(VIDEO_CHANNEL_RECORD);
-    
-    // 删除视频帧获取RTOS任务
-    TaskManager::deleteTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
-    // Utils_Logger::info("Video frame capture RTOS task deleted");
-    
-    // 删除音频处理RTOS任务（停止音频采集）
-    TaskManager::deleteTask(TaskManager::TASK_AUDIO_PROCESSING);
-    // Utils_Logger::info("Audio processing RTOS task deleted");
-    
-    // 不再刷新剩余音频数据，避免音画不同步
-    // 直接丢弃队列中的剩余数据，确保音视频同步结束
-    size_t queueAvailable = g_microphoneManager.getAudioQueueAvailable();
-    if (queueAvailable > 0) {
-        // Utils_Logger::info("Discarding remaining audio samples from queue: %d blocks", queueAvailable);
+    if (s_preEventArmed) {
+        // 预录模式下采集任务继续运行：暂停接收数据（等待进行中的提交完成），写出剩余积压
+        xSemaphoreTake(s_recordInputLock, portMAX_DELAY);
+        s_recordInputPaused = true;
+        xSemaphoreGive(s_recordInputLock);
+        // 积压按时间顺序写出，限时避免长时间阻塞UI；超时剩下的是录像末尾的数据，丢弃后文件仍完整
+        preEventBuffer.drain(writeRecordChunk, VIDEO_PREEVENT_STOP_DRAIN_MS);
+        if (preEventBuffer.getBufferedBytes() > 0) {
+            Utils_Logger::error("Pre-event: stop drain budget exceeded, %u KB (%u video frames) at end of recording discarded",
+                              preEventBuffer.getBufferedBytes() / 1024, preEventBuffer.getBufferedVideoFrames());
+        }
+    } else {
+        // 先停止视频通道（确保视频采集停止）
+        Camera.channelEnd(VIDEO_CHANNEL_RECORD);
+        
+        // 删除视频帧获取RTOS任务
+        TaskManager::deleteTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
+        // Utils_Logger::info("Video frame capture RTOS task deleted");
+        
+        // 删除音频处理RTOS任务（停止音频采集）
+        TaskManager::deleteTask(TaskManager::TASK_AUDIO_PROCESSING);
+        // Utils_Logger::info("Audio processing RTOS task deleted");
+        
+        // 不再刷新剩余音频数据，避免音画不同步
+        // 直接丢弃队列中的剩余数据，确保音视频同步结束
+        size_t queueAvailable = g_microphoneManager.getAudioQueueAvailable();
+        if (queueAvailable > 0) {
+            // Utils_Logger::info("Discarding remaining audio samples from queue: %d blocks", queueAvailable);
+        }
+        
+        // 停止音频采集
+        g_microphoneManager.stopAVIRecording();
     }
     
-    // 停止音频采集
-    g_microphoneManager.stopAVIRecording();
-    
     // 读取DS3231获取录制结束时间戳（在停止MJPEG录制前获取，确保时间戳准确）
     DS3231_Time endTime;
     readDS3231Time(endTime);
     
-    // 停止MJPEG录制并传递时间参数（这样在文件写入时会自动设置时间戳）
-    mjpegEncoder.end(&endTime);
+    // 停止MJPEG录制并传递时间参数（剩余缓冲落盘、回写文件头后设置时间戳）
+    // 循环录制时结束当前分段；分段收尾任务常驻，不在此删除
+    if (loopRecorder.isActive()) {
+        loopRecorder.end(&endTime);
+    } else {
+        mjpegEncoder.end(&endTime);
+    }
+    
+    // 写入器未能排空时写入任务仍持有缓冲区：任务继续落盘，两个录制器各再给一次关闭机会
+    bool writersClosed = !loopRecorder.hasOpenWriters() && !mjpegEncoder.hasOpenWriters();
+    if (!writersClosed) {
+        Utils_Logger::error("AVI writer not drained at stop, retrying close");
+        bool loopClosed = loopRecorder.retryCloseWriters();
+        bool encoderClosed = mjpegEncoder.retryCloseWriters();
+        writersClosed = loopClosed && encoderClosed;
+    }
+    
+    // AVI写入任务常驻，不在此删除（写入中可能持有文件系统锁和已出队的请求）；
+    // 仍未排空则等写入任务完成当前请求并暂停后放弃未关闭的写入器，.idx保留给下次启动时修复
+    if (!writersClosed) {
+        if (AVIStreamWriter::pauseWriteTask(AVI_WRITE_WAIT_MS)) {
+            loopRecorder.abortWriters();
+            mjpegEncoder.abortWriters();
+            AVIStreamWriter::resumeWriteTask();
+            Utils_Logger::error("AVI writer abandoned, file will be recovered at next boot: %s", recordingFileName);
+        } else {
+            // 写入任务仍卡在写卡操作中，写入器保持打开，下次begin()时再重试关闭
+            Utils_Logger::error("AVI write task busy, writer left open: %s", recordingFileName);
+        }
+    }
     
     // 打印停止录制日志
     char timeStamp[32];
@@ -370,11 +412,134 @@ void stopVideoRecording(void) {
     g_recorderState = REC_IDLE;
     updatemodifiedtime = true;
     
+    // 预录缓冲区重新开始积累下一段录制的前置数据
+    if (s_preEventArmed) {
+        Utils_Logger::info("Pre-event: %u chunks flushed, %u dropped",
+                          preEventBuffer.getFlushedChunks(), preEventBuffer.getDroppedChunks());
+        preEventBuffer.reset();
+        s_recordInputPaused = false;
+    }
+    
     // Utils_Logger::info("Video Recording with Audio Stopped and File Saved Successfully");
 }
 
+// 预录数据写出回调：写入当前录制器
+static bool writeRecordChunk(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp) {
+    if (type == PREEVENT_CHUNK_VIDEO) {
+        if (loopRecorder.isActive()) {
+            return loopRecorder.addVideoFrame(data, size, timestamp);
+        }
+        return mjpegEncoder.addVideoFrame(data, size, timestamp);
+    }
+    if (loopRecorder.isActive()) {
+        return loopRecorder.addAudioFrame(data, size, timestamp);
+    }
+    return mjpegEncoder.addAudioFrame(data, size, timestamp);
+}
+
+bool submitRecordChunk(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp) {
+    if (!s_recordInputLock || xSemaphoreTake(s_recordInputLock, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    bool ok = false;
+    if (s_recordInputPaused) {
+        ok = false;
+    } else if (g_recorderState != REC_RECORDING) {
+        // 空闲时存入预录缓冲区
+        ok = s_preEventArmed && preEventBuffer.push(type, data, size, timestamp);
+    } else if (preEventBuffer.pushIfDraining(type, data, size, timestamp)) {
+        // 预录数据尚未写完：新数据排队，由视频帧周期分批写出，避免阻塞采集
+        ok = true;
+        if (type == PREEVENT_CHUNK_VIDEO) {
+            preEventBuffer.drain(writeRecordChunk, VIDEO_PREEVENT_DRAIN_BUDGET_MS);
+        }
+    } else if (type == PREEVENT_CHUNK_VIDEO) {
+        if (loopRecorder.isActive()) {
+            // 直接写入时视频负载零拷贝，VOE帧缓冲在waitRecordFrameWritten()之后才复用
+            ok = loopRecorder.addVideoFrame(data, size, timestamp, true);
+        } else {
+            ok = mjpegEncoder.addVideoFrame(data, size, timestamp, true);
+        }
+    } else {
+        ok = writeRecordChunk(type, data, size, timestamp);
+    }
+
+    xSemaphoreGive(s_recordInputLock);
+    return ok;
+}
+
+bool waitRecordFrameWritten(void) {
+    bool ok = mjpegEncoder.waitZeroCopyWrites(AVI_WRITE_WAIT_MS);
+    return loopRecorder.waitZeroCopyWrites(AVI_WRITE_WAIT_MS) && ok;
+}
+
+bool isPreEventArmed(void) {
+    return s_preEventArmed;
+}
+
+void startPreEventCapture(void) {
+#if VIDEO_PREEVENT_ENABLED
+    if (s_preEventArmed) {
+        return;
+    }
+    if (!s_recordInputLock) {
+        s_recordInputLock = xSemaphoreCreateMutex();
+    }
+    if (!s_recordInputLock || !preEventBuffer.init(VIDEO_PREEVENT_BUFFER_SIZE, VIDEO_PREEVENT_SECONDS * 1000)) {
+        Utils_Logger::error("Pre-event buffer unavailable, recording starts without pre-roll");
+        return;
+    }
+
+    s_recordInputPaused = false;
+    s_preEventArmed = true;
+
+    // 录制通道、视频帧获取和音频任务在空闲时也保持运行
+    Camera.channelBegin(VIDEO_CHANNEL_RECORD);
+    TaskManager::createTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
+    if (g_microphoneManager.startAVIRecording()) {
+        TaskManager::createTask(TaskManager::TASK_AUDIO_PROCESSING);
+    } else {
+        Utils_Logger::info("Audio recording init failed, pre-event buffer holds video only");
+    }
+    Utils_Logger::info("Pre-event capture armed: %u s", VIDEO_PREEVENT_SECONDS);
+#endif
+}
+
+void stopPreEventCapture(void) {
+    if (!s_preEventArmed) {
+        return;
+    }
+
+    // 先暂停接收数据，并在持有输入锁期间删除采集任务：此时它们不可能正处于submitRecordChunk()内，
+    // 不会带着输入锁或预录缓冲区锁被删除，也不会有进行中的push()访问随后释放的记录区
+    xSemaphoreTake(s_recordInputLock, portMAX_DELAY);
+    s_recordInputPaused = true;
+    Camera.channelEnd(VIDEO_CHANNEL_RECORD);
+    TaskManager::deleteTask(TaskManager::TASK_VIDEO_FRAME_CAPTURE);
+    TaskManager::deleteTask(TaskManager::TASK_AUDIO_PROCESSING);
+    xSemaphoreGive(s_recordInputLock);
+    g_microphoneManager.stopAVIRecording();
+
+    s_preEventArmed = false;
+    preEventBuffer.deinit();
+    Utils_Logger::info("Pre-event capture stopped");
+}
+
+void setLoopRecordingEnabled(bool enabled) {
+    if (g_recorderState == REC_RECORDING) {
+        Utils_Logger::error("Cannot change loop recording mode while recording");
+        return;
+    }
+    s_loopRecordingEnabled = enabled;
+}
+
+bool isLoopRecordingEnabled(void) {
+    return s_loopRecordingEnabled;
+}
+
 void videoRecorderLoop(void) {
-    if (g_recorderState != REC_RECORDING) {
+    if (g_recorderState != REC_RECORDING && !(g_recorderState == REC_IDLE && s_preEventArmed)) {
         return;
     }
 
@@ -387,7 +552,7 @@ void videoRecorderLoop(void) {
     while (g_microphoneManager.receiveAudioDataBlock(&audioBlock, 1 / portTICK_PERIOD_MS)) {
         if (audioBlock.count > 0) {
             size_t audioBytes = audioBlock.count * sizeof(int16_t);
-            mjpegEncoder.addAudioFrame((const uint8_t*)audioBlock.samples, audioBytes, audioBlock.timestamp);
+            submitRecordChunk(PREEVENT_CHUNK_AUDIO, (const uint8_t*)audioBlock.samples, audioBytes, audioBlock.timestamp);
             audioBlockCounter++;
 
             // if (audioBlockCounter % 10 == 0) {
@@ -403,6 +568,22 @@ void videoRecorderLoop(void) {
     }
 }
 
+bool previewZoomIn(void) {
+    if (!s_previewZoom.zoomIn()) {
+        return false;
+    }
+    Utils_Logger::info("Video preview zoom: %dx", s_previewZoom.getLevel());
+    return true;
+}
+
+bool previewZoomOut(void) {
+    if (!s_previewZoom.zoomOut()) {
+        return false;
+    }
+    Utils_Logger::info("Video preview zoom: %dx", s_previewZoom.getLevel());
+    return true;
+}
+
 void processPreviewFrame(void) {
     if (g_recorderState != REC_RECORDING && g_recorderState != REC_IDLE) {
         return;
@@ -436,17 +617,44 @@ void processPreviewFrame(void) {
     } while (retryCount < MAX_RETRIES);
 
     if (imgLen > 0) {
-        memset(s_previewFrameBuffer, 0, sizeof(s_previewFrameBuffer));
-        s_previewFrameReady = false;
-        
-        if (jpeg.open((void*)imgAddr, imgLen, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDrawForPreview)) {
-            jpeg.decode(0, 0, JPEG_SCALE_HALF);
-            jpeg.close();
+        // 解码器被其他任务占满时跳过本帧预览，不阻塞录制
+        JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("VideoPreview", 0);
+        if (decoder != nullptr &&
+            decoder->open((void*)imgAddr, imgLen, nullptr, jpegReadCallback, jpegSeekCallback, Utils_JpegDecoderPool::drawToFrameTarget)) {
+            // 只解码当前变焦倍数下屏幕上可见的区域
+            int decodeX = 0;
+            int decodeY = 0;
+            int options = JPEG_SCALE_HALF;
+            s_previewZoom.prepareDecode(*decoder, PREVIEW_FB_WIDTH, PREVIEW_FB_HEIGHT, &decodeX, &decodeY, &options);
+
+            // 1x时直接解码到屏幕DMA缓冲区（大端RGB565），不经过帧缓冲区
+            AmebaST7789_DMA_SPI1& tft = tftManager.getTFT();
+            bool direct = PREVIEW_DIRECT_DMA_ENABLED && s_previewZoom.fillsDisplay();
+            if (direct) {
+                decoder->setFramebuffer(tft.getFrameBuffer(), PREVIEW_FB_WIDTH);
+                decoder->setPixelType(RGB565_BIG_ENDIAN);
+            } else {
+                memset(s_previewFrameBuffer, 0, sizeof(s_previewFrameBuffer));
+                s_previewTarget.ready = false;
+                s_previewTarget.upscale = s_previewZoom.getUpscale();
+                decoder->setUserPointer(&s_previewTarget);
+            }
+            uint32_t decodeStart = micros();
+            int decoded = decoder->decode(decodeX, decodeY, options);
+            s_previewZoom.recordDecodeTime(micros() - decodeStart);
+            decoder->close();
             
-            if (s_previewFrameReady) {
+            if (direct) {
+                if (decoded) {
+                    tft.sendFrameBuffer(0, 0, PREVIEW_FB_WIDTH, PREVIEW_FB_HEIGHT);
+                } else {
+                    tft.releaseFrameBuffer();
+                }
+            } else if (s_previewTarget.ready) {
                 tftManager.drawBitmap(0, 0, PREVIEW_FB_WIDTH, PREVIEW_FB_HEIGHT, s_previewFrameBuffer);
             }
         }
+        Utils_JpegDecoderPool::release(decoder);
     }
     
     if (shouldDrawDot) {
@@ -482,6 +690,15 @@ void processPreviewFrame(void) {
 // MJPEG解码器对象
 MJPEGDecoder mjpegDecoder;
 
+// 回放预取：读取任务提前读入后续帧，预取不可用时回退到播放循环内同步读取
+MJPEGPlaybackPrefetcher playbackPrefetcher;
+
+// 回放音频：正常速度播放时输出音频，视频以音频时钟为准
+MJPEGPlaybackAudio playbackAudio;
+
+// 回放实时调度：落后的帧不解码，持续过载时降低解码比例
+MJPEGPlaybackGovernor playbackGovernor;
+
 // 媒体文件列表相关变量
 MediaFileInfo mediaFileList[MAX_MEDIA_FILES];
 uint32_t mediaFileCount = 0;
@@ -501,6 +718,40 @@ bool isPlaying = false;
 bool isPaused = false;
 unsigned long lastFrameTime = 0;
 
+// 快进/快退与暂停拖动
+#define PLAYBACK_SCRUB_REFINE_MS      250   // 停止拖动该时间后以回放尺寸重新解码当前帧
+#define PLAYBACK_SCRUB_FAST_MS        120   // 两次拖动间隔小于该值时按1秒跳转，否则逐帧
+#define PLAYBACK_SEEK_TIMEOUT_MS      500   // 定位时等待读取一帧的上限
+#define PLAYBACK_EXIT_DOUBLE_PRESS_MS 400   // 播放中两次按键间隔小于该值时退出回放
+
+static const int8_t s_playbackSpeeds[] = { -16, -8, -4, -2, 1, 2, 4, 8, 16 };
+static int8_t s_playbackSpeed = 1;            // 每个显示帧前进的帧数（负数为快退）
+static uint32_t s_playbackFrameIndex = 0;     // 当前显示的帧号
+static uint32_t s_nextPlaybackFrame = 0;      // 同步读取时下一个要显示的帧号
+static bool s_playbackSeeked = false;         // 暂停期间拖动过，恢复时从当前位置重新预取
+static bool s_scrubRefinePending = false;
+static uint32_t s_lastScrubTime = 0;
+static uint8_t* s_scrubFrameData = nullptr;   // 拖动显示的帧数据（预取帧缓冲或解码器缓冲）
+static uint32_t s_scrubFrameSize = 0;
+static MJPEGPlaybackPrefetcher::Frame s_heldFrame;
+static bool s_heldFrameValid = false;
+static uint32_t s_lastSeekMs = 0;
+static uint32_t s_maxSeekMs = 0;
+static uint32_t s_lastPlaybackButtonTime = 0;
+
+// 播放时钟：正常速度且有音频时以音频为主时钟，否则从首个显示帧起按墙上时钟和倍速推算
+#define PLAYBACK_STATUS_REFRESH_MS 1000 // 倍速播放时状态栏时间的刷新间隔
+
+static MJPEGPlaybackPrefetcher::Frame s_pendingFrame;  // 已取出、等待到达显示时间的帧
+static bool s_pendingFrameValid = false;
+static bool s_clockAnchored = false;          // 开始、跳转或恢复后尚未显示第一帧
+static uint32_t s_clockAnchorWall = 0;
+static uint32_t s_clockAnchorMedia = 0;
+static uint32_t s_lastStatusDrawTime = 0;
+static uint32_t s_audioUnderruns = 0;
+static uint32_t s_audioUnderrunMs = 0;
+static uint32_t s_audioMinBufferedMs = UINT32_MAX;
+
 // 图片查看状态
 bool isImageViewing = false;
 uint8_t* currentImageBuffer = nullptr;
@@ -510,7 +761,6 @@ uint32_t currentImageSize = 0;
 extern DS3231_ClockModule clockModule;
 extern SDCardManager sdCardManager;
 extern Display_TFTManager tftManager;
-extern JPEGDEC jpeg;
 extern EncoderControl encoder;
 
 // 比较函数：按时间递减排序（最新的在前）
@@ -721,18 +971,77 @@ void startVideoPlayback(const char* fileName) {
         return;
     }
     
+    s_playbackSpeed = 1;
+    s_playbackFrameIndex = 0;
+    s_nextPlaybackFrame = 0;
+    s_playbackSeeked = false;
+    s_scrubRefinePending = false;
+    s_scrubFrameData = nullptr;
+    s_heldFrameValid = false;
+    s_maxSeekMs = 0;
+    s_pendingFrameValid = false;
+    s_clockAnchored = false;
+    s_audioUnderruns = 0;
+    s_audioUnderrunMs = 0;
+    s_audioMinBufferedMs = UINT32_MAX;
+    
+    if (VIDEO_PLAYBACK_PREFETCH_ENABLED) {
+        TaskManager::createTask(TaskManager::TASK_PLAYBACK_READER);
+        if (!playbackPrefetcher.begin(&mjpegDecoder, 0, VIDEO_PLAYBACK_PREFETCH_FRAMES)) {
+            Utils_Logger::info("Playback prefetch unavailable, reading frames synchronously");
+        }
+    }
+    
     g_recorderState = REC_PLAYING;
     isPlaying = true;
     isPaused = false;
     lastFrameTime = 0;
+    uint32_t fps = mjpegDecoder.getFPS();
+    playbackGovernor.reset((fps > 0) ? 1000 / fps : 67, VIDEO_PLAYBACK_SCALE_FALLBACK != 0);
+    syncPlaybackAudio(0);
     
     // 编码器回调已在Camera.ino中统一管理，无需在此更新
     
+    drawPlaybackStatus();
     Utils_Logger::info("Started playing video: %s", fileName);
 }
 
 // 停止视频播放
 void stopVideoPlayback(void) {
+    if (s_maxSeekMs > 0) {
+        Utils_Logger::info("Playback seek: max %u ms", s_maxSeekMs);
+    }
+    s_heldFrameValid = false;
+    s_pendingFrameValid = false;
+    s_scrubFrameData = nullptr;
+    
+    // 音频输出须在解码器关闭前停止
+    stopPlaybackAudio();
+    if (s_audioMinBufferedMs != UINT32_MAX) {
+        Utils_Logger::info("Playback audio: %u underruns (%u ms), min buffered %u ms",
+                          s_audioUnderruns, s_audioUnderrunMs, s_audioMinBufferedMs);
+    }
+    uint32_t fpsX10 = playbackGovernor.getAchievedFpsX10();
+    Utils_Logger::info("Playback governor: %u.%u fps, %u presented, %u dropped, %u scale fallbacks",
+                      fpsX10 / 10, fpsX10 % 10, playbackGovernor.getPresentedFrames(),
+                      playbackGovernor.getDroppedFrames(), playbackGovernor.getScaleFallbacks());
+    static const char* const stageNames[MJPEGPlaybackGovernor::STAGE_COUNT] = { "read", "decode", "draw" };
+    for (int i = 0; i < MJPEGPlaybackGovernor::STAGE_COUNT; i++) {
+        MJPEGPlaybackGovernor::Stage stage = (MJPEGPlaybackGovernor::Stage)i;
+        Utils_Logger::info("Playback %-6s p50 %u ms, p90 %u ms, p99 %u ms, max %u us", stageNames[i],
+                          playbackGovernor.getStagePercentileMs(stage, 50), playbackGovernor.getStagePercentileMs(stage, 90),
+                          playbackGovernor.getStagePercentileMs(stage, 99), playbackGovernor.getStageMaxUs(stage));
+    }
+    
+    // 预取任务常驻，只等待其当前读取完成并释放帧缓冲，再关闭解码器
+    if (playbackPrefetcher.isActive()) {
+        Utils_Logger::info("Playback prefetch: %u read, %u repeated, %u stalls (%u ms), buffered avg %u%% min %u/%u, max read %u us",
+                          playbackPrefetcher.getReadFrames(), playbackPrefetcher.getRepeatFrames(),
+                          playbackPrefetcher.getStallCount(), playbackPrefetcher.getStallTimeMs(),
+                          playbackPrefetcher.getAverageBufferedPercent(), playbackPrefetcher.getMinBufferedFrames(),
+                          playbackPrefetcher.getPoolFrames(), playbackPrefetcher.getMaxReadTimeUs());
+        playbackPrefetcher.end();
+    }
     mjpegDecoder.close();
     isPlaying = false;
     isPaused = false;
@@ -756,15 +1065,30 @@ void stopVideoPlayback(void) {
 void pauseVideoPlayback(void) {
     if (isPlaying) {
         isPaused = true;
+        s_playbackSeeked = false;
+        stopPlaybackAudio();
+        playbackGovernor.pause();
+        drawPlaybackStatus();
         Utils_Logger::info("Paused video playback");
     }
 }
 
-// 恢复视频播放
+// 恢复视频播放（恢复为正常速度）
 void resumeVideoPlayback(void) {
     if (isPlaying && isPaused) {
         isPaused = false;
         lastFrameTime = millis();
+        releaseHeldFrame();
+        s_scrubRefinePending = false;
+        s_clockAnchored = false;
+        playbackGovernor.resume();
+        if (s_playbackSeeked || s_playbackSpeed != 1) {
+            s_playbackSpeed = 1;
+            restartPlaybackFrom(s_playbackFrameIndex + 1);
+        } else {
+            syncPlaybackAudio(s_playbackFrameIndex + 1);
+        }
+        drawPlaybackStatus();
         Utils_Logger::info("Resumed video playback");
     }
 }
@@ -853,11 +1177,14 @@ void startImageViewer(const char* fileName) {
     isImageViewing = true;
     
     // 解码并显示图片
-    if (jpeg.open((void*)currentImageBuffer, currentImageSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
+    JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("ImageViewer");
+    if (decoder != nullptr &&
+        decoder->open((void*)currentImageBuffer, currentImageSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
         // 使用1/4缩放，确保宽度不超过240像素，与视频播放保持一致
-        jpeg.decode(0, 30, JPEG_SCALE_QUARTER);
-        jpeg.close();
+        decoder->decode(0, 30, JPEG_SCALE_QUARTER);
+        decoder->close();
     }
+    Utils_JpegDecoderPool::release(decoder);
     
     Utils_Logger::info("Started viewing image: %s", fileName);
 }
@@ -886,35 +1213,332 @@ void imageViewerLoop(void) {
     // 主要通过编码器按钮来退出
 }
 
-// 视频播放循环（使用帧缓冲区实现高性能回放）
-void videoPlaybackLoop(void) {
-    if (g_recorderState != REC_PLAYING || !isPlaying || isPaused) {
+// 解码一帧到回放帧缓冲；scale为JPEG_SCALE_EIGHTH时按2倍像素复制铺满回放区域
+static bool decodePlaybackFrame(uint8_t* frameData, uint32_t frameSize, int scale) {
+    JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("Playback");
+    if (decoder == nullptr) {
+        return false;
+    }
+    s_playbackTarget.ready = false;
+    s_playbackTarget.upscale = (scale == JPEG_SCALE_EIGHTH) ? 2 : 1;
+    if (decoder->open((void*)frameData, frameSize, nullptr, jpegReadCallback, jpegSeekCallback, Utils_JpegDecoderPool::drawToFrameTarget)) {
+        decoder->setUserPointer(&s_playbackTarget);
+        // 分片解码，片间补充音频缓冲（没有预取任务时音频由播放循环补充，整帧解码期间不能断供）
+        const int sliceRows = (VIDEO_PLAYBACK_DECODE_SLICE_ROWS > 0) ? VIDEO_PLAYBACK_DECODE_SLICE_ROWS : 0x7fffffff;
+        decoder->decodeStart(0, 0, scale);
+        while (decoder->decodeRows(sliceRows) > 0) {
+            if (!playbackPrefetcher.isActive()) {
+                playbackAudio.service();
+            }
+        }
+        decoder->close();
+    }
+    Utils_JpegDecoderPool::release(decoder);
+    return s_playbackTarget.ready;
+}
+
+// 解码一帧并显示到回放区域
+static void drawPlaybackFrame(uint8_t* frameData, uint32_t frameSize, int scale) {
+    if (decodePlaybackFrame(frameData, frameSize, scale)) {
+        tftManager.drawBitmap(0, 30, PLAYBACK_FB_WIDTH, PLAYBACK_FB_HEIGHT, s_playbackFrameBuffer);
+    }
+}
+
+// 回放顶部状态栏：播放/暂停/快进/快退倍速和当前时间
+void drawPlaybackStatus(void) {
+    uint32_t fps = mjpegDecoder.getFPS();
+    if (fps == 0) {
+        fps = 15;
+    }
+    uint32_t position = s_playbackFrameIndex / fps;
+    uint32_t duration = mjpegDecoder.getFrameCount() / fps;
+    
+    char mode[16];
+    if (isPaused) {
+        snprintf(mode, sizeof(mode), "Pause");
+    } else if (s_playbackSpeed > 1) {
+        snprintf(mode, sizeof(mode), ">> %dx", s_playbackSpeed);
+    } else if (s_playbackSpeed < 0) {
+        snprintf(mode, sizeof(mode), "<< %dx", -s_playbackSpeed);
+    } else {
+        snprintf(mode, sizeof(mode), "Play");
+    }
+    
+    char text[48];
+    snprintf(text, sizeof(text), "%-8s %02u:%02u / %02u:%02u", mode,
+             (unsigned)(position / 60), (unsigned)(position % 60), (unsigned)(duration / 60), (unsigned)(duration % 60));
+    tftManager.fillRectangle(0, 0, PLAYBACK_FB_WIDTH, 28, ST7789_BLACK);
+    tftManager.setTextSize(1);
+    tftManager.setCursor(10, 10);
+    tftManager.setTextColor(ST7789_WHITE, ST7789_BLACK);
+    tftManager.print(text);
+    s_lastStatusDrawTime = millis();
+}
+
+// 归还拖动定位时取出的预取帧
+static void releaseHeldFrame(void) {
+    if (s_heldFrameValid) {
+        playbackPrefetcher.releaseFrame(s_heldFrame);
+        s_heldFrameValid = false;
+    }
+    s_scrubFrameData = nullptr;
+}
+
+// 归还已取出、尚未显示的预取帧
+static void releasePendingFrame(void) {
+    if (s_pendingFrameValid) {
+        playbackPrefetcher.releaseFrame(s_pendingFrame);
+        s_pendingFrameValid = false;
+    }
+}
+
+// 帧在文件时间轴上的显示时间
+static uint32_t playbackFrameTimeMs(uint32_t frameIndex) {
+    uint32_t fps = mjpegDecoder.getFPS();
+    return (uint32_t)((uint64_t)frameIndex * 1000 / ((fps > 0) ? fps : 15));
+}
+
+// 停止音频输出并累计本段的欠载统计
+static void stopPlaybackAudio(void) {
+    if (!playbackAudio.isActive()) {
         return;
     }
+    s_audioUnderruns += playbackAudio.getUnderruns();
+    s_audioUnderrunMs += playbackAudio.getUnderrunMs();
+    if (playbackAudio.getMinBufferedMs() < s_audioMinBufferedMs) {
+        s_audioMinBufferedMs = playbackAudio.getMinBufferedMs();
+    }
+    playbackAudio.end();
+}
+
+// 正常速度播放时从frameIndex对应的时间开始输出音频，暂停和倍速播放时静音
+static void syncPlaybackAudio(uint32_t frameIndex) {
+    stopPlaybackAudio();
+    if (VIDEO_PLAYBACK_AUDIO_ENABLED && isPlaying && !isPaused && s_playbackSpeed == 1) {
+        playbackAudio.begin(&mjpegDecoder, playbackFrameTimeMs(frameIndex), VIDEO_PLAYBACK_AUDIO_BUFFER_MS);
+    }
+}
 
-    unsigned long currentMillis = millis();
+// 从nextFrame开始按当前倍速继续播放
+static void restartPlaybackFrom(uint32_t nextFrame) {
+    releasePendingFrame();
+    s_nextPlaybackFrame = nextFrame;
+    s_clockAnchored = false;
+    if (playbackPrefetcher.isActive()) {
+        playbackPrefetcher.restart(nextFrame, s_playbackSpeed);
+    }
+    syncPlaybackAudio(nextFrame);
+}
+
+// 切换快进/快退倍速：只读取和解码步长上的帧
+static void changePlaybackSpeed(RotationDirection direction) {
+    const int speedCount = sizeof(s_playbackSpeeds) / sizeof(s_playbackSpeeds[0]);
+    int level = 0;
+    while (level < speedCount - 1 && s_playbackSpeeds[level] != s_playbackSpeed) {
+        level++;
+    }
+    level += (direction == ROTATION_CW) ? 1 : -1;
+    if (level < 0 || level >= speedCount) {
+        return;
+    }
+    
+    s_playbackSpeed = s_playbackSpeeds[level];
+    int64_t next = (int64_t)s_playbackFrameIndex + s_playbackSpeed;
+    restartPlaybackFrom(next > 0 ? (uint32_t)next : 0);
+    drawPlaybackStatus();
+    Utils_Logger::info("Playback speed: %dx", s_playbackSpeed);
+}
+
+// 读取指定帧用于定位显示：预取时让读取任务只读这一帧，否则同步读取
+static bool fetchPlaybackFrame(uint32_t frameIndex, uint8_t** frameData, uint32_t* frameSize) {
+    releaseHeldFrame();
+    releasePendingFrame();
+    if (playbackPrefetcher.isActive()) {
+        playbackPrefetcher.restart(frameIndex, 1, 1);
+        if (!playbackPrefetcher.acquireFrame(&s_heldFrame, PLAYBACK_SEEK_TIMEOUT_MS)) {
+            return false;
+        }
+        s_heldFrameValid = true;
+        *frameData = s_heldFrame.data;
+        *frameSize = s_heldFrame.size;
+        return true;
+    }
+    return mjpegDecoder.seekToFrame(frameIndex) && mjpegDecoder.readNextFrame(frameData, frameSize);
+}
+
+// 暂停时拖动：每一格读取目标帧并以1/8缩放显示，停止拖动后再以回放尺寸细化
+static void scrubVideoPlayback(RotationDirection direction) {
+    uint32_t frameCount = mjpegDecoder.getFrameCount();
+    if (frameCount == 0) {
+        return;
+    }
+    
+    uint32_t now = millis();
     uint32_t fps = mjpegDecoder.getFPS();
-    uint32_t frameInterval = (fps > 0) ? 1000 / fps : 67;
+    int64_t step = (now - s_lastScrubTime < PLAYBACK_SCRUB_FAST_MS && fps > 0) ? fps : 1;
+    s_lastScrubTime = now;
+    
+    int64_t target = (int64_t)s_playbackFrameIndex + ((direction == ROTATION_CW) ? step : -step);
+    if (target < 0) {
+        target = 0;
+    } else if (target >= frameCount) {
+        target = frameCount - 1;
+    }
+    if ((uint32_t)target == s_playbackFrameIndex && s_scrubFrameData) {
+        return;
+    }
+    
+    uint32_t startTime = millis();
+    if (!fetchPlaybackFrame((uint32_t)target, &s_scrubFrameData, &s_scrubFrameSize)) {
+        Utils_Logger::error("Seek to frame %u failed", (uint32_t)target);
+        s_scrubFrameData = nullptr;
+        return;
+    }
+    drawPlaybackFrame(s_scrubFrameData, s_scrubFrameSize, JPEG_SCALE_EIGHTH);
+    
+    s_lastSeekMs = millis() - startTime;
+    if (s_lastSeekMs > s_maxSeekMs) {
+        s_maxSeekMs = s_lastSeekMs;
+    }
+    s_playbackFrameIndex = (uint32_t)target;
+    s_playbackSeeked = true;
+    s_scrubRefinePending = true;
+    drawPlaybackStatus();
+}
 
-    if (currentMillis - lastFrameTime >= frameInterval) {
-        lastFrameTime = currentMillis;
+// 播放时钟（文件时间轴上的毫秒数）
+static int64_t playbackClockMs(void) {
+    if (playbackAudio.isActive() && !playbackAudio.isFinished()) {
+        return playbackAudio.getClockMs();
+    }
+    return (int64_t)s_clockAnchorMedia + (int64_t)(millis() - s_clockAnchorWall) * s_playbackSpeed;
+}
 
-        uint8_t* frameData;
-        uint32_t frameSize;
+// 解码并显示一帧，各阶段耗时交给调度器统计
+static void presentPlaybackFrame(uint8_t* frameData, uint32_t frameSize) {
+    uint32_t startTime = micros();
+    bool decoded = decodePlaybackFrame(frameData, frameSize, playbackGovernor.getScale());
+    uint32_t decodeTime = micros();
+    playbackGovernor.recordStage(MJPEGPlaybackGovernor::STAGE_DECODE, decodeTime - startTime);
+    if (decoded) {
+        tftManager.drawBitmap(0, 30, PLAYBACK_FB_WIDTH, PLAYBACK_FB_HEIGHT, s_playbackFrameBuffer);
+        playbackGovernor.recordStage(MJPEGPlaybackGovernor::STAGE_DRAW, micros() - decodeTime);
+    }
+}
 
-        if (mjpegDecoder.readNextFrame(&frameData, &frameSize)) {
-            s_playbackFrameReady = false;
-            if (jpeg.open((void*)frameData, frameSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDrawForPlayback)) {
-                jpeg.decode(0, 0, JPEG_SCALE_QUARTER);
-                jpeg.close();
+// 按播放时钟显示下一帧：未到显示时间的帧保留到下次循环，落后超过一个显示间隔的帧由调度器丢弃（不解码）
+// 返回false表示没有后续帧
+static bool presentNextPlaybackFrame(void) {
+    uint32_t frameIndex;
+    if (playbackPrefetcher.isActive()) {
+        if (!s_pendingFrameValid) {
+            if (!playbackPrefetcher.acquireFrame(&s_pendingFrame, 0)) {
+                return !playbackPrefetcher.isFinished();
             }
-            if (s_playbackFrameReady) {
-                tftManager.drawBitmap(0, 30, PLAYBACK_FB_WIDTH, PLAYBACK_FB_HEIGHT, s_playbackFrameBuffer);
+            s_pendingFrameValid = true;
+        }
+        frameIndex = s_pendingFrame.frameIndex;
+    } else {
+        if (s_nextPlaybackFrame >= mjpegDecoder.getFrameCount()) {
+            return false;
+        }
+        frameIndex = s_nextPlaybackFrame;
+    }
+    
+    // 开始、跳转或恢复后的第一帧立即显示，并以它作为墙上时钟的起点
+    uint32_t frameTime = playbackFrameTimeMs(frameIndex);
+    if (!s_clockAnchored) {
+        s_clockAnchored = true;
+        s_clockAnchorWall = millis();
+        s_clockAnchorMedia = frameTime;
+    }
+    
+    // 按播放方向计算该帧相对时钟的超前量，快退时帧时间递减
+    int64_t clock = playbackClockMs();
+    int64_t lead = (s_playbackSpeed > 0) ? (int64_t)frameTime - clock : clock - (int64_t)frameTime;
+    if (lead > 0) {
+        return true;
+    }
+    uint32_t lateMs = (uint32_t)(-lead / abs(s_playbackSpeed));
+    bool drop = playbackGovernor.shouldDrop(lateMs);
+    
+    if (playbackPrefetcher.isActive()) {
+        if (!s_pendingFrame.repeat) {
+            playbackGovernor.recordStage(MJPEGPlaybackGovernor::STAGE_READ, s_pendingFrame.readTimeUs);
+        }
+        if (drop) {
+            playbackGovernor.onFrameDropped();
+        } else {
+            // 重复帧与上一帧画面相同，保持当前显示
+            if (!s_pendingFrame.repeat) {
+                presentPlaybackFrame(s_pendingFrame.data, s_pendingFrame.size);
             }
+            playbackGovernor.onFramePresented();
+            lastFrameTime = millis();
+        }
+        s_playbackFrameIndex = frameIndex;
+        releasePendingFrame();
+        return true;
+    }
+    
+    int64_t next = (int64_t)frameIndex + s_playbackSpeed;
+    if (drop) {
+        // 同步读取时丢弃的帧不读取
+        playbackGovernor.onFrameDropped();
+    } else {
+        uint8_t* frameData;
+        uint32_t frameSize;
+        uint32_t startTime = micros();
+        if (!mjpegDecoder.seekToFrame(frameIndex) || !mjpegDecoder.readNextFrame(&frameData, &frameSize)) {
+            return false;
+        }
+        playbackGovernor.recordStage(MJPEGPlaybackGovernor::STAGE_READ, micros() - startTime);
+        presentPlaybackFrame(frameData, frameSize);
+        playbackGovernor.onFramePresented();
+        lastFrameTime = millis();
+    }
+    s_playbackFrameIndex = frameIndex;
+    s_nextPlaybackFrame = (next >= 0) ? (uint32_t)next : UINT32_MAX;
+    return true;
+}
+
+// 视频播放循环（使用帧缓冲区实现高性能回放）
+void videoPlaybackLoop(void) {
+    if (g_recorderState != REC_PLAYING || !isPlaying) {
+        return;
+    }
+    
+    if (isPaused) {
+        // 停止拖动后以回放尺寸重新解码当前帧
+        if (s_scrubRefinePending && s_scrubFrameData && millis() - s_lastScrubTime >= PLAYBACK_SCRUB_REFINE_MS) {
+            drawPlaybackFrame(s_scrubFrameData, s_scrubFrameSize, JPEG_SCALE_QUARTER);
+            s_scrubRefinePending = false;
+        }
+        return;
+    }
+
+    // 没有预取任务时由播放循环补充音频缓冲
+    if (!playbackPrefetcher.isActive()) {
+        playbackAudio.service();
+    }
+
+    if (!presentNextPlaybackFrame()) {
+        if (s_playbackSpeed < 0) {
+            // 快退到开头：从第一帧恢复正常播放
+            s_playbackSpeed = 1;
+            s_playbackFrameIndex = 0;
+            restartPlaybackFrom(0);
+            drawPlaybackStatus();
         } else {
             // 播放结束
             stopVideoPlayback();
         }
+        return;
+    }
+    
+    if (s_playbackSpeed != 1 && millis() - s_lastStatusDrawTime >= PLAYBACK_STATUS_REFRESH_MS) {
+        // 倍速播放时约每秒刷新一次时间显示
+        drawPlaybackStatus();
     }
 }
 
@@ -1137,15 +1761,18 @@ bool generateThumbnail(const char* fileName, ThumbnailCache& cache, MediaType me
         cache.valid = true;
         
         // 解码JPEG获取尺寸信息
-        if (jpeg.open((void*)cache.jpegFrame, bytesRead, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
-            cache.width = jpeg.getWidth();
-            cache.height = jpeg.getHeight();
-            jpeg.close();
+        JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("Thumbnail");
+        if (decoder != nullptr &&
+            decoder->open((void*)cache.jpegFrame, bytesRead, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
+            cache.width = decoder->getWidth();
+            cache.height = decoder->getHeight();
+            decoder->close();
         } else {
             // 解码失败时标记无效但不报错（可能是截断的 JPEG）
             cache.width = 0;
             cache.height = 0;
         }
+        Utils_JpegDecoderPool::release(decoder);
         
         return true;
     } else {
@@ -1250,15 +1877,18 @@ bool generateThumbnail(const char* fileName, ThumbnailCache& cache, MediaType me
                         cache.valid = true;
                         
                         // 解码JPEG帧获取尺寸信息
-                        if (jpeg.open((void*)cache.jpegFrame, frameSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
-                            cache.width = jpeg.getWidth();
-                            cache.height = jpeg.getHeight();
-                            jpeg.close();
+                        JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("Thumbnail");
+                        if (decoder != nullptr &&
+                            decoder->open((void*)cache.jpegFrame, frameSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
+                            cache.width = decoder->getWidth();
+                            cache.height = decoder->getHeight();
+                            decoder->close();
                         } else {
                             // Utils_Logger::error("Failed to open JPEG decoder for thumbnail");
                             cache.width = 0;
                             cache.height = 0;
                         }
+                        Utils_JpegDecoderPool::release(decoder);
                         
                         free(buffer);
                         f_close(&file);
@@ -1405,13 +2035,15 @@ void drawFileListUI(void) {
             // 绘制媒体预览图
             if (i < thumbnailCacheSize && thumbnailCache[i].valid && thumbnailCache[i].jpegFrame != nullptr) {
                 // 使用缓存中的JPEG帧数据解码显示
-                if (jpeg.open((void*)thumbnailCache[i].jpegFrame, thumbnailCache[i].frameSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
+                JPEGDEC* decoder = Utils_JpegDecoderPool::acquire("Thumbnail");
+                if (decoder != nullptr &&
+                    decoder->open((void*)thumbnailCache[i].jpegFrame, thumbnailCache[i].frameSize, nullptr, jpegReadCallback, jpegSeekCallback, JPEGDraw)) {
                     // 固定缩放比例
                     int scale = JPEG_SCALE_EIGHTH;  // 使用1/8缩放
                     
                     // 解码并显示图像
-                    jpeg.decode(imgX, imgY, scale);
-                    jpeg.close();
+                    decoder->decode(imgX, imgY, scale);
+                    decoder->close();
                 } else {
                     // 解码失败，显示"Decode Error"文本
                     tftManager.setCursor(x + 5, y + 30);
@@ -1419,6 +2051,7 @@ void drawFileListUI(void) {
                     tftManager.setTextColor(ST7789_RED, ST7789_BLACK);
                     tftManager.print("Decode Error");
                 }
+                Utils_JpegDecoderPool::release(decoder);
             } else {
                 // 缓存无效或不足，显示"No Preview"文本
                 tftManager.setCursor(x + 5, y + 30);
@@ -1694,8 +2327,20 @@ void videoHandleEncoderButton() {
                 Utils_Logger::info("图片查看模式，按下按钮返回文件列表");
                 stopImageViewer();
             } else {
-                // 视频播放模式，暂停/恢复播放
-                if (isPaused) {
+                // 视频播放模式：快速按两次退出，倍速播放时恢复正常速度，否则暂停/恢复播放
+                uint32_t now = millis();
+                bool doublePress = (now - s_lastPlaybackButtonTime < PLAYBACK_EXIT_DOUBLE_PRESS_MS);
+                s_lastPlaybackButtonTime = now;
+                if (doublePress) {
+                    Utils_Logger::info("视频播放模式，双击退出播放");
+                    stopVideoPlayback();
+                    isBackButtonSelected = false;
+                } else if (!isPaused && s_playbackSpeed != 1) {
+                    Utils_Logger::info("视频播放模式，恢复正常速度");
+                    s_playbackSpeed = 1;
+                    restartPlaybackFrom(s_playbackFrameIndex + 1);
+                    drawPlaybackStatus();
+                } else if (isPaused) {
                     Utils_Logger::info("视频播放模式，恢复播放");
                     resumeVideoPlayback();
                 } else {
@@ -1780,13 +2425,18 @@ void videoHandleEncoderRotation(RotationDirection direction) {
             }
         }
     } else if (g_recorderState == REC_PLAYING) {
-        if (isImageViewing) {
-            // 在图片查看过程中检测到旋钮旋转，返回文件列表
-            stopImageViewer();
-        } else {
-            // 在视频回放过程中检测到旋钮旋转，停止播放并返回文件选择界面
-            stopVideoPlayback();
+        if (!isImageViewing) {
+            // 视频回放：播放中旋转切换快进/快退倍速，暂停时旋转逐帧/逐秒拖动
+            if (isPaused) {
+                scrubVideoPlayback(direction);
+            } else {
+                changePlaybackSpeed(direction);
+            }
+            return;
         }
+        
+        // 在图片查看过程中检测到旋钮旋转，返回文件列表
+        stopImageViewer();
         // 返回到文件列表状态
         g_recorderState = REC_FILE_LIST;
         // 确保返回按钮未被选中
@@ -1794,7 +2444,7 @@ void videoHandleEncoderRotation(RotationDirection direction) {
         // 通知Camera.ino需要重绘文件列表
         extern bool fileListNeedsRedraw;
         fileListNeedsRedraw = true;
-        Utils_Logger::info("Stopped media playback due to encoder rotation, returning to file list");
+        Utils_Logger::info("Stopped image viewer due to encoder rotation, returning to file list");
     }
 }
 
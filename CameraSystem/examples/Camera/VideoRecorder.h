@@ -75,8 +75,22 @@ void videoRecorderInit(void);
 void videoRecorderCleanup(void);
 void startVideoRecording(void);
 void stopVideoRecording(void);
+// 循环分段录制开关（仅在空闲时切换），分段参数和统计见MJPEGLoopRecorder
+void setLoopRecordingEnabled(bool enabled);
+bool isLoopRecordingEnabled(void);
+// 预录：进入拍视频界面后开始缓存，开始录制时前VIDEO_PREEVENT_SECONDS秒写入文件开头
+void startPreEventCapture(void);
+void stopPreEventCapture(void);
+bool isPreEventArmed(void);
+// 采集任务提交录制数据（type为PREEVENT_CHUNK_VIDEO/AUDIO），按状态进入预录缓冲区或录制器
+bool submitRecordChunk(uint8_t type, const uint8_t* data, uint32_t size, uint32_t timestamp);
+// 等待上一帧的零拷贝写入完成，采集任务在下一次Camera.getImage()之前调用
+bool waitRecordFrameWritten(void);
 void videoRecorderLoop(void);
 void processPreviewFrame(void);
+// 预览数字变焦（1x/2x/4x，只影响LCD预览，不影响录制通道），已到最大倍数或1x时返回false
+bool previewZoomIn(void);
+bool previewZoomOut(void);
 bool generateThumbnail(const char* fileName, ThumbnailCache& cache, MediaType mediaType);
 
 // 媒体播放相关函数声明
@@ -84,6 +98,7 @@ void startVideoPlayback(const char* fileName);
 void stopVideoPlayback(void);
 void pauseVideoPlayback(void);
 void resumeVideoPlayback(void);
+void drawPlaybackStatus(void);
 void startImageViewer(const char* fileName);
 void stopImageViewer(void);
 void nextMediaFile(void);
@@ -0,0 +1,127 @@
+/*******************************************************
+ * JPEGDEC DSP内核板上基准测试
+ * 1. JPEGDEC::dspSelfTest()：DSP内核（IDCT输出限幅、YCbCr转RGB565）与C查表实现逐位比较，并用DWT周期计数器计时
+ * 2. 整帧解码耗时：依次解码SD卡根目录下相机拍摄的JPEG（VOE输出，最多MAX_FILES张），按1/1和1/2缩放各解码DECODE_LOOPS次
+ * 整帧C实现的对比数据：在jpeg.inl开头加入 #define NO_SIMD 后重新编译运行本示例
+ * 主机端逐像素比对DSP与C解码结果见 extras/jpeg_dsp_check
+ ******************************************************/
+
+#include <stdarg.h>
+#include <JPEGDEC_Libraries/JPEGDEC.h>
+#include "AmebaFatFS.h"
+
+#define MAX_FILES     16       // 最多测试的JPEG文件数
+#define DECODE_LOOPS  5        // 每种缩放的解码次数
+
+JPEGDEC jpeg;
+AmebaFatFS fs;
+
+// DWT周期计数器（Cortex-M33）
+static uint32_t readCycleCounter() {
+    return *(volatile uint32_t*)0xE0001004;  // DWT_CYCCNT
+}
+
+static void enableCycleCounter() {
+    *(volatile uint32_t*)0xE000EDFC |= (1UL << 24);  // DEMCR.TRCENA
+    *(volatile uint32_t*)0xE0001000 |= 1UL;          // DWT_CTRL.CYCCNTENA
+}
+
+// AMB82-MINI的Serial不提供printf，格式化后整行输出
+static void logLine(const char *format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    Serial.println(line);
+}
+
+// 只测解码本身，不送显
+int JPEGDrawNothing(JPEGDRAW *pDraw) {
+    (void)pDraw;
+    return 1;
+}
+
+static void runKernelTest() {
+    JPEGDSPSTATS stats;
+    int result = JPEGDEC::dspSelfTest(&stats, readCycleCounter);
+    if (result < 0) {
+        Serial.println("DSP内核未启用（未定义__ARM_FEATURE_DSP或定义了NO_SIMD），跳过内核比较");
+        return;
+    }
+    logLine("内核比较: %d个输出, %d个不一致 -> %s", stats.iPixelsChecked, stats.iMismatches,
+                  result == 0 ? "通过" : "失败");
+    logLine("像素转换周期 C/DSP: %u/%u", stats.u32PixelRefCycles, stats.u32PixelDspCycles);
+    logLine("IDCT输出限幅周期 C/DSP: %u/%u", stats.u32IDCTRefCycles, stats.u32IDCTDspCycles);
+}
+
+static void benchmarkFile(const char *path) {
+    File file = fs.open(path);
+    unsigned char *data = NULL;
+    uint32_t size = 0;
+    if (!file.readFile(data, size)) {
+        logLine("读取失败: %s", path);
+        file.close();
+        return;
+    }
+    file.close();
+
+    const int scales[2] = {0, JPEG_SCALE_HALF};
+    for (int s = 0; s < 2; s++) {
+        uint32_t totalCycles = 0;
+        int width = 0, height = 0;
+        bool ok = true;
+        for (int i = 0; i < DECODE_LOOPS && ok; i++) {
+            ok = jpeg.openRAM(data, size, JPEGDrawNothing);
+            if (ok) {
+                width = jpeg.getWidth();
+                height = jpeg.getHeight();
+                uint32_t start = readCycleCounter();
+                ok = jpeg.decode(0, 0, scales[s]);
+                totalCycles += readCycleCounter() - start;
+                jpeg.close();
+            }
+        }
+        if (!ok) {
+            logLine("%s: 解码失败 (错误 %d)", path, jpeg.getLastError());
+            break;
+        }
+        logLine("%s %dx%d 1/%d: 平均 %u 周期/帧", path, width, height, 1 << s, totalCycles / DECODE_LOOPS);
+    }
+    free(data);
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial);
+    Serial.println("=== JPEGDEC DSP内核基准测试 ===");
+
+    enableCycleCounter();
+    runKernelTest();
+
+    fs.begin();
+    DIR dir;
+    FILINFO fno;
+    char path[128];
+    int count = 0;
+    if (f_opendir(&dir, fs.getRootPath()) != FR_OK) {
+        Serial.println("无法打开SD卡根目录");
+        return;
+    }
+    while (count < MAX_FILES && f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0) {
+        const char *ext = strrchr(fno.fname, '.');
+        if ((fno.fattrib & AM_DIR) || ext == NULL || strcasecmp(ext, ".jpg") != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s%s", fs.getRootPath(), fno.fname);
+        benchmarkFile(path);
+        count++;
+    }
+    f_closedir(&dir);
+    fs.end();
+    logLine("共测试 %d 个文件", count);
+}
+
+void loop() {
+    delay(1000);
+}
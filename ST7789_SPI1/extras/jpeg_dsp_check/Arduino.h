@@ -0,0 +1,11 @@
+//
+// Minimal stand-in for the Arduino core so that JPEGDEC.h / jpeg.inl build
+// on a host PC exactly as they do in the Arduino (C++) configuration
+//
+#ifndef __ARDUINO_HOST__
+#define __ARDUINO_HOST__
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#endif // __ARDUINO_HOST__
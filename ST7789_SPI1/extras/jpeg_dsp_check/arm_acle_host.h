@@ -0,0 +1,51 @@
+//
+// Portable versions of the ACLE DSP intrinsics used by the HAS_DSP kernels
+// in jpeg.inl, so that the kernels can be checked on a host PC.
+// Each one follows the Armv8-M instruction description lane by lane.
+//
+#ifndef __ARM_ACLE_HOST__
+#define __ARM_ACLE_HOST__
+#include <stdint.h>
+
+static inline int32_t __acle_host_sat(int32_t v, int32_t lo, int32_t hi)
+{
+    return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+static inline uint32_t __acle_host_pack(int32_t lo, int32_t hi)
+{
+    return (uint32_t)(uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+static inline uint32_t __sadd16(uint32_t a, uint32_t b)
+{
+    return __acle_host_pack((int16_t)a + (int16_t)b, (int16_t)(a >> 16) + (int16_t)(b >> 16));
+}
+
+static inline uint32_t __ssub16(uint32_t a, uint32_t b)
+{
+    return __acle_host_pack((int16_t)a - (int16_t)b, (int16_t)(a >> 16) - (int16_t)(b >> 16));
+}
+
+static inline int32_t __smlad(uint32_t a, uint32_t b, int32_t c)
+{
+    return c + (int16_t)a * (int16_t)b + (int16_t)(a >> 16) * (int16_t)(b >> 16);
+}
+
+static inline uint32_t __ssat16(uint32_t a, int n)
+{
+    int32_t lo = -(1 << (n - 1)), hi = (1 << (n - 1)) - 1;
+    return __acle_host_pack(__acle_host_sat((int16_t)a, lo, hi), __acle_host_sat((int16_t)(a >> 16), lo, hi));
+}
+
+static inline uint32_t __usat16(uint32_t a, int n)
+{
+    int32_t hi = (1 << n) - 1;
+    return __acle_host_pack(__acle_host_sat((int16_t)a, 0, hi), __acle_host_sat((int16_t)(a >> 16), 0, hi));
+}
+
+static inline uint32_t __rev16(uint32_t a)
+{
+    return ((a & 0x00ff00ffu) << 8) | ((a >> 8) & 0x00ff00ffu);
+}
+#endif // __ARM_ACLE_HOST__
@@ -0,0 +1,79 @@
+//
+// One build of the JPEGDEC decoder for jpeg_dsp_check
+// The Makefile compiles this file once as the C reference (NO_SIMD) and once
+// with HAS_DSP forced on and the ACLE intrinsics taken from arm_acle_host.h.
+// JPEG_CHECK_NAMESPACE and JPEG_CHECK_DECODE name the copy being built.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "JPEGDEC.h"
+#include "jpeg_dsp_check.h"
+
+namespace JPEG_CHECK_NAMESPACE {
+#include "jpeg.inl"
+#if defined(JPEG_CHECK_EXPECT_DSP) && !defined(HAS_DSP)
+#error "the DSP build of the decoder did not enable HAS_DSP"
+#endif
+
+static DECODE_RESULT *pCanvas;
+
+static int drawCanvas(JPEGDRAW *pDraw)
+{
+    for (int y = 0; y < pDraw->iHeight; y++) {
+        int dy = pDraw->y + y;
+        if (dy >= pCanvas->iHeight)
+            break;
+        int w = pDraw->iWidthUsed;
+        if (pDraw->x + w > pCanvas->iWidth)
+            w = pCanvas->iWidth - pDraw->x;
+        memcpy(&pCanvas->pPixels[dy * pCanvas->iWidth + pDraw->x], &pDraw->pPixels[y * pDraw->iWidth], w * sizeof(uint16_t));
+    }
+    return 1;
+}
+
+static uint64_t nanoTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+} // namespace JPEG_CHECK_NAMESPACE
+
+int JPEG_CHECK_DECODE(const uint8_t *pData, int iSize, int iOptions, int iPixelType, int iIterations, DECODE_RESULT *pResult)
+{
+    using namespace JPEG_CHECK_NAMESPACE;
+    static JPEGIMAGE jpeg;
+    int iShift = (iOptions & JPEG_SCALE_EIGHTH) ? 3 : ((iOptions & JPEG_SCALE_QUARTER) ? 2 : ((iOptions & JPEG_SCALE_HALF) ? 1 : 0));
+
+    memset(pResult, 0, sizeof(DECODE_RESULT));
+    for (int i = 0; i < iIterations; i++) {
+        // same setup as JPEGDEC::openRAM()
+        memset(&jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keeps the Huffman tables like openRAM()
+        jpeg.ucMemType = JPEG_MEM_RAM;
+        jpeg.pfnRead = readRAM;
+        jpeg.pfnSeek = seekMem;
+        jpeg.pfnDraw = drawCanvas;
+        jpeg.JPEGFile.iSize = iSize;
+        jpeg.JPEGFile.pData = (uint8_t *)pData;
+        jpeg.iMaxMCUs = 1000;
+        if (!JPEGInit(&jpeg))
+            return 0;
+        if (pResult->pPixels == NULL) {
+            pResult->iWidth = (jpeg.iWidth + (1 << iShift) - 1) >> iShift;
+            pResult->iHeight = (jpeg.iHeight + (1 << iShift) - 1) >> iShift;
+            pResult->pPixels = (uint16_t *)calloc(pResult->iWidth * pResult->iHeight, sizeof(uint16_t));
+            if (pResult->pPixels == NULL)
+                return 0;
+        }
+        jpeg.ucPixelType = (uint8_t)iPixelType;
+        pCanvas = pResult;
+        uint64_t u64Start = nanoTime();
+        jpeg.iOptions = iOptions;
+        int rc = DecodeJPEG(&jpeg);
+        pResult->u64Nanos += nanoTime() - u64Start;
+        if (!rc)
+            return 0;
+    }
+    return 1;
+}
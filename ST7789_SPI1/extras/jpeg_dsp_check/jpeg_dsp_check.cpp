@@ -0,0 +1,115 @@
+//
+// jpeg_dsp_check - bit-exact check and benchmark of the JPEGDEC DSP kernels
+//
+// Decodes every JPEG given on the command line with the table based C code
+// and with the HAS_DSP kernels at all four scales, in little and big endian
+// RGB565, and compares the output pixel by pixel. Use photos taken by the
+// camera (IMG_*.jpg on the SD card) so that the corpus is real VOE output.
+//
+// usage: jpeg_dsp_check [-n iterations] file.jpg ...
+// exit status is 0 when every decode matched
+//
+// The timings are host timings. The DSP column runs the portable intrinsics
+// from arm_acle_host.h, so it only shows that nothing pathological happens;
+// the cycle counts that matter come from JPEGDEC::dspSelfTest() on the board
+// (see examples/JPEGDEC_DspBenchmark).
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JPEGDEC.h"
+#include "jpeg_dsp_check.h"
+
+static uint8_t *loadFile(const char *szName, int *pSize)
+{
+    FILE *f = fopen(szName, "rb");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    *pSize = (int)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *pData = (uint8_t *)malloc(*pSize);
+    if (pData != NULL && fread(pData, 1, *pSize, f) != (size_t)*pSize) {
+        free(pData);
+        pData = NULL;
+    }
+    fclose(f);
+    return pData;
+}
+
+int main(int argc, char **argv)
+{
+    static const int iScales[4] = {0, JPEG_SCALE_HALF, JPEG_SCALE_QUARTER, JPEG_SCALE_EIGHTH};
+    static const int iPixelTypes[2] = {RGB565_LITTLE_ENDIAN, RGB565_BIG_ENDIAN};
+    int iIterations = 5;
+    int iFirst = 1;
+    int iFiles = 0, iSkipped = 0, iDecodes = 0, iFailures = 0;
+    uint64_t u64RefNanos = 0, u64DspNanos = 0;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        iIterations = atoi(argv[2]);
+        if (iIterations < 1)
+            iIterations = 1;
+        iFirst = 3;
+    }
+    if (iFirst >= argc) {
+        printf("usage: %s [-n iterations] file.jpg ...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = iFirst; i < argc; i++) {
+        int iSize;
+        uint8_t *pData = loadFile(argv[i], &iSize);
+        if (pData == NULL) {
+            printf("%s: cannot read\n", argv[i]);
+            iFailures++;
+            continue;
+        }
+        iFiles++;
+        for (int s = 0; s < 4; s++) {
+            for (int t = 0; t < 2; t++) {
+                DECODE_RESULT ref, dsp;
+                int bRef = decodeReference(pData, iSize, iScales[s], iPixelTypes[t], iIterations, &ref);
+                int bDsp = decodeDsp(pData, iSize, iScales[s], iPixelTypes[t], iIterations, &dsp);
+                if (!bRef && !bDsp) {
+                    // not decodable by either build (e.g. progressive), nothing to compare
+                    if (s == 0 && t == 0) {
+                        printf("%s: skipped, JPEGDEC cannot decode it\n", argv[i]);
+                        iSkipped++;
+                    }
+                    free(ref.pPixels);
+                    free(dsp.pPixels);
+                    continue;
+                }
+                int iDiff = 0;
+                if (bRef && bDsp && ref.iWidth == dsp.iWidth && ref.iHeight == dsp.iHeight) {
+                    for (int p = 0; p < ref.iWidth * ref.iHeight; p++) {
+                        if (ref.pPixels[p] != dsp.pPixels[p])
+                            iDiff++;
+                    }
+                } else {
+                    iDiff = -1;
+                }
+                iDecodes++;
+                if (iDiff != 0) {
+                    printf("%s: scale 1/%d %s: MISMATCH (%d pixels, decode %d/%d)\n", argv[i], 1 << s,
+                           t ? "BE" : "LE", iDiff, bRef, bDsp);
+                    iFailures++;
+                }
+                if (s == 0 && t == 0) {
+                    printf("%s: %dx%d, C %.2f ms, DSP %.2f ms per decode\n", argv[i], ref.iWidth, ref.iHeight,
+                           ref.u64Nanos / 1e6 / iIterations, dsp.u64Nanos / 1e6 / iIterations);
+                }
+                u64RefNanos += ref.u64Nanos;
+                u64DspNanos += dsp.u64Nanos;
+                free(ref.pPixels);
+                free(dsp.pPixels);
+            }
+        }
+        free(pData);
+    }
+
+    printf("%d files (%d skipped), %d decodes compared, %d failures; host time C %.1f ms, DSP (emulated) %.1f ms\n",
+           iFiles, iSkipped, iDecodes, iFailures, u64RefNanos / 1e6, u64DspNanos / 1e6);
+    return iFailures != 0;
+}
@@ -0,0 +1,19 @@
+//
+// Host side check of the JPEGDEC Cortex-M33 DSP kernels
+// jpeg_decode_variant.cpp is built twice (table based C code and HAS_DSP
+// kernels), each copy of the decoder living in its own namespace
+//
+#ifndef __JPEG_DSP_CHECK__
+#define __JPEG_DSP_CHECK__
+#include <stdint.h>
+
+typedef struct decode_result_tag {
+    int iWidth, iHeight;    // output size after scaling
+    uint16_t *pPixels;      // iWidth x iHeight, freed by the caller
+    uint64_t u64Nanos;      // time spent in decode() for all iterations
+} DECODE_RESULT;
+
+// Decode pData iIterations times; the pixels of the last pass are returned
+int decodeReference(const uint8_t *pData, int iSize, int iOptions, int iPixelType, int iIterations, DECODE_RESULT *pResult);
+int decodeDsp(const uint8_t *pData, int iSize, int iOptions, int iPixelType, int iIterations, DECODE_RESULT *pResult);
+#endif // __JPEG_DSP_CHECK__
@@ -28,15 +28,32 @@ JPEG_STATIC int JPEGParseInfo(JPEGIMAGE *pPage, int bExtractThumb);
 JPEG_STATIC void JPEGGetMoreData(JPEGIMAGE *pPage);
 JPEG_STATIC int DecodeJPEG(JPEGIMAGE *pImage);
 JPEG_STATIC void JPEG_setFramebuffer(JPEGIMAGE *pPage, void *pFramebuffer);
+JPEG_STATIC void JPEG_setFramebufferPitch(JPEGIMAGE *pPage, int iPitch);
+JPEG_STATIC int JPEG_dspSelfTest(JPEGDSPSTATS *pStats, JPEG_CYCLES_CALLBACK *pfnCycles);
+JPEG_STATIC void JPEG_setCropArea(JPEGIMAGE *pJPEG, int x, int y, int w, int h);
+JPEG_STATIC void JPEG_getCropArea(JPEGIMAGE *pJPEG, int *x, int *y, int *w, int *h);
+JPEG_STATIC void JPEG_invalidateTables(JPEGIMAGE *pJPEG);
+JPEG_STATIC int JPEG_getTablesReused(JPEGIMAGE *pJPEG);
 
 // Include the C code which does the actual work
 #include "jpeg.inl"
 
+JPEGDEC::JPEGDEC()
+{
+    JPEG_invalidateTables(&_jpeg);    // the tables are only valid once built by open()
+} /* JPEGDEC() */
+
 void JPEGDEC::setFramebuffer(void *pFramebuffer)
 {
     JPEG_setFramebuffer(&_jpeg, pFramebuffer);
 } /* setFramebuffer() */
 
+void JPEGDEC::setFramebuffer(void *pFramebuffer, int iPitch)
+{
+    JPEG_setFramebuffer(&_jpeg, pFramebuffer);
+    JPEG_setFramebufferPitch(&_jpeg, iPitch);
+} /* setFramebuffer() */
+
 void JPEGDEC::setPixelType(int iType)
 {
     if (iType >= 0 && iType < INVALID_PIXEL_TYPE) {
@@ -54,11 +71,44 @@ void JPEGDEC::setMaxOutputSize(int iMaxMCUs)
     _jpeg.iMaxMCUs = iMaxMCUs;
 } /* setMaxOutputSize() */
 //
+// Only decode the MCUs inside this area of the image (call after open)
+// The area is expanded to whole MCUs, and output pixels are placed relative
+// to its top left corner (plus the x/y given to decode)
+//
+void JPEGDEC::setCropArea(int x, int y, int w, int h)
+{
+    JPEG_setCropArea(&_jpeg, x, y, w, h);
+} /* setCropArea() */
+
+void JPEGDEC::getCropArea(int *x, int *y, int *w, int *h)
+{
+    JPEG_getCropArea(&_jpeg, x, y, w, h);
+} /* getCropArea() */
+
+//
+// open() keeps the expanded Huffman tables when the DHT segments of the new
+// image match the previous one; this forces them to be rebuilt (e.g. to measure)
+//
+void JPEGDEC::invalidateTables()
+{
+    JPEG_invalidateTables(&_jpeg);
+} /* invalidateTables() */
+
+int JPEGDEC::getTablesReused()
+{
+    return JPEG_getTablesReused(&_jpeg);
+} /* getTablesReused() */
+
+int JPEGDEC::dspSelfTest(JPEGDSPSTATS *pStats, JPEG_CYCLES_CALLBACK *pfnCycles)
+{
+    return JPEG_dspSelfTest(pStats, pfnCycles);
+} /* dspSelfTest() */
+//
 // Memory initialization
 //
 int JPEGDEC::openRAM(uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw)
 {
-    memset(&_jpeg, 0, sizeof(JPEGIMAGE));
+    memset(&_jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keep the Huffman tables
     _jpeg.ucMemType = JPEG_MEM_RAM;
     _jpeg.pfnRead = readRAM;
     _jpeg.pfnSeek = seekMem;
@@ -73,7 +123,7 @@ int JPEGDEC::openRAM(uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw)
 
 int JPEGDEC::openFLASH(uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw)
 {
-    memset(&_jpeg, 0, sizeof(JPEGIMAGE));
+    memset(&_jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keep the Huffman tables
     _jpeg.ucMemType = JPEG_MEM_FLASH;
     _jpeg.pfnRead = readFLASH;
     _jpeg.pfnSeek = seekMem;
@@ -136,7 +186,7 @@ int JPEGDEC::getSubSample()
 //
 int JPEGDEC::open(const char *szFilename, JPEG_OPEN_CALLBACK *pfnOpen, JPEG_CLOSE_CALLBACK *pfnClose, JPEG_READ_CALLBACK *pfnRead, JPEG_SEEK_CALLBACK *pfnSeek, JPEG_DRAW_CALLBACK *pfnDraw)
 {
-    memset(&_jpeg, 0, sizeof(JPEGIMAGE));
+    memset(&_jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keep the Huffman tables
     _jpeg.pfnRead = pfnRead;
     _jpeg.pfnSeek = pfnSeek;
     _jpeg.pfnDraw = pfnDraw;
@@ -156,7 +206,7 @@ int JPEGDEC::open(const char *szFilename, JPEG_OPEN_CALLBACK *pfnOpen, JPEG_CLOS
 //
 int JPEGDEC::open(void *fHandle, int iDataSize, JPEG_CLOSE_CALLBACK *pfnClose, JPEG_READ_CALLBACK *pfnRead, JPEG_SEEK_CALLBACK *pfnSeek, JPEG_DRAW_CALLBACK *pfnDraw)
 {
-    memset(&_jpeg, 0, sizeof(JPEGIMAGE));
+    memset(&_jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keep the Huffman tables
     _jpeg.pfnRead = pfnRead;
     _jpeg.pfnSeek = pfnSeek;
     _jpeg.pfnDraw = pfnDraw;
@@ -186,7 +236,7 @@ int JPEGDEC::open(File &file, JPEG_DRAW_CALLBACK *pfnDraw)
     if (!file) {
         return 0;
     }
-    memset(&_jpeg, 0, sizeof(JPEGIMAGE));
+    memset(&_jpeg, 0, JPEG_OPEN_CLEAR_SIZE);    // keep the Huffman tables
     _jpeg.pfnRead = FileRead;
     _jpeg.pfnSeek = FileSeek;
     _jpeg.pfnClose = FileClose;
@@ -232,3 +282,22 @@ int JPEGDEC::decodeDither(uint8_t *pDither, int iOptions)
     _jpeg.pDitherBuffer = pDither;
     return DecodeJPEG(&_jpeg);
 }
+//
+// Incremental decode: decodeStart() takes the same parameters as decode(),
+// then each decodeRows() call decodes at most iMaxRows rows of MCUs so the
+// caller can do other work between calls. Don't open another image until
+// decodeRows() has returned 0 or -1.
+//
+int JPEGDEC::decodeStart(int x, int y, int iOptions)
+{
+    _jpeg.iXOffset = x;
+    _jpeg.iYOffset = y;
+    _jpeg.iOptions = iOptions;
+    _jpeg.ucDecodeState = JPEG_DECODE_START;
+    return 1;
+} /* decodeStart() */
+
+int JPEGDEC::decodeRows(int iMaxRows)
+{
+    return JPEGDecodeRows(&_jpeg, iMaxRows);
+} /* decodeRows() */
@@ -24,6 +24,7 @@
 #include <FS.h>
 #endif
 #endif
+#include <stddef.h>    // offsetof()
 #ifndef PROGMEM
 #define memcpy_P memcpy
 #define PROGMEM
@@ -56,6 +57,8 @@
 #define MAX_MCU_COUNT       6
 #define MAX_COMPS_IN_SCAN   4
 #define MAX_BUFFERED_PIXELS 2048
+#define JPEG_MAX_RST_MARKS  64    // restart marker positions remembered in the VLC buffer
+#define JPEG_DHT_COPY_SIZE  1092  // DHT bytes kept with the expanded tables (4 full tables)
 
 // Decoder options
 #define JPEG_AUTO_ROTATE    1
@@ -100,6 +103,14 @@ enum {
     JPEG_MEM_FLASH
 };
 
+// Incremental decode progress (decodeStart() / decodeRows())
+enum {
+    JPEG_DECODE_IDLE = 0,
+    JPEG_DECODE_START,
+    JPEG_DECODE_RUNNING,
+    JPEG_DECODE_DONE
+};
+
 // Error codes returned by getLastError()
 enum {
     JPEG_SUCCESS = 0,
@@ -137,6 +148,16 @@ typedef int32_t(JPEG_SEEK_CALLBACK)(JPEGFILE *pFile, int32_t iPosition);
 typedef int(JPEG_DRAW_CALLBACK)(JPEGDRAW *pDraw);
 typedef void *(JPEG_OPEN_CALLBACK)(const char *szFilename, int32_t *pFileSize);
 typedef void(JPEG_CLOSE_CALLBACK)(void *pHandle);
+typedef uint32_t(JPEG_CYCLES_CALLBACK)(void);    // free running cycle counter for JPEG_dspSelfTest()
+
+// Result of comparing the DSP kernels with the C reference code
+#define JPEG_DSP_BENCH_LOOPS 64
+typedef struct jpeg_dsp_stats_tag {
+    int iMismatches;       // outputs which differ from the C code
+    int iPixelsChecked;    // outputs compared
+    uint32_t u32PixelRefCycles, u32PixelDspCycles;    // JPEG_DSP_BENCH_LOOPS x 128 RGB565 pixel pairs
+    uint32_t u32IDCTRefCycles, u32IDCTDspCycles;      // JPEG_DSP_BENCH_LOOPS x 8 rows of IDCT output
+} JPEGDSPSTATS;
 
 /* JPEG color component info */
 typedef struct _jpegcompinfo {
@@ -181,6 +202,7 @@ typedef struct jpeg_image_tag {
     int iThumbWidth, iThumbHeight;    // thumbnail size (if present)
     int iThumbData;                   // offset to image data
     int iXOffset, iYOffset;           // placement on the display
+    int iCropX, iCropY, iCropCX, iCropCY;    // MCU aligned crop area in image pixels (0 width = no crop)
     uint8_t ucBpp, ucSubSample, ucHuffTableUsed;
     uint8_t ucMode, ucOrientation, ucHasThumb, b11Bit;
     uint8_t ucComponentsInScan, cApproxBitsLow, cApproxBitsHigh;
@@ -210,11 +232,29 @@ typedef struct jpeg_image_tag {
     int16_t *sMCUs;                                           // needs to be 16-byte aligned for S3 SIMD
     int16_t sUnalignedMCUs[8 + (DCTSIZE * MAX_MCU_COUNT)];    // 4:2:0 needs 6 DCT blocks per MCU
     void *pFramebuffer;
+    int iFBPitch;                             // pixels per framebuffer line (0 = image width rounded up to 8)
     int16_t sQuantTable[DCTSIZE * 4];         // quantization tables
     uint8_t ucFileBuf[JPEG_FILE_BUF_SIZE];    // holds temp data and pixel stack
+    int iRstCount;                            // restart markers noted in ucFileBuf (u16RstOff)
+    uint8_t bRstOverflow;                     // more markers than JPEG_MAX_RST_MARKS were seen
+    uint8_t bTablesReused;                    // Huffman tables of the last open() were reused
+    uint8_t ucDecodeState;                    // JPEG_DECODE_xxx for decodeRows()
+    int iDecodeRow;                           // next MCU row of an incremental decode
+    int iDCPred[3];                           // DC predictors kept between decodeRows() calls
+    uint16_t u16RstOff[JPEG_MAX_RST_MARKS];
+    uint32_t u32HuffHash;                     // fingerprint of the DHT segments being parsed
+    uint32_t u32HuffLen;                      // bytes of DHT segments parsed so far
+    // The class open() functions leave everything from here on untouched, so consecutive
+    // images with identical DHT segments (e.g. MJPEG frames) reuse the expanded tables
+    uint32_t u32TableHash;                    // fingerprint the tables below were built from (0 = not built)
+    uint32_t u32TableDHTLen;                  // length of the DHT bytes the tables were built from
+    uint8_t ucTableMode;                      // SOF marker (ucMode) the tables were built for; progressive tables differ
+    uint8_t ucTableDHT[JPEG_DHT_COPY_SIZE];   // copy of those bytes; a matching hash alone is not trusted
     uint8_t ucHuffDC[DC_TABLE_SIZE * 2];      // up to 2 'short' tables
     uint16_t usHuffAC[HUFF11SIZE * 2];
 } JPEGIMAGE;
+// bytes cleared by open(); the Huffman tables and their fingerprint are kept
+#define JPEG_OPEN_CLEAR_SIZE offsetof(JPEGIMAGE, u32TableHash)
 
 #ifdef __cplusplus
 #if defined(__has_include) && __has_include(<FS.h>)
@@ -226,11 +266,13 @@ typedef struct jpeg_image_tag {
 //
 class JPEGDEC {
 public:
+    JPEGDEC();
     int openRAM(uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw);
     int openFLASH(uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw);
     int open(const char *szFilename, JPEG_OPEN_CALLBACK *pfnOpen, JPEG_CLOSE_CALLBACK *pfnClose, JPEG_READ_CALLBACK *pfnRead, JPEG_SEEK_CALLBACK *pfnSeek, JPEG_DRAW_CALLBACK *pfnDraw);
     int open(void *fHandle, int iDataSize, JPEG_CLOSE_CALLBACK *pfnClose, JPEG_READ_CALLBACK *pfnRead, JPEG_SEEK_CALLBACK *pfnSeek, JPEG_DRAW_CALLBACK *pfnDraw);
     void setFramebuffer(void *pFramebuffer);
+    void setFramebuffer(void *pFramebuffer, int iPitch);    // iPitch in pixels, e.g. the display width
 
 #ifdef FS_H
     int open(File &file, JPEG_DRAW_CALLBACK *pfnDraw);
@@ -238,6 +280,8 @@ public:
     void close();
     int decode(int x, int y, int iOptions);
     int decodeDither(uint8_t *pDither, int iOptions);
+    int decodeStart(int x, int y, int iOptions);    // begin a decode performed by decodeRows()
+    int decodeRows(int iMaxRows);                   // returns MCU rows left (0 = done), -1 on error
     int getOrientation();
     int getWidth();
     int getHeight();
@@ -250,6 +294,11 @@ public:
     int getLastError();
     void setPixelType(int iType);    // defaults to little endian
     void setMaxOutputSize(int iMaxMCUs);
+    void setCropArea(int x, int y, int w, int h);    // call after open(), aligned to MCU boundaries
+    void getCropArea(int *x, int *y, int *w, int *h);
+    void invalidateTables();    // force the next open() to rebuild the Huffman tables
+    int getTablesReused();      // 1 if the last open() reused the previous Huffman tables
+    static int dspSelfTest(JPEGDSPSTATS *pStats, JPEG_CYCLES_CALLBACK *pfnCycles);
 
 private:
     JPEGIMAGE _jpeg;
@@ -258,11 +307,14 @@ private:
 #define JPEG_STATIC
 int JPEG_openRAM(JPEGIMAGE *pJPEG, uint8_t *pData, int iDataSize, JPEG_DRAW_CALLBACK *pfnDraw);
 void JPEG_setFramebuffer(JPEGIMAGE *pJPEG, void *pFramebuffer);
+void JPEG_setFramebufferPitch(JPEGIMAGE *pJPEG, int iPitch);
 int JPEG_openFile(JPEGIMAGE *pJPEG, const char *szFilename, JPEG_DRAW_CALLBACK *pfnDraw);
 int JPEG_getWidth(JPEGIMAGE *pJPEG);
 int JPEG_getHeight(JPEGIMAGE *pJPEG);
 int JPEG_decode(JPEGIMAGE *pJPEG, int x, int y, int iOptions);
 int JPEG_decodeDither(JPEGIMAGE *pJPEG, uint8_t *pDither, int iOptions);
+int JPEG_decodeStart(JPEGIMAGE *pJPEG, int x, int y, int iOptions);
+int JPEG_decodeRows(JPEGIMAGE *pJPEG, int iMaxRows);
 void JPEG_close(JPEGIMAGE *pJPEG);
 int JPEG_getLastError(JPEGIMAGE *pJPEG);
 int JPEG_getOrientation(JPEGIMAGE *pJPEG);
@@ -274,6 +326,11 @@ int JPEG_getThumbHeight(JPEGIMAGE *pJPEG);
 int JPEG_getLastError(JPEGIMAGE *pJPEG);
 void JPEG_setPixelType(JPEGIMAGE *pJPEG, int iType);    // defaults to little endian
 void JPEG_setMaxOutputSize(JPEGIMAGE *pJPEG, int iMaxMCUs);
+void JPEG_setCropArea(JPEGIMAGE *pJPEG, int x, int y, int w, int h);
+void JPEG_getCropArea(JPEGIMAGE *pJPEG, int *x, int *y, int *w, int *h);
+void JPEG_invalidateTables(JPEGIMAGE *pJPEG);
+int JPEG_getTablesReused(JPEGIMAGE *pJPEG);
+int JPEG_dspSelfTest(JPEGDSPSTATS *pStats, JPEG_CYCLES_CALLBACK *pfnCycles);
 #endif    // __cplusplus
 
 #ifdef ALLOWS_UNALIGNED
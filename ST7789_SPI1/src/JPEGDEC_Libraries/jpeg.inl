@@ -57,11 +57,25 @@ int16_t i16_Consts[8] = {0x80, 113, 90, 22, 46, 1, 32, 2048};
 #define HAS_NEON
 #endif
 
+//
+// Armv8-M Mainline parts with the DSP extension (Cortex-M33, e.g. AmebaPro2)
+// have the same dual 16-bit saturating instructions as Cortex-M4/M7. The ACLE
+// intrinsics are used so that no CMSIS header is needed. Unlike HAS_SIMD, these
+// kernels are bit-exact with the table based C code (see JPEG_dspSelfTest())
+//
+#if !defined(HAS_SIMD) && !defined(NO_SIMD) && defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#define HAS_DSP
+#endif
+// Sign-extended 10-bit range table index ((x >> shift) & 0x3ff), a single SBFX on ARM
+#define JPEG_RANGE_INDEX(x, shift) ((int32_t)((uint32_t)(x) << (22 - (shift))) >> 22)
+
 // forward references
 static int JPEGInit(JPEGIMAGE *pJPEG);
 static int JPEGParseInfo(JPEGIMAGE *pPage, int bExtractThumb);
 static void JPEGGetMoreData(JPEGIMAGE *pPage);
 static int DecodeJPEG(JPEGIMAGE *pImage);
+static int JPEGDecodeRows(JPEGIMAGE *pJPEG, int iMaxRows);
 static int32_t readRAM(JPEGFILE *pFile, uint8_t *pBuf, int32_t iLen);
 static int32_t seekMem(JPEGFILE *pFile, int32_t iPosition);
 #if defined(__MACH__) || defined(__LINUX__) || defined(__MCUXPRESSO)
@@ -648,6 +662,11 @@ static void JPEG_setFramebuffer(JPEGIMAGE *pJPEG, void *pFramebuffer)
     pJPEG->pFramebuffer = pFramebuffer;
 } /* JPEG_setFramebuffer() */
 
+void JPEG_setFramebufferPitch(JPEGIMAGE *pJPEG, int iPitch)
+{
+    pJPEG->iFBPitch = iPitch;
+} /* JPEG_setFramebufferPitch() */
+
 void JPEG_setMaxOutputSize(JPEGIMAGE *pJPEG, int iMaxMCUs)
 {
     if (iMaxMCUs < 1) {
@@ -671,6 +690,20 @@ int JPEG_decodeDither(JPEGIMAGE *pJPEG, uint8_t *pDither, int iOptions)
     return DecodeJPEG(pJPEG);
 } /* JPEG_decodeDither() */
 
+int JPEG_decodeStart(JPEGIMAGE *pJPEG, int x, int y, int iOptions)
+{
+    pJPEG->iXOffset = x;
+    pJPEG->iYOffset = y;
+    pJPEG->iOptions = iOptions;
+    pJPEG->ucDecodeState = JPEG_DECODE_START;
+    return 1;
+} /* JPEG_decodeStart() */
+
+int JPEG_decodeRows(JPEGIMAGE *pJPEG, int iMaxRows)
+{
+    return JPEGDecodeRows(pJPEG, iMaxRows);
+} /* JPEG_decodeRows() */
+
 void JPEG_close(JPEGIMAGE *pJPEG)
 {
     if (pJPEG->pfnClose) {
@@ -730,6 +763,77 @@ static void JPEG_setFramebuffer(JPEGIMAGE *pJPEG, void *pFramebuffer)
     pJPEG->pFramebuffer = pFramebuffer;
 } /* JPEG_setFramebuffer() */
 
+//
+// Lines of the framebuffer are iPitch pixels apart instead of the image width.
+// MCUs are written whole, so the buffer must hold the crop area rounded up to
+// whole MCUs at the output scale (nothing is clipped to the pitch)
+//
+static void JPEG_setFramebufferPitch(JPEGIMAGE *pJPEG, int iPitch)
+{
+    pJPEG->iFBPitch = iPitch;
+} /* JPEG_setFramebufferPitch() */
+//
+// Set the area of the image to decode (must be called after the header is parsed)
+// The area is expanded outwards to MCU boundaries; a zero width/height removes the crop
+//
+JPEG_STATIC void JPEG_setCropArea(JPEGIMAGE *pJPEG, int x, int y, int w, int h)
+{
+    int iMCUX, iMCUY, x2, y2;
+
+    pJPEG->iCropX = pJPEG->iCropY = pJPEG->iCropCX = pJPEG->iCropCY = 0;
+    if (w <= 0 || h <= 0) {
+        return;    // no crop, decode the whole image
+    }
+    iMCUX = (pJPEG->ucSubSample == 0x21 || pJPEG->ucSubSample == 0x22) ? 16 : 8;
+    iMCUY = (pJPEG->ucSubSample == 0x12 || pJPEG->ucSubSample == 0x22) ? 16 : 8;
+    x2 = x + w;
+    y2 = y + h;
+    if (x < 0) {
+        x = 0;
+    }
+    if (y < 0) {
+        y = 0;
+    }
+    if (x2 > pJPEG->iWidth) {
+        x2 = pJPEG->iWidth;
+    }
+    if (y2 > pJPEG->iHeight) {
+        y2 = pJPEG->iHeight;
+    }
+    if (x >= x2 || y >= y2) {
+        pJPEG->iError = JPEG_INVALID_PARAMETER;
+        return;
+    }
+    x &= ~(iMCUX - 1);
+    y &= ~(iMCUY - 1);
+    x2 = (x2 + iMCUX - 1) & ~(iMCUX - 1);
+    y2 = (y2 + iMCUY - 1) & ~(iMCUY - 1);
+    pJPEG->iCropX = x;
+    pJPEG->iCropY = y;
+    pJPEG->iCropCX = ((x2 > pJPEG->iWidth) ? pJPEG->iWidth : x2) - x;
+    pJPEG->iCropCY = ((y2 > pJPEG->iHeight) ? pJPEG->iHeight : y2) - y;
+} /* JPEG_setCropArea() */
+
+JPEG_STATIC void JPEG_getCropArea(JPEGIMAGE *pJPEG, int *x, int *y, int *w, int *h)
+{
+    *x = pJPEG->iCropX;
+    *y = pJPEG->iCropY;
+    *w = pJPEG->iCropCX;
+    *h = pJPEG->iCropCY;
+} /* JPEG_getCropArea() */
+//
+// Forget the expanded Huffman tables so the next open() rebuilds them
+//
+JPEG_STATIC void JPEG_invalidateTables(JPEGIMAGE *pJPEG)
+{
+    pJPEG->u32TableHash = 0;
+} /* JPEG_invalidateTables() */
+
+JPEG_STATIC int JPEG_getTablesReused(JPEGIMAGE *pJPEG)
+{
+    return pJPEG->bTablesReused;
+} /* JPEG_getTablesReused() */
+
 #if defined(__MACH__) || defined(__LINUX__) || defined(__MCUXPRESSO)
 
 static void closeFile(void *handle)
@@ -787,6 +891,21 @@ static int JPEGGetHuffTables(uint8_t *pBuf, int iLen, JPEGIMAGE *pJPEG)
     int i, j, iOffset, iTableOffset;
     uint8_t ucTable, *pHuffVals;
 
+    // fingerprint the segment (FNV-1a) so identical tables in the next image can be reused
+    for (i = 0; i < iLen; i++) {
+        pJPEG->u32HuffHash = (pJPEG->u32HuffHash ^ pBuf[i]) * 16777619;
+    }
+    // keep a copy of the DHT bytes next to the tables, reuse needs the bytes to match as well
+    if (pJPEG->u32HuffLen + iLen <= JPEG_DHT_COPY_SIZE) {
+        uint8_t *pCopy = &pJPEG->ucTableDHT[pJPEG->u32HuffLen];
+        if (memcmp(pCopy, pBuf, iLen) != 0) {
+            pJPEG->u32TableHash = 0;    // the copy no longer describes the expanded tables
+            memcpy(pCopy, pBuf, iLen);
+        }
+    } else {
+        pJPEG->u32TableHash = 0;    // too many tables to keep a copy, always rebuild
+    }
+    pJPEG->u32HuffLen += iLen;
     iOffset = 0;
     pHuffVals = (uint8_t *)pJPEG->usPixels;    // temp holding area to save RAM
     while (iLen > 17)                          // while there are tables to copy (we may have combined more than 1 table together)
@@ -1340,12 +1459,28 @@ static int JPEGGetSOS(JPEGIMAGE *pJPEG, int *iOff)
 
 } /* JPEGGetSOS() */
 //
+// Remember where a restart interval starts in the filtered data so that
+// cropped decodes can jump over whole intervals (see JPEGSkipRestarts)
+//
+static void JPEGMarkRestart(JPEGIMAGE *pPage, uint8_t ucMarker, uint8_t *d)
+{
+    if ((ucMarker & 0xf8) != 0xd0) {    // only RST0-RST7
+        return;
+    }
+    if (pPage->iRstCount >= JPEG_MAX_RST_MARKS) {
+        pPage->bRstOverflow = 1;    // positions are incomplete from now on
+        return;
+    }
+    pPage->u16RstOff[pPage->iRstCount++] = (uint16_t)(d - pPage->ucFileBuf);
+} /* JPEGMarkRestart() */
+//
 // Remove markers from the data stream to allow faster decode
 // Stuffed zeros and restart interval markers aren't needed to properly decode
 // the data, but they make reading VLC data slower, so I pull them out first
 //
-static int JPEGFilter(uint8_t *pBuf, uint8_t *d, int iLen, uint8_t *bFF)
+static int JPEGFilter(JPEGIMAGE *pPage, uint8_t *pBuf, uint8_t *d, int iLen)
 {
+    uint8_t *bFF = &pPage->ucFF;
 #ifdef HAS_SSE
     __m128i xmmIn, xmmOut;
     __m128i xmmFF = _mm_cmpeq_epi8(xmmIn, xmmIn);
@@ -1366,6 +1501,8 @@ static int JPEGFilter(uint8_t *pBuf, uint8_t *d, int iLen, uint8_t *bFF)
     {
         if (s[0] == 0) {    // stuffed 0, keep the FF
             *d++ = 0xff;
+        } else {
+            JPEGMarkRestart(pPage, s[0], d);
         }
         s++;
         *bFF = 0;
@@ -1386,6 +1523,7 @@ static int JPEGFilter(uint8_t *pBuf, uint8_t *d, int iLen, uint8_t *bFF)
                 if (c == 0xff) {        // marker or stuffed zeros?
                     if (s[0] != 0) {    // it's a marker, skip both
                         d--;
+                        JPEGMarkRestart(pPage, s[0], d);
                     }
                     s++;    // for stuffed 0's, store the FF, skip the 00
                 }           // found FF
@@ -1416,6 +1554,7 @@ static int JPEGFilter(uint8_t *pBuf, uint8_t *d, int iLen, uint8_t *bFF)
                 if (c == 0xff) {        // marker or stuffed zeros?
                     if (s[0] != 0) {    // it's a marker, skip both
                         d--;
+                        JPEGMarkRestart(pPage, s[0], d);
                     }
                     s++;    // for stuffed 0's, store the FF, skip the 00
                 }           // found FF
@@ -1432,6 +1571,7 @@ static int JPEGFilter(uint8_t *pBuf, uint8_t *d, int iLen, uint8_t *bFF)
             if (s[0] != 0)    // it's a marker, skip both
             {
                 d--;
+                JPEGMarkRestart(pPage, s[0], d);
             }
             s++;    // for stuffed 0's, store the FF, skip the 00
         }
@@ -1459,6 +1599,13 @@ static void JPEGGetMoreData(JPEGIMAGE *pPage)
         return;    // buffer is already full; no need to read more data
     }
     if (pPage->iVLCOff != 0) {
+        int i, j;
+        for (i = j = 0; i < pPage->iRstCount; i++) {    // keep the restart positions in step with the data
+            if (pPage->u16RstOff[i] >= pPage->iVLCOff) {
+                pPage->u16RstOff[j++] = pPage->u16RstOff[i] - pPage->iVLCOff;
+            }
+        }
+        pPage->iRstCount = j;
         memcpy(pPage->ucFileBuf, &pPage->ucFileBuf[pPage->iVLCOff], pPage->iVLCSize - pPage->iVLCOff);
         pPage->iVLCSize -= pPage->iVLCOff;
         pPage->iVLCOff = 0;
@@ -1469,7 +1616,7 @@ static void JPEGGetMoreData(JPEGIMAGE *pPage)
         // Try to read enough to fill the buffer
         i = (*pPage->pfnRead)(&pPage->JPEGFile, &pPage->ucFileBuf[pPage->iVLCSize], JPEG_FILE_BUF_SIZE - pPage->iVLCSize);    // max length we can read
         // Filter out the markers
-        pPage->iVLCSize += JPEGFilter(&pPage->ucFileBuf[pPage->iVLCSize], &pPage->ucFileBuf[pPage->iVLCSize], i, &pPage->ucFF);
+        pPage->iVLCSize += JPEGFilter(pPage, &pPage->ucFileBuf[pPage->iVLCSize], &pPage->ucFileBuf[pPage->iVLCSize], i);
     }
 } /* JPEGGetMoreData() */
 
@@ -1500,6 +1647,9 @@ static int JPEGParseInfo(JPEGIMAGE *pPage, int bExtractThumb)
         i = 16;
     }
     pPage->sMCUs = &pPage->sUnalignedMCUs[(16 - i) >> 1];
+    pPage->u32HuffHash = 2166136261;    // FNV-1a offset basis
+    pPage->u32HuffLen = 0;
+    pPage->bTablesReused = 0;
 
     if (bExtractThumb)    // seek to the start of the thumbnail image
     {
@@ -1665,13 +1815,29 @@ static int JPEGParseInfo(JPEGIMAGE *pPage, int bExtractThumb)
             iOffset -= usLen;
             JPEGGetSOS(pPage, &iOffset);    // get Start-Of-Scan info for decoding
         }
-        if (!JPEGMakeHuffTables(pPage, 0))    // int bThumbnail) DEBUG
-        {
-            pPage->iError = JPEG_UNSUPPORTED_FEATURE;
-            return 0;
+        if (pPage->u32TableHash != 0 && pPage->u32TableHash == pPage->u32HuffHash && pPage->u32TableDHTLen == pPage->u32HuffLen &&
+            pPage->ucTableMode == pPage->ucMode) {
+            pPage->bTablesReused = 1;    // same DHT bytes and frame type as the last image (checked against the copy), tables are still valid
+        } else {
+            // the tables are filled sparsely, so start from a clean slate like a fresh open()
+            pPage->u32TableHash = 0;
+            memset(pPage->ucHuffDC, 0, sizeof(pPage->ucHuffDC));
+            memset(pPage->usHuffAC, 0, sizeof(pPage->usHuffAC));
+            if (!JPEGMakeHuffTables(pPage, 0))    // int bThumbnail) DEBUG
+            {
+                pPage->iError = JPEG_UNSUPPORTED_FEATURE;
+                return 0;
+            }
+            if (pPage->u32HuffLen <= JPEG_DHT_COPY_SIZE) {
+                pPage->u32TableDHTLen = pPage->u32HuffLen;
+                pPage->ucTableMode = pPage->ucMode;
+                pPage->u32TableHash = pPage->u32HuffHash;
+            }
         }
         // Now the offset points to the start of compressed data
-        i = JPEGFilter(&pPage->ucFileBuf[iOffset], pPage->ucFileBuf, iBytesRead - iOffset, &pPage->ucFF);
+        pPage->iRstCount = 0;
+        pPage->bRstOverflow = 0;
+        i = JPEGFilter(pPage, &pPage->ucFileBuf[iOffset], pPage->ucFileBuf, iBytesRead - iOffset);
         pPage->iVLCOff = 0;
         pPage->iVLCSize = i;
         JPEGGetMoreData(pPage);    // read more VLC data
@@ -1896,6 +2062,224 @@ mcu_done:
     return 0;
 } /* JPEGDecodeMCU() */
 //
+// Walk over the Huffman codes of one 8x8 block outside of the crop area
+// Only the DC predictor is kept; no coefficients are extracted or stored
+//
+static int JPEGSkipBlock(JPEGIMAGE *pJPEG, int *iDCPredictor)
+{
+    my_ulong ulCode, ulTemp;
+    unsigned short *pFast;
+    unsigned char ucHuff, *pucFast;
+    uint32_t usHuff;
+    uint32_t ulBitOff;
+    my_ulong ulBits;
+    uint8_t *pBuf;
+    signed char cCoeff;
+    int iCoeff;
+
+    ulBitOff = pJPEG->bb.ulBitOff;
+    ulBits = pJPEG->bb.ulBits;
+    pBuf = pJPEG->bb.pBuf;
+    if (ulBitOff > (REGISTER_WIDTH - 17))    // need to get more data
+    {
+        pBuf += (ulBitOff >> 3);
+        ulBitOff &= 7;
+        ulBits = MOTOLONG(pBuf);
+    }
+    // the DC value is still needed as the base for the next block
+    pucFast = &pJPEG->ucHuffDC[pJPEG->ucDCTable * DC_TABLE_SIZE];
+    ulCode = (ulBits >> (REGISTER_WIDTH - 12 - ulBitOff)) & 0xfff;
+    if (ulCode >= 0xf80) {
+        ulCode = (ulCode & 0xff);
+    } else {
+        ulCode >>= 6;
+    }
+    ucHuff = pucFast[ulCode];
+    cCoeff = (signed char)pucFast[ulCode + 512];
+    if (ucHuff == 0) {    // invalid code
+        return -1;
+    }
+    ulBitOff += (ucHuff >> 4);
+    ucHuff &= 0xf;
+    if (ucHuff) {
+        if (cCoeff) {
+            (*iDCPredictor) += cCoeff;
+        } else {
+            if (ulBitOff > (REGISTER_WIDTH - 17)) {
+                pBuf += (ulBitOff >> 3);
+                ulBitOff &= 7;
+                ulBits = MOTOLONG(pBuf);
+            }
+            ulCode = ulBits << ulBitOff;
+            ulTemp = ~(my_ulong)(((my_long)ulCode) >> (REGISTER_WIDTH - 1));
+            ulCode >>= (REGISTER_WIDTH - ucHuff);
+            ulCode -= ulTemp >> (REGISTER_WIDTH - ucHuff);
+            ulBitOff += ucHuff;
+            (*iDCPredictor) += (int)ulCode;
+        }
+    }
+    if (pJPEG->ucACTable > 1) {
+        return -1;
+    }
+    // AC coefficients - only the code and extra bit lengths matter
+    pFast = &pJPEG->usHuffAC[pJPEG->ucACTable * HUFF11SIZE];
+    iCoeff = 1;
+    while (iCoeff < 64) {
+        if (ulBitOff > (REGISTER_WIDTH - 17)) {
+            pBuf += (ulBitOff >> 3);
+            ulBitOff &= 7;
+            ulBits = MOTOLONG(pBuf);
+        }
+        ulCode = (ulBits >> (REGISTER_WIDTH - 16 - ulBitOff)) & 0xffff;
+        if (pJPEG->b11Bit) {    // 11-bit "slow" tables
+            ulCode = (ulCode >= 0xf000) ? (ulCode & 0x1fff) : (ulCode >> 4);
+        } else {    // 10-bit "fast" tables
+            ulCode = (ulCode >= 0xfc00) ? (ulCode & 0x7ff) : (ulCode >> 6);
+        }
+        usHuff = pFast[ulCode];
+        if (usHuff == 0) {    // invalid code
+            return -1;
+        }
+        ulBitOff += (usHuff >> 8) + (usHuff & 0xf);    // code length + (SSSS) extra length
+        usHuff &= 0xff;
+        if (usHuff == 0) {    // no more AC components
+            break;
+        }
+        iCoeff += (usHuff >> 4) + 1;    // (RRRR) zeros + this one
+    }
+    pJPEG->bb.pBuf = pBuf;
+    pJPEG->iVLCOff = (int)(pBuf - pJPEG->ucFileBuf);
+    pJPEG->bb.ulBitOff = ulBitOff;
+    pJPEG->bb.ulBits = ulBits;
+    return 0;
+} /* JPEGSkipBlock() */
+//
+// Jump over whole restart intervals using the marker positions noted by
+// JPEGFilter; must be called at the start of an interval. Decoding always
+// resumes at a known marker, so an interval longer than the buffer (or too
+// many markers to remember) just ends the jump early
+// Returns the number of intervals jumped
+//
+static int JPEGSkipRestarts(JPEGIMAGE *pJPEG, int iIntervals)
+{
+    int i, iAvail, iPos, iJumped = 0;
+
+    iPos = (int)(pJPEG->bb.pBuf - pJPEG->ucFileBuf) + (int)(pJPEG->bb.ulBitOff >> 3);
+    while (iIntervals > 0 && !pJPEG->bRstOverflow) {
+        for (i = 0; i < pJPEG->iRstCount && pJPEG->u16RstOff[i] <= iPos; i++) {
+        }
+        iAvail = pJPEG->iRstCount - i;    // markers ahead of the current position
+        if (iAvail == 0) {
+            break;
+        }
+        if (iAvail > iIntervals) {
+            iAvail = iIntervals;
+        }
+        iPos = pJPEG->u16RstOff[i + iAvail - 1];
+        iJumped += iAvail;
+        iIntervals -= iAvail;
+        pJPEG->iVLCOff = iPos;
+        pJPEG->bb.pBuf = &pJPEG->ucFileBuf[iPos];
+        if (iPos < FILE_HIGHWATER) {    // same refill rule as the decoder (the data move must not overlap)
+            break;
+        }
+        JPEGGetMoreData(pJPEG);    // move the new interval to the start of the buffer and read more behind it
+        iPos = (int)(pJPEG->bb.pBuf - pJPEG->ucFileBuf);
+    }
+    if (iJumped) {
+        pJPEG->bb.ulBitOff = 0;
+        pJPEG->bb.ulBits = MOTOLONG(pJPEG->bb.pBuf);
+    }
+    return iJumped;
+} /* JPEGSkipRestarts() */
+//
+// Per-MCU housekeeping: restart interval bookkeeping and refilling the VLC buffer
+//
+static void JPEGNextMCU(JPEGIMAGE *pJPEG, int *iDCPred0, int *iDCPred1, int *iDCPred2)
+{
+    if (pJPEG->iResInterval) {
+        if (--pJPEG->iResCount == 0) {
+            pJPEG->iResCount = pJPEG->iResInterval;
+            *iDCPred0 = *iDCPred1 = *iDCPred2 = 0;    // reset DC predictors
+            if (pJPEG->bb.ulBitOff & 7)               // need to start at the next even byte
+            {
+                pJPEG->bb.ulBitOff += (8 - (pJPEG->bb.ulBitOff & 7));    // new restart interval starts on byte boundary
+            }
+        }    // if restart interval needs to reset
+    }        // if there is a restart interval
+    // See if we need to feed it more data
+    if (pJPEG->iVLCOff >= FILE_HIGHWATER) {
+        JPEGGetMoreData(pJPEG);    // need more 'filtered' VLC data
+    }
+} /* JPEGNextMCU() */
+//
+// Pass over MCUs outside of the crop area without doing the IDCT or color conversion
+// Whole restart intervals are jumped when the marker positions are known
+//
+static int JPEGSkipMCUs(JPEGIMAGE *pJPEG, int iCount, int iLumBlocks, int *iDCPred0, int *iDCPred1, int *iDCPred2)
+{
+    int i, iErr = 0;
+
+    while (iCount > 0 && iErr == 0) {
+        if (pJPEG->iResInterval && pJPEG->iResCount == pJPEG->iResInterval && iCount >= pJPEG->iResInterval) {
+            i = JPEGSkipRestarts(pJPEG, iCount / pJPEG->iResInterval);
+            if (i > 0) {
+                iCount -= i * pJPEG->iResInterval;
+                continue;
+            }
+        }
+        pJPEG->ucDCTable = pJPEG->JPCI[0].dc_tbl_no;
+        pJPEG->ucACTable = pJPEG->JPCI[0].ac_tbl_no;
+        for (i = 0; i < iLumBlocks; i++) {
+            iErr |= JPEGSkipBlock(pJPEG, iDCPred0);
+        }
+        if (pJPEG->ucSubSample && pJPEG->ucNumComponents == 3) {    // if color (not CMYK)
+            pJPEG->ucDCTable = pJPEG->JPCI[1].dc_tbl_no;
+            pJPEG->ucACTable = pJPEG->JPCI[1].ac_tbl_no;
+            iErr |= JPEGSkipBlock(pJPEG, iDCPred1);
+            pJPEG->ucDCTable = pJPEG->JPCI[2].dc_tbl_no;
+            pJPEG->ucACTable = pJPEG->JPCI[2].ac_tbl_no;
+            iErr |= JPEGSkipBlock(pJPEG, iDCPred2);
+        }
+        JPEGNextMCU(pJPEG, iDCPred0, iDCPred1, iDCPred2);
+        iCount--;
+    }
+    return iErr;
+} /* JPEGSkipMCUs() */
+//
+// IDCT final output stage - scale down and range limit one row of 8 pixels
+// (also the reference for the DSP version)
+//
+static inline void JPEGRangeLimitRow_C(uint8_t *pOutput, int32_t i0, int32_t i1, int32_t i2, int32_t i3, int32_t i4, int32_t i5, int32_t i6, int32_t i7)
+{
+    // I've tried various things to speed this up, but it always seems to take the same amount of time
+    pOutput[0] = ucRangeTable[((i0 >> 5) & 0x3ff)];
+    pOutput[1] = ucRangeTable[((i1 >> 5) & 0x3ff)];
+    pOutput[2] = ucRangeTable[((i2 >> 5) & 0x3ff)];
+    pOutput[3] = ucRangeTable[((i3 >> 5) & 0x3ff)];
+    pOutput[4] = ucRangeTable[((i4 >> 5) & 0x3ff)];
+    pOutput[5] = ucRangeTable[((i5 >> 5) & 0x3ff)];
+    pOutput[6] = ucRangeTable[((i6 >> 5) & 0x3ff)];
+    pOutput[7] = ucRangeTable[((i7 >> 5) & 0x3ff)];
+} /* JPEGRangeLimitRow_C() */
+#ifdef HAS_DSP
+//
+// ucRangeTable[i] is the 10-bit signed index + 128 clamped to 0..255, so two
+// outputs at a time can be done with SSAT16 instead of byte lookups in flash
+//
+static inline uint32_t JPEGRangeLimitPair_DSP(int32_t i1, int32_t i2)
+{
+    uint32_t ul = ((uint32_t)JPEG_RANGE_INDEX(i1, 5) & 0xffff) | ((uint32_t)JPEG_RANGE_INDEX(i2, 5) << 16);
+    return __sadd16(__ssat16(ul, 8), 0x00800080);
+} /* JPEGRangeLimitPair_DSP() */
+
+static inline void JPEGRangeLimitRow_DSP(uint8_t *pOutput, int32_t i0, int32_t i1, int32_t i2, int32_t i3, int32_t i4, int32_t i5, int32_t i6, int32_t i7)
+{
+    *(uint32_t *)&pOutput[0] = JPEGRangeLimitPair_DSP(i0, i2) | (JPEGRangeLimitPair_DSP(i1, i3) << 8);
+    *(uint32_t *)&pOutput[4] = JPEGRangeLimitPair_DSP(i4, i6) | (JPEGRangeLimitPair_DSP(i5, i7) << 8);
+} /* JPEGRangeLimitRow_DSP() */
+#endif    // HAS_DSP
+//
 // Inverse DCT
 //
 static void JPEGIDCT(JPEGIMAGE *pJPEG, int iMCUOffset, int iQuantTable)
@@ -2368,16 +2752,10 @@ static void JPEGIDCT(JPEGIMAGE *pJPEG, int iMCUOffset, int iQuantTable)
             ulOut |= (ul << 8);                  // combine 4 outputs
             *(uint32_t *)&pOutput[4] = ulOut;    // store second 4
         }
+#elif defined(HAS_DSP)
+        JPEGRangeLimitRow_DSP(pOutput, tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 - tmp4, tmp3 + tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7);
 #else
-        // I've tried various things to speed this up, but it always seems to take the same amount of time
-        pOutput[0] = ucRangeTable[(((tmp0 + tmp7) >> 5) & 0x3ff)];
-        pOutput[1] = ucRangeTable[(((tmp1 + tmp6) >> 5) & 0x3ff)];
-        pOutput[2] = ucRangeTable[(((tmp2 + tmp5) >> 5) & 0x3ff)];
-        pOutput[3] = ucRangeTable[(((tmp3 - tmp4) >> 5) & 0x3ff)];
-        pOutput[4] = ucRangeTable[(((tmp3 + tmp4) >> 5) & 0x3ff)];
-        pOutput[5] = ucRangeTable[(((tmp2 - tmp5) >> 5) & 0x3ff)];
-        pOutput[6] = ucRangeTable[(((tmp1 - tmp6) >> 5) & 0x3ff)];
-        pOutput[7] = ucRangeTable[(((tmp0 - tmp7) >> 5) & 0x3ff)];
+        JPEGRangeLimitRow_C(pOutput, tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 - tmp4, tmp3 + tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7);
 #endif
         pOutput += 8;
     }    // for each row
@@ -2626,6 +3004,79 @@ static void JPEGPutMCUGray(JPEGIMAGE *pJPEG, int x, int iPitch)
     }
 } /* JPEGPutMCUGray() */
 
+//
+// Reference C versions of the RGB565 little endian pixel conversion
+//
+static inline void JPEGPixelLE_C(uint16_t *pDest, int iY, int iCb, int iCr)
+{
+    int iCBB, iCBG, iCRG, iCRR;
+    unsigned short usPixel;
+
+    iCBB = 7258 * (iCb - 0x80);
+    iCBG = -1409 * (iCb - 0x80);
+    iCRG = -2925 * (iCr - 0x80);
+    iCRR = 5742 * (iCr - 0x80);
+    usPixel = usRangeTableB[((iCBB + iY) >> 12) & 0x3ff];            // blue pixel
+    usPixel |= usRangeTableG[((iCBG + iCRG + iY) >> 12) & 0x3ff];    // green pixel
+    usPixel |= usRangeTableR[((iCRR + iY) >> 12) & 0x3ff];           // red pixel
+    pDest[0] = usPixel;
+} /* JPEGPixelLE_C() */
+
+static inline void JPEGPixel2LE_C(uint16_t *pDest, int iY1, int iY2, int iCb, int iCr)
+{
+    uint32_t ulPixel1, ulPixel2;
+    int iCBB, iCBG, iCRG, iCRR;
+    iCBB = 7258 * (iCb - 0x80);
+    iCBG = -1409 * (iCb - 0x80);
+    iCRG = -2925 * (iCr - 0x80);
+    iCRR = 5742 * (iCr - 0x80);
+    ulPixel1 = usRangeTableB[((iCBB + iY1) >> 12) & 0x3ff];            // blue pixel
+    ulPixel1 |= usRangeTableG[((iCBG + iCRG + iY1) >> 12) & 0x3ff];    // green pixel
+    ulPixel1 |= usRangeTableR[((iCRR + iY1) >> 12) & 0x3ff];           // red pixel
+
+    ulPixel2 = usRangeTableB[((iCBB + iY2) >> 12) & 0x3ff];            // blue pixel
+    ulPixel2 |= usRangeTableG[((iCBG + iCRG + iY2) >> 12) & 0x3ff];    // green pixel
+    ulPixel2 |= usRangeTableR[((iCRR + iY2) >> 12) & 0x3ff];           // red pixel
+    *(uint32_t *)&pDest[0] = (ulPixel1 | (ulPixel2 << 16));
+} /* JPEGPixel2LE_C() */
+#ifdef HAS_DSP
+//
+// The usRangeTableB/G/R entries are the 10-bit signed index clamped to 0..255
+// and then cut down to 5/6/5 bits, so the same result comes from USAT16 on two
+// pixels at once (one pixel per 16-bit half) without the three table lookups
+//
+static inline uint32_t JPEGClampPair_DSP(int32_t i1, int32_t i2)
+{
+    uint32_t ul = ((uint32_t)JPEG_RANGE_INDEX(i1, 12) & 0xffff) | ((uint32_t)JPEG_RANGE_INDEX(i2, 12) << 16);
+    return __usat16(ul, 8);
+} /* JPEGClampPair_DSP() */
+
+static inline uint32_t JPEGPixelPair_DSP(int iY1, int iY2, int iCb, int iCr)
+{
+    uint32_t ulCbCr, ulB, ulG, ulR;
+    int32_t iCBB, iCG, iCRR;
+
+    ulCbCr = __ssub16(iCb | (iCr << 16), 0x00800080);    // Cb - 128, Cr - 128
+    iCG = __smlad(ulCbCr, 0xf493fa7f, 0);                 // -1409 * Cb + -2925 * Cr
+    iCBB = 7258 * (iCb - 0x80);
+    iCRR = 5742 * (iCr - 0x80);
+    ulB = JPEGClampPair_DSP(iCBB + iY1, iCBB + iY2);
+    ulG = JPEGClampPair_DSP(iCG + iY1, iCG + iY2);
+    ulR = JPEGClampPair_DSP(iCRR + iY1, iCRR + iY2);
+    return ((ulB >> 3) & 0x001f001f) | ((ulG << 3) & 0x07e007e0) | ((ulR << 8) & 0xf800f800);
+} /* JPEGPixelPair_DSP() */
+
+static inline void JPEGPixelLE_DSP(uint16_t *pDest, int iY, int iCb, int iCr)
+{
+    pDest[0] = (uint16_t)JPEGPixelPair_DSP(iY, iY, iCb, iCr);
+} /* JPEGPixelLE_DSP() */
+
+static inline void JPEGPixel2LE_DSP(uint16_t *pDest, int iY1, int iY2, int iCb, int iCr)
+{
+    *(uint32_t *)&pDest[0] = JPEGPixelPair_DSP(iY1, iY2, iCb, iCr);
+} /* JPEGPixel2LE_DSP() */
+#endif    // HAS_DSP
+
 static void JPEGPixelLE(uint16_t *pDest, int iY, int iCb, int iCr)
 {
 //
@@ -2646,23 +3097,18 @@ static void JPEGPixelLE(uint16_t *pDest, int iY, int iCb, int iCr)
     ulTmp = __USAT16(ulTmp, 5);                    // range limit to 5 bits
     ulPixel |= (ulTmp << 11);                      // now we have R + G + B
     pDest[0] = (uint16_t)ulPixel;
+#elif defined(HAS_DSP)
+    JPEGPixelLE_DSP(pDest, iY, iCb, iCr);
 #else
-    int iCBB, iCBG, iCRG, iCRR;
-    unsigned short usPixel;
-
-    iCBB = 7258 * (iCb - 0x80);
-    iCBG = -1409 * (iCb - 0x80);
-    iCRG = -2925 * (iCr - 0x80);
-    iCRR = 5742 * (iCr - 0x80);
-    usPixel = usRangeTableB[((iCBB + iY) >> 12) & 0x3ff];            // blue pixel
-    usPixel |= usRangeTableG[((iCBG + iCRG + iY) >> 12) & 0x3ff];    // green pixel
-    usPixel |= usRangeTableR[((iCRR + iY) >> 12) & 0x3ff];           // red pixel
-    pDest[0] = usPixel;
+    JPEGPixelLE_C(pDest, iY, iCb, iCr);
 #endif
 } /* JPEGPixelLE() */
 
 static void JPEGPixelBE(uint16_t *pDest, int iY, int iCb, int iCr)
 {
+#ifdef HAS_DSP
+    pDest[0] = (uint16_t)__rev16(JPEGPixelPair_DSP(iY, iY, iCb, iCr));
+#else
     int iCBB, iCBG, iCRG, iCRR;
     unsigned short usPixel;
 
@@ -2674,6 +3120,7 @@ static void JPEGPixelBE(uint16_t *pDest, int iY, int iCb, int iCr)
     usPixel |= usRangeTableG[((iCBG + iCRG + iY) >> 12) & 0x3ff];    // green pixel
     usPixel |= usRangeTableR[((iCRR + iY) >> 12) & 0x3ff];           // red pixel
     pDest[0] = __builtin_bswap16(usPixel);
+#endif
 } /* JPEGPixelBE() */
 
 static void JPEGPixelRGB(uint32_t *pDest, int iY, int iCb, int iCr)
@@ -2713,12 +3160,12 @@ static void JPEGPixelRGB(uint32_t *pDest, int iY, int iCb, int iCr)
 
 static void JPEGPixel2LE(uint16_t *pDest, int iY1, int iY2, int iCb, int iCr)
 {
-    uint32_t ulPixel1, ulPixel2;
 //
 // Cortex-M4/M7 has some SIMD instructions which can shave a few cycles
 // off of this function (e.g. Teensy, Arduino Nano 33 BLE, Portenta, etc)
 //
 #ifdef HAS_SIMD
+    uint32_t ulPixel1, ulPixel2;
     uint32_t ulCbCr = (iCb | (iCr << 16));
     uint32_t ulTmp2, ulTmp = -1409 | (-2925 << 16);    // for green calc
     ulCbCr = __SSUB16(ulCbCr, 0x00800080);             // dual 16-bit subtraction
@@ -2735,25 +3182,90 @@ static void JPEGPixel2LE(uint16_t *pDest, int iY1, int iY2, int iCb, int iCr)
     ulTmp = __USAT16(ulTmp | (ulTmp2 << 16), 5);    // range limit both to 5 bits
     ulPixel1 |= (ulTmp << 11);                      // now we have R + G + B
     *(uint32_t *)&pDest[0] = ulPixel1;
+#elif defined(HAS_DSP)
+    JPEGPixel2LE_DSP(pDest, iY1, iY2, iCb, iCr);
 #else
-    int iCBB, iCBG, iCRG, iCRR;
-    iCBB = 7258 * (iCb - 0x80);
-    iCBG = -1409 * (iCb - 0x80);
-    iCRG = -2925 * (iCr - 0x80);
-    iCRR = 5742 * (iCr - 0x80);
-    ulPixel1 = usRangeTableB[((iCBB + iY1) >> 12) & 0x3ff];            // blue pixel
-    ulPixel1 |= usRangeTableG[((iCBG + iCRG + iY1) >> 12) & 0x3ff];    // green pixel
-    ulPixel1 |= usRangeTableR[((iCRR + iY1) >> 12) & 0x3ff];           // red pixel
-
-    ulPixel2 = usRangeTableB[((iCBB + iY2) >> 12) & 0x3ff];            // blue pixel
-    ulPixel2 |= usRangeTableG[((iCBG + iCRG + iY2) >> 12) & 0x3ff];    // green pixel
-    ulPixel2 |= usRangeTableR[((iCRR + iY2) >> 12) & 0x3ff];           // red pixel
-    *(uint32_t *)&pDest[0] = (ulPixel1 | (ulPixel2 << 16));
+    JPEGPixel2LE_C(pDest, iY1, iY2, iCb, iCr);
 #endif
 } /* JPEGPixel2LE() */
+//
+// Compare the DSP kernels against the C reference code and time both
+// Y covers the full-size (Y << 12) and 1/2 scale averaged (sum << 10) inputs,
+// the IDCT sums go well past the 10-bit table range to check the wrap around
+// Returns the number of mismatches, or -1 if the DSP kernels aren't built in
+//
+JPEG_STATIC int JPEG_dspSelfTest(JPEGDSPSTATS *pStats, JPEG_CYCLES_CALLBACK *pfnCycles)
+{
+    memset(pStats, 0, sizeof(JPEGDSPSTATS));
+#ifdef HAS_DSP
+    uint32_t u32Ref[4], u32Dsp[4];
+    uint32_t u32Start;
+    int iY, iCb, iCr, i;
+
+    // pixel conversion - every chroma pair on a 15 step grid, every Y step
+    for (iCb = 0; iCb <= 255; iCb += 15) {
+        for (iCr = 0; iCr <= 255; iCr += 15) {
+            for (iY = 0; iY <= (1020 << 10); iY += (1 << 10)) {
+                JPEGPixel2LE_C((uint16_t *)&u32Ref[0], iY, (1020 << 10) - iY, iCb, iCr);
+                JPEGPixel2LE_DSP((uint16_t *)&u32Dsp[0], iY, (1020 << 10) - iY, iCb, iCr);
+                JPEGPixelLE_C((uint16_t *)&u32Ref[1], iY, iCb, iCr);
+                JPEGPixelLE_DSP((uint16_t *)&u32Dsp[1], iY, iCb, iCr);
+                pStats->iPixelsChecked += 3;
+                if (u32Ref[0] != u32Dsp[0] || (uint16_t)u32Ref[1] != (uint16_t)u32Dsp[1]) {
+                    pStats->iMismatches++;
+                }
+            }
+        }
+    }
+    // IDCT output stage - sums from -65536 to 65535 (table index wraps past +/-16384)
+    for (i = -65536; i < 65536; i += 8 * 7) {
+        JPEGRangeLimitRow_C((uint8_t *)u32Ref, i, i + 7, i + 14, i + 21, -i, -i - 7, -i - 14, -i - 21);
+        JPEGRangeLimitRow_DSP((uint8_t *)u32Dsp, i, i + 7, i + 14, i + 21, -i, -i - 7, -i - 14, -i - 21);
+        pStats->iPixelsChecked += 8;
+        if (u32Ref[0] != u32Dsp[0] || u32Ref[1] != u32Dsp[1]) {
+            pStats->iMismatches++;
+        }
+    }
+
+    if (pfnCycles) {
+        // one 16x16 4:2:0 MCU worth of pixel pairs, JPEG_DSP_BENCH_LOOPS times
+        u32Start = (*pfnCycles)();
+        for (i = 0; i < JPEG_DSP_BENCH_LOOPS * 128; i++) {
+            JPEGPixel2LE_C((uint16_t *)&u32Ref[i & 3], (i & 255) << 12, ((i >> 2) & 255) << 12, i & 255, (i >> 3) & 255);
+        }
+        pStats->u32PixelRefCycles = (*pfnCycles)() - u32Start;
+        u32Start = (*pfnCycles)();
+        for (i = 0; i < JPEG_DSP_BENCH_LOOPS * 128; i++) {
+            JPEGPixel2LE_DSP((uint16_t *)&u32Dsp[i & 3], (i & 255) << 12, ((i >> 2) & 255) << 12, i & 255, (i >> 3) & 255);
+        }
+        pStats->u32PixelDspCycles = (*pfnCycles)() - u32Start;
+        // one 8x8 block (8 rows) of IDCT output, JPEG_DSP_BENCH_LOOPS times
+        u32Start = (*pfnCycles)();
+        for (i = 0; i < JPEG_DSP_BENCH_LOOPS * 8; i++) {
+            JPEGRangeLimitRow_C((uint8_t *)&u32Ref[(i & 1) << 1], i, i << 1, -i, i << 2, i << 3, -(i << 2), i << 4, -(i << 3));
+        }
+        pStats->u32IDCTRefCycles = (*pfnCycles)() - u32Start;
+        u32Start = (*pfnCycles)();
+        for (i = 0; i < JPEG_DSP_BENCH_LOOPS * 8; i++) {
+            JPEGRangeLimitRow_DSP((uint8_t *)&u32Dsp[(i & 1) << 1], i, i << 1, -i, i << 2, i << 3, -(i << 2), i << 4, -(i << 3));
+        }
+        pStats->u32IDCTDspCycles = (*pfnCycles)() - u32Start;
+        if (memcmp(u32Ref, u32Dsp, sizeof(u32Ref)) != 0) {
+            pStats->iMismatches++;
+        }
+    }
+    return pStats->iMismatches;
+#else
+    (void)pfnCycles;
+    return -1;
+#endif    // HAS_DSP
+} /* JPEG_dspSelfTest() */
 
 static void JPEGPixel2BE(uint16_t *pDest, int32_t iY1, int32_t iY2, int32_t iCb, int32_t iCr)
 {
+#ifdef HAS_DSP
+    *(uint32_t *)&pDest[0] = __rev16(JPEGPixelPair_DSP(iY1, iY2, iCb, iCr));
+#else
     int32_t iCBB, iCBG, iCRG, iCRR;
     uint32_t ulPixel1, ulPixel2;
 
@@ -2769,6 +3281,7 @@ static void JPEGPixel2BE(uint16_t *pDest, int32_t iY1, int32_t iY2, int32_t iCb,
     ulPixel2 |= usRangeTableG[((iCBG + iCRG + iY2) >> 12) & 0x3ff];    // green pixel
     ulPixel2 |= usRangeTableR[((iCRR + iY2) >> 12) & 0x3ff];           // red pixel
     *(uint32_t *)&pDest[0] = __builtin_bswap16(ulPixel1) | ((uint32_t)__builtin_bswap16(ulPixel2) << 16);
+#endif
 } /* JPEGPixel2BE() */
 
 static void JPEGPixel2RGB(uint32_t *pDest, int32_t iY1, int32_t iY2, int32_t iCb, int32_t iCr)
@@ -4421,7 +4934,19 @@ static void JPEGDither(JPEGIMAGE *pJPEG, int iWidth, int iHeight)
 //
 static int DecodeJPEG(JPEGIMAGE *pJPEG)
 {
-    int cx, cy, x, y, mcuCX, mcuCY;
+    pJPEG->ucDecodeState = JPEG_DECODE_START;
+    return (JPEGDecodeRows(pJPEG, 0x7fffffff) == 0);    // all rows in one go
+} /* DecodeJPEG() */
+//
+// Decode up to iMaxRows rows of MCUs, continuing where the previous call stopped
+// (JPEG_DECODE_START begins a new image). The bit buffer, restart count and DC
+// predictors live in JPEGIMAGE between calls.
+// Returns the number of MCU rows still to decode (0 = finished), or -1 on error
+//
+static int JPEGDecodeRows(JPEGIMAGE *pJPEG, int iMaxRows)
+{
+    int cx, cy, x, y, mcuCX, mcuCY, iRows, bStart;
+    int cx0, cy0, cx1, cy1, iLumBlocks;    // MCU columns/rows inside the crop area
     int iLum0, iLum1, iLum2, iLum3, iCr, iCb;
     signed int iDCPred0, iDCPred1, iDCPred2;
     int i, iQuant1, iQuant2, iQuant3, iErr;
@@ -4433,15 +4958,25 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
     JPEGDRAW jd;
     int iMaxFill = 16, iScaleShift = 0;
 
+    if (pJPEG->ucDecodeState == JPEG_DECODE_IDLE) {    // decodeStart() not called
+        pJPEG->iError = JPEG_INVALID_PARAMETER;
+        return -1;
+    }
+    if (pJPEG->ucDecodeState == JPEG_DECODE_DONE) {
+        return 0;
+    }
+    bStart = (pJPEG->ucDecodeState == JPEG_DECODE_START);
     // Requested the Exif thumbnail
-    if (pJPEG->iOptions & JPEG_EXIF_THUMBNAIL) {
+    if (bStart && (pJPEG->iOptions & JPEG_EXIF_THUMBNAIL)) {
         if (pJPEG->iThumbData == 0 || pJPEG->iThumbWidth == 0)    // doesn't exist
         {
             pJPEG->iError = JPEG_INVALID_PARAMETER;
-            return 0;
+            pJPEG->ucDecodeState = JPEG_DECODE_DONE;
+            return -1;
         }
         if (!JPEGParseInfo(pJPEG, 1)) {    // parse the embedded thumbnail file header
-            return 0;                      // something went wrong
+            pJPEG->ucDecodeState = JPEG_DECODE_DONE;
+            return -1;    // something went wrong
         }
     }
     // Fast downscaling options
@@ -4456,11 +4991,13 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
         bThumbnail = 1;
     }
 
-    // reorder and fix the quantization table for decoding
-    JPEGFixQuantD(pJPEG);
-    pJPEG->bb.ulBits = MOTOLONG(&pJPEG->ucFileBuf[0]);    // preload first 4/8 bytes
-    pJPEG->bb.pBuf = pJPEG->ucFileBuf;
-    pJPEG->bb.ulBitOff = 0;
+    if (bStart) {
+        // reorder and fix the quantization table for decoding
+        JPEGFixQuantD(pJPEG);
+        pJPEG->bb.ulBits = MOTOLONG(&pJPEG->ucFileBuf[0]);    // preload first 4/8 bytes
+        pJPEG->bb.pBuf = pJPEG->ucFileBuf;
+        pJPEG->bb.ulBitOff = 0;
+    }
 
     cDCTable0 = pJPEG->JPCI[0].dc_tbl_no;
     cACTable0 = pJPEG->JPCI[0].ac_tbl_no;
@@ -4509,6 +5046,16 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
             iCr = iCb = 0;
             break;
     }
+    cx0 = cy0 = 0;
+    cx1 = cx;
+    cy1 = cy;
+    if (pJPEG->iCropCX > 0 && !(pJPEG->iOptions & JPEG_EXIF_THUMBNAIL)) {    // crop area is MCU aligned
+        cx0 = pJPEG->iCropX / mcuCX;
+        cy0 = pJPEG->iCropY / mcuCY;
+        cx1 = (pJPEG->iCropX + pJPEG->iCropCX + mcuCX - 1) / mcuCX;
+        cy1 = (pJPEG->iCropY + pJPEG->iCropCY + mcuCY - 1) / mcuCY;
+    }
+    iLumBlocks = (pJPEG->ucSubSample == 0x22) ? 4 : ((pJPEG->ucSubSample > 0x11) ? 2 : 1);
     // Scale down the MCUs by the requested amount
     mcuCX >>= iScaleShift;
     mcuCY >>= iScaleShift;
@@ -4522,7 +5069,6 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
     iLum2 = MCU2;
     iLum3 = MCU3;
     iErr = 0;
-    pJPEG->iResCount = pJPEG->iResInterval;
     // Calculate how many MCUs we can fit in the pixel buffer to maximize LCD drawing speed
     iMCUCount = MAX_BUFFERED_PIXELS / (mcuCX * mcuCY);
     if (pJPEG->ucPixelType == RGB8888) {
@@ -4531,14 +5077,14 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
     if (pJPEG->ucPixelType == EIGHT_BIT_GRAYSCALE) {
         iMCUCount *= 2;    // each pixel is only 1 byte
     }
-    if (iMCUCount > cx) {
-        iMCUCount = cx;    // don't go wider than the image
+    if (iMCUCount > cx1 - cx0) {
+        iMCUCount = cx1 - cx0;    // don't go wider than the image (or crop area)
     }
     if (iMCUCount > pJPEG->iMaxMCUs) {    // did the user set an upper bound on how many pixels per JPEGDraw callback?
         iMCUCount = pJPEG->iMaxMCUs;
     }
     if (pJPEG->ucPixelType > EIGHT_BIT_GRAYSCALE) {    // dithered, override the max MCU count
-        iMCUCount = cx;                                // do the whole row
+        iMCUCount = cx1 - cx0;                         // do the whole row
     }
     jd.iBpp = 16;
     switch (pJPEG->ucPixelType) {
@@ -4564,21 +5110,33 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
         jd.pPixels = pJPEG->usPixels;
     }
     jd.iHeight = mcuCY;
-    jd.y = pJPEG->iYOffset;
-    for (y = 0; y < cy && bContinue && iErr == 0; y++, jd.y += mcuCY) {
+    if (bStart) {
+        pJPEG->iResCount = pJPEG->iResInterval;
+        y = cy0;
+        if (cy0 || cx0) {    // pass over the MCUs above and to the left of the crop area
+            iErr = JPEGSkipMCUs(pJPEG, cy0 * cx + cx0, iLumBlocks, &iDCPred0, &iDCPred1, &iDCPred2);
+        }
+    } else {    // pick up where the last call stopped
+        y = pJPEG->iDecodeRow;
+        iDCPred0 = pJPEG->iDCPred[0];
+        iDCPred1 = pJPEG->iDCPred[1];
+        iDCPred2 = pJPEG->iDCPred[2];
+    }
+    jd.y = pJPEG->iYOffset + (y - cy0) * mcuCY;
+    for (iRows = 0; y < cy1 && iRows < iMaxRows && bContinue && iErr == 0; y++, iRows++, jd.y += mcuCY) {
         jd.x = pJPEG->iXOffset;
         xoff = 0;                                     // start of new LCD output group
         if (pJPEG->pFramebuffer) {                    // user-supplied buffer is full width
-            iPitch = (pJPEG->iWidth + 7) & 0xfff8;    // must be 16-byte aligned
+            iPitch = pJPEG->iFBPitch ? pJPEG->iFBPitch : (pJPEG->iWidth + 7) & 0xfff8;    // must be 16-byte aligned
             pJPEG->usPixels = (uint16_t *)pJPEG->pFramebuffer;
-            pJPEG->usPixels += (y * mcuCY * iPitch);
+            pJPEG->usPixels += ((y - cy0) * mcuCY * iPitch);
             if (pJPEG->ucPixelType == RGB8888) {    // iPitch is 1/2
-                pJPEG->usPixels += (y * mcuCY * iPitch);
+                pJPEG->usPixels += ((y - cy0) * mcuCY * iPitch);
             }
         } else {                           // use our internal buffer to do it a block at a time
             iPitch = iMCUCount * mcuCX;    // pixels per line of LCD buffer
         }
-        for (x = 0; x < cx && bContinue && iErr == 0; x++) {
+        for (x = cx0; x < cx1 && bContinue && iErr == 0; x++) {
             pJPEG->ucACTable = cACTable0;
             pJPEG->ucDCTable = cDCTable0;
             // do the first luminance component
@@ -4697,44 +5255,45 @@ static int DecodeJPEG(JPEGIMAGE *pJPEG)
                 }    // switch on color option
             }
             xoff += mcuCX;
-            if (pJPEG->pFramebuffer == NULL && (xoff == iPitch || x == cx - 1))    // time to draw
+            if (pJPEG->pFramebuffer == NULL && (xoff == iPitch || x == cx1 - 1))    // time to draw
             {
                 xoff = 0;
                 jd.iWidth = jd.iWidthUsed = iPitch;    // width of each LCD block group
                 jd.pUser = pJPEG->pUser;
                 if (pJPEG->ucPixelType > EIGHT_BIT_GRAYSCALE) {    // dither to 4/2/1 bits
-                    JPEGDither(pJPEG, cx * mcuCX, mcuCY);
+                    JPEGDither(pJPEG, (cx1 - cx0) * mcuCX, mcuCY);
                 }
                 if ((x + 1) * mcuCX > pJPEG->iWidth) {    // right edge has clipped pixels
                     jd.iWidthUsed = iPitch - (cx * mcuCX - pJPEG->iWidth);
                 }
-                if ((jd.y - pJPEG->iYOffset + mcuCY) > (pJPEG->iHeight >> iScaleShift)) {    // last row needs to be trimmed
-                    jd.iHeight = (pJPEG->iHeight >> iScaleShift) - (jd.y - pJPEG->iYOffset);
+                if (((y + 1) * mcuCY) > (pJPEG->iHeight >> iScaleShift)) {    // last row needs to be trimmed
+                    jd.iHeight = (pJPEG->iHeight >> iScaleShift) - (y * mcuCY);
                 }
                 bContinue = (*pJPEG->pfnDraw)(&jd);
                 jd.x += iPitch;
-                if ((cx - 1 - x) < iMCUCount) {    // change pitch for the last set of MCUs on this row
-                    iPitch = (cx - 1 - x) * mcuCX;
+                if ((cx1 - 1 - x) < iMCUCount) {    // change pitch for the last set of MCUs on this row
+                    iPitch = (cx1 - 1 - x) * mcuCX;
                 }
             }
-            if (pJPEG->iResInterval) {
-                if (--pJPEG->iResCount == 0) {
-                    pJPEG->iResCount = pJPEG->iResInterval;
-                    iDCPred0 = iDCPred1 = iDCPred2 = 0;    // reset DC predictors
-                    if (pJPEG->bb.ulBitOff & 7)            // need to start at the next even byte
-                    {
-                        pJPEG->bb.ulBitOff += (8 - (pJPEG->bb.ulBitOff & 7));    // new restart interval starts on byte boundary
-                    }
-                }    // if restart interval needs to reset
-            }        // if there is a restart interval
-            // See if we need to feed it more data
-            if (pJPEG->iVLCOff >= FILE_HIGHWATER) {
-                JPEGGetMoreData(pJPEG);    // need more 'filtered' VLC data
-            }
+            JPEGNextMCU(pJPEG, &iDCPred0, &iDCPred1, &iDCPred2);
         }    // for x
+        if (y < cy1 - 1 && cx1 - cx0 < cx && bContinue && iErr == 0) {    // right of this row + left of the next
+            iErr = JPEGSkipMCUs(pJPEG, cx - cx1 + cx0, iLumBlocks, &iDCPred0, &iDCPred1, &iDCPred2);
+        }
     }        // for y
     if (iErr != 0) {
         pJPEG->iError = JPEG_DECODE_ERROR;
+        pJPEG->ucDecodeState = JPEG_DECODE_DONE;
+        return -1;
     }
-    return (iErr == 0);
-} /* DecodeJPEG() */
+    if (!bContinue || y >= cy1) {    // finished (or the DRAW callback asked to stop)
+        pJPEG->ucDecodeState = JPEG_DECODE_DONE;
+        return 0;
+    }
+    pJPEG->ucDecodeState = JPEG_DECODE_RUNNING;
+    pJPEG->iDecodeRow = y;
+    pJPEG->iDCPred[0] = iDCPred0;
+    pJPEG->iDCPred[1] = iDCPred1;
+    pJPEG->iDCPred[2] = iDCPred2;
+    return cy1 - y;
+} /* JPEGDecodeRows() */